@@ -0,0 +1,1938 @@
+#!/usr/bin/env python3
+"""
+Bench simulator — the whole workbench without a Pi, hubs, radio or DUTs.
+
+Runs the unmodified portal against simulated hardware, for offline tests
+and for throughput/latency benchmarks in CI on a plain Linux box:
+
+  - DUTs are pty pairs (/dev/pts/N behind a sim-dir/dev/ttyUSBn symlink)
+    that emit an ESP32 boot log, heartbeats and BOOTREC records. DTR/RTS
+    and the slot's BOOT/EN GPIOs reach the DUT over a per-port control
+    socket, so serial resets, download mode and GPIO recovery behave.
+  - Flashing: in download mode a DUT speaks the ROM loader / flasher stub
+    protocol over its pty into a 4 MB flash array; the portal's flash
+    workers import SimEspLoader as "esptool" and drive it unchanged.
+    ttyUSB DUTs sit behind a simulated FTDI bridge (sysfs tree under
+    sim-dir/sys) whose latency_timer delays every loader response.
+  - Hotplug: plug()/unplug() and replay() of recorded uevent traces post
+    synthetic uevents to /api/hotplug (HOTPLUG_SOURCE=none).
+  - WiFi: hostapd, dnsmasq, wpa_supplicant, wpa_passphrase, wpa_cli, iw,
+    ip and dhclient are shims on PATH keeping state in the sim dir;
+    wifi_controller runs its normal command lines against them. Stations
+    join the AP through dnsmasq's lease events, scans list the scenario
+    networks, and sta_join checks the WPA passphrase.
+  - BLE: a fake bleak module; each booted DUT advertises "WB-Test" with
+    the Nordic UART service, and writes show up in its serial log.
+  - UDP logs: each DUT sends its log lines from its own 127.0.0.x address.
+  - Unconfigured DUTs (auto_slots=N, "USBn") have no slots.json entry:
+    the portal gives them ports from a free AUTO_PORTS range and starts
+    their proxies on first connect.
+
+The portal runs in a child process (portal.main(), module globals pointed
+at the sim: port, proxy wrapper, GPIO backend, WiFi work dir); the
+RFC2217 proxies it starts are the real plain_rfc2217_server.py.
+
+Usage:
+    python3 bench_sim.py serve [--slots 3] [--port 8080]
+    python3 bench_sim.py bench [--slots 3] [--auto-slots 0] [--json out.json]
+                               [--baseline base.json] [--max-slowdown 1.5]
+"""
+
+import hashlib
+import heapq
+import itertools
+import json
+import os
+import pty
+import random
+import re
+import selectors
+import shutil
+import signal
+import socket
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+import termios
+import threading
+import time
+import traceback
+import tty
+import types
+import zlib
+
+import uevent_monitor
+
+# asyncio, http.client and argparse are imported where used: the tool shims
+# import this module on every hostapd/ip/iw call and should start fast.
+
+PI_DIR = os.path.dirname(os.path.abspath(__file__))
+
+GPIO_PAIRS = [(18, 17), (22, 23), (24, 25), (26, 27), (20, 21), (12, 13), (5, 6), (16, 19)]
+STARTUP_TIMEOUT_S = 15
+OUT_MAX = 256 * 1024          # DUT output queued while nobody reads the port
+
+FW_VERSION = "0.1.0"
+FLASH_SIZE = 4 * 1024 * 1024
+APP_OFFSET = 0x10000
+CHIP_NAME = "ESP32-C3"
+CHIP_MAGIC = 0x1B31506F         # value of CHIP_DETECT_MAGIC_REG on an ESP32-C3
+CHIP_MAGIC_REG = 0x40001000
+FTDI_LATENCY_MS = 16            # ftdi_sio's default latency_timer
+BLE_NAME = "WB-Test"
+NUS_SERVICE = "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
+NUS_RX = "6e400002-b5a3-f393-e0a9-e50e24dcca9e"
+NUS_TX = "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
+
+# Recorded ESP32-C3 boot with the test firmware. ROM lines go out at reset,
+# "I (ms)" lines at their timestamp; {rst} and {boot} are filled per reset.
+BOOT_LOG = """\
+ESP-ROM:esp32c3-api1-20210207
+Build:Feb  7 2021
+rst:{rst},boot:{boot}
+SPIWP:0xee
+mode:DIO, clock div:1
+load:0x3fcd5820,len:0x1714
+load:0x403cc710,len:0x968
+load:0x403ce710,len:0x2f9c
+entry 0x403cc710
+I (24) boot: ESP-IDF v5.1.2 2nd stage bootloader
+I (24) boot: compile time Jan 12 2026 10:02:11
+I (25) boot: chip revision: v0.4
+I (29) boot.esp32c3: SPI Speed      : 80MHz
+I (34) boot.esp32c3: SPI Mode       : DIO
+I (38) boot.esp32c3: SPI Flash Size : 4MB
+I (64) boot: Loaded app from partition at offset 0x10000
+I (253) cpu_start: Unicore app
+I (287) cpu_start: Pro cpu start user code
+I (312) app_main: === Workbench Test Firmware v0.1.0 ===
+I (455) app_main: Waiting for WiFi STA connection before starting BLE...
+I (1480) wifi_prov: got ip:192.168.4.2
+I (1491) app_main: Init complete, running event-driven
+"""
+
+BOOT_NORMAL = "0x28 (SPI_FAST_FLASH_BOOT)"
+BOOT_DOWNLOAD = "0x23 (DOWNLOAD(USB/UART0))"
+# reset cause -> (ROM rst: field, esp_reset_reason name in BOOTREC)
+RESETS = {
+    "poweron": ("0x1 (POWERON)", "poweron"),
+    "en":      ("0x1 (POWERON)", "poweron"),
+    "usb":     ("0x15 (USB_UART_CHIP_RESET)", "ext"),
+    "panic":   ("0xc (RTC_SW_CPU_RST)", "panic"),
+}
+
+DEFAULT_NETWORKS = [
+    {"ssid": "SimNet", "password": "simpass123", "rssi": -48, "channel": 6,
+     "ip": "192.168.50.23/24", "gateway": "192.168.50.1"},
+    {"ssid": "SimOpen", "password": "", "rssi": -71, "channel": 11,
+     "ip": "10.0.0.23/24", "gateway": "10.0.0.1"},
+]
+DEFAULT_STATIONS = [{"mac": "24:0a:c4:00:01:01", "hostname": "wb-test", "delay_s": 0.3}]
+
+
+# ---------------------------------------------------------------------------
+# Helpers
+# ---------------------------------------------------------------------------
+
+def _free_port(kind=socket.SOCK_STREAM) -> int:
+    s = socket.socket(socket.AF_INET, kind)
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def _free_port_range(count: int) -> tuple[int, int]:
+    """*count* consecutive TCP ports that are free right now."""
+    for _ in range(200):
+        base = random.randrange(20000, 60000 - count)
+        socks = []
+        try:
+            for port in range(base, base + count):
+                s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                socks.append(s)
+                s.bind(("", port))
+            return base, base + count - 1
+        except OSError:
+            continue
+        finally:
+            for s in socks:
+                s.close()
+    raise RuntimeError(f"no {count} free consecutive ports")
+
+
+def _write_json(path: str, data):
+    """Atomic JSON write (the shims and the portal read these concurrently)."""
+    tmp = f"{path}.{os.getpid()}.tmp"
+    with open(tmp, "w") as f:
+        json.dump(data, f)
+    os.replace(tmp, path)
+
+
+def _read_json(path: str, default=None):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return default
+
+
+def _ctl_path(sim_dir: str, pts: str) -> str:
+    """Control socket of the simulated DUT behind pty *pts*."""
+    return os.path.join(sim_dir, "lines", pts.replace("/dev/", "").replace("/", "-"))
+
+
+def _send_ctl(path: str, msg: str):
+    try:
+        with socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM) as s:
+            s.sendto(msg.encode(), path)
+    except OSError:
+        pass        # device gone
+
+
+def _psk(ssid: str, password: str) -> str:
+    return hashlib.pbkdf2_hmac("sha1", password.encode(), ssid.encode(), 4096, 32).hex()
+
+
+# ---------------------------------------------------------------------------
+# Modem lines (DTR/RTS) on ptys
+# ---------------------------------------------------------------------------
+
+class _ModemLines:
+    """Stand-in for the fcntl module inside serial.serialposix.
+
+    A pty has no modem lines, so TIOCM* ioctls on a simulated port become
+    "dtr 1" / "rts 0" datagrams to the device's control socket; everything
+    else goes to the real fcntl.
+    """
+
+    _REQUESTS = (termios.TIOCMBIS, termios.TIOCMBIC, termios.TIOCMSET, termios.TIOCMGET)
+
+    def __init__(self, real, sim_dir: str):
+        self._real = real
+        self._sim_dir = sim_dir
+        self._bits: dict[str, int] = {}
+
+    def __getattr__(self, name):
+        return getattr(self._real, name)
+
+    def ioctl(self, fd, request, arg=0, *rest):
+        if request in self._REQUESTS:
+            try:
+                path = _ctl_path(self._sim_dir, os.ttyname(fd))
+            except OSError:
+                path = None
+            if path and os.path.exists(path):
+                return self._modem(path, request, arg)
+        return self._real.ioctl(fd, request, arg, *rest)
+
+    def _modem(self, path, request, arg):
+        old = self._bits.get(path, 0)
+        if request == termios.TIOCMGET:
+            return struct.pack("I", old | termios.TIOCM_CTS | termios.TIOCM_DSR | termios.TIOCM_CAR)
+        bits = struct.unpack("I", arg)[0]
+        if request == termios.TIOCMBIS:
+            new, touched = old | bits, bits
+        elif request == termios.TIOCMBIC:
+            new, touched = old & ~bits, bits
+        else:
+            new, touched = bits, termios.TIOCM_DTR | termios.TIOCM_RTS
+        self._bits[path] = new
+        for name, mask in (("dtr", termios.TIOCM_DTR), ("rts", termios.TIOCM_RTS)):
+            if touched & mask:
+                _send_ctl(path, f"{name} {int(bool(new & mask))}")
+        return arg
+
+
+def patch_modem_lines(sim_dir: str | None = None):
+    """Route pyserial's DTR/RTS on simulated ports to the devices."""
+    import serial.serialposix as serialposix
+    sim_dir = sim_dir or os.environ["BENCH_SIM_DIR"]
+    if not isinstance(serialposix.fcntl, _ModemLines):
+        serialposix.fcntl = _ModemLines(serialposix.fcntl, sim_dir)
+
+
+# ---------------------------------------------------------------------------
+# Event loop — one thread drives every simulated device
+# ---------------------------------------------------------------------------
+
+class _Loop:
+    def __init__(self):
+        self._sel = selectors.DefaultSelector()
+        self._timers: list = []
+        self._seq = itertools.count()
+        self._lock = threading.Lock()
+        self._wake_r, self._wake_w = os.pipe()
+        os.set_blocking(self._wake_r, False)
+        os.set_blocking(self._wake_w, False)
+        self._handlers: dict[int, list] = {}
+        self._sel.register(self._wake_r, selectors.EVENT_READ)
+        self._stop = False
+        self._thread = threading.Thread(target=self._run, daemon=True, name="bench-sim")
+
+    def start(self):
+        self._thread.start()
+
+    def stop(self):
+        self._stop = True
+        self._wake()
+        self._thread.join(5)
+
+    def _wake(self):
+        try:
+            os.write(self._wake_w, b"x")
+        except BlockingIOError:
+            pass
+
+    def call_at(self, t: float, fn, *args):
+        with self._lock:
+            heapq.heappush(self._timers, (t, next(self._seq), fn, args))
+        if threading.current_thread() is not self._thread:
+            self._wake()
+
+    def call_later(self, delay: float, fn, *args):
+        self.call_at(time.monotonic() + delay, fn, *args)
+
+    def call_soon(self, fn, *args):
+        self.call_at(0, fn, *args)
+
+    def _watch(self, fd: int, reader=None, writer=None, *, set_writer=False):
+        """Register fd callbacks (readers before start(), writers from the loop)."""
+        h = self._handlers.setdefault(fd, [None, None])
+        if reader:
+            h[0] = reader
+        if set_writer:
+            h[1] = writer
+        mask = (selectors.EVENT_READ if h[0] else 0) | (selectors.EVENT_WRITE if h[1] else 0)
+        try:
+            self._sel.modify(fd, mask, fd)
+        except KeyError:
+            self._sel.register(fd, mask, fd)
+
+    def add_reader(self, fd: int, fn):
+        self._watch(fd, reader=fn)
+
+    def set_writer(self, fd: int, fn):
+        self._watch(fd, writer=fn, set_writer=True)
+
+    def _run(self):
+        while not self._stop:
+            now = time.monotonic()
+            due = []
+            with self._lock:
+                while self._timers and self._timers[0][0] <= now:
+                    due.append(heapq.heappop(self._timers))
+                timeout = self._timers[0][0] - now if self._timers else None
+            for _, _, fn, args in due:
+                self._call(fn, *args)
+            if due:
+                continue
+            for key, events in self._sel.select(timeout):
+                if key.data is None:
+                    try:
+                        os.read(self._wake_r, 4096)
+                    except BlockingIOError:
+                        pass
+                    continue
+                reader, writer = self._handlers[key.data]
+                if events & selectors.EVENT_READ and reader:
+                    self._call(reader)
+                if events & selectors.EVENT_WRITE and writer:
+                    self._call(writer)
+
+    @staticmethod
+    def _call(fn, *args):
+        try:
+            fn(*args)
+        except Exception:
+            traceback.print_exc()
+
+
+# ---------------------------------------------------------------------------
+# Simulated DUT
+# ---------------------------------------------------------------------------
+
+class UdpLogSource:
+    """A DUT's UDP log stream (udp_log.c), sent from its own address."""
+
+    def __init__(self, ip: str, port: int):
+        self.ip = ip
+        self.port = port
+        self._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self._sock.bind((ip, 0))
+
+    def send(self, line: str):
+        try:
+            self._sock.sendto(line.encode() + b"\n", ("127.0.0.1", self.port))
+        except OSError:
+            pass
+
+    def close(self):
+        self._sock.close()
+
+
+def _slip(packet: bytes) -> bytes:
+    return b"\xc0" + packet.replace(b"\xdb", b"\xdb\xdd").replace(b"\xc0", b"\xdb\xdc") + b"\xc0"
+
+
+class _SlipReader:
+    """Splits a byte stream into SLIP frames; bytes outside frames
+    (boot messages) are dropped."""
+
+    def __init__(self):
+        self._frame: bytearray | None = None
+        self._esc = False
+
+    def feed(self, data: bytes) -> list:
+        frames = []
+        for b in data:
+            if b == 0xC0:
+                if self._frame:
+                    frames.append(bytes(self._frame))
+                    self._frame = None
+                else:
+                    self._frame = bytearray()
+            elif self._frame is None:
+                continue
+            elif self._esc:
+                self._frame.append({0xDC: 0xC0, 0xDD: 0xDB}.get(b, b))
+                self._esc = False
+            elif b == 0xDB:
+                self._esc = True
+            else:
+                self._frame.append(b)
+        return frames
+
+
+def _checksum(data: bytes) -> int:
+    state = 0xEF
+    for b in data:
+        state ^= b
+    return state
+
+
+class _Loader:
+    """Download mode of a simulated DUT: the serial protocol of the ROM
+    loader and, once "uploaded", the esptool flasher stub — enough commands
+    to connect, change baud, flash (plain or deflated) and MD5-verify.
+    Replies are paced at the current baud unless the port is native USB."""
+
+    SYNC, READ_REG, WRITE_REG, GET_SECURITY_INFO = 0x08, 0x0A, 0x09, 0x14
+    MEM_BEGIN, MEM_END, MEM_DATA = 0x05, 0x06, 0x07
+    FLASH_BEGIN, FLASH_DATA, FLASH_END = 0x02, 0x03, 0x04
+    FLASH_DEFL_BEGIN, FLASH_DEFL_DATA, FLASH_DEFL_END = 0x10, 0x11, 0x12
+    SPI_SET_PARAMS, SPI_ATTACH, CHANGE_BAUDRATE, SPI_FLASH_MD5 = 0x0B, 0x0D, 0x0F, 0x13
+
+    def __init__(self, dev: "SimDevice"):
+        self.dev = dev
+        self.stub = False
+        self.baud = 115200
+        self._reader = _SlipReader()
+        self._write = None            # [offset, end, decompressobj or None]
+        self._free = 0.0              # UART busy until (monotonic)
+
+    def feed(self, data: bytes):
+        for frame in self._reader.feed(data):
+            if len(frame) >= 8 and frame[0] == 0x00:
+                self._command(frame)
+
+    def _send(self, packet: bytes, cost: int, epoch: int):
+        frame = _slip(packet)
+        at = time.monotonic()
+        if not self.dev.sim.native_usb:
+            at = self._free = max(at, self._free) + (cost + len(frame)) * 10 / self.baud
+        at += self.dev.bridge_latency_s()
+        self.dev.sim.loop.call_at(at, self.dev._queue, frame, epoch)
+
+    def _command(self, frame: bytes):
+        op, size, chk = struct.unpack_from("<BHI", frame, 1)
+        data = frame[8:8 + size]
+        try:
+            value, body = self._handle(op, data, chk)
+            status = b"\0\0" if self.stub else b"\0\0\0\0"
+        except _LoaderError as e:
+            value, body = 0, b""
+            status = bytes([1, e.code]) + (b"" if self.stub else b"\0\0")
+        epoch = self.dev._epoch
+        self._send(struct.pack("<BBHI", 1, op, len(body) + len(status), value) + body + status,
+                   len(frame), epoch)
+        if op == self.MEM_END and not self.stub:
+            self.stub = True
+            self._send(b"OHAI", 0, epoch)
+        elif op == self.CHANGE_BAUDRATE:
+            self.baud = struct.unpack_from("<I", data)[0]
+
+    def _flash(self, offset: int, data: bytes):
+        w = self._write
+        if w is None or offset + len(data) > min(w[1], FLASH_SIZE):
+            raise _LoaderError(0x06)
+        self.dev.flash[offset:offset + len(data)] = data
+        w[0] = offset + len(data)
+
+    def _handle(self, op: int, data: bytes, chk: int) -> tuple[int, bytes]:
+        flash = self.dev.flash
+        if op in (self.SYNC, self.WRITE_REG, self.SPI_ATTACH, self.SPI_SET_PARAMS,
+                  self.CHANGE_BAUDRATE, self.MEM_BEGIN, self.MEM_DATA, self.MEM_END):
+            return 0, b""
+        if op == self.READ_REG:
+            addr = struct.unpack_from("<I", data)[0]
+            return (CHIP_MAGIC if addr == CHIP_MAGIC_REG else 0), b""
+        if op == self.GET_SECURITY_INFO:
+            return 0, struct.pack("<IBBBBBBBBII", 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0)
+        if op in (self.FLASH_BEGIN, self.FLASH_DEFL_BEGIN):
+            erase, _, _, offset = struct.unpack_from("<IIII", data)
+            if op == self.FLASH_BEGIN and erase == 0:
+                self._write = None
+                return 0, b""
+            if offset % 0x1000 or offset + erase > FLASH_SIZE:
+                raise _LoaderError(0x06)
+            flash[offset:offset + erase] = b"\xff" * erase
+            self._write = [offset, offset + erase,
+                           zlib.decompressobj() if op == self.FLASH_DEFL_BEGIN else None]
+            return 0, b""
+        if op in (self.FLASH_DATA, self.FLASH_DEFL_DATA):
+            length = struct.unpack_from("<I", data)[0]
+            payload = data[16:16 + length]
+            if len(payload) != length or _checksum(payload) != chk:
+                raise _LoaderError(0x07)
+            w = self._write
+            if w is None or (op == self.FLASH_DEFL_DATA) != (w[2] is not None):
+                raise _LoaderError(0x05)
+            try:
+                chunk = w[2].decompress(payload) if w[2] else payload
+            except zlib.error:
+                raise _LoaderError(0xC1) from None
+            self._flash(w[0], chunk)
+            return 0, b""
+        if op in (self.FLASH_END, self.FLASH_DEFL_END):
+            return 0, b""
+        if op == self.SPI_FLASH_MD5:
+            addr, size = struct.unpack_from("<II", data)
+            if addr + size > FLASH_SIZE:
+                raise _LoaderError(0x06)
+            digest = hashlib.md5(flash[addr:addr + size])
+            return 0, digest.digest() if self.stub else digest.hexdigest().encode()
+        raise _LoaderError(0x05)
+
+
+class _LoaderError(Exception):
+    def __init__(self, code: int):
+        super().__init__(f"loader error 0x{code:02x}")
+        self.code = code
+
+
+class SimDevice:
+    """One ESP32 on a slot: a pty pair, its modem/GPIO lines and a UDP log.
+
+    All state changes run on the loop thread; the public methods schedule
+    onto it. Every reset bumps the epoch, which cancels output still queued
+    from the previous boot.
+    """
+
+    def __init__(self, sim: "BenchSim", index: int, configured: bool = True):
+        self.sim = sim
+        self.index = index
+        self.configured = configured
+        # unconfigured: the portal names it (AUTO<port>); USBn is the sim's name
+        self.label = f"SLOT{index}" if configured else f"USB{index}"
+        self.slot_key = f"platform-sim-usb-0:1.{index}:1.0"
+        name = f"ttyACM{index - 1}" if sim.native_usb else f"ttyUSB{index - 1}"
+        self.devpath = f"/devices/platform/sim/usb1/1-1/1-1.{index}/1-1.{index}:1.0/tty/{name}"
+        self.devnode = os.path.join(sim.dir, "dev", name)
+        self.ble_address = f"24:0A:C4:00:00:{index:02X}"
+        self.udp = UdpLogSource(f"127.0.0.{10 + index}", sim.udp_port)
+
+        self.master, self._slave = pty.openpty()
+        tty.setraw(self._slave)          # no echo: DUT output must not loop back
+        os.set_blocking(self.master, False)
+        self.pts = os.ttyname(self._slave)
+        self.ctl_path = _ctl_path(sim.dir, self.pts)
+        self._ctl = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        self._ctl.bind(self.ctl_path)
+        self._ctl.setblocking(False)
+
+        self.present = False
+        self.mode = "off"                # off, reset, app, download
+        self.boots = 0
+        self.resets: list[str] = []      # reset causes, oldest first
+        self._epoch = 0
+        self._boot_t = 0.0
+        self._lines = {"dtr": False, "rts": False, "en": True, "io0": True}
+        self._cause = "poweron"
+        self._out = bytearray()
+        self._uart_free = 0.0
+        self._tick = 0
+        self._prev_rec = None
+        self.rx_bytes = 0
+        self.flash = bytearray(b"\xff") * FLASH_SIZE
+        self._loader: _Loader | None = None
+        self._make_sysfs(name)
+
+        sim.loop.add_reader(self.master, self._on_input)
+        sim.loop.add_reader(self._ctl.fileno(), self._on_ctl)
+
+    def _make_sysfs(self, name: str):
+        """/sys/class/tty/<name>/device as serial_tuning sees it: an FTDI
+        FT232R (ftdi_sio, latency_timer) or an ESP32-C3's USB-Serial/JTAG."""
+        sysfs = os.path.join(self.sim.dir, "sys")
+        usb_dir = os.path.join(sysfs, "devices", "platform", "sim", "usb1", "1-1",
+                               f"1-1.{self.index}")
+        intf = os.path.join(usb_dir, f"1-1.{self.index}:1.0")
+        native = self.sim.native_usb
+        port = intf if native else os.path.join(intf, name)
+        driver = os.path.join(sysfs, "bus", "usb" if native else "usb-serial", "drivers",
+                              "cdc_acm" if native else "ftdi_sio")
+        for d in (port, driver, os.path.join(sysfs, "class", "tty", name)):
+            os.makedirs(d, exist_ok=True)
+        vid, pid, product = (("303a", "1001", "USB JTAG/serial debug unit") if native
+                             else ("0403", "6001", "FT232R USB UART"))
+        for attr, value in (("idVendor", vid), ("idProduct", pid), ("product", product),
+                            ("serial", f"SIM{self.index:04d}")):
+            with open(os.path.join(usb_dir, attr), "w") as f:
+                f.write(value + "\n")
+        os.symlink(driver, os.path.join(port, "driver"))
+        os.symlink(port, os.path.join(sysfs, "class", "tty", name, "device"))
+        self._latency_path = None if native else os.path.join(port, "latency_timer")
+        if self._latency_path:
+            with open(self._latency_path, "w") as f:
+                f.write(f"{FTDI_LATENCY_MS}\n")
+
+    def bridge_latency_s(self) -> float:
+        """The bridge holds a short packet until its latency timer expires."""
+        if not self._latency_path:
+            return 0.0
+        try:
+            with open(self._latency_path) as f:
+                return int(f.read()) / 1000
+        except (OSError, ValueError):
+            return FTDI_LATENCY_MS / 1000
+
+    def close(self):
+        for fd in (self.master, self._slave):
+            try:
+                os.close(fd)
+            except OSError:
+                pass
+        self._ctl.close()
+        self.udp.close()
+
+    # -- public (any thread) --
+
+    def power(self, on: bool):
+        """USB plug/unplug without the uevent (see BenchSim.plug)."""
+        if on:
+            if not os.path.lexists(self.devnode):
+                os.symlink(self.pts, self.devnode)
+        elif os.path.lexists(self.devnode):
+            os.remove(self.devnode)
+        self.sim.loop.call_soon(self._power, on)
+
+    def crash(self):
+        """Panic and reboot (rst:0xc, BOOTREC reset "panic")."""
+        self.sim.loop.call_soon(self._crash)
+
+    def flood(self, count: int, marker: str = "flood done"):
+        """Emit *count* log lines, then *marker*."""
+        self.sim.loop.call_soon(self._flood, count, marker)
+
+    # -- loop thread --
+
+    def _power(self, on: bool):
+        self.present = on
+        if on:
+            self._lines.update(dtr=False, rts=False, en=True, io0=True)
+            self._boot("poweron")
+        else:
+            self._epoch += 1
+            self.mode = "off"
+            self._out.clear()
+            self.sim._ble_changed()
+
+    def _ms(self) -> int:
+        return int((time.monotonic() - self._boot_t) * 1000)
+
+    def _emit(self, line: str, udp: bool = False, epoch: int | None = None):
+        if epoch is not None and epoch != self._epoch:
+            return
+        baud = self.sim.baud
+        data = line.encode() + b"\r\n"
+        if baud and not self.sim.native_usb:
+            # UART pacing: 10 bits per byte
+            now = time.monotonic()
+            start = max(now, self._uart_free)
+            self._uart_free = start + len(data) * 10 / baud
+            if start > now:
+                self.sim.loop.call_at(start, self._queue, data, self._epoch)
+            else:
+                self._queue(data, self._epoch)
+        else:
+            self._queue(data, self._epoch)
+        if udp:
+            self.udp.send(line)
+
+    def _queue(self, data: bytes, epoch: int):
+        if epoch != self._epoch or len(self._out) > OUT_MAX:
+            return                       # reset, or overrun with nobody reading
+        self._out += data
+        self._flush()
+
+    def _flush(self):
+        try:
+            n = os.write(self.master, self._out)
+        except (BlockingIOError, OSError):
+            n = 0
+        del self._out[:n]
+        self.sim.loop.set_writer(self.master, self._flush if self._out else None)
+
+    def _on_input(self):
+        try:
+            data = os.read(self.master, 65536)
+        except OSError:
+            return
+        self.rx_bytes += len(data)
+        if self._loader:
+            self._loader.feed(data)     # console input is ignored in the app
+
+    def _on_ctl(self):
+        try:
+            words = self._ctl.recv(256).decode().split()
+        except OSError:
+            return
+        if not words or not self.present:
+            return
+        if words[0] in ("dtr", "rts") and len(words) == 2:
+            self._set_line(words[0], words[1] == "1", "usb")
+        elif words[0] == "gpio" and len(words) == 3:
+            line = {"en": "en", "boot": "io0"}.get(words[1])
+            if line:
+                self._set_line(line, words[2] == "1", "en")
+        elif words[0] == "ble" and self.mode == "app":
+            self._on_ble(words[1:])
+
+    def _set_line(self, name: str, value: bool, cause: str):
+        self._lines[name] = value
+        held = self._lines["rts"] or not self._lines["en"]
+        if held and self.mode != "reset":
+            self._epoch += 1
+            self.mode = "reset"
+            self._out.clear()
+            self._cause = cause
+            self.sim._ble_changed()
+        elif not held and self.mode == "reset":
+            self._boot(self._cause)
+
+    def _boot(self, cause: str):
+        self._epoch += 1
+        epoch = self._epoch
+        self._boot_t = time.monotonic()
+        self._uart_free = 0.0
+        self.resets.append(cause)
+        rst, _ = RESETS[cause]
+        download = self._lines["dtr"] or not self._lines["io0"]
+        self.mode = "download" if download else "app"
+        self._loader = _Loader(self) if download else None
+        self.sim._ble_changed()
+        boot = BOOT_DOWNLOAD if download else BOOT_NORMAL
+        version = self.app_version()
+        at_ms = 0
+        for line in self.sim.boot_log:
+            line = line.replace("{rst}", rst).replace("{boot}", boot)
+            line = line.replace(f" v{FW_VERSION} ", f" v{version} ")
+            m = re.match(r"[IWE] \((\d+)\)", line)
+            if m:
+                if download:
+                    break
+                at_ms = int(m.group(1))
+            self.sim.loop.call_later(at_ms / 1000, self._emit, line, False, epoch)
+            if download and line.startswith("rst:"):
+                self.sim.loop.call_later(at_ms / 1000, self._emit, "waiting for download", False, epoch)
+                break
+        if not download:
+            self.sim.loop.call_later(at_ms / 1000 + 0.01, self._app_up, cause, epoch)
+
+    def app_version(self) -> str:
+        """Version in the esp_app_desc_t of the flashed app (FW_VERSION if
+        none): image header 0x18 bytes, segment header 8, then the desc."""
+        head = self.flash[APP_OFFSET:APP_OFFSET + 0x50]
+        if head[0] == 0xE9 and struct.unpack_from("<I", head, 0x20)[0] == 0xABCD5432:
+            return head[0x30:0x50].split(b"\0")[0].decode(errors="replace")
+        return FW_VERSION
+
+    def _app_up(self, cause: str, epoch: int):
+        if epoch != self._epoch:
+            return
+        self.boots += 1
+        version = self.app_version()
+        rec = {"boot": self.boots, "version": version, "reset": RESETS[cause][1],
+               "uptime_s": 0, "heap_min_free": 182340, "heap_peak_used": 48212,
+               "stack_min": 1184, "stack_task": "wifi", "reconnects": 0, "udp_drops": 0}
+        self._emit(f"I ({self._ms()}) app_main: === Workbench Test Firmware v{version} ===",
+                   udp=False)
+        for r in ([self._prev_rec] if self._prev_rec else []) + [rec]:
+            self.udp.send(f"I ({self._ms()}) boot_record: BOOTREC {json.dumps(r, separators=(',', ':'))}")
+        self._prev_rec = dict(rec, uptime_s=0)
+        self._tick = 0
+        self.sim.loop.call_later(self.sim.tick_s, self._heartbeat, epoch)
+
+    def _heartbeat(self, epoch: int):
+        if epoch != self._epoch:
+            return
+        self._prev_rec["uptime_s"] = int(time.monotonic() - self._boot_t)
+        self._emit(f"I ({self._ms()}) app_main: heartbeat {self._tick} | wifi=1 ble=0", udp=True)
+        self._tick += 1
+        self.sim.loop.call_later(self.sim.tick_s, self._heartbeat, epoch)
+
+    def _crash(self):
+        if self.mode != "app":
+            return
+        self._emit("Guru Meditation Error: Core  0 panic'ed (Load access fault). "
+                   "Exception was unhandled.", udp=True)
+        self._emit("Rebooting...")
+        self._boot("panic")
+
+    def _flood(self, count: int, marker: str):
+        if self.mode != "app":
+            return
+        for i in range(count):
+            self._emit(f"I ({self._ms()}) bench: line {i:06d} "
+                       "................................................")
+        self._emit(f"I ({self._ms()}) bench: {marker}")
+
+    def _on_ble(self, words: list):
+        if words[0] == "connect":
+            self._emit(f"I ({self._ms()}) ble_nus: Connected, handle=1", udp=True)
+        elif words[0] == "disconnect":
+            self._emit(f"I ({self._ms()}) ble_nus: Disconnected, reason=19", udp=True)
+        elif words[0] == "rx" and len(words) == 2:
+            self._emit(f"I ({self._ms()}) ble_nus: RX {words[1]} bytes from conn=1 (ignored)",
+                       udp=True)
+
+
+# ---------------------------------------------------------------------------
+# Bench: devices + portal process
+# ---------------------------------------------------------------------------
+
+class BenchSim:
+    """Simulated workbench with a running portal.
+
+        with BenchSim(slots=2) as sim:
+            sim.plug_all()
+            sim.wait_ready("SLOT1")
+            ... drive sim.url with WiFiTesterDriver ...
+    """
+
+    def __init__(self, slots: int = 3, port: int | None = None, native_usb: bool = False,
+                 baud: int = 115200, tick_s: float = 1.0, boot_log: str | None = None,
+                 networks: list | None = None, stations: list | None = None,
+                 scan_s: float = 0.05, ble_scan_s: float = 0.2, work_dir: str | None = None,
+                 portal_env: dict | None = None, auto_slots: int = 0):
+        self.native_usb = native_usb
+        self.baud = baud
+        self.tick_s = tick_s
+        self.boot_log = (boot_log or BOOT_LOG).splitlines()
+        self.networks = DEFAULT_NETWORKS if networks is None else networks
+        self.stations = DEFAULT_STATIONS if stations is None else stations
+        self.scan_s = scan_s
+        self.ble_scan_s = ble_scan_s
+        self.slot_count = slots
+        self.auto_count = auto_slots
+        self.portal_env = portal_env or {}
+        self.port = port or _free_port()
+        self.udp_port = _free_port(socket.SOCK_DGRAM)
+        self._own_dir = work_dir is None
+        # unix socket paths must stay short: keep the sim dir under /tmp
+        self.dir = work_dir or tempfile.mkdtemp(prefix="bench-sim-", dir="/tmp")
+        self.url = f"http://127.0.0.1:{self.port}"
+        self.loop = _Loop()
+        self.devices: dict[str, SimDevice] = {}
+        self.proc: subprocess.Popen | None = None
+        self._http = threading.local()
+
+    def __enter__(self):
+        self.start()
+        return self
+
+    def __exit__(self, *exc):
+        self.stop()
+
+    # -- setup --
+
+    def start(self):
+        for sub in ("dev", "lines", "bin", "wifi", "run", "firmware", "coredumps", "pylib/esptool"):
+            os.makedirs(os.path.join(self.dir, sub), exist_ok=True)
+        for i in range(1, self.slot_count + self.auto_count + 1):
+            dev = SimDevice(self, i, configured=i <= self.slot_count)
+            self.devices[dev.label] = dev
+        auto = _free_port_range(self.auto_count) if self.auto_count else None
+        self._write_config()
+        self._write_bin()
+        self._ble_changed()
+        self.loop.start()
+
+        env = dict(os.environ,
+                   BENCH_SIM_DIR=self.dir,
+                   PATH=os.path.join(self.dir, "bin") + os.pathsep + os.environ.get("PATH", ""),
+                   RFC2217_CONFIG=os.path.join(self.dir, "slots.json"),
+                   HOTPLUG_SOURCE="none",
+                   UDP_LOG_PORT=str(self.udp_port),
+                   FIRMWARE_DIR=os.path.join(self.dir, "firmware"),
+                   COREDUMP_DIR=os.path.join(self.dir, "coredumps"),
+                   WIFI_WLAN_IF="simwlan0",
+                   BLE_SCAN_TIMEOUT=str(self.ble_scan_s),
+                   PYTHONPATH=os.path.join(self.dir, "pylib"),
+                   USB_NET_BUS="",
+                   SERIAL_SYSFS=os.path.join(self.dir, "sys"),
+                   AUTO_PORTS=f"{auto[0]}-{auto[1]}" if auto else "",
+                   PORT_MAP_FILE=os.path.join(self.dir, "ports.json"),
+                   PYTHONUNBUFFERED="1")
+        env.update(self.portal_env)
+        self._log = open(os.path.join(self.dir, "portal.log"), "w")
+        self.proc = subprocess.Popen(
+            [sys.executable, os.path.abspath(__file__), "_portal", self.dir],
+            env=env, stdin=subprocess.DEVNULL, stdout=self._log, stderr=subprocess.STDOUT)
+        deadline = time.monotonic() + STARTUP_TIMEOUT_S
+        while time.monotonic() < deadline:
+            if self.proc.poll() is not None:
+                raise RuntimeError(f"portal exited ({self.proc.returncode}); see {self._log.name}")
+            try:
+                self.api("GET", "/api/info")
+                return
+            except OSError:
+                time.sleep(0.05)
+        raise RuntimeError(f"portal did not come up; see {self._log.name}")
+
+    def _write_config(self):
+        slots = []
+        for i, dev in enumerate(d for d in self.devices.values() if d.configured):
+            entry = {"label": dev.label, "slot_key": dev.slot_key, "tcp_port": _free_port()}
+            if i < len(GPIO_PAIRS):
+                entry["gpio_boot"], entry["gpio_en"] = GPIO_PAIRS[i]
+            slots.append(entry)
+        _write_json(os.path.join(self.dir, "slots.json"), {"slots": slots})
+        _write_json(os.path.join(self.dir, "scenario.json"), {
+            "portal_port": self.port, "networks": self.networks, "stations": self.stations,
+            "scan_s": self.scan_s})
+
+    def _write_bin(self):
+        bin_dir = os.path.join(self.dir, "bin")
+        # start_proxy runs "python3 <PROXY_EXE>": same interpreter as ours
+        os.symlink(sys.executable, os.path.join(bin_dir, "python3"))
+        head = f"#!{sys.executable}\nimport sys\nsys.path.insert(0, {PI_DIR!r})\nimport bench_sim\n"
+        with open(os.path.join(bin_dir, "rfc2217_proxy.py"), "w") as f:
+            f.write(head + "bench_sim.patch_modem_lines()\n"
+                    "import plain_rfc2217_server\nplain_rfc2217_server.main()\n")
+        # the flash worker imports esptool: give it SimEspLoader instead
+        esptool_dir = os.path.join(self.dir, "pylib", "esptool")
+        with open(os.path.join(esptool_dir, "__init__.py"), "w") as f:
+            f.write(head.split("\n", 1)[1] + "bench_sim.patch_modem_lines()\n"
+                    "__version__ = 'bench-sim'\n")
+        with open(os.path.join(esptool_dir, "cmds.py"), "w") as f:
+            f.write("from bench_sim import sim_detect_chip as detect_chip  # noqa: F401\n")
+        for name in TOOLS:
+            path = os.path.join(bin_dir, name)
+            with open(path, "w") as f:
+                if name == "ip":
+                    # GET /api/devices runs "ip ... show eth0" every call: answer
+                    # that without starting Python, as fast as the real binary
+                    f.write('#!/bin/sh\ncase "$*" in *eth0*) '
+                            'echo \'Device "eth0" does not exist.\' >&2; exit 1;; esac\n'
+                            f'exec {sys.executable} -c "import sys; sys.path.insert(0, {PI_DIR!r}); '
+                            'import bench_sim; sys.exit(bench_sim.tool_main(\'ip\', sys.argv[1:]))" "$@"\n')
+                else:
+                    f.write(head + f"sys.exit(bench_sim.tool_main({name!r}, sys.argv[1:]))\n")
+            os.chmod(path, 0o755)
+
+    def _ble_changed(self):
+        """Publish advertising DUTs for the fake bleak in the portal process."""
+        adv = {d.ble_address: {"name": BLE_NAME, "rssi": -40 - 3 * d.index, "ctl": d.ctl_path}
+               for d in self.devices.values() if d.mode == "app"}
+        _write_json(os.path.join(self.dir, "ble.json"), adv)
+
+    def stop(self):
+        if self.proc and self.proc.poll() is None:
+            self.proc.send_signal(signal.SIGTERM)      # portal.main() cleanup stops proxies
+            try:
+                self.proc.wait(10)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+                self.proc.wait()
+        if self.proc:
+            self._log.close()
+        self.loop.stop()
+        for dev in self.devices.values():
+            dev.close()
+        if self._own_dir:
+            shutil.rmtree(self.dir, ignore_errors=True)
+
+    # -- portal API --
+
+    def api(self, method: str, path: str, body: dict | None = None, timeout: float = 60):
+        """One request on this thread's keep-alive connection; returns the JSON reply."""
+        import http.client
+        conn = getattr(self._http, "conn", None)
+        if conn is None:
+            conn = self._http.conn = http.client.HTTPConnection("127.0.0.1", self.port)
+        conn.timeout = timeout
+        if conn.sock:
+            conn.sock.settimeout(timeout)
+        data = json.dumps(body).encode() if body is not None else None
+        headers = {"Content-Type": "application/json"} if data is not None else {}
+        try:
+            conn.request(method, path, body=data, headers=headers)
+            resp = conn.getresponse()
+            raw = resp.read()
+        except (OSError, http.client.HTTPException):
+            conn.close()
+            self._http.conn = None
+            raise
+        return json.loads(raw) if raw else {}
+
+    def slot(self, label: str) -> dict:
+        """A slot's view by portal label or slot_key (USBn devices: their key)."""
+        if label in self.devices and not self.devices[label].configured:
+            label = self.devices[label].slot_key
+        for s in self.api("GET", "/api/devices")["slots"]:
+            if label in (s["label"], s["slot_key"]):
+                return s
+        raise KeyError(label)
+
+    def wait_ready(self, label: str, timeout: float = 15) -> float:
+        """Wait until *label* is idle with its proxy up, or listening for
+        its first client (lazy slots); returns seconds waited."""
+        if label in self.devices and not self.devices[label].configured:
+            label = self.devices[label].slot_key
+        t0 = time.monotonic()
+        version = -1
+        while True:
+            reply = self.api("GET", f"/api/devices?since={version}&timeout=5")
+            version = reply["version"]
+            for s in reply["slots"]:
+                if label in (s["label"], s["slot_key"]) and s["state"] == "idle" \
+                        and (s["running"] or s["listening"]):
+                    return time.monotonic() - t0
+            if time.monotonic() - t0 > timeout:
+                raise TimeoutError(f"{label} not ready after {timeout}s")
+
+    # -- hotplug --
+
+    def _uevent(self, dev: SimDevice, action: str):
+        props = {"ACTION": action, "SUBSYSTEM": "tty", "DEVPATH": dev.devpath,
+                 "DEVNAME": dev.devnode, "ID_PATH": dev.slot_key}
+        action, devnode, id_path, devpath = uevent_monitor.hotplug_args(props)
+        return self.api("POST", "/api/hotplug", {"action": action, "devnode": devnode,
+                                                 "id_path": id_path, "devpath": devpath})
+
+    def plug(self, label: str):
+        dev = self.devices[label]
+        dev.power(True)
+        return self._uevent(dev, "add")
+
+    def unplug(self, label: str):
+        dev = self.devices[label]
+        reply = self._uevent(dev, "remove")
+        dev.power(False)
+        return reply
+
+    def plug_all(self, wait: bool = True, auto: bool = True):
+        labels = [d.label for d in self.devices.values() if auto or d.configured]
+        for label in labels:
+            self.plug(label)
+        if wait:
+            for label in labels:
+                self.wait_ready(label)
+
+    def replay(self, path: str, speed: float = 1.0) -> int:
+        """Post a recorded uevent trace (uevent_monitor --record) to the portal
+        with its original timing. Events for a simulated slot key also power
+        that DUT and use its devnode. Returns the number of events posted."""
+        by_key = {d.slot_key: d for d in self.devices.values()}
+        t_prev = None
+        posted = 0
+        for t, props in uevent_monitor.replay(path):
+            args = uevent_monitor.hotplug_args(props)
+            if args is None:
+                continue
+            if t_prev is not None and t > t_prev:
+                time.sleep((t - t_prev) / speed)
+            t_prev = t
+            action, devnode, id_path, devpath = args
+            dev = by_key.get(id_path or devpath)
+            if dev:
+                devnode = dev.devnode
+                if action == "add":
+                    dev.power(True)
+            else:
+                devnode = os.path.join(self.dir, "dev", os.path.basename(devnode))
+            self.api("POST", "/api/hotplug", {"action": action, "devnode": devnode,
+                                              "id_path": id_path, "devpath": devpath})
+            if dev and action == "remove":
+                dev.power(False)
+            posted += 1
+        return posted
+
+
+# ---------------------------------------------------------------------------
+# Portal process
+# ---------------------------------------------------------------------------
+
+def _fake_bleak(sim_dir: str) -> types.ModuleType:
+    """A bleak module whose peripherals are the booted simulated DUTs."""
+    import asyncio
+    mod = types.ModuleType("bleak")
+
+    def advertising() -> dict:
+        return _read_json(os.path.join(sim_dir, "ble.json"), {})
+
+    class BleakError(Exception):
+        pass
+
+    class BLEDevice:
+        def __init__(self, address, name, rssi):
+            self.address = address
+            self.name = name
+            self.rssi = rssi
+
+    class BleakScanner:
+        @staticmethod
+        async def discover(timeout: float = 5.0, **kwargs):
+            await asyncio.sleep(timeout)
+            return [BLEDevice(a, p["name"], p["rssi"]) for a, p in sorted(advertising().items())]
+
+    class _Char:
+        def __init__(self, uuid, properties):
+            self.uuid = uuid
+            self.properties = properties
+
+    class _Service:
+        def __init__(self, uuid, characteristics):
+            self.uuid = uuid
+            self.characteristics = characteristics
+
+    class BleakClient:
+        def __init__(self, address, disconnected_callback=None, **kwargs):
+            self.address = address
+            self._on_disconnect = disconnected_callback
+            self._ctl = None
+            self.is_connected = False
+            self.services = []
+
+        async def connect(self, **kwargs):
+            peer = advertising().get(self.address.upper())
+            if peer is None:
+                raise BleakError(f"Device with address {self.address} was not found")
+            await asyncio.sleep(0.03)
+            self._ctl = peer["ctl"]
+            self.is_connected = True
+            self.services = [_Service(NUS_SERVICE, [
+                _Char(NUS_RX, ["write", "write-without-response"]),
+                _Char(NUS_TX, ["notify"])])]
+            _send_ctl(self._ctl, "ble connect")
+            return True
+
+        async def disconnect(self):
+            if self.is_connected:
+                self.is_connected = False
+                _send_ctl(self._ctl, "ble disconnect")
+            return True
+
+        async def write_gatt_char(self, char, data, response: bool = True):
+            if self.is_connected and self.address.upper() not in advertising():
+                self.is_connected = False          # DUT reset or unplugged
+                if self._on_disconnect:
+                    self._on_disconnect(self)
+            if not self.is_connected:
+                raise BleakError("Not connected")
+            if str(char).lower() != NUS_RX:
+                raise BleakError(f"Characteristic {char} was not found!")
+            if response:
+                await asyncio.sleep(0.005)
+            _send_ctl(self._ctl, f"ble rx {len(data)}")
+
+    mod.BleakError = BleakError
+    mod.BLEDevice = BLEDevice
+    mod.BleakScanner = BleakScanner
+    mod.BleakClient = BleakClient
+    return mod
+
+
+def _sim_gpio_backend(get_slots):
+    """GPIO SimBackend that also drives the DUT on the slot a BOOT/EN pin belongs to."""
+    import gpio_sequencer
+
+    class SlotGpio(gpio_sequencer.SimBackend):
+        def _output_changed(self, ts, pin, state):
+            super()._output_changed(ts, pin, state)
+            level = 0 if state == 0 else 1
+            for slot in list(get_slots().values()):
+                role = ("en" if slot.get("gpio_en") == pin else
+                        "boot" if slot.get("gpio_boot") == pin else None)
+                if role and slot.get("devnode"):
+                    try:
+                        pts = os.path.realpath(slot["devnode"])
+                    except OSError:
+                        continue
+                    _send_ctl(_ctl_path(os.environ["BENCH_SIM_DIR"], pts), f"gpio {role} {level}")
+
+    return SlotGpio()
+
+
+def _run_portal(sim_dir: str):
+    scenario = _read_json(os.path.join(sim_dir, "scenario.json"))
+    patch_modem_lines(sim_dir)
+    sys.modules["bleak"] = _fake_bleak(sim_dir)
+    sys.path.insert(0, PI_DIR)
+    import gpio_sequencer
+    import portal
+    import wifi_controller
+
+    portal.PORT = scenario["portal_port"]
+    portal.PROXY_EXE = os.path.join(sim_dir, "bin", "rfc2217_proxy.py")
+    portal.scan_existing_devices = lambda: None      # DUTs arrive as uevents
+    portal._gpio_bank = gpio_sequencer.GpioBank(_sim_gpio_backend(lambda: portal.slots),
+                                                portal.GPIO_ALLOWED)
+    work = os.path.join(sim_dir, "wifi")
+    wifi_controller.WORK_DIR = work
+    wifi_controller.HOSTAPD_CONF = os.path.join(work, "hostapd.conf")
+    wifi_controller.DNSMASQ_CONF = os.path.join(work, "dnsmasq.conf")
+    wifi_controller.DNSMASQ_LEASES = os.path.join(work, "dnsmasq.leases")
+    wifi_controller.WPA_CONF = os.path.join(work, "wpa_supplicant.conf")
+    wifi_controller.WPA_LOG = os.path.join(work, "wpa_supplicant.log")
+
+    def _term(*_):
+        raise KeyboardInterrupt
+    signal.signal(signal.SIGTERM, _term)
+    portal.main()
+
+
+# ---------------------------------------------------------------------------
+# esptool stand-in — the flash worker's "import esptool" in the sim
+# ---------------------------------------------------------------------------
+
+class SimEspLoader:
+    """The part of esptool's ESPLoader API that flash_orchestrator's worker
+    uses, speaking the real serial protocol (SLIP commands, DTR/RTS reset)
+    to a simulated DUT, so the worker code runs unchanged without esptool.
+    Connecting and the stub upload are abbreviated; the flash traffic is not."""
+
+    CHIP_NAME = CHIP_NAME
+    CHIP_DETECT_MAGIC_REG_ADDR = CHIP_MAGIC_REG
+    ROM_WRITE_SIZE = 0x400
+    STUB_WRITE_SIZE = 0x4000
+
+    def __init__(self, port: str, baud: int):
+        import serial
+        self._port = serial.Serial(port, baud, timeout=0.05)
+        self._reader = _SlipReader()
+        self._frames: list = []
+        self.IS_STUB = False
+
+    @property
+    def FLASH_WRITE_SIZE(self) -> int:
+        return self.STUB_WRITE_SIZE if self.IS_STUB else self.ROM_WRITE_SIZE
+
+    def _read_frame(self, timeout: float) -> bytes:
+        deadline = time.monotonic() + timeout
+        while not self._frames:
+            if time.monotonic() > deadline:
+                raise RuntimeError("Timed out waiting for packet header")
+            self._frames += self._reader.feed(self._port.read(self._port.in_waiting or 1))
+        return self._frames.pop(0)
+
+    def command(self, op: int, data: bytes = b"", chk: int = 0,
+                timeout: float = 3.0) -> tuple[int, bytes]:
+        self._port.write(_slip(struct.pack("<BBHI", 0, op, len(data), chk) + data))
+        while True:
+            frame = self._read_frame(timeout)
+            if len(frame) < 8 or frame[0] != 1 or frame[1] != op:
+                continue
+            value = struct.unpack_from("<I", frame, 4)[0]
+            body = frame[8:]
+            status = body[-2:] if self.IS_STUB else body[-4:-2]
+            if status[0]:
+                raise RuntimeError(f"Failed to execute command 0x{op:02x} (result 0x{status[1]:02x})")
+            return value, body[:-2 if self.IS_STUB else -4]
+
+    def connect(self, attempts: int):
+        for _ in range(attempts):
+            # classic auto-reset circuit: EN low, then IO0 low while EN rises
+            self._port.dtr = False
+            self._port.rts = True
+            time.sleep(0.1)
+            self._port.dtr = True
+            self._port.rts = False
+            time.sleep(0.05)
+            self._port.dtr = False
+            time.sleep(0.05)
+            self._port.reset_input_buffer()
+            self._frames.clear()
+            for _ in range(5):
+                try:
+                    self.command(_Loader.SYNC, b"\x07\x07\x12\x20" + b"\x55" * 32, timeout=0.1)
+                    return
+                except RuntimeError:
+                    pass
+        raise RuntimeError(f"Failed to connect to {CHIP_NAME}: No serial data received.")
+
+    def read_reg(self, addr: int) -> int:
+        return self.command(_Loader.READ_REG, struct.pack("<I", addr))[0]
+
+    def run_stub(self) -> "SimEspLoader":
+        stub = b"\x00" * 0x800
+        self.command(_Loader.MEM_BEGIN, struct.pack("<IIII", len(stub), 2, 0x400, 0x40380000))
+        for seq in range(2):
+            block = stub[seq * 0x400:(seq + 1) * 0x400]
+            self.command(_Loader.MEM_DATA, struct.pack("<IIII", len(block), seq, 0, 0) + block,
+                         _checksum(block))
+        self.command(_Loader.MEM_END, struct.pack("<II", 0, 0x40380000))
+        if self._read_frame(3.0) != b"OHAI":
+            raise RuntimeError("Failed to start stub. Unexpected response")
+        self.IS_STUB = True
+        return self
+
+    def change_baud(self, baud: int):
+        self.command(_Loader.CHANGE_BAUDRATE, struct.pack("<II", baud, 115200 if self.IS_STUB else 0))
+        self._port.baudrate = baud
+        time.sleep(0.05)
+        self._port.reset_input_buffer()
+
+    def flash_spi_attach(self, hspi_arg: int):
+        self.command(_Loader.SPI_ATTACH, struct.pack("<II", hspi_arg, 0))
+
+    def flash_set_parameters(self, size: int):
+        self.command(_Loader.SPI_SET_PARAMS,
+                     struct.pack("<IIIIII", 0, size, 64 * 1024, 4096, 256, 0xFFFF))
+
+    def flash_md5sum(self, addr: int, size: int) -> str:
+        _, body = self.command(_Loader.SPI_FLASH_MD5, struct.pack("<IIII", addr, size, 0, 0),
+                               timeout=max(3.0, 8 * size / 1e6))
+        return body.hex() if len(body) == 16 else body.decode()
+
+    def flash_defl_begin(self, size: int, compsize: int, offset: int) -> int:
+        blocks = (compsize + self.FLASH_WRITE_SIZE - 1) // self.FLASH_WRITE_SIZE
+        self.command(_Loader.FLASH_DEFL_BEGIN,
+                     struct.pack("<IIII", size, blocks, self.FLASH_WRITE_SIZE, offset),
+                     timeout=max(3.0, 40 * size / 1e6))
+        return blocks
+
+    def flash_defl_block(self, data: bytes, seq: int, timeout: float = 3.0):
+        self.command(_Loader.FLASH_DEFL_DATA, struct.pack("<IIII", len(data), seq, 0, 0) + data,
+                     _checksum(data), timeout=timeout)
+
+    def flash_defl_finish(self, reboot: bool = False):
+        self.command(_Loader.FLASH_DEFL_END, struct.pack("<I", int(not reboot)))
+
+    def hard_reset(self):
+        self._port.dtr = False
+        self._port.rts = True
+        time.sleep(0.1)
+        self._port.rts = False
+
+
+def sim_detect_chip(port: str, baud: int = 115200, connect_mode: str = "default_reset",
+                    trace_enabled: bool = False, connect_attempts: int = 7) -> SimEspLoader:
+    """esptool.cmds.detect_chip() for simulated DUTs."""
+    esp = SimEspLoader(port, baud)
+    try:
+        esp.connect(connect_attempts)
+        if esp.read_reg(CHIP_MAGIC_REG) != CHIP_MAGIC:
+            raise RuntimeError("Unexpected CHIP magic value")
+    except Exception:
+        esp._port.close()
+        raise
+    return esp
+
+
+# ---------------------------------------------------------------------------
+# Tool shims (hostapd, dnsmasq, wpa_supplicant, iw, ip, ...)
+# ---------------------------------------------------------------------------
+
+TOOLS = ("hostapd", "dnsmasq", "wpa_supplicant", "wpa_passphrase", "wpa_cli", "iw", "ip",
+         "dhclient", "udhcpc")
+
+
+def _conf(path: str) -> dict:
+    out = {}
+    try:
+        with open(path) as f:
+            for line in f:
+                key, sep, value = line.strip().partition("=")
+                if sep and not key.startswith("#"):
+                    out.setdefault(key, value)
+    except OSError:
+        pass
+    return out
+
+
+def _until_terminated(cleanup=None, poll=None):
+    """Run like a daemon in the foreground until SIGTERM/SIGINT."""
+    stop = threading.Event()
+    signal.signal(signal.SIGTERM, lambda *_: stop.set())
+    signal.signal(signal.SIGINT, lambda *_: stop.set())
+    try:
+        while not stop.is_set():
+            if poll:
+                poll()
+            stop.wait(0.05)
+    finally:
+        if cleanup:
+            cleanup()
+    return 0
+
+
+class _Tools:
+    def __init__(self, sim_dir: str):
+        self.dir = sim_dir
+        self.scenario = _read_json(os.path.join(sim_dir, "scenario.json"), {})
+        self.wifi = os.path.join(sim_dir, "wifi")
+        self.ip_state = os.path.join(self.wifi, "ip.json")
+        self.sta_state = os.path.join(self.wifi, "sta.json")
+        self.ap_state = os.path.join(self.wifi, "ap.json")
+
+    def _network(self, ssid):
+        for net in self.scenario.get("networks", []):
+            if net["ssid"] == ssid:
+                return net
+        return None
+
+    def _sta(self):
+        sta = _read_json(self.sta_state)
+        if sta and time.time() >= sta["at"]:
+            return sta
+        return None
+
+    def _ip(self):
+        return _read_json(self.ip_state, {"addrs": {}, "up": {}})
+
+    # -- hostapd CONF --
+    def hostapd(self, argv):
+        conf = _conf(argv[-1])
+        iface = conf.get("interface", "wlan0")
+        _write_json(self.ap_state, {"ssid": conf.get("ssid", ""), "channel": int(conf.get("channel", 0)),
+                                    "wpa": conf.get("wpa_passphrase", "")})
+        ctl_dir = os.path.join(self.dir, "run", "hostapd")
+        os.makedirs(ctl_dir, exist_ok=True)
+        ctl_path = os.path.join(ctl_dir, iface)
+        if os.path.exists(ctl_path):
+            os.remove(ctl_path)
+        ctl = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        ctl.bind(ctl_path)
+        ctl.setblocking(False)
+        print(f"{iface}: interface state UNINITIALIZED->ENABLED\n{iface}: AP-ENABLED", flush=True)
+
+        def serve():
+            try:
+                cmd, addr = ctl.recvfrom(256)
+            except BlockingIOError:
+                return
+            if not addr:
+                return
+            ap = _read_json(self.ap_state, {})
+            reply = {b"PING": "PONG\n",
+                     b"STATUS": f"state=ENABLED\nssid[0]={ap.get('ssid')}\nchannel={ap.get('channel')}\n"}
+            ctl.sendto(reply.get(cmd.strip(), "UNKNOWN COMMAND\n").encode(), addr)
+
+        def cleanup():
+            ctl.close()
+            for path in (ctl_path, self.ap_state):
+                try:
+                    os.remove(path)
+                except OSError:
+                    pass
+        return _until_terminated(cleanup, serve)
+
+    # -- dnsmasq -C CONF: hands out leases to the scenario's stations --
+    def dnsmasq(self, argv):
+        conf = _conf(argv[argv.index("-C") + 1])
+        start = conf.get("dhcp-range", "192.168.4.2").split(",")[0]
+        base, last = start.rsplit(".", 1)
+        ap = _read_json(self.ap_state, {})
+        t0 = time.monotonic()
+        pending = [s for s in self.scenario.get("stations", [])
+                   if s.get("ssid") in (None, ap.get("ssid"))]
+        pending.sort(key=lambda s: s.get("delay_s", 0))
+        leased = []
+
+        def poll():
+            while pending and time.monotonic() - t0 >= pending[0].get("delay_s", 0):
+                sta = pending.pop(0)
+                ip = f"{base}.{int(last) + len(leased)}"
+                leased.append(f"{int(time.time()) + 3600} {sta['mac']} {ip} {sta.get('hostname', '*')} *")
+                if conf.get("dhcp-leasefile"):
+                    with open(conf["dhcp-leasefile"], "w") as f:
+                        f.write("\n".join(leased) + "\n")
+                self._lease_event("add", sta["mac"], ip, sta.get("hostname", ""), conf)
+        return _until_terminated(None, poll)
+
+    def _lease_event(self, action, mac, ip, hostname, conf):
+        script = conf.get("dhcp-script")
+        if script:
+            subprocess.run([script, action, mac, ip, hostname], check=False, timeout=5)
+            return
+        # what wifi-lease-notify.sh does
+        import http.client
+        conn = http.client.HTTPConnection("127.0.0.1", self.scenario["portal_port"], timeout=2)
+        try:
+            conn.request("POST", "/api/wifi/lease_event", body=json.dumps(
+                {"action": action, "mac": mac, "ip": ip, "hostname": hostname}),
+                headers={"Content-Type": "application/json"})
+            conn.getresponse().read()
+        except OSError:
+            pass
+        finally:
+            conn.close()
+
+    # -- wpa_supplicant -i IF -c CONF -B -f LOG --
+    def wpa_supplicant(self, argv):
+        text = ""
+        try:
+            with open(argv[argv.index("-c") + 1]) as f:
+                text = f.read()
+        except (OSError, ValueError, IndexError):
+            pass
+        m = re.search(r'^\s*ssid="(.*)"', text, re.M)
+        ssid = m.group(1) if m else ""
+        net = self._network(ssid)
+        ok = False
+        if net:
+            if not net.get("password"):
+                ok = "key_mgmt=NONE" in text
+            else:
+                psk = re.search(r"^\s*psk=([0-9a-f]{64})\s*$", text, re.M)
+                plain = re.search(r'^\s*psk="(.*)"', text, re.M)
+                ok = bool((psk and psk.group(1) == _psk(ssid, net["password"])) or
+                          (plain and plain.group(1) == net["password"]))
+        if ok:
+            # association + DHCP: address appears after a short delay
+            _write_json(self.sta_state, {"ssid": ssid, "at": time.time() + 0.2,
+                                         "ip": net.get("ip", "192.168.50.23/24"),
+                                         "gateway": net.get("gateway", "")})
+        elif os.path.exists(self.sta_state):
+            os.remove(self.sta_state)
+        return 0
+
+    def wpa_passphrase(self, argv):
+        ssid, password = argv[0], argv[1]
+        print(f'network={{\n\tssid="{ssid}"\n\t#psk="{password}"\n\tpsk={_psk(ssid, password)}\n}}')
+        return 0
+
+    def wpa_cli(self, argv):
+        if "status" in argv:
+            sta = self._sta()
+            if sta:
+                print(f"ssid={sta['ssid']}\nwpa_state=COMPLETED\nip_address={sta['ip'].split('/')[0]}")
+            else:
+                print("wpa_state=SCANNING" if os.path.exists(self.sta_state) else "wpa_state=DISCONNECTED")
+        else:
+            print("OK")
+        return 0
+
+    def iw(self, argv):
+        if "scan" not in argv:
+            return 0
+        time.sleep(self.scenario.get("scan_s", 0))
+        for i, net in enumerate(self.scenario.get("networks", [])):
+            freq = 2407 + 5 * net.get("channel", 1)
+            print(f"BSS 02:00:00:00:10:{i:02x}(on simwlan0)\n\tfreq: {freq}\n"
+                  f"\tsignal: {net.get('rssi', -60):.2f} dBm\n\tSSID: {net['ssid']}")
+            if net.get("password"):
+                print("\tRSN:\t * Version: 1\n\t\t * Authentication suites: PSK")
+        return 0
+
+    def ip(self, argv):
+        args = [a for a in argv if a not in ("-4", "-o")]
+        state = self._ip()
+        if args[:2] == ["link", "set"] and len(args) >= 4:
+            state["up"][args[2]] = args[3] == "up"
+            if args[3] == "down" and os.path.exists(self.sta_state):
+                os.remove(self.sta_state)            # link down drops the association
+        elif args[:2] == ["addr", "add"] and "dev" in args:
+            state["addrs"].setdefault(args[args.index("dev") + 1], []).append(args[2])
+        elif args[:2] == ["addr", "flush"] and "dev" in args:
+            state["addrs"].pop(args[args.index("dev") + 1], None)
+            if os.path.exists(self.sta_state):
+                os.remove(self.sta_state)
+        elif args[:2] == ["addr", "show"] and len(args) >= 3:
+            iface = args[-1]
+            addrs = list(state["addrs"].get(iface, []))
+            sta = self._sta()
+            if sta:
+                addrs.append(sta["ip"])
+            print(f"3: {iface}: <BROADCAST,MULTICAST,UP> mtu 1500 state UP")
+            for a in addrs:
+                print(f"    inet {a} scope global {iface}")
+            return 0
+        elif args[:2] == ["route", "show"]:
+            sta = self._sta()
+            if sta and sta.get("gateway"):
+                print(f"default via {sta['gateway']} dev {args[-1]}")
+            return 0
+        else:
+            return 0
+        _write_json(self.ip_state, state)
+        return 0
+
+    def dhclient(self, argv):
+        if "-r" in argv and os.path.exists(self.sta_state):
+            os.remove(self.sta_state)
+        return 0          # the lease itself comes with the association
+
+    udhcpc = dhclient
+
+
+def tool_main(name: str, argv: list) -> int:
+    """Entry point of the shims in <sim dir>/bin."""
+    return getattr(_Tools(os.environ["BENCH_SIM_DIR"]), name)(argv)
+
+
+# ---------------------------------------------------------------------------
+# Benchmarks
+# ---------------------------------------------------------------------------
+
+def _stats(samples: list, elapsed: float | None = None) -> dict:
+    s = sorted(samples)
+    out = {"n": len(s),
+           "p50_ms": round(statistics.median(s) * 1000, 2),
+           "p95_ms": round(s[min(len(s) - 1, int(len(s) * 0.95))] * 1000, 2),
+           "max_ms": round(s[-1] * 1000, 2)}
+    if elapsed:
+        out["ops_s"] = round(len(s) / elapsed, 1)
+    return out
+
+
+def _timed(fn, *args) -> float:
+    t0 = time.monotonic()
+    fn(*args)
+    return time.monotonic() - t0
+
+
+def _check(reply: dict) -> dict:
+    if reply.get("ok") is False:
+        raise RuntimeError(reply.get("error"))
+    return reply
+
+
+def bench_devices(sim: BenchSim, threads: int = 4, calls: int = 300) -> dict:
+    """GET /api/devices from several keep-alive clients at once."""
+    samples: list = []
+    lock = threading.Lock()
+
+    def worker():
+        mine = [_timed(sim.api, "GET", "/api/devices") for _ in range(calls)]
+        with lock:
+            samples.extend(mine)
+
+    t0 = time.monotonic()
+    pool = [threading.Thread(target=worker) for _ in range(threads)]
+    for t in pool:
+        t.start()
+    for t in pool:
+        t.join()
+    return _stats(samples, time.monotonic() - t0)
+
+
+def bench_hotplug(sim: BenchSim, cycles: int = 3) -> dict:
+    """Unplug + plug until the slot is idle with its proxy listening."""
+    samples = []
+    label = next(iter(sim.devices))
+    for _ in range(cycles):
+        sim.unplug(label)
+        t0 = time.monotonic()
+        sim.plug(label)
+        sim.wait_ready(label)
+        samples.append(time.monotonic() - t0)
+    return _stats(samples)
+
+
+def bench_serial_stream(sim: BenchSim, lines: int = 2000, rounds: int = 3) -> dict:
+    """DUT output -> pty -> RFC2217 proxy -> serial monitor, lines per second."""
+    label = next(iter(sim.devices))
+    dev = sim.devices[label]
+    samples = []
+    for r in range(rounds):
+        marker = f"stream done {r}"
+        reply = {}
+
+        def monitor():
+            reply.update(sim.api("POST", "/api/serial/monitor",
+                                 {"slot": label, "pattern": marker, "timeout": 30}))
+
+        version = sim.api("GET", "/api/devices")["version"]
+        t = threading.Thread(target=monitor)
+        t.start()
+        while sim.slot(label)["state"] != "monitoring":   # proxy connection is up
+            version = sim.api("GET", f"/api/devices?since={version}&timeout=5")["version"]
+        t0 = time.monotonic()
+        dev.flood(lines, marker)
+        t.join()
+        if not _check(reply).get("matched"):
+            raise RuntimeError(f"serial monitor missed {marker!r}")
+        samples.append(time.monotonic() - t0)
+    out = _stats(samples)
+    out["lines_s"] = round(lines / statistics.median(samples), 1)
+    return out
+
+
+def bench_serial_reset(sim: BenchSim, rounds: int = 1) -> dict:
+    """POST /api/serial/reset (DTR/RTS pulse, 5 s boot capture, proxy restart)."""
+    label = next(iter(sim.devices))
+    samples = []
+    for _ in range(rounds):
+        t0 = time.monotonic()
+        reply = _check(sim.api("POST", "/api/serial/reset", {"slot": label}))
+        if not any("rst:0x15" in line for line in reply["output"]):
+            raise RuntimeError("reset output has no boot banner")
+        samples.append(time.monotonic() - t0)
+    return _stats(samples)
+
+
+def bench_flash(sim: BenchSim, rounds: int = 1, size: int = 256 * 1024) -> dict:
+    """POST /api/flash of a *size*-byte app to one slot, rewritten every
+    round; "rtt_ms" is the worker's measured command round trip."""
+    label = next(iter(sim.devices))
+    proj = os.path.join(sim.dir, "firmware", "bench-flash")
+    os.makedirs(proj, exist_ok=True)
+    with open(os.path.join(proj, "flash_args"), "w") as f:
+        f.write("--flash_size 4MB\n0x10000 app.bin\n")
+    samples, rtts = [], []
+    for r in range(rounds):
+        with open(os.path.join(proj, "app.bin"), "wb") as f:
+            f.write(random.Random(r).randbytes(size))     # incompressible
+        t0 = time.monotonic()
+        job = _check(sim.api("POST", "/api/flash", {"project": "bench-flash", "slots": [label],
+                                                    "skip_unchanged": False}))
+        version = -1
+        while job["state"] == "running":
+            snap = sim.api("GET", f"/api/flash?since={version}&timeout=25")
+            version = snap["version"]
+            job = next(j for j in snap["jobs"] if j["job"] == job["job"])
+        if job["state"] != "done":
+            raise RuntimeError(f"flash failed: {job['slots'][0]['error']}")
+        samples.append(time.monotonic() - t0)
+        rtts.append(job["slots"][0]["rtt_ms"]["p50"])
+        sim.wait_ready(label)
+    out = _stats(samples)
+    out["rtt_ms"] = statistics.median(rtts)
+    out["kb_s"] = round(size / 1024 / statistics.median(samples), 1)
+    return out
+
+
+def bench_udplog(sim: BenchSim, lines: int = 2000) -> dict:
+    """UDP log lines until all of them are visible in GET /api/udplog."""
+    src = UdpLogSource("127.0.0.200", sim.udp_port)
+    try:
+        since = time.time()
+        t0 = time.monotonic()
+        for i in range(lines):
+            src.send(f"I ({i}) bench: udp {i}")
+        seen = 0
+        while seen < lines and time.monotonic() - t0 < 30:
+            got = sim.api("GET", f"/api/udplog?since={since}&source=127.0.0.200&limit={lines}")
+            seen = len(got["lines"])
+            if seen < lines:
+                time.sleep(0.01)
+        elapsed = time.monotonic() - t0
+    finally:
+        src.close()
+    return {"n": seen, "lost": lines - seen, "p50_ms": round(elapsed * 1000, 2),
+            "lines_s": round(seen / elapsed, 1)}
+
+
+def bench_wifi(sim: BenchSim, scans: int = 5) -> dict:
+    """AP start/stop, scans and a station join/leave through the tool shims."""
+    out = {"ap_start": _stats([_timed(lambda: _check(sim.api(
+        "POST", "/api/wifi/ap_start", {"ssid": "WB-Bench", "pass": "benchpass1"})))])}
+    out["ap_stop"] = _stats([_timed(sim.api, "POST", "/api/wifi/ap_stop")])
+    out["scan"] = _stats([_timed(lambda: _check(sim.api("GET", "/api/wifi/scan")))
+                          for _ in range(scans)])
+    net = next((n for n in sim.networks if n.get("password")), None)
+    if net:
+        out["sta_join"] = _stats([_timed(lambda: _check(sim.api(
+            "POST", "/api/wifi/sta_join",
+            {"ssid": net["ssid"], "pass": net["password"], "timeout": 10})))])
+        sim.api("POST", "/api/wifi/sta_leave")
+    return out
+
+
+def bench_ble(sim: BenchSim, writes: int = 20) -> dict:
+    """BLE scan, connect, GATT writes and disconnect via the fake bleak."""
+    dev = next(iter(sim.devices.values()))
+    out = {"scan": _stats([_timed(lambda: _check(sim.api("POST", "/api/ble/scan",
+                                                          {"timeout": sim.ble_scan_s})))])}
+    out["connect"] = _stats([_timed(lambda: _check(sim.api(
+        "POST", "/api/ble/connect", {"address": dev.ble_address})))])
+    out["write"] = _stats([_timed(lambda: _check(sim.api(
+        "POST", "/api/ble/write", {"characteristic": NUS_RX, "data": "48656c6c6f"})))
+        for _ in range(writes)])
+    sim.api("POST", "/api/ble/disconnect")
+    return out
+
+
+def _rss_kb(pid: int) -> int:
+    with open(f"/proc/{pid}/status") as f:
+        for line in f:
+            if line.startswith("VmRSS:"):
+                return int(line.split()[1])
+    return 0
+
+
+def bench_slots(sim: BenchSim) -> dict:
+    """Cost of auto slots: portal memory and fds per idle (listening) slot,
+    proxy processes while idle, memory per active proxy, and the first
+    connect's latency (proxy start included). Call with the auto devices
+    still unplugged, so their slots are created here."""
+    import serial
+    devs = [d for d in sim.devices.values() if not d.configured]
+    if not devs:
+        raise RuntimeError("bench_slots needs a BenchSim with auto_slots")
+    portal = sim.proc.pid
+    sim.api("GET", "/api/devices")
+    rss0, fds0 = _rss_kb(portal), len(os.listdir(f"/proc/{portal}/fd"))
+    for dev in devs:
+        if not dev.present:
+            sim.plug(dev.label)
+    for dev in devs:
+        sim.wait_ready(dev.label)
+    views = [sim.slot(d.label) for d in devs]
+    n = len(devs)
+    idle = {"idle_rss_kb": round((_rss_kb(portal) - rss0) / n, 1),
+            "idle_fds": round((len(os.listdir(f"/proc/{portal}/fd")) - fds0) / n, 2),
+            "idle_procs": sum(v["running"] for v in views)}
+
+    samples, conns = [], []
+    try:
+        for v in views:
+            t0 = time.monotonic()
+            conns.append(serial.serial_for_url(f"rfc2217://127.0.0.1:{v['tcp_port']}",
+                                               baudrate=115200, timeout=0.1))
+            samples.append(time.monotonic() - t0)
+        pids = [sim.slot(d.label)["pid"] for d in devs]
+        active_rss = statistics.median(_rss_kb(pid) for pid in pids)
+    finally:
+        for c in conns:
+            c.close()
+    out = _stats(samples)
+    out.update(idle, slots=n, active_rss_kb=active_rss)
+    return out
+
+
+def run_bench(sim: BenchSim, quick: bool = False) -> dict:
+    """Run every workload; returns {name: stats}."""
+    results = {"devices": bench_devices(sim, calls=50 if quick else 300),
+               "hotplug": bench_hotplug(sim, cycles=1 if quick else 3),
+               "serial_stream": bench_serial_stream(sim, lines=200 if quick else 2000,
+                                                    rounds=1 if quick else 3),
+               "udplog": bench_udplog(sim, lines=200 if quick else 2000)}
+    if not quick:
+        results["serial_reset"] = bench_serial_reset(sim)
+    results["flash"] = bench_flash(sim, size=64 * 1024 if quick else 256 * 1024)
+    for group, stats in (("wifi", bench_wifi(sim, scans=2 if quick else 5)),
+                         ("ble", bench_ble(sim, writes=5 if quick else 20))):
+        for name, s in stats.items():
+            results[f"{group}_{name}"] = s
+    if sim.auto_count:
+        results["slots"] = bench_slots(sim)
+    return results
+
+
+def compare(results: dict, baseline: dict, max_slowdown: float = 1.5,
+            slack_ms: float = 5.0) -> list[str]:
+    """Regressions against a baseline run: p50 latency up, or throughput down,
+    by more than max_slowdown (latencies get slack_ms of absolute slack)."""
+    problems = []
+    for name, base in baseline.items():
+        cur = results.get(name)
+        if cur is None:
+            continue
+        if cur["p50_ms"] > base["p50_ms"] * max_slowdown + slack_ms:
+            problems.append(f"{name}: p50 {cur['p50_ms']} ms vs {base['p50_ms']} ms")
+        for key in ("ops_s", "lines_s", "kb_s"):
+            if key in base and key in cur and cur[key] * max_slowdown < base[key]:
+                problems.append(f"{name}: {key} {cur[key]} vs {base[key]}")
+    return problems
+
+
+def _print_results(results: dict):
+    print(f"{'workload':<16} {'n':>6} {'p50 ms':>9} {'p95 ms':>9} {'max ms':>9} {'rate':>10}")
+    for name, s in results.items():
+        rate = s.get("ops_s") or s.get("lines_s") or s.get("kb_s") or ""
+        print(f"{name:<16} {s['n']:>6} {s['p50_ms']:>9} {s.get('p95_ms', ''):>9} "
+              f"{s.get('max_ms', ''):>9} {rate:>10}")
+    if "slots" in results:
+        s = results["slots"]
+        print(f"{s['slots']} auto slots: idle {s['idle_rss_kb']} kB + {s['idle_fds']} fd each "
+              f"in the portal, {s['idle_procs']} proxies; active proxy {s['active_rss_kb']} kB")
+
+
+# ---------------------------------------------------------------------------
+# CLI
+# ---------------------------------------------------------------------------
+
+def _main(argv):
+    if argv[:1] == ["_portal"]:
+        _run_portal(argv[1])
+        return 0
+
+    import argparse
+
+    parser = argparse.ArgumentParser(description="Simulated workbench for offline tests and benchmarks")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    for name in ("serve", "bench"):
+        p = sub.add_parser(name)
+        p.add_argument("--slots", type=int, default=3)
+        p.add_argument("--auto-slots", type=int, default=0,
+                       help="extra DUTs without a slots.json entry (auto ports, lazy proxies)")
+        p.add_argument("--native-usb", action="store_true", help="ttyACM devices (2 s boot delay)")
+        p.add_argument("--boot-log", help="recorded boot log to replay instead of the built-in one")
+    serve = sub.choices["serve"]
+    serve.add_argument("--port", type=int, default=8080)
+    serve.add_argument("--replay", help="uevent trace to replay after start")
+    bench = sub.choices["bench"]
+    bench.add_argument("--quick", action="store_true")
+    bench.add_argument("--json", help="write results here")
+    bench.add_argument("--baseline", help="fail on regressions against this results file")
+    bench.add_argument("--max-slowdown", type=float, default=1.5)
+    bench.add_argument("--untuned", action="store_true",
+                       help="SERIAL_LOW_LATENCY=0: bridges keep their default latency timer")
+    args = parser.parse_args(argv)
+
+    boot_log = None
+    if args.boot_log:
+        with open(args.boot_log) as f:
+            boot_log = f.read()
+
+    if args.cmd == "serve":
+        with BenchSim(args.slots, port=args.port, native_usb=args.native_usb,
+                      boot_log=boot_log, auto_slots=args.auto_slots) as sim:
+            sim.plug_all()
+            print(f"bench-sim: portal {sim.url}, {args.slots} slot(s), sim dir {sim.dir}", flush=True)
+            if args.replay:
+                print(f"bench-sim: replayed {sim.replay(args.replay)} uevent(s)", flush=True)
+            try:
+                signal.pause()
+            except KeyboardInterrupt:
+                pass
+        return 0
+
+    # benchmarks measure the portal pipeline, so the UART is not baud-limited
+    env = {"SERIAL_LOW_LATENCY": "0"} if args.untuned else None
+    with BenchSim(args.slots, native_usb=args.native_usb, baud=0, boot_log=boot_log,
+                  portal_env=env, auto_slots=args.auto_slots) as sim:
+        sim.plug_all(auto=False)                    # bench_slots plugs those
+        results = run_bench(sim, quick=args.quick)
+    _print_results(results)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+    if args.baseline:
+        with open(args.baseline) as f:
+            problems = compare(results, json.load(f), args.max_slowdown)
+        for p in problems:
+            print(f"REGRESSION {p}")
+        return 1 if problems else 0
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(_main(sys.argv[1:]))
@@ -0,0 +1,191 @@
+"""
+Flap detector — per-slot USB connect/disconnect storm detection in O(1).
+
+A slot is flapping once `threshold` hotplug events fall within `window_s`.
+The last `threshold` event times are kept in a fixed-size ring, so that
+test is a single comparison against the oldest entry: no list rebuilds,
+no pruning, constant memory however fast events arrive.
+
+Hysteresis: entering needs a burst, leaving needs silence. A flapping slot
+only returns to stable after `quiet_s` without events (checked on the next
+event or by poll()), and the ring is emptied on that transition, so a
+fresh burst of `threshold` events is required to trip again.
+
+observe() and poll() return FLAPPING / STABLE on a transition, else None.
+
+Thresholds can be tuned offline against recorded hotplug traces
+(see uevent_monitor.py --record):
+
+    python3 flap_detector.py trace.jsonl [--threshold N] [--window S] [--quiet S]
+    python3 flap_detector.py --bench
+"""
+
+FLAPPING = "flapping"
+STABLE = "stable"
+
+DEFAULT_THRESHOLD = 6       # 6 events = 3 connect/disconnect cycles
+DEFAULT_WINDOW_S = 30.0
+DEFAULT_QUIET_S = 10.0
+
+
+class FlapDetector:
+    __slots__ = ("threshold", "window_s", "quiet_s", "flapping",
+                 "_ring", "_idx", "_count", "_last", "events", "trips")
+
+    def __init__(self, threshold: int = DEFAULT_THRESHOLD,
+                 window_s: float = DEFAULT_WINDOW_S, quiet_s: float = DEFAULT_QUIET_S):
+        if threshold < 2:
+            raise ValueError("threshold must be >= 2")
+        self.threshold = threshold
+        self.window_s = float(window_s)
+        self.quiet_s = float(quiet_s)
+        self.flapping = False
+        self._ring = [0.0] * threshold
+        self._idx = 0               # next slot to overwrite == oldest entry when full
+        self._count = 0
+        self._last = None           # time of the most recent event
+        self.events = 0             # lifetime totals, for /api/devices
+        self.trips = 0
+
+    @classmethod
+    def from_config(cls, cfg: dict | None):
+        """Build from a slots.json "flap" object; missing keys use defaults."""
+        cfg = cfg or {}
+        return cls(int(cfg.get("threshold", DEFAULT_THRESHOLD)),
+                   float(cfg.get("window_s", DEFAULT_WINDOW_S)),
+                   float(cfg.get("quiet_s", DEFAULT_QUIET_S)))
+
+    def observe(self, now: float) -> str | None:
+        """Record one hotplug event at time *now*."""
+        self.events += 1
+        transition = None
+        if self.flapping and self._last is not None and now - self._last >= self.quiet_s:
+            self._clear()
+            transition = STABLE
+        self._last = now
+
+        self._ring[self._idx] = now
+        self._idx = (self._idx + 1) % self.threshold
+        if self._count < self.threshold:
+            self._count += 1
+
+        # After the write, _idx points at the oldest of the last `threshold`
+        if (not self.flapping and self._count == self.threshold
+                and now - self._ring[self._idx] < self.window_s):
+            self.flapping = True
+            self.trips += 1
+            transition = FLAPPING
+        return transition
+
+    def poll(self, now: float) -> str | None:
+        """Clear a flapping state that has gone quiet without a new event."""
+        if self.flapping and (self._last is None or now - self._last >= self.quiet_s):
+            self._clear()
+            return STABLE
+        return None
+
+    def trip(self, now: float):
+        """Enter flapping without a burst (manual recovery)."""
+        self.flapping = True
+        self._last = now
+
+    def reset(self):
+        """Forget recent events (after recovery rebinds the device)."""
+        self._clear()
+        self._last = None
+
+    def burst_span(self) -> float:
+        """Seconds covered by the last `threshold` events (for log messages)."""
+        if self._count == 0:
+            return 0.0
+        newest = self._ring[(self._idx - 1) % self.threshold]
+        oldest = self._ring[self._idx] if self._count == self.threshold else self._ring[0]
+        return newest - oldest
+
+    def _clear(self):
+        self.flapping = False
+        self._count = 0
+        self._idx = 0
+
+    def info(self) -> dict:
+        return {"threshold": self.threshold, "window_s": self.window_s,
+                "quiet_s": self.quiet_s, "events": self.events, "trips": self.trips}
+
+
+# ---------------------------------------------------------------------------
+# Offline replay and benchmark
+# ---------------------------------------------------------------------------
+
+def replay_trace(path: str, threshold=DEFAULT_THRESHOLD, window_s=DEFAULT_WINDOW_S,
+                 quiet_s=DEFAULT_QUIET_S) -> list:
+    """Run a recorded uevent trace through one detector per slot.
+
+    Returns [(t, slot_key, transition)]. Events are treated as if no
+    recovery ran, so every burst shows up — that is what tuning wants.
+    """
+    import uevent_monitor
+
+    detectors: dict[str, FlapDetector] = {}
+    out = []
+    for t, props in uevent_monitor.replay(path):
+        args = uevent_monitor.hotplug_args(props)
+        if not args:
+            continue
+        _, _, id_path, devpath = args
+        key = id_path or devpath
+        det = detectors.get(key)
+        if det is None:
+            det = detectors[key] = FlapDetector(threshold, window_s, quiet_s)
+        tr = det.observe(t)
+        if tr:
+            out.append((t, key, tr))
+    return out
+
+
+def _bench(n: int = 200_000):
+    import time
+
+    def list_rebuild(times, now, window):
+        times.append(now)
+        return [t for t in times if now - t < window]
+
+    for rate in (2, 50):                  # events per second
+        stamps = [i / rate for i in range(n)]
+        det = FlapDetector()
+        t0 = time.perf_counter()
+        for s in stamps:
+            det.observe(s)
+        ring_ns = (time.perf_counter() - t0) / n * 1e9
+
+        times: list = []
+        m = n // 10
+        t0 = time.perf_counter()
+        for s in stamps[:m]:
+            times = list_rebuild(times, s, DEFAULT_WINDOW_S)
+        list_ns = (time.perf_counter() - t0) / m * 1e9
+        print(f"{rate:3d} ev/s: ring {ring_ns:7.0f} ns/event   list rebuild {list_ns:7.0f} ns/event")
+
+
+def _main(argv):
+    if "--bench" in argv:
+        _bench()
+        return
+
+    def opt(name, default):
+        return type(default)(argv[argv.index(name) + 1]) if name in argv else default
+
+    paths = [a for i, a in enumerate(argv)
+             if not a.startswith("--") and (i == 0 or not argv[i - 1].startswith("--"))]
+    if not paths:
+        print(__doc__)
+        return
+    threshold = opt("--threshold", DEFAULT_THRESHOLD)
+    window_s = opt("--window", DEFAULT_WINDOW_S)
+    quiet_s = opt("--quiet", DEFAULT_QUIET_S)
+    for t, key, tr in replay_trace(paths[0], threshold, window_s, quiet_s):
+        print(f"{t:.3f}  {tr:8s}  {key}")
+
+
+if __name__ == "__main__":
+    import sys
+    _main(sys.argv[1:])
@@ -0,0 +1,684 @@
+"""
+GPIO sequencer — persistent line requests and tightly timed pin sequences.
+
+GpioBank owns every GPIO line the portal drives. Lines are requested once
+and kept; a direction change (drive <-> release to pull-up input) is a
+reconfigure of the existing request, never a release + re-request. Pins
+used together (a slot's BOOT and EN) share one request, so a sequence can
+change several of them in a single set_values() call.
+
+A sequence is a list of declarative steps, run back to back while its
+lines are reserved (other pins stay usable meanwhile):
+
+    {"set": {"boot": 0, "en": "z"}}                 drive/release pins at once
+    {"pulse": "en", "level": 0, "us": 100}          pulse, then restore (or "then")
+    {"sleep_us": 5000}
+    {"wait_edge": "ready", "edge": "rising", "timeout_ms": 2000}
+
+Pins are referred to by name (from the slot config) or BCM number. Waits
+sleep, and only their last SPIN_THRESHOLD_NS is busy-waited on
+CLOCK_MONOTONIC, the clock the kernel stamps edge events with, so edge
+latencies are measured against the moment the preceding pin change took
+effect. The garbage collector is paused from the spin to the pin change
+that ends it, never across a whole sequence. run() returns the measured
+offset of every step.
+
+capture() records input edges for a fixed time, optionally while running
+a sequence, and returns per-pin edge lists with pulse statistics. Edge
+events are read from the request fd in bulk and decoded with memoryview
+slices (no Python object per edge on the read path); the kernel
+line_seqno exposes events dropped by a full buffer.
+
+Backends: GpiodBackend (libgpiod v2, real hardware or gpio-sim) and
+SimBackend (in-process stand-in with scripted DUT responses, for tests).
+"""
+
+import gc
+import heapq
+import os
+import threading
+import time
+
+MAX_STEPS = 64
+MAX_SEQUENCE_US = 10_000_000         # total of all sleeps, pulses and edge timeouts
+SPIN_THRESHOLD_NS = 2_000_000        # sleep() overshoots by ~0.1-1 ms; spin the tail
+EDGES = ("rising", "falling", "both")
+MAX_CAPTURE_MS = 10_000
+MAX_CAPTURE_EDGES = 200_000
+
+# struct gpio_v2_line_event (linux/gpio.h): u64 timestamp_ns, u32 id, offset,
+# seqno, line_seqno, padding[6]
+EVENT_SIZE = 48
+EVENT_RISING = 1
+EVENT_BUFFER = 1024                  # kernel maximum (16 * GPIO_V2_LINES_MAX)
+
+
+def _now_ns() -> int:
+    return time.monotonic_ns()
+
+
+class _GcPause:
+    """Keeps the garbage collector out of a timed stretch (a spin and the
+    pin change after it); a collection there would stretch a pulse."""
+
+    def __init__(self):
+        self._paused = False
+
+    def begin(self):
+        if not self._paused and gc.isenabled():
+            gc.disable()
+            self._paused = True
+
+    def end(self):
+        if self._paused:
+            gc.enable()
+            self._paused = False
+
+
+def _wait_until(deadline_ns: int, pause: _GcPause | None = None):
+    # sleep() may return early or late: sleep again until the tail is short
+    while (remaining := deadline_ns - _now_ns()) > SPIN_THRESHOLD_NS:
+        time.sleep((remaining - SPIN_THRESHOLD_NS // 2) / 1e9)
+    if pause:
+        pause.begin()
+    while _now_ns() < deadline_ns:
+        pass
+
+
+# ---------------------------------------------------------------------------
+# Backends
+# ---------------------------------------------------------------------------
+#
+# A backend hands out line handles for a set of pins. Pin state is 0 / 1
+# (output, driven) or "z" (input with pull-up and edge detection).
+# Handles provide: set_values(dict), reconfigure(dict), get_value(pin),
+# wait_edges(timeout_s) -> bool, read_edges() -> [(pin, rising, ts_ns)],
+# read_edge_batch() -> (ts_ns[], pin[], rising[], line_seqno[]), release().
+
+class GpiodBackend:
+    """libgpiod v2 line requests on one gpiochip."""
+
+    def __init__(self, chip_path: str = "/dev/gpiochip0", consumer: str = "serial-portal"):
+        self._chip_path = chip_path
+        self._consumer = consumer
+        self._chip = None
+
+    def request(self, config: dict):
+        import gpiod
+        if self._chip is None:
+            self._chip = gpiod.Chip(self._chip_path)
+        return _GpiodHandle(gpiod, self._chip, self._consumer, config)
+
+
+class _GpiodHandle:
+    def __init__(self, gpiod, chip, consumer, config):
+        self._gpiod = gpiod
+        self._req = chip.request_lines(consumer=consumer, config=self._settings(config),
+                                       event_buffer_size=EVENT_BUFFER)
+        os.set_blocking(self._req.fd, False)     # empty queue reads as EAGAIN
+
+    def _settings(self, config: dict) -> dict:
+        g = self._gpiod
+        out = {}
+        for pin, state in config.items():
+            if state == "z":
+                out[pin] = g.LineSettings(direction=g.line.Direction.INPUT,
+                                          bias=g.line.Bias.PULL_UP,
+                                          edge_detection=g.line.Edge.BOTH,
+                                          event_clock=g.line.Clock.MONOTONIC)
+            else:
+                out[pin] = g.LineSettings(direction=g.line.Direction.OUTPUT,
+                                          output_value=self._value(state))
+        return out
+
+    def _value(self, v):
+        return self._gpiod.line.Value.ACTIVE if v else self._gpiod.line.Value.INACTIVE
+
+    def set_values(self, values: dict):
+        self._req.set_values({p: self._value(v) for p, v in values.items()})
+
+    def reconfigure(self, config: dict):
+        self._req.reconfigure_lines(self._settings(config))
+
+    def get_value(self, pin: int) -> int:
+        return 1 if self._req.get_value(pin) == self._gpiod.line.Value.ACTIVE else 0
+
+    def wait_edges(self, timeout_s: float) -> bool:
+        return self._req.wait_edge_events(max(timeout_s, 0))
+
+    def read_edges(self) -> list:
+        ts, pins, rising, _ = self.read_edge_batch()
+        return list(zip(pins, rising, ts))
+
+    def read_edge_batch(self) -> tuple:
+        """Read every queued event with one read(); decode by strided slices."""
+        try:
+            data = os.read(self._req.fd, EVENT_SIZE * EVENT_BUFFER)
+        except BlockingIOError:
+            return [], [], [], []
+        n = len(data) // EVENT_SIZE
+        if not n:
+            return [], [], [], []
+        mv = memoryview(data)[:n * EVENT_SIZE]
+        q = mv.cast("Q")
+        u = mv.cast("I")
+        rising = [i == EVENT_RISING for i in u[2::12].tolist()]
+        return q[0::6].tolist(), u[3::12].tolist(), rising, u[5::12].tolist()
+
+    def release(self):
+        self._req.release()
+
+
+class SimBackend:
+    """In-process GPIO stand-in.
+
+    Inputs idle high (pull-up). link() scripts a DUT: when an output pin
+    changes, another pin follows after a delay, e.g. a "ready" line rising
+    2 ms after EN is released. drive() sets an input externally. Every
+    applied output change is logged in .writes as (ts_ns, pin, state).
+    """
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._ext: dict[int, int] = {}           # externally driven input levels
+        self._sched: list = []                   # heap of (ts_ns, seq, pin, level)
+        self._seq = 0
+        self._links: dict[int, list] = {}
+        self._handles: list = []
+        self.writes: list = []
+
+    def request(self, config: dict):
+        h = _SimHandle(self, config)
+        with self._lock:
+            self._handles.append(h)
+        return h
+
+    def link(self, src: int, dst: int, delay_us: float, invert: bool = False):
+        self._links.setdefault(src, []).append((dst, int(delay_us * 1000), invert))
+
+    def drive(self, pin: int, level: int, at_ns: int | None = None):
+        with self._lock:
+            self._schedule(at_ns if at_ns is not None else _now_ns(), pin, level)
+
+    def _schedule(self, ts, pin, level):
+        self._seq += 1
+        heapq.heappush(self._sched, (ts, self._seq, pin, level))
+
+    def _output_changed(self, ts, pin, state):
+        self.writes.append((ts, pin, state))
+        level = 1 if state == "z" else state
+        for dst, delay, invert in self._links.get(pin, ()):
+            self._schedule(ts + delay, dst, level ^ 1 if invert else level)
+
+    def pulse_train(self, pin: int, high_us: float, low_us: float, count: int,
+                    start_ns: int | None = None):
+        """Schedule `count` high pulses on an input (a PWM source)."""
+        t = start_ns if start_ns is not None else _now_ns()
+        with self._lock:
+            for _ in range(count):
+                self._schedule(t, pin, 1)
+                t += int(high_us * 1000)
+                self._schedule(t, pin, 0)
+                t += int(low_us * 1000)
+
+    def _advance(self, now):
+        """Apply scheduled external changes that are due; emit input edges."""
+        while self._sched and self._sched[0][0] <= now:
+            ts, _, pin, level = heapq.heappop(self._sched)
+            old = self._ext.get(pin, 1)
+            self._ext[pin] = level
+            if level != old:
+                for h in self._handles:
+                    if h.state.get(pin) == "z":
+                        h.line_seqno[pin] = h.line_seqno.get(pin, 0) + 1
+                        h.events.append((pin, level == 1, ts, h.line_seqno[pin]))
+
+    def _next_due(self):
+        return self._sched[0][0] if self._sched else None
+
+
+class _SimHandle:
+    def __init__(self, sim: SimBackend, config: dict):
+        self._sim = sim
+        self.state = dict(config)
+        self.events: list = []
+        self.line_seqno: dict = {}
+        ts = _now_ns()
+        with sim._lock:
+            for pin, st in config.items():
+                if st != "z":
+                    sim._output_changed(ts, pin, st)
+
+    def set_values(self, values: dict):
+        ts = _now_ns()
+        with self._sim._lock:
+            for pin, v in values.items():
+                if self.state.get(pin) != v:
+                    self.state[pin] = v
+                    self._sim._output_changed(ts, pin, v)
+
+    def reconfigure(self, config: dict):
+        ts = _now_ns()
+        with self._sim._lock:
+            for pin, st in config.items():
+                if self.state.get(pin) != st:
+                    self.state[pin] = st
+                    self._sim._output_changed(ts, pin, st)
+
+    def get_value(self, pin: int) -> int:
+        with self._sim._lock:
+            self._sim._advance(_now_ns())
+            st = self.state.get(pin)
+            return self._sim._ext.get(pin, 1) if st == "z" else st
+
+    def wait_edges(self, timeout_s: float) -> bool:
+        deadline = _now_ns() + int(timeout_s * 1e9)
+        while True:
+            now = _now_ns()
+            with self._sim._lock:
+                self._sim._advance(now)
+                if self.events:
+                    return True
+                due = self._sim._next_due()
+            if now >= deadline:
+                return False
+            _wait_until(min(deadline, due) if due is not None else deadline)
+
+    def read_edges(self) -> list:
+        ts, pins, rising, _ = self.read_edge_batch()
+        return list(zip(pins, rising, ts))
+
+    def read_edge_batch(self) -> tuple:
+        with self._sim._lock:
+            self._sim._advance(_now_ns())
+            out, self.events = self.events[:EVENT_BUFFER], self.events[EVENT_BUFFER:]
+        if not out:
+            return [], [], [], []
+        pins, rising, ts, seq = (list(c) for c in zip(*out))
+        return ts, pins, rising, seq
+
+    def release(self):
+        with self._sim._lock:
+            if self in self._sim._handles:
+                self._sim._handles.remove(self)
+
+
+# ---------------------------------------------------------------------------
+# Bank
+# ---------------------------------------------------------------------------
+
+class GpioBank:
+    """Owns all driven GPIO lines; serializes access under one lock.
+
+    A sequence or capture holds the lock only to set up: its handle is then
+    marked busy and it runs unlocked. Calls touching a busy group's pins
+    wait for it; calls on other pins go ahead."""
+
+    def __init__(self, backend, allowed: set | None = None):
+        self._backend = backend
+        self._allowed = allowed
+        self._lock = threading.Lock()
+        self._idle = threading.Condition(self._lock)
+        self._groups: list = []                  # [(frozenset(pins), handle)]
+        self._busy: set = set()                  # handles running a sequence or capture
+        self._state: dict = {}                   # pin -> 0 | 1 | "z"
+
+    # -- line ownership --
+
+    def _handle_for(self, pins) -> object:
+        pins = frozenset(pins)
+        for group, handle in self._groups:
+            if pins <= group:
+                return handle
+        # Merge every overlapping group into one request for the union
+        union = set(pins)
+        keep = []
+        for group, handle in self._groups:
+            if group & pins:
+                union |= group
+                handle.release()
+            else:
+                keep.append((group, handle))
+        handle = self._backend.request({p: self._state.get(p, "z") for p in sorted(union)})
+        for p in union:
+            self._state.setdefault(p, "z")
+        keep.append((frozenset(union), handle))
+        self._groups = keep
+        return handle
+
+    def _claim(self, pins, busy: bool = False) -> object:
+        """(lock held) Wait until no sequence or capture uses a group of
+        *pins*, then return their handle; busy=True reserves it until
+        _unclaim()."""
+        pins = frozenset(pins)
+        while any(h in self._busy for g, h in self._groups if g & pins):
+            self._idle.wait()
+        handle = self._handle_for(pins)
+        if busy:
+            self._busy.add(handle)
+        return handle
+
+    def _unclaim(self, handle):
+        with self._lock:
+            self._busy.discard(handle)
+            self._idle.notify_all()
+
+    def _group_pins(self, handle) -> frozenset:
+        return next(g for g, h in self._groups if h is handle)
+
+    def _apply(self, handle, values: dict):
+        """Drive/release pins of one handle; reconfigure only on direction change."""
+        redirect = any((v == "z") != (self._state.get(p) == "z") for p, v in values.items())
+        self._state.update(values)
+        if redirect:
+            handle.reconfigure({p: self._state[p] for p in sorted(self._group_pins(handle))})
+        else:
+            handle.set_values(values)
+
+    def _check(self, pins):
+        if self._allowed is not None:
+            bad = [p for p in pins if p not in self._allowed]
+            if bad:
+                raise ValueError(f"pin {bad[0]} not in allowed set")
+
+    # -- simple access --
+
+    def set(self, values: dict):
+        """values: pin -> 0 | 1 | "z"."""
+        self._check(values)
+        with self._lock:
+            self._apply(self._claim(values), values)
+
+    def status(self) -> dict:
+        pins = {}
+        with self._lock:
+            for group, handle in self._groups:
+                for p in sorted(group):
+                    try:
+                        pins[str(p)] = {"direction": "input" if self._state[p] == "z" else "output",
+                                        "value": handle.get_value(p)}
+                    except Exception:
+                        pins[str(p)] = {"direction": "unknown", "value": None}
+        return pins
+
+    def sample(self, pins) -> dict:
+        """Read input levels; pins not yet owned are requested as inputs."""
+        self._check(pins)
+        with self._lock:
+            handle = self._claim(pins)           # new pins start as inputs
+            return {str(p): {"direction": "input" if self._state[p] == "z" else "output",
+                             "value": handle.get_value(p)} for p in pins}
+
+    def close(self):
+        with self._lock:
+            while self._busy:
+                self._idle.wait()
+            for _, handle in self._groups:
+                handle.release()
+            self._groups = []
+
+    # -- sequences --
+
+    def run(self, steps: list, names: dict | None = None) -> dict:
+        """Execute a sequence; returns {"ok", "steps": [...], "total_us"}."""
+        ops = compile_sequence(steps, names or {})
+        pins = {p for op in ops for p in op["pins"]}
+        self._check(pins)
+        # Pins only waited on must be inputs for edge detection
+        driven = {p for op in ops if op["op"] != "wait_edge" for p in op["pins"]}
+        watch = {p: "z" for p in pins - driven if self._state.get(p) != "z"}
+
+        with self._lock:
+            handle = self._claim(pins, busy=True)
+            try:
+                if watch:
+                    self._apply(handle, watch)
+                self._drain(handle)              # drop edges from before the run
+            except BaseException:
+                self._busy.discard(handle)
+                self._idle.notify_all()
+                raise
+        try:
+            return self._execute(handle, ops)
+        finally:
+            self._unclaim(handle)
+
+    def _execute(self, handle, ops) -> dict:
+        pause = _GcPause()
+        try:
+            return self._execute_steps(handle, ops, pause)
+        finally:
+            pause.end()
+
+    def _execute_steps(self, handle, ops, pause) -> dict:
+        results = []
+        t0 = last_change = _now_ns()
+
+        def us(ns):
+            return round(ns / 1000, 1)
+
+        for op in ops:
+            at = _now_ns()
+            res = {"op": op["op"], "at_us": us(at - t0)}
+            kind = op["op"]
+            if kind == "set":
+                pause.begin()
+                self._apply(handle, op["values"])
+                last_change = _now_ns()
+                pause.end()
+                res["pins"] = {str(p): v for p, v in op["values"].items()}
+            elif kind == "pulse":
+                pin = op["pin"]
+                restore = op["then"] if op["then"] is not None else self._state.get(pin, "z")
+                pause.begin()
+                self._apply(handle, {pin: op["level"]})
+                start = _now_ns()
+                pause.end()
+                _wait_until(start + op["ns"], pause)
+                self._apply(handle, {pin: restore})
+                last_change = _now_ns()
+                pause.end()
+                res.update(pin=op["name"], level=op["level"], width_us=us(last_change - start))
+            elif kind == "sleep":
+                _wait_until(at + op["ns"], pause)   # paused on to the next set
+                res["slept_us"] = us(_now_ns() - at)
+            elif kind == "wait_edge":
+                pause.end()                      # edges carry kernel timestamps
+                edge = self._wait_edge(handle, op, at + op["ns"])
+                res.update(pin=op["name"], edge=op["edge"])
+                if edge is None:
+                    res["timeout"] = True
+                    results.append(res)
+                    return {"ok": False, "error": f"timeout waiting for {op['edge']} edge on "
+                                                  f"{op['name']}", "steps": results,
+                            "total_us": us(_now_ns() - t0)}
+                rising, ts = edge
+                res.update(rising=rising, ts_ns=ts, latency_us=us(ts - last_change))
+                last_change = ts
+            results.append(res)
+        return {"ok": True, "steps": results, "total_us": us(_now_ns() - t0)}
+
+    def capture(self, pins: list, duration_ms: float, names: dict | None = None,
+                max_edges: int = 10_000, steps: list | None = None,
+                include_edges: bool = True) -> dict:
+        """Record edges on input pins for duration_ms (optionally while a
+        sequence runs); returns per-pin edges and pulse statistics."""
+        names = names or {}
+        if not isinstance(pins, list) or not pins:
+            raise ValueError("capture needs a non-empty pin list")
+        if not isinstance(duration_ms, (int, float)) or not 0 < duration_ms <= MAX_CAPTURE_MS:
+            raise ValueError(f"duration_ms must be in (0, {MAX_CAPTURE_MS}]")
+        if not isinstance(max_edges, int) or not 0 < max_edges <= MAX_CAPTURE_EDGES:
+            raise ValueError(f"max_edges must be in (0, {MAX_CAPTURE_EDGES}]")
+        watch = dict(resolve_pin(ref, names) for ref in pins)
+        ops = compile_sequence(steps, names) if steps else []
+        if any(op["op"] == "wait_edge" for op in ops):
+            raise ValueError("wait_edge steps cannot run inside a capture")
+        if set(watch) & {p for op in ops for p in op["pins"]}:
+            raise ValueError("captured pins cannot be driven by the sequence")
+        all_pins = set(watch) | {p for op in ops for p in op["pins"]}
+        self._check(all_pins)
+
+        ts_all, pin_all, rise_all, seq_all = [], [], [], []
+        with self._lock:
+            handle = self._claim(all_pins, busy=True)
+            try:
+                release = {p: "z" for p in watch if self._state.get(p) != "z"}
+                if release:
+                    self._apply(handle, release)
+                initial = {p: handle.get_value(p) for p in watch}
+                self._drain(handle)              # drop edges from before the capture
+            except BaseException:
+                self._busy.discard(handle)
+                self._idle.notify_all()
+                raise
+        try:
+            t0 = _now_ns()
+            deadline = t0 + int(duration_ms * 1_000_000)
+            seq_result = self._execute(handle, ops) if ops else None
+            while len(ts_all) < max_edges:
+                remaining = deadline - _now_ns()
+                if remaining <= 0 or not handle.wait_edges(remaining / 1e9):
+                    break
+                ts, pins_b, rising, seq = handle.read_edge_batch()
+                ts_all += ts
+                pin_all += pins_b
+                rise_all += rising
+                seq_all += seq
+        finally:
+            self._unclaim(handle)
+
+        result = {"ok": True, "t0_ns": t0, "duration_ms": duration_ms,
+                  "truncated": len(ts_all) >= max_edges, "pins": {}}
+        if seq_result is not None:
+            result["sequence"] = seq_result
+        for pin, name in watch.items():
+            idx = [i for i, p in enumerate(pin_all[:max_edges]) if p == pin]
+            t_ns = [ts_all[i] for i in idx]
+            levels = [1 if rise_all[i] else 0 for i in idx]
+            seqs = [seq_all[i] for i in idx]
+            lost = (seqs[-1] - seqs[0] + 1 - len(seqs)) if seqs else 0
+            entry = {"initial": initial[pin], "count": len(t_ns), "lost": lost}
+            entry.update(edge_stats(t_ns, levels, t0))
+            if include_edges:
+                entry["t_us"] = [round((t - t0) / 1000, 1) for t in t_ns]
+                entry["level"] = levels
+            result["pins"][name] = entry
+        return result
+
+    @staticmethod
+    def _drain(handle):
+        """Drop queued edges; a read with nothing queued would block."""
+        while handle.wait_edges(0):
+            if not handle.read_edge_batch()[0]:
+                break
+
+    @staticmethod
+    def _wait_edge(handle, op, deadline):
+        pin, want = op["pin"], op["edge"]
+        while True:
+            remaining = deadline - _now_ns()
+            if remaining <= 0 or not handle.wait_edges(remaining / 1e9):
+                return None
+            for p, rising, ts in handle.read_edges():
+                if p == pin and (want == "both" or rising == (want == "rising")):
+                    return rising, ts
+
+
+def _summary(values: list) -> dict | None:
+    if not values:
+        return None
+    return {"min": round(min(values), 1), "max": round(max(values), 1),
+            "mean": round(sum(values) / len(values), 1)}
+
+
+def edge_stats(t_ns: list, levels: list, t0_ns: int) -> dict:
+    """Pulse widths, periods, frequency and duty cycle from one pin's edges.
+
+    levels[i] is the level after edge i. A high pulse is a rising edge
+    followed by a falling edge; periods are measured rising to rising.
+    """
+    high, low = [], []
+    for i in range(1, len(t_ns)):
+        (high if levels[i - 1] else low).append((t_ns[i] - t_ns[i - 1]) / 1000)
+    rises = [t for t, lv in zip(t_ns, levels) if lv]
+    periods = [(b - a) / 1000 for a, b in zip(rises, rises[1:])]
+    out = {"first_us": round((t_ns[0] - t0_ns) / 1000, 1) if t_ns else None,
+           "high_us": _summary(high), "low_us": _summary(low), "period_us": _summary(periods)}
+    if periods:
+        mean = sum(periods) / len(periods)
+        out["freq_hz"] = round(1e6 / mean, 2)
+        if high:
+            out["duty"] = round(sum(high) / len(high) / mean, 4)
+    return out
+
+
+def resolve_pin(ref, names: dict) -> tuple:
+    """Pin reference (name, BCM number or digit string) -> (pin, name)."""
+    if isinstance(ref, bool):
+        raise ValueError(f"bad pin {ref!r}")
+    if isinstance(ref, int):
+        return ref, str(ref)
+    if isinstance(ref, str) and ref in names and names[ref] is not None:
+        return names[ref], ref
+    if isinstance(ref, str) and ref.isdigit():
+        return int(ref), ref
+    raise ValueError(f"unknown pin {ref!r}")
+
+
+def compile_sequence(steps: list, names: dict) -> list:
+    """Validate steps and resolve pin names; raises ValueError."""
+    if not isinstance(steps, list) or not steps:
+        raise ValueError("steps must be a non-empty list")
+    if len(steps) > MAX_STEPS:
+        raise ValueError(f"at most {MAX_STEPS} steps")
+
+    def pin_of(ref):
+        return resolve_pin(ref, names)
+
+    def level(v, allow_z=True):
+        if v in (0, 1) and not isinstance(v, bool) or (allow_z and v == "z"):
+            return v
+        raise ValueError(f"bad level {v!r}")
+
+    def duration(v, scale, what):
+        if not isinstance(v, (int, float)) or isinstance(v, bool) or v < 0:
+            raise ValueError(f"bad {what} {v!r}")
+        return int(v * scale)
+
+    ops = []
+    budget = 0
+    for i, step in enumerate(steps):
+        if not isinstance(step, dict):
+            raise ValueError(f"step {i}: not an object")
+        if "set" in step:
+            if not isinstance(step["set"], dict) or not step["set"]:
+                raise ValueError(f"step {i}: set needs pins")
+            values = {}
+            for ref, v in step["set"].items():
+                values[pin_of(ref)[0]] = level(v)
+            ops.append({"op": "set", "values": values, "pins": list(values)})
+        elif "pulse" in step:
+            pin, name = pin_of(step["pulse"])
+            ns = duration(step.get("us", 100), 1000, "pulse width")
+            then = step.get("then")
+            ops.append({"op": "pulse", "pin": pin, "name": name, "ns": ns,
+                        "level": level(step.get("level", 0), allow_z=False),
+                        "then": level(then) if then is not None else None, "pins": [pin]})
+        elif "sleep_us" in step:
+            ns = duration(step["sleep_us"], 1000, "sleep_us")
+            ops.append({"op": "sleep", "ns": ns, "pins": []})
+        elif "wait_edge" in step:
+            pin, name = pin_of(step["wait_edge"])
+            edge = step.get("edge", "both")
+            if edge not in EDGES:
+                raise ValueError(f"step {i}: edge must be one of {', '.join(EDGES)}")
+            ns = duration(step.get("timeout_ms", 1000), 1_000_000, "timeout_ms")
+            ops.append({"op": "wait_edge", "pin": pin, "name": name, "edge": edge,
+                        "ns": ns, "pins": [pin]})
+        else:
+            raise ValueError(f"step {i}: unknown step {sorted(step)}")
+        budget += ops[-1].get("ns", 0)
+    if budget > MAX_SEQUENCE_US * 1000:
+        raise ValueError(f"sequence longer than {MAX_SEQUENCE_US // 1_000_000} s")
+    return ops
@@ -9,7 +9,7 @@ echo "=== Installing RFC2217 Portal v5 ==="
 # Install dependencies
 echo "Installing dependencies..."
 sudo apt-get install -y python3-serial python3-pip hostapd dnsmasq-base curl bluetooth bluez
-sudo pip3 install esptool bleak --break-system-packages 2>/dev/null || true
+sudo pip3 install esptool esp-coredump bleak --break-system-packages 2>/dev/null || true
 
 # Disable hostapd/dnsmasq system services (we manage them ourselves)
 sudo systemctl disable --now hostapd 2>/dev/null || true
@@ -25,16 +25,26 @@ sudo cp "$SCRIPT_DIR/portal.py" /usr/local/bin/rfc2217-portal
 sudo cp "$SCRIPT_DIR/plain_rfc2217_server.py" /usr/local/bin/plain_rfc2217_server.py
 sudo cp "$SCRIPT_DIR/wifi_controller.py" /usr/local/bin/wifi_controller.py
 sudo cp "$SCRIPT_DIR/ble_controller.py" /usr/local/bin/ble_controller.py
+sudo cp "$SCRIPT_DIR/uevent_monitor.py" /usr/local/bin/uevent_monitor.py
+sudo cp "$SCRIPT_DIR/flap_detector.py" /usr/local/bin/flap_detector.py
+sudo cp "$SCRIPT_DIR/gpio_sequencer.py" /usr/local/bin/gpio_sequencer.py
+sudo cp "$SCRIPT_DIR/session_hub.py" /usr/local/bin/session_hub.py
+sudo cp "$SCRIPT_DIR/lease_manager.py" /usr/local/bin/lease_manager.py
+sudo cp "$SCRIPT_DIR/flash_orchestrator.py" /usr/local/bin/flash_orchestrator.py
+sudo cp "$SCRIPT_DIR/serial_tuning.py" /usr/local/bin/serial_tuning.py
+sudo cp "$SCRIPT_DIR/usb_bus.py" /usr/local/bin/usb_bus.py
+sudo cp "$SCRIPT_DIR/slot_actor.py" /usr/local/bin/slot_actor.py
+sudo cp "$SCRIPT_DIR/port_map.py" /usr/local/bin/port_map.py
+sudo cp "$SCRIPT_DIR/proxy_activator.py" /usr/local/bin/proxy_activator.py
 sudo cp "$SCRIPT_DIR/rfc2217-learn-slots" /usr/local/bin/rfc2217-learn-slots
 
 sudo chmod +x /usr/local/bin/rfc2217-portal
 sudo chmod +x /usr/local/bin/plain_rfc2217_server.py
 sudo chmod +x /usr/local/bin/rfc2217-learn-slots
 
-# Install udev notify script
-echo "Installing udev notify script..."
-sudo cp "$SCRIPT_DIR/scripts/rfc2217-udev-notify.sh" /usr/local/bin/rfc2217-udev-notify.sh
-sudo chmod +x /usr/local/bin/rfc2217-udev-notify.sh
+# Hotplug events now come from the portal's own netlink monitor; remove the
+# old udev rule -> notify script chain so events are not delivered twice
+sudo rm -f /etc/udev/rules.d/99-rfc2217-hotplug.rules /usr/local/bin/rfc2217-udev-notify.sh
 
 # Install WiFi lease notify script
 echo "Installing WiFi lease notify script..."
@@ -57,6 +67,9 @@ sudo mkdir -p /tmp/wifi-tester
 echo "Creating firmware directory..."
 sudo mkdir -p /var/lib/rfc2217/firmware
 
+# Core dumps uploaded by DUTs after a crash
+sudo mkdir -p /var/lib/rfc2217/coredumps
+
 # Configure eth0 for DHCP (if not already configured)
 if ! grep -q "eth0" /etc/network/interfaces 2>/dev/null; then
     echo "Configuring eth0 for DHCP..."
@@ -79,10 +92,6 @@ fi
 echo "Installing systemd services..."
 sudo cp "$SCRIPT_DIR/systemd/rfc2217-portal.service" /etc/systemd/system/
 
-# Install udev rules
-echo "Installing udev rules..."
-sudo cp "$SCRIPT_DIR/udev/99-rfc2217-hotplug.rules" /etc/udev/rules.d/
-
 # Reload systemd and udev
 echo "Reloading systemd and udev..."
 sudo systemctl daemon-reload
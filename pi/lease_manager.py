@@ -0,0 +1,188 @@
+"""
+Lease manager — exclusive, expiring use of slots and the Pi radio.
+
+Parallel test workers each lease a slot ("any" picks a free, present one)
+for the whole run, and lease the radio only around tests that drive wlan0,
+so radio tests serialize across workers while serial/GPIO work runs in
+parallel.
+
+A lease is a token covering one or more resources ("slot:SLOT1",
+"radio"). It expires after ttl seconds unless renewed, so a crashed worker
+frees its slot on its own. Acquire can wait: waiters sleep on a condition
+and wake on every release or expiry, in arrival order per resource.
+
+Endpoints that touch a leased resource check the caller's tokens with
+conflict(); with no leases held everything behaves as before.
+"""
+
+import itertools
+import secrets
+import threading
+import time
+
+RADIO = "radio"
+DEFAULT_TTL_S = 60
+MAX_TTL_S = 600
+MAX_WAIT_S = 30          # server-side cap; clients loop for longer waits
+
+
+def slot_resource(label: str) -> str:
+    return f"slot:{label}"
+
+
+class Lease:
+    __slots__ = ("token", "holder", "resources", "slot", "ttl", "acquired", "expires")
+
+    def __init__(self, token: str, holder: str, resources: tuple, slot: str | None,
+                 ttl: float, now: float):
+        self.token = token
+        self.holder = holder
+        self.resources = resources
+        self.slot = slot
+        self.ttl = ttl
+        self.acquired = now
+        self.expires = now + ttl
+
+    def info(self, now: float) -> dict:
+        return {"token": self.token, "holder": self.holder, "slot": self.slot,
+                "radio": RADIO in self.resources, "resources": list(self.resources),
+                "ttl": self.ttl, "acquired": self.acquired,
+                "expires_in": round(max(0.0, self.expires - now), 3)}
+
+
+class LeaseManager:
+    def __init__(self, slot_labels=lambda: [], clock=time.monotonic):
+        """*slot_labels* returns the labels of slots that "any" may pick."""
+        self._slot_labels = slot_labels
+        self._clock = clock
+        self._cond = threading.Condition()
+        self._leases: dict[str, Lease] = {}          # by token
+        self._owner: dict[str, Lease] = {}           # by resource
+        self._tickets = itertools.count()
+        self._queue: dict[int, tuple] = {}           # ticket -> wanted resources
+
+    # -- internals (call with _cond held) --
+
+    def _expire(self, now: float):
+        dead = [l for l in self._leases.values() if l.expires <= now]
+        for lease in dead:
+            self._drop(lease)
+        if dead:
+            self._cond.notify_all()
+
+    def _drop(self, lease: Lease):
+        self._leases.pop(lease.token, None)
+        for r in lease.resources:
+            if self._owner.get(r) is lease:
+                del self._owner[r]
+
+    def _blocked_by_queue(self, ticket: int, wanted: set) -> bool:
+        """An earlier waiter wants one of these resources (FIFO fairness)."""
+        return any(t < ticket and wanted & set(res) for t, res in self._queue.items())
+
+    def _pick(self, ticket: int, slot: str | None, radio: bool) -> tuple | None:
+        """Resources to grant now, or None if something is busy."""
+        extra = (RADIO,) if radio else ()
+        if slot is None:
+            candidates = [None]
+        elif slot == "any":
+            candidates = [l for l in self._slot_labels()
+                          if slot_resource(l) not in self._owner]
+        else:
+            candidates = [slot]
+        for label in candidates:
+            res = ((slot_resource(label),) if label else ()) + extra
+            if any(r in self._owner for r in res):
+                continue
+            if self._blocked_by_queue(ticket, set(res)):
+                continue
+            return label, res
+        return None
+
+    def _next_expiry(self, now: float) -> float | None:
+        if not self._leases:
+            return None
+        return max(0.0, min(l.expires for l in self._leases.values()) - now)
+
+    # -- API --
+
+    def acquire(self, holder: str, slot: str | None = None, radio: bool = False,
+                ttl: float = DEFAULT_TTL_S, wait: float = 0) -> Lease | None:
+        """Lease *slot* (a label, "any" or None) and/or the radio.
+
+        Waits up to *wait* seconds (capped at MAX_WAIT_S); returns None if
+        the resources are still busy.
+        """
+        if slot is None and not radio:
+            raise ValueError("nothing to lease: give slot and/or radio")
+        if slot == "any" and not self._slot_labels():
+            raise ValueError("no slots available to lease")
+        if slot not in (None, "any") and slot not in self._slot_labels():
+            raise ValueError(f"slot '{slot}' not found")
+        ttl = min(max(float(ttl), 1.0), MAX_TTL_S)
+        deadline = time.monotonic() + min(max(float(wait), 0.0), MAX_WAIT_S)
+
+        with self._cond:
+            ticket = next(self._tickets)
+            # "any" doesn't reserve a particular slot, so it only queues for the radio
+            self._queue[ticket] = (((slot_resource(slot),) if slot not in (None, "any") else ())
+                                   + ((RADIO,) if radio else ()))
+            try:
+                while True:
+                    now = self._clock()
+                    self._expire(now)
+                    got = self._pick(ticket, slot, radio)
+                    if got is not None:
+                        label, res = got
+                        lease = Lease(secrets.token_hex(8), holder, res, label, ttl, now)
+                        self._leases[lease.token] = lease
+                        for r in res:
+                            self._owner[r] = lease
+                        return lease
+                    remaining = deadline - time.monotonic()
+                    if remaining <= 0:
+                        return None
+                    nxt = self._next_expiry(now)
+                    self._cond.wait(remaining if nxt is None else min(remaining, nxt + 0.01))
+            finally:
+                del self._queue[ticket]
+                self._cond.notify_all()
+
+    def renew(self, token: str, ttl: float | None = None) -> Lease | None:
+        with self._cond:
+            now = self._clock()
+            self._expire(now)
+            lease = self._leases.get(token)
+            if lease is None:
+                return None
+            if ttl is not None:
+                lease.ttl = min(max(float(ttl), 1.0), MAX_TTL_S)
+            lease.expires = now + lease.ttl
+            return lease
+
+    def release(self, token: str) -> bool:
+        with self._cond:
+            lease = self._leases.get(token)
+            if lease is None:
+                return False
+            self._drop(lease)
+            self._cond.notify_all()
+            return True
+
+    def conflict(self, tokens, slot: str | None = None, radio: bool = False) -> Lease | None:
+        """The lease blocking a caller holding *tokens* from using these
+        resources, or None if they are free or held by the caller."""
+        tokens = set(tokens or ())
+        with self._cond:
+            self._expire(self._clock())
+            for r in ((slot_resource(slot),) if slot else ()) + ((RADIO,) if radio else ()):
+                lease = self._owner.get(r)
+                if lease is not None and lease.token not in tokens:
+                    return lease
+            return None
+
+    def snapshot(self) -> list:
+        with self._cond:
+            now = self._clock()
+            self._expire(now)
+            return [l.info(now) for l in sorted(self._leases.values(), key=lambda l: l.acquired)]
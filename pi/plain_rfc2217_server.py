@@ -17,6 +17,11 @@ the C3 native USB needs.
 
 The portal detects ttyACM devices and launches this server instead
 of esp_rfc2217_server automatically.
+
+For lazily started slots the portal passes its listening socket as
+--fd (the first client is already waiting in its backlog) and
+--idle-exit, so the server goes away again when nobody uses the slot.
+"ready" on stdout tells the portal the serial port is open.
 """
 import argparse
 import logging
@@ -28,12 +33,18 @@ import time
 import serial
 import serial.rfc2217
 
+import serial_tuning
+
 
 def main():
     parser = argparse.ArgumentParser(
         description="Plain RFC2217 server (direct DTR/RTS passthrough)")
     parser.add_argument("SERIALPORT")
     parser.add_argument("-p", "--localport", type=int, default=2217)
+    parser.add_argument("--fd", type=int, default=None,
+                        help="inherited listening socket instead of binding --localport")
+    parser.add_argument("--idle-exit", type=float, default=0,
+                        help="exit after this many seconds without a client (0: never)")
     parser.add_argument("-v", "--verbose", dest="verbosity",
                         action="count", default=0)
     args = parser.parse_args()
@@ -67,25 +78,40 @@ def main():
     ser.rts = False          # Release reset — chip boots normally
     time.sleep(0.1)
     settings = ser.get_settings()
-
-    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-    srv.bind(("", args.localport))
-    srv.listen(1)
-    logging.info("Listening on port %d for %s", args.localport,
+    # Bridge latency timer and ASYNC_LOW_LATENCY: every esptool command
+    # through this proxy waits for its response to leave the bridge.
+    tuned = serial_tuning.tune(ser, args.SERIALPORT)
+    logging.info("%s: bridge %s, low_latency %s, latency_timer %s ms",
+                 args.SERIALPORT, tuned["bridge"], tuned["low_latency"],
+                 tuned["latency_timer_ms"])
+
+    if args.fd is not None:
+        srv = socket.socket(fileno=args.fd)
+    else:
+        srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        srv.bind(("", args.localport))
+        srv.listen(1)
+    logging.info("Listening on port %d for %s", srv.getsockname()[1],
                  args.SERIALPORT)
+    print("ready", flush=True)
 
     while True:
-        srv.settimeout(5)
+        srv.settimeout(min(5, args.idle_exit or 5))
         conn = None
+        idle_since = time.monotonic()
         try:
             while conn is None:
                 try:
                     conn, addr = srv.accept()
                 except TimeoutError:
-                    pass
+                    if args.idle_exit and time.monotonic() - idle_since >= args.idle_exit:
+                        break
         except KeyboardInterrupt:
             break
+        if conn is None:
+            logging.info("No client for %.0f s, exiting", args.idle_exit)
+            break
 
         logging.info("Client connected from %s", addr)
         conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
@@ -140,6 +166,8 @@ def main():
         ser.rts = False
         ser.apply_settings(settings)
 
+    ser.close()
+
 
 if __name__ == "__main__":
     main()
@@ -0,0 +1,157 @@
+"""
+Port map — TCP ports for USB serial devices that have no slots.json entry.
+
+slots.json pins known connectors to fixed ports; every other device used to
+be tracked without a proxy until someone edited the file and restarted the
+portal. The portal now gives such a device a port from AUTO_PORTS (e.g.
+"4100-4199") the first time it is plugged in, and keeps the assignment in a
+JSON file so it survives restarts:
+
+  - a device with a USB serial number (FTDI, CP210x, ESP32 native USB) is
+    matched by serial first, so it keeps its port when moved to another
+    hub port — unless the entry's old connector is in use, since cheap
+    bridges share serials like "0001"
+  - otherwise it is matched by slot_key (the physical connector)
+  - a new device gets the lowest free port; when the range is full, the
+    entry seen longest ago whose connector is not in use is recycled
+
+Labels are derived from the port ("AUTO4100"), so they are stable too.
+Ports of configured slots (and the portal's own) are reserved.
+"""
+
+import json
+import os
+import threading
+import time
+
+
+class PortsExhausted(Exception):
+    pass
+
+
+def parse_range(spec: str) -> tuple[int, int] | None:
+    """'4100-4199' -> (4100, 4199); '' -> None (allocation off)."""
+    spec = (spec or "").strip()
+    if not spec:
+        return None
+    lo, sep, hi = spec.partition("-")
+    lo, hi = int(lo), int(hi if sep else lo)
+    if not 0 < lo <= hi < 65536:
+        raise ValueError(f"bad port range {spec!r}")
+    return lo, hi
+
+
+def label_for(port: int) -> str:
+    return f"AUTO{port}"
+
+
+class PortMap:
+    def __init__(self, path: str | None, lo: int, hi: int, reserved=(), clock=time.time):
+        self.path = path
+        self.lo = lo
+        self.hi = hi
+        self.reserved = set(reserved)
+        self._clock = clock
+        self._lock = threading.Lock()
+        self._entries: dict[int, dict] = {}     # port -> entry
+        self.recycled = 0
+        self._load()
+
+    # -- persistence --
+
+    def _load(self):
+        if not self.path:
+            return
+        try:
+            with open(self.path) as f:
+                data = json.load(f)
+        except FileNotFoundError:
+            return
+        except (OSError, ValueError) as e:
+            print(f"[ports] ignoring unreadable {self.path}: {e}", flush=True)
+            return
+        for e in data.get("entries", []):
+            port = e.get("port")
+            if isinstance(port, int) and self.lo <= port <= self.hi and port not in self.reserved:
+                self._entries[port] = {"port": port, "label": label_for(port),
+                                       "slot_key": e.get("slot_key"),
+                                       "usb_serial": e.get("usb_serial"),
+                                       "assigned": e.get("assigned"),
+                                       "last_seen": e.get("last_seen")}
+
+    def _save(self):
+        if not self.path:
+            return
+        data = {"range": [self.lo, self.hi],
+                "entries": [self._entries[p] for p in sorted(self._entries)]}
+        tmp = self.path + ".tmp"
+        try:
+            os.makedirs(os.path.dirname(self.path) or ".", exist_ok=True)
+            with open(tmp, "w") as f:
+                json.dump(data, f, indent=1)
+            os.replace(tmp, self.path)
+        except OSError as e:
+            print(f"[ports] cannot save {self.path}: {e}", flush=True)
+
+    # -- API --
+
+    def lookup(self, slot_key: str) -> dict | None:
+        with self._lock:
+            for e in self._entries.values():
+                if e["slot_key"] == slot_key:
+                    return dict(e)
+            return None
+
+    def assign(self, slot_key: str, usb_serial: str | None = None, in_use=()) -> dict:
+        """Port entry for a device on *slot_key*; *in_use* holds the slot
+        keys of devices currently plugged in. Raises PortsExhausted."""
+        in_use = set(in_use) - {slot_key}
+        now = self._clock()
+        with self._lock:
+            entry = None
+            if usb_serial:
+                entry = next((e for e in self._entries.values()
+                              if e["usb_serial"] == usb_serial
+                              and e["slot_key"] not in in_use), None)
+            if entry is None:
+                entry = next((e for e in self._entries.values()
+                              if e["slot_key"] == slot_key), None)
+            if entry is None:
+                entry = self._new_entry(in_use)
+                entry["assigned"] = now
+            changed = (entry["slot_key"], entry["usb_serial"]) != (slot_key, usb_serial or
+                                                                    entry["usb_serial"])
+            if changed:
+                # the connector now belongs to this entry alone
+                for other in self._entries.values():
+                    if other is not entry and other["slot_key"] == slot_key:
+                        other["slot_key"] = None
+            entry["slot_key"] = slot_key
+            entry["usb_serial"] = usb_serial or entry["usb_serial"]
+            entry["last_seen"] = now
+            if changed:
+                self._save()
+            return dict(entry)
+
+    def _new_entry(self, in_use: set) -> dict:
+        for port in range(self.lo, self.hi + 1):
+            if port not in self._entries and port not in self.reserved:
+                entry = self._entries[port] = {"port": port, "label": label_for(port),
+                                               "slot_key": None, "usb_serial": None,
+                                               "assigned": None, "last_seen": None}
+                return entry
+        idle = [e for e in self._entries.values() if e["slot_key"] not in in_use]
+        if not idle:
+            raise PortsExhausted(f"all ports {self.lo}-{self.hi} in use")
+        entry = min(idle, key=lambda e: e["last_seen"] or 0)
+        print(f"[ports] recycling {entry['port']} (last seen on {entry['slot_key']})", flush=True)
+        entry.update(slot_key=None, usb_serial=None)
+        self.recycled += 1
+        return entry
+
+    def snapshot(self) -> dict:
+        with self._lock:
+            size = self.hi - self.lo + 1 - len(self.reserved & set(range(self.lo, self.hi + 1)))
+            return {"range": [self.lo, self.hi], "assigned": len(self._entries),
+                    "free": size - len(self._entries), "recycled": self.recycled,
+                    "entries": [dict(self._entries[p]) for p in sorted(self._entries)]}
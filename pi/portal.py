@@ -7,10 +7,11 @@ plain_rfc2217_server.py lifecycle.  On hotplug add → start proxy; on remove 
 Slot configuration is loaded from slots.json.
 """
 
+import hashlib
 import http.server
 import json
 import os
-import signal
+import select
 import socket
 import subprocess
 import sys
@@ -19,6 +20,17 @@ import time
 from datetime import datetime, timezone
 from urllib.parse import parse_qs, urlparse
 
+import flap_detector
+import flash_orchestrator
+import gpio_sequencer
+import lease_manager
+import port_map
+import proxy_activator
+import serial_tuning
+import session_hub
+import slot_actor
+import uevent_monitor
+import usb_bus
 import wifi_controller
 try:
     import ble_controller
@@ -30,11 +42,16 @@ CONFIG_FILE = os.environ.get("RFC2217_CONFIG", "/etc/rfc2217/slots.json")
 PROXY_EXE = "/usr/local/bin/plain_rfc2217_server.py"
 
 # Flap detection — suppress proxy restarts during USB connect/disconnect storms
-FLAP_WINDOW_S = 30       # Look at events within this window
-FLAP_THRESHOLD = 6        # 6 events in 30s = 3 connect/disconnect cycles
 FLAP_COOLDOWN_S = 10      # After flapping, wait before recovery attempt
 FLAP_MAX_RETRIES = 2      # Max no-GPIO recovery attempts before manual intervention
 
+# Hotplug source: "netlink" (in-process uevent monitor, default) or "none"
+# (events only via POST /api/hotplug, e.g. injected by tests).
+# UEVENT_GROUP=kernel listens to raw kernel events (no ID_PATH) instead of udev.
+HOTPLUG_SOURCE = os.environ.get("HOTPLUG_SOURCE", "netlink")
+UEVENT_GROUP = os.environ.get("UEVENT_GROUP", "udev")
+UEVENT_RECORD = os.environ.get("UEVENT_RECORD")   # optional JSONL trace of raw uevents
+
 # Native USB (ttyACM) boot delay — let ESP32-C3 boot past download-mode window
 # before opening the port (Linux cdc_acm asserts DTR+RTS on open, which triggers
 # the USB-Serial/JTAG controller's auto-download if the chip is still in early boot)
@@ -44,6 +61,7 @@ NATIVE_USB_BOOT_DELAY_S = 2
 STATE_ABSENT     = "absent"
 STATE_IDLE       = "idle"
 STATE_RESETTING  = "resetting"
+STATE_FLASHING   = "flashing"
 STATE_MONITORING = "monitoring"
 STATE_FLAPPING      = "flapping"
 STATE_RECOVERING    = "recovering"
@@ -55,31 +73,91 @@ seq_counter: int = 0
 host_ip: str = "127.0.0.1"  # refreshed periodically; see _refresh_host_ip()
 hostname: str = "localhost"
 
+# Slot actors — every change to a slot (hotplug event, proxy start/stop,
+# serial reset and monitor, flash hand-over, flap recovery, GPIO release)
+# runs as a command in that slot's mailbox, on SLOT_WORKERS shared threads.
+# After each command the slot's JSON view in _slot_views is replaced, and
+# readers use the views, never the slot dicts. See slot_actor.py.
+SLOT_WORKERS = int(os.environ.get("SLOT_WORKERS", slot_actor.DEFAULT_WORKERS))
+HOTPLUG_WAIT_S = 10
+_actors = slot_actor.SlotActors(SLOT_WORKERS, after=lambda key: _publish(slots.get(key)))
+_slot_views: dict[str, dict] = {}
+
+# Auto ports — a USB serial device without a slots.json entry gets a TCP
+# port from AUTO_PORTS, kept in PORT_MAP_FILE by USB serial number and
+# slot_key so it is the same after replugging or a restart (port_map.py).
+# Such slots are lazy, as is any configured slot with "lazy": true: the
+# portal only listens on the port, starts the proxy on the first client
+# connect and lets it exit after PROXY_IDLE_S without one
+# (proxy_activator.py). AUTO_PORTS="" turns allocation off.
+AUTO_PORTS = os.environ.get("AUTO_PORTS", "4100-4199")
+PORT_MAP_FILE = os.environ.get("PORT_MAP_FILE", "/var/lib/rfc2217/ports.json")
+PROXY_IDLE_S = float(os.environ.get("PROXY_IDLE_S", "60"))
+PROXY_READY_S = 2.5
+_ports: "port_map.PortMap | None" = None      # created in main() from the config
+_activator = proxy_activator.Activator(
+    lambda key: _actors.tell(key, _activate, slots[key]),
+    lambda key, pid: _actors.tell(key, _proxy_exited, slots[key], pid))
+
+# Published views bump a version; GET /api/devices?since=V&timeout=S
+# long-polls on it so clients wait for a state instead of polling.
+_slots_cond = threading.Condition()
+_slots_version: int = 0
+DEVICES_POLL_MAX_S = 30
+
+# Hotplug events from every source go through one dispatcher thread, in order
+_hotplug_dispatcher = uevent_monitor.HotplugDispatcher(
+    lambda *args: process_hotplug(*args))
+_uevent_monitor: "uevent_monitor.UeventMonitor | None" = None
+
 # Activity log — recent operations visible in UI
 import collections
 activity_log: collections.deque = collections.deque(maxlen=200)
 _enter_portal_running: bool = False
 
-# Human interaction — test scripts block on POST /api/human-interaction
-# until the operator clicks Done/Cancel on the web UI.
-_human_event: threading.Event | None = None
-_human_confirmed: bool = False
-_human_message: str | None = None
-_human_lock = threading.Lock()
-
-# Test progress — test scripts push updates via POST /api/test/update,
-# UI polls via GET /api/test/progress.
-_test_lock = threading.Lock()
-_test_session = None  # dict or None; see _handle_test_update for schema
-
-# GPIO control — drive Pi GPIO pins from test scripts (e.g. hold DUT GPIO low)
-import gpiod
-
-_gpio_lock = threading.Lock()
-_gpio_chip = None       # gpiod.Chip, opened lazily
-_gpio_requests = {}     # pin -> gpiod.LineRequest
-_gpio_directions = {}   # pin -> "output" | "input"
+# Test sessions — progress (POST /api/test/update) and operator requests
+# (POST /api/human-interaction) are kept per session ID so parallel test
+# runs don't collide; UIs long-poll GET /api/sessions for changes.
+_sessions = session_hub.SessionHub()
+SESSIONS_POLL_MAX_S = 30
+
+# Leases — exclusive use of a slot and/or the Pi radio by one test worker,
+# so parallel runs can't reset each other's DUT or retune wlan0 mid-test.
+# Holders send their tokens in the X-Lease header; unleased resources stay
+# open to everyone. "any" picks from slots with a device present.
+_leases = lease_manager.LeaseManager(
+    lambda: [v["label"] for v in list(_slot_views.values()) if v["label"] and v["present"]])
+
+# USB bus budget — flashes, resets and OTA downloads are admitted per USB
+# host controller while their demand fits USB_BUS_BUDGET_KBPS, the rest
+# wait in line; serial monitors are counted only. On a Pi 3 the Ethernet
+# NIC shares the hub's bus, so OTA served over eth0 is charged there too.
+# GET /api/bus reports utilisation. See usb_bus.py.
+USB_BUS_BUDGET_KBPS = float(os.environ.get("USB_BUS_BUDGET_KBPS", usb_bus.DEFAULT_BUDGET_KBPS))
+USB_NET_BUS = os.environ.get("USB_NET_BUS")    # "" = NIC not on USB; unset = detect
+OTA_KBPS = float(os.environ.get("OTA_KBPS", "250"))
+RESET_BUS_WAIT_S = 60
+OTA_BUS_WAIT_S = 20
+_bus = usb_bus.BusScheduler(USB_BUS_BUDGET_KBPS)
+_net_bus = usb_bus.net_bus() if USB_NET_BUS is None else (USB_NET_BUS or None)
+
+# Local flashing — POST /api/flash writes an uploaded image set to several
+# slots in parallel from the Pi's own ttys (proxies suspended meanwhile);
+# GET /api/flash long-polls per-slot progress. See flash_orchestrator.py.
+_flasher = flash_orchestrator.FlashManager(
+    lambda label: _flash_suspend(label), lambda label: _flash_resume(label),
+    lambda job: _flash_ended(job),
+    admit=lambda label, baud: _bus.hold(_slot_bus(_find_slot_by_label(label)), "flash",
+                                        label, usb_bus.baud_kbps(baud)))
+FLASH_POLL_MAX_S = 30
+FLASH_READY_STATES = {STATE_IDLE, STATE_MONITORING, STATE_DOWNLOAD_MODE}
+
+# GPIO control — drive Pi GPIO pins from test scripts (e.g. hold DUT GPIO low).
+# Lines are requested on first use and kept; see gpio_sequencer.py.
+GPIO_CHIP = os.environ.get("GPIO_CHIP", "/dev/gpiochip0")
 GPIO_ALLOWED = {5, 6, 12, 13, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27}  # BCM GPIOs safe for DUT control
+GPIO_EN_PULSE_US = 100_000   # EN low time for a DUT reset (board RC needs ms, not µs)
+_gpio_bank = gpio_sequencer.GpioBank(gpio_sequencer.GpiodBackend(GPIO_CHIP), GPIO_ALLOWED)
 
 # UDP log receiver — ESP32 devices send debug logs over UDP to port 5555
 UDP_LOG_PORT = int(os.environ.get("UDP_LOG_PORT", "5555"))
@@ -88,49 +166,44 @@ _udp_log: collections.deque = collections.deque(maxlen=UDP_LOG_MAX_LINES)
 _udp_thread: threading.Thread | None = None
 _udp_shutdown = threading.Event()
 
+# Per-boot records pushed by the test firmware as "BOOTREC {json}" log lines
+BOOTREC_MARKER = "BOOTREC "
+BOOTREC_MAX_PER_SOURCE = 64
+BOOTREC_CRASH_RESETS = {"panic", "int_wdt", "task_wdt", "wdt", "brownout"}
+BOOTREC_INT_FIELDS = ("uptime_s", "heap_min_free", "heap_peak_used", "stack_min",
+                      "reconnects", "udp_drops")
+BOOTREC_STR_FIELDS = ("version", "reset", "stack_task")
+_bootrec: dict[str, collections.OrderedDict] = {}  # source ip -> boot -> record
+_bootrec_lock = threading.Lock()
+
 # OTA firmware repository — serve .bin files for ESP32 OTA updates
 FIRMWARE_DIR = os.environ.get("FIRMWARE_DIR", "/var/lib/rfc2217/firmware")
 
+# Core dumps uploaded by DUTs after a crash, decoded against ELFs in FIRMWARE_DIR
+COREDUMP_DIR = os.environ.get("COREDUMP_DIR", "/var/lib/rfc2217/coredumps")
+COREDUMP_MAX_SIZE = 1024 * 1024
+COREDUMP_DECODE_TIMEOUT = 120
+_coredump_lock = threading.Lock()
+_coredump_done: dict[str, tuple] = {}   # device -> last chunk of its finished upload
+
 
 def _gpio_set(pin, value):
     """Set a GPIO pin: value=0 (low), 1 (high), or "z" (input with pull-up)."""
-    global _gpio_chip
-    with _gpio_lock:
-        if _gpio_chip is None:
-            _gpio_chip = gpiod.Chip("/dev/gpiochip0")
-
-        if value == "z":
-            # Switch to input with pull-up (not floating)
-            if pin in _gpio_requests:
-                _gpio_requests[pin].release()
-                del _gpio_requests[pin]
-            _gpio_requests[pin] = _gpio_chip.request_lines(
-                consumer="serial-portal",
-                config={pin: gpiod.LineSettings(
-                    direction=gpiod.line.Direction.INPUT,
-                    bias=gpiod.line.Bias.PULL_UP,
-                )},
-            )
-            _gpio_directions[pin] = "input"
-            return
-
-        gval = gpiod.line.Value.ACTIVE if value else gpiod.line.Value.INACTIVE
-
-        # Request as output if not already, or reconfigure if switching from input
-        if pin not in _gpio_requests or _gpio_directions.get(pin) == "input":
-            if pin in _gpio_requests:
-                _gpio_requests[pin].release()
-                del _gpio_requests[pin]
-            _gpio_requests[pin] = _gpio_chip.request_lines(
-                consumer="serial-portal",
-                config={pin: gpiod.LineSettings(
-                    direction=gpiod.line.Direction.OUTPUT,
-                    output_value=gval,
-                )},
-            )
-        else:
-            _gpio_requests[pin].set_value(pin, gval)
-        _gpio_directions[pin] = "output"
+    _gpio_bank.set({pin: value})
+
+
+def _slot_gpio_names(slot: dict) -> dict:
+    """Pin names usable in a slot's GPIO sequences."""
+    return {"boot": slot.get("gpio_boot"), "en": slot.get("gpio_en")}
+
+
+def _slot_gpio_run(slot: dict, steps: list) -> dict:
+    """Run a GPIO sequence for a slot and log its measured timing."""
+    label = slot["label"] or slot["slot_key"][-20:]
+    result = _gpio_bank.run(steps, _slot_gpio_names(slot))
+    print(f"[portal] {label}: gpio sequence {'ok' if result['ok'] else 'failed'} "
+          f"in {result['total_us']:.0f} µs", flush=True)
+    return result
 
 
 # ---------------------------------------------------------------------------
@@ -228,11 +301,86 @@ def _udp_log_thread():
             line = line.rstrip("\r")
             if line:
                 _udp_log.append({"ts": ts, "source": source_ip, "line": line})
+                _bootrec_ingest(source_ip, ts, line)
                 log_activity(f"[{source_ip}] {line}", "info")
     sock.close()
     print("[udplog] stopped", flush=True)
 
 
+def _is_int(v) -> bool:
+    return isinstance(v, int) and not isinstance(v, bool)
+
+
+def _bootrec_parse(text: str) -> dict | None:
+    """A BOOTREC payload reduced to its known, correctly typed fields, or
+    None without a valid boot number. Anyone can send to the UDP log port,
+    so nothing downstream (sorting by boot) may trust the raw JSON."""
+    try:
+        raw = json.loads(text)
+    except ValueError:
+        return None
+    if not isinstance(raw, dict) or not _is_int(raw.get("boot")) or raw["boot"] < 0:
+        return None
+    rec = {"boot": raw["boot"]}
+    rec.update((k, raw[k]) for k in BOOTREC_INT_FIELDS if _is_int(raw.get(k)))
+    rec.update((k, raw[k][:64]) for k in BOOTREC_STR_FIELDS if isinstance(raw.get(k), str))
+    return rec
+
+
+def _bootrec_ingest(source_ip, ts, line):
+    """Keep the latest BOOTREC record per (source, boot number)."""
+    idx = line.find(BOOTREC_MARKER)
+    if idx < 0:
+        return
+    rec = _bootrec_parse(line[idx + len(BOOTREC_MARKER):])
+    if rec is None:
+        return
+    boot = rec["boot"]
+    rec["ts"] = ts
+    with _bootrec_lock:
+        recs = _bootrec.setdefault(source_ip, collections.OrderedDict())
+        recs[boot] = rec
+        recs.move_to_end(boot)
+        while len(recs) > BOOTREC_MAX_PER_SOURCE:
+            recs.popitem(last=False)
+
+
+def _bootrec_summary(source_ip):
+    """Records newest first, plus the number of consecutive crash resets."""
+    with _bootrec_lock:
+        recs = sorted(_bootrec.get(source_ip, {}).values(),
+                      key=lambda r: r["boot"], reverse=True)
+    crash_loop = 0
+    for rec in recs:
+        if rec.get("reset") not in BOOTREC_CRASH_RESETS:
+            break
+        crash_loop += 1
+    return {"source": source_ip, "crash_loop": crash_loop, "boots": recs}
+
+
+def _on_uevent(props):
+    args = uevent_monitor.hotplug_args(props)
+    if args:
+        _hotplug_dispatcher.submit(args)
+
+
+def start_hotplug_monitor():
+    """Start the hotplug dispatcher and, unless disabled, the netlink monitor."""
+    global _uevent_monitor
+    _hotplug_dispatcher.start()
+    if HOTPLUG_SOURCE != "netlink":
+        print("[portal] netlink hotplug monitor disabled (POST /api/hotplug only)", flush=True)
+        return
+    group = uevent_monitor.GROUP_KERNEL if UEVENT_GROUP == "kernel" else uevent_monitor.GROUP_UDEV
+    _uevent_monitor = uevent_monitor.UeventMonitor(_on_uevent, group=group,
+                                                   record_path=UEVENT_RECORD)
+    try:
+        _uevent_monitor.start()
+    except OSError as e:
+        _uevent_monitor = None
+        print(f"[portal] uevent monitor unavailable ({e}); POST /api/hotplug only", flush=True)
+
+
 def start_udp_log():
     """Start the UDP log receiver thread."""
     global _udp_thread
@@ -241,6 +389,91 @@ def start_udp_log():
     _udp_thread.start()
 
 
+# ---------------------------------------------------------------------------
+# Core dumps
+# ---------------------------------------------------------------------------
+
+def _safe_name(value):
+    """True for identifiers that are safe as file name components."""
+    return bool(value) and len(value) <= 64 and all(c.isalnum() or c in "-_." for c in value) \
+        and ".." not in value
+
+
+def _coredump_find_elf(project, elf_sha):
+    """Find the .elf in FIRMWARE_DIR whose SHA-256 starts with elf_sha.
+
+    The project directory is searched first, then every other project.
+    """
+    if not elf_sha or not os.path.isdir(FIRMWARE_DIR):
+        return None
+    dirs = sorted(os.listdir(FIRMWARE_DIR))
+    if project in dirs:
+        dirs.remove(project)
+        dirs.insert(0, project)
+    for d in dirs:
+        pdir = os.path.join(FIRMWARE_DIR, d)
+        if not os.path.isdir(pdir):
+            continue
+        for fname in sorted(os.listdir(pdir)):
+            if not fname.endswith(".elf"):
+                continue
+            fpath = os.path.join(pdir, fname)
+            h = hashlib.sha256()
+            with open(fpath, "rb") as f:
+                for chunk in iter(lambda: f.read(65536), b""):
+                    h.update(chunk)
+            if h.hexdigest().startswith(elf_sha.lower()):
+                return fpath
+    return None
+
+
+def _coredump_write_meta(meta):
+    path = os.path.join(COREDUMP_DIR, meta["name"] + ".json")
+    with open(path + ".tmp", "w") as f:
+        json.dump(meta, f, indent=2)
+    os.replace(path + ".tmp", path)
+
+
+def _coredump_decode(meta):
+    """Background: run esp-coredump on a completed upload, store the report."""
+    core = os.path.join(COREDUMP_DIR, meta["name"] + ".core")
+    elf = _coredump_find_elf(meta["project"], meta["elf_sha256"])
+    meta["elf"] = elf
+    if not elf:
+        meta["status"] = "no_elf"
+        _coredump_write_meta(meta)
+        log_activity(f"coredump {meta['name']}: no ELF matching sha256 {meta['elf_sha256']!r} "
+                     f"in {FIRMWARE_DIR}", "error")
+        return
+
+    cmd = ["esp-coredump", "info_corefile", "--core", core, "--core-format", "raw", elf]
+    try:
+        r = subprocess.run(cmd, capture_output=True, text=True, timeout=COREDUMP_DECODE_TIMEOUT)
+        report = r.stdout + (("\n" + r.stderr) if r.stderr else "")
+        meta["status"] = "decoded" if r.returncode == 0 else "decode_failed"
+    except (OSError, subprocess.TimeoutExpired) as e:
+        report = f"{' '.join(cmd)}: {e}"
+        meta["status"] = "decode_failed"
+    with open(os.path.join(COREDUMP_DIR, meta["name"] + ".txt"), "w") as f:
+        f.write(report)
+    _coredump_write_meta(meta)
+    log_activity(f"coredump {meta['name']}: {meta['status']} ({os.path.basename(elf)})",
+                 "ok" if meta["status"] == "decoded" else "error")
+
+
+def _coredump_list():
+    metas = []
+    if os.path.isdir(COREDUMP_DIR):
+        for fname in sorted(os.listdir(COREDUMP_DIR), reverse=True):
+            if fname.endswith(".json"):
+                try:
+                    with open(os.path.join(COREDUMP_DIR, fname)) as f:
+                        metas.append(json.load(f))
+                except (OSError, ValueError):
+                    continue
+    return metas
+
+
 # ---------------------------------------------------------------------------
 # Helpers
 # ---------------------------------------------------------------------------
@@ -259,6 +492,9 @@ def load_config(path: str) -> dict[str, dict]:
                 "tcp_port": entry["tcp_port"],
                 "gpio_boot": entry.get("gpio_boot"),
                 "gpio_en": entry.get("gpio_en"),
+                "lazy": bool(entry.get("lazy", False)),
+                "auto": False,
+                "listening": False,
                 "present": False,
                 "running": False,
                 "pid": None,
@@ -270,10 +506,18 @@ def load_config(path: str) -> dict[str, dict]:
                 "last_error": None,
                 "flapping": False,
                 "state": STATE_ABSENT,
-                "_event_times": [],
+                "serial": None,
+                "rtt_ms": None,
+                "_flap": flap_detector.FlapDetector.from_config(entry.get("flap")),
                 "_recovering": False,
                 "_recover_retries": 0,
-                "_lock": threading.Lock(),
+                "_lent": None,
+                "_lent_state": None,
+                "_monitors": 0,
+                "_plugged": 0.0,
+                "_proxy_at": 0.0,
+                "_proc": None,
+                "_flap_poll": False,
             }
         print(f"[portal] loaded {len(result)} slot(s) from {path}", flush=True)
     except FileNotFoundError:
@@ -317,7 +561,7 @@ def _refresh_host_ip():
         old = host_ip
         host_ip = new_ip
         for slot in slots.values():
-            if slot["running"] and slot["tcp_port"]:
+            if (slot["running"] or slot["listening"]) and slot["tcp_port"]:
                 slot["url"] = f"rfc2217://{host_ip}:{slot['tcp_port']}"
         print(f"[portal] host_ip changed: {old} -> {host_ip}", flush=True)
 
@@ -362,16 +606,12 @@ def is_port_listening(port: int) -> bool:
         return False
 
 
-def _is_process_alive(pid: int) -> bool:
-    try:
-        os.kill(pid, 0)
-        return True
-    except OSError:
-        return False
-
-
 def start_proxy(slot: dict) -> bool:
-    """Start plain_rfc2217_server for *slot*.  Returns True on success."""
+    """Start plain_rfc2217_server for *slot* (on its actor).  Returns True on success.
+
+    A lazy slot's proxy gets the portal's listening socket (--fd) and exits
+    by itself after PROXY_IDLE_S without a client; see _proxy_exited().
+    """
     devnode = slot["devnode"]
     tcp_port = slot["tcp_port"]
     label = slot["label"]
@@ -381,86 +621,240 @@ def start_proxy(slot: dict) -> bool:
         print(f"[portal] {label}: {slot['last_error']}", flush=True)
         return False
 
-    # Settle — done *before* acquiring lock (caller holds lock already)
+    # Settle — wait for the device node to appear
     if not wait_for_device(devnode):
         slot["last_error"] = f"Device {devnode} not ready after settle timeout"
         print(f"[portal] {label}: {slot['last_error']}", flush=True)
         return False
 
     cmd = ["python3", PROXY_EXE, "-p", str(tcp_port), devnode]
+    fds: tuple = ()
+    if slot["lazy"]:
+        if not _listen(slot):
+            return False
+        fds = (_activator.fileno(slot["slot_key"]),)
+        _activator.disarm(slot["slot_key"])      # the proxy accepts from now on
+        cmd += ["--fd", str(fds[0]), "--idle-exit", str(PROXY_IDLE_S)]
 
     try:
         proc = subprocess.Popen(
             cmd,
-            stdout=subprocess.DEVNULL,
+            stdout=subprocess.PIPE,
             stderr=subprocess.DEVNULL,
             start_new_session=True,
+            pass_fds=fds,
         )
     except Exception as exc:
         slot["last_error"] = str(exc)
         print(f"[portal] {label}: popen failed: {exc}", flush=True)
         return False
 
-    # Brief pause then check it didn't die immediately
-    time.sleep(0.5)
-    if proc.poll() is not None:
-        slot["last_error"] = f"Proxy exited immediately (code {proc.returncode})"
-        print(f"[portal] {label}: {slot['last_error']}", flush=True)
-        return False
+    if fds:
+        # Not is_port_listening(): the portal's socket always is, and a test
+        # connect would be the proxy's first client
+        if not _wait_proxy_ready(proc, PROXY_READY_S):
+            _stop_proc(proc)
+            proc.stdout.close()
+            _unlisten(slot)             # refuse the waiting client
+            slot["last_error"] = f"Proxy not ready (code {proc.returncode})"
+            print(f"[portal] {label}: {slot['last_error']}", flush=True)
+            return False
+        _proxy_started(slot, proc)
+        return True
 
-    # Wait up to 2 s for port to be listening
-    for _ in range(20):
+    # Wait up to 2.5 s for the port to be listening (or the proxy to die)
+    for _ in range(50):
+        time.sleep(0.05)
+        if proc.poll() is not None:
+            proc.stdout.close()
+            slot["last_error"] = f"Proxy exited immediately (code {proc.returncode})"
+            print(f"[portal] {label}: {slot['last_error']}", flush=True)
+            return False
         if is_port_listening(tcp_port):
-            slot["running"] = True
-            slot["pid"] = proc.pid
-            slot["last_error"] = None
-            slot["url"] = f"rfc2217://{host_ip}:{tcp_port}"
-            slot["state"] = STATE_IDLE
-            print(
-                f"[portal] {label}: proxy started (pid {proc.pid}, port {tcp_port})",
-                flush=True,
-            )
+            _proxy_started(slot, proc)
             return True
-        time.sleep(0.1)
 
     # Port never came up — kill the process
-    _stop_pid(proc.pid)
+    _stop_proc(proc)
+    proc.stdout.close()
     slot["last_error"] = "Proxy started but port not listening"
     print(f"[portal] {label}: {slot['last_error']}", flush=True)
     return False
 
 
-def _stop_pid(pid: int, timeout: float = 5.0):
-    """SIGTERM, wait, SIGKILL fallback."""
-    try:
-        os.kill(pid, signal.SIGTERM)
-    except OSError:
-        return
-    deadline = time.time() + timeout
-    while time.time() < deadline:
-        if not _is_process_alive(pid):
-            return
-        time.sleep(0.1)
-    try:
-        os.kill(pid, signal.SIGKILL)
-    except OSError:
-        pass
+def _proxy_started(slot: dict, proc: subprocess.Popen):
+    # The activator reports the exit (stdout EOF) back to this slot's actor,
+    # which reaps it; nothing else waits on proxy processes
+    _activator.watch_exit(slot["slot_key"], proc.stdout, proc.pid)
+    pid = proc.pid
+    slot["_proc"] = proc
+    slot["running"] = True
+    slot["pid"] = pid
+    slot["last_error"] = None
+    slot["url"] = f"rfc2217://{host_ip}:{slot['tcp_port']}"
+    slot["serial"] = serial_tuning.describe(slot["devnode"])
+    slot["_proxy_at"] = time.monotonic()
+    _set_state(slot, STATE_IDLE)
+    print(f"[portal] {slot['label']}: proxy started (pid {pid}, port {slot['tcp_port']})",
+          flush=True)
+
+
+def _wait_proxy_ready(proc, timeout: float) -> bool:
+    """Wait for a lazy proxy's "ready" line: its serial port is open."""
+    buf = b""
+    deadline = time.monotonic() + timeout
+    while b"ready" not in buf:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0 or not select.select([proc.stdout], [], [], remaining)[0]:
+            return False
+        chunk = os.read(proc.stdout.fileno(), 256)
+        if not chunk:
+            return False            # exited (tty gone, bad args)
+        buf += chunk
+    return True
+
+
+def _stop_proc(proc: subprocess.Popen, timeout: float = 5.0):
+    """SIGTERM, wait, SIGKILL fallback; always reaps *proc*.
+
+    Only through the Popen: it never signals a pid it has already reaped,
+    so a recycled pid can't be hit. Its stdout is left alone — once the
+    proxy started, the activator owns it (and may be selecting on it)."""
+    if proc.poll() is None:
+        proc.terminate()
+        try:
+            proc.wait(timeout)
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            proc.wait()
 
 
 def stop_proxy(slot: dict) -> bool:
-    """Stop proxy for *slot*.  Returns True if stopped (or already stopped)."""
+    """Stop proxy for *slot* (on its actor).  Returns True if stopped (or already stopped)."""
     label = slot["label"]
-    pid = slot["pid"]
-    if pid and _is_process_alive(pid):
-        print(f"[portal] {label}: stopping proxy (pid {pid})", flush=True)
-        _stop_pid(pid)
+    proc = slot["_proc"]
+    _activator.forget(slot["slot_key"])
+    if proc is not None:
+        if proc.poll() is None:
+            print(f"[portal] {label}: stopping proxy (pid {proc.pid})", flush=True)
+        _stop_proc(proc)
+    slot["_proc"] = None
     slot["running"] = False
     slot["pid"] = None
-    slot["url"] = None
+    if not slot["listening"]:
+        slot["url"] = None
     slot["last_error"] = None
     return True
 
 
+def _listen(slot: dict) -> bool:
+    """Arm a lazy slot's port (on its actor): the proxy starts when a
+    client connects. False if the port can't be bound."""
+    try:
+        _activator.listen(slot["slot_key"], slot["tcp_port"])
+    except OSError as e:
+        slot["last_error"] = f"Cannot listen on port {slot['tcp_port']}: {e}"
+        print(f"[portal] {slot['label']}: {slot['last_error']}", flush=True)
+        return False
+    if not slot["listening"]:
+        print(f"[portal] {slot['label']}: listening on port {slot['tcp_port']} "
+              f"(proxy starts on connect)", flush=True)
+    slot["listening"] = True
+    slot["url"] = f"rfc2217://{host_ip}:{slot['tcp_port']}"
+    return True
+
+
+def _unlisten(slot: dict):
+    """Close a lazy slot's port; clients are refused until _listen()."""
+    if slot["listening"]:
+        _activator.close(slot["slot_key"])
+        slot["listening"] = False
+        if not slot["running"]:
+            slot["url"] = None
+
+
+def _activate(slot: dict):
+    """First client on a lazy slot's port (on its actor): start the proxy
+    on the listening socket, where the client is already waiting."""
+    if slot["running"] or not slot["listening"]:
+        return
+    # ttyACM: same boot window as _reconcile(); the client waits meanwhile
+    wait = slot["_plugged"] + NATIVE_USB_BOOT_DELAY_S - time.monotonic()
+    if slot["devnode"] and "ttyACM" in slot["devnode"] and wait > 0:
+        _actors.after(wait, slot["slot_key"], _activate, slot)
+        return
+    usable = (slot["present"] and not slot["_lent"] and not slot["flapping"]
+              and not slot["_recovering"] and not _flasher.busy(slot["label"]))
+    if usable and start_proxy(slot):
+        return
+    # Refuse the waiting client rather than leave it hanging, then listen afresh
+    _unlisten(slot)
+    _reconcile(slot)                # the next client tries again
+
+
+def _proxy_exited(slot: dict, pid: int):
+    """A slot's proxy closed its stdout (on its actor): reap it. A lazy
+    proxy exits when idle or when its tty goes away, so the slot listens
+    again; any other proxy died."""
+    proc = slot["_proc"]
+    if proc is None or proc.pid != pid:
+        return                      # stopped by us meanwhile
+    _stop_proc(proc, timeout=1.0)
+    slot["_proc"] = None
+    slot["running"] = False
+    slot["pid"] = None
+    if slot["state"] == STATE_MONITORING:
+        slot["_monitors"] = 0
+    if not slot["lazy"]:
+        slot["url"] = None
+        slot["last_error"] = "Process died"
+        _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
+        print(f"[portal] {slot['label']}: proxy died (pid {pid}, code {proc.returncode})",
+              flush=True)
+        return
+    if slot["state"] == STATE_MONITORING:
+        _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
+    print(f"[portal] {slot['label']}: proxy exited (pid {pid})", flush=True)
+    _reconcile(slot)
+
+
+def _assign_port(slot: dict, devnode: str):
+    """Give an unconfigured slot its port from AUTO_PORTS (on its actor).
+    Also on every add of an auto slot: another device may have taken the
+    port over by serial number, or this one brings a known serial."""
+    if _ports is None or not (slot["auto"] or slot["tcp_port"] is None):
+        return
+    key = slot["slot_key"]
+    usb_serial = serial_tuning.describe(devnode).get("usb_serial")
+    in_use = [v["slot_key"] for v in list(_slot_views.values()) if v["present"]]
+    try:
+        entry = _ports.assign(key, usb_serial, in_use)
+    except port_map.PortsExhausted as e:
+        slot["last_error"] = str(e)
+        print(f"[portal] {key}: {e}", flush=True)
+        return
+    if entry["port"] == slot["tcp_port"]:
+        return
+    if slot["tcp_port"] is not None:
+        stop_proxy(slot)
+        _unlisten(slot)
+    slot.update(tcp_port=entry["port"], label=entry["label"], auto=True, last_error=None)
+    # The slot that had this port before (device moved, or port recycled)
+    for other, view in list(_slot_views.items()):
+        if other != key and view["tcp_port"] == entry["port"]:
+            _actors.tell(other, _release_port, slots[other], entry["port"])
+    log_activity(f"{entry['label']}: port {entry['port']} for {key}"
+                 + (f" (serial {usb_serial})" if usb_serial else ""), "ok")
+
+
+def _release_port(slot: dict, port: int):
+    """The port map gave *port* to a device elsewhere: drop it here."""
+    if slot["auto"] and slot["tcp_port"] == port and not slot["present"]:
+        stop_proxy(slot)
+        _unlisten(slot)
+        slot.update(tcp_port=None, label=None, url=None)
+
+
 def _make_dynamic_slot(slot_key: str) -> dict:
     """Create a minimal slot dict for an unknown (unconfigured) slot_key."""
     return {
@@ -469,6 +863,9 @@ def _make_dynamic_slot(slot_key: str) -> dict:
         "tcp_port": None,
         "gpio_boot": None,
         "gpio_en": None,
+        "lazy": True,
+        "auto": False,
+        "listening": False,
         "present": False,
         "running": False,
         "pid": None,
@@ -480,10 +877,18 @@ def _make_dynamic_slot(slot_key: str) -> dict:
         "last_error": None,
         "flapping": False,
         "state": STATE_ABSENT,
-        "_event_times": [],
+        "serial": None,
+        "rtt_ms": None,
+        "_flap": flap_detector.FlapDetector(),
         "_recovering": False,
         "_recover_retries": 0,
-        "_lock": threading.Lock(),
+        "_lent": None,
+        "_lent_state": None,
+        "_monitors": 0,
+        "_plugged": 0.0,
+        "_proxy_at": 0.0,
+        "_proc": None,
+        "_flap_poll": False,
     }
 
 
@@ -528,66 +933,87 @@ def scan_existing_devices():
 
         if slot_key not in slots:
             slots[slot_key] = _make_dynamic_slot(slot_key)
-            print(f"[portal] boot scan: unknown slot_key={slot_key} (tracked, no proxy)", flush=True)
+            print(f"[portal] boot scan: unknown slot_key={slot_key}", flush=True)
 
         slot = slots[slot_key]
-        slot["present"] = True
-        slot["devnode"] = devnode
-        slot["state"] = STATE_IDLE
+        _actors.ask(slot_key, _boot_add, slot, devnode)
+        if slot["tcp_port"] is not None:
+            print(f"[portal] boot scan: {slot['label']} ({devnode}) on port {slot['tcp_port']}",
+                  flush=True)
 
-        if slot["tcp_port"] is not None and not slot["running"]:
-            print(f"[portal] boot scan: starting proxy for {slot['label']} ({devnode})", flush=True)
-            with slot["_lock"]:
-                start_proxy(slot)
 
+def _boot_add(slot: dict, devnode: str):
+    """A device found by the boot scan: long past its boot, so no delay."""
+    slot["present"] = True
+    slot["devnode"] = devnode
+    _set_state(slot, STATE_IDLE)
+    _assign_port(slot, devnode)
+    _reconcile(slot)
 
-def _refresh_slot_health(slot: dict):
-    """Check that a slot's proxy is still alive; mark dead if not."""
-    if slot["running"] and slot["pid"]:
-        if not _is_process_alive(slot["pid"]):
-            slot["running"] = False
-            slot["pid"] = None
-            slot["url"] = None
-            slot["last_error"] = "Process died"
-            slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
 
+def _set_state(slot: dict, state: str):
+    """Set a slot's state; it is published when the running command ends."""
+    slot["state"] = state
+
+
+def _set_fields(slot: dict, fields: dict):
+    """Update plain fields of a slot (e.g. rtt_ms after a flash job)."""
+    slot.update(fields)
 
-def _slot_info(slot: dict) -> dict:
-    """Return a JSON-safe copy of a slot (excludes _lock, promotes _recovering/_recover_retries)."""
-    # Clear stale flapping: if no events in the last FLAP_WINDOW_S, the device
-    # has stabilised. This handles the case where the device stops cycling and
-    # no new hotplug event arrives to trigger the in-handler quiet-period check.
-    if slot["flapping"] and not slot["_recovering"]:
-        now = time.time()
-        recent = [t for t in slot["_event_times"] if now - t < FLAP_WINDOW_S]
-        slot["_event_times"] = recent
-        if len(recent) < FLAP_THRESHOLD:
-            label = slot["label"] or slot["slot_key"][-20:]
-            slot["flapping"] = False
-            slot["last_error"] = None
-            slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
-            print(f'[portal] {label}: flapping cleared (events aged out during poll)', flush=True)
-            log_activity(f"{label}: device stabilised — flapping cleared", "ok")
 
+def _slot_info(slot: dict) -> dict:
+    """Return a JSON-safe copy of a slot (excludes internals, promotes _recovering/_recover_retries)."""
     info = {k: v for k, v in slot.items() if not k.startswith("_")}
+    info["flap"] = slot["_flap"].info()
     info["recovering"] = slot["_recovering"]
     info["recover_retries"] = slot["_recover_retries"]
     info["has_gpio"] = slot.get("gpio_boot") is not None
+    info["bus"] = _slot_bus(slot)
     return info
 
 
+def _publish(slot: dict | None):
+    """Replace a slot's view after a command; wake GET /api/devices
+    long-polls if anything changed. Views are never modified in place."""
+    global _slots_version
+    if slot is None:
+        return
+    info = _slot_info(slot)
+    with _slots_cond:
+        if _slot_views.get(slot["slot_key"]) == info:
+            return
+        _slot_views[slot["slot_key"]] = info
+        _slots_version += 1
+        _slots_cond.notify_all()
+
+
+def _slot_bus(slot: dict) -> str:
+    return usb_bus.bus_of(slot["slot_key"])
+
+
 # ---------------------------------------------------------------------------
 # Serial Services — reset and monitor (FR-008, FR-009)
 # ---------------------------------------------------------------------------
 
-def _find_slot_by_label(label: str) -> dict | None:
-    """Find a configured slot by its human-readable label."""
-    for s in slots.values():
-        if s["label"] == label:
-            return s
+def _find_view_by_label(label: str) -> dict | None:
+    """The published view of the slot with this human-readable label.
+
+    An auto slot's label and port change on its actor, so other threads
+    resolve them from the views, never from the slot itself."""
+    with _slots_cond:
+        views = list(_slot_views.values())
+    for view in views:
+        if view["label"] == label:
+            return view
     return None
 
 
+def _find_slot_by_label(label: str) -> dict | None:
+    """Find a slot by its label as last published (for actor commands)."""
+    view = _find_view_by_label(label)
+    return slots.get(view["slot_key"]) if view else None
+
+
 def _read_serial_lines(ser, pattern: str | None, timeout: float) -> tuple[list[str], str | None]:
     """Read serial lines until pattern matched or timeout.
 
@@ -625,61 +1051,104 @@ def _read_serial_lines(ser, pattern: str | None, timeout: float) -> tuple[list[s
 
 def serial_reset(slot: dict) -> dict:
     """FR-008: Reset device via DTR/RTS.  Stops proxy, opens direct serial,
-    sends reset pulse, reads initial boot output, closes.  Proxy restarts
-    via hotplug re-enumeration.
+    sends reset pulse, reads initial boot output, closes, restarts proxy.
+    Waits up to RESET_BUS_WAIT_S for room on the slot's USB bus first.
 
     Returns {"ok": True/False, "output": [...], "error": "..."}.
     """
-    import serial as pyserial
+    with _slots_cond:
+        label = _slot_views[slot["slot_key"]]["label"]
+    try:
+        with _bus.hold(_slot_bus(slot), "reset", label, usb_bus.baud_kbps(115200),
+                       RESET_BUS_WAIT_S):
+            return _serial_reset(slot)
+    except usb_bus.BusBusy as e:
+        return {"ok": False, "error": f"{label}: {e}"}
 
-    label = slot["label"]
-    devnode = slot.get("devnode")
 
-    if not devnode:
-        return {"ok": False, "error": f"{label}: no device node"}
-    if not slot.get("present"):
-        return {"ok": False, "error": f"{label}: device not present"}
+def _serial_reset(slot: dict) -> dict:
+    import serial as pyserial
 
-    # Stop the proxy so we can open direct serial
-    with slot["_lock"]:
-        stop_proxy(slot)
-        slot["state"] = STATE_RESETTING
+    # The slot's actor hands the tty over; the serial I/O runs here, so
+    # the slot's other commands (hotplug events) aren't held up by it.
+    try:
+        devnode = _actors.ask(slot["slot_key"], _lend_port, slot, "reset", STATE_RESETTING)
+    except RuntimeError as e:
+        return {"ok": False, "error": str(e)}
 
-    # Open direct serial with DTR/RTS safe
+    # Whatever happens below, the port goes back to the actor
     try:
-        ser = pyserial.Serial(devnode, 115200, timeout=0.1)
-        ser.dtr = False
-        ser.rts = False
-        time.sleep(0.1)
-        ser.read(8192)  # drain
-    except Exception as e:
-        slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
-        return {"ok": False, "error": f"Cannot open {devnode}: {e}"}
-
-    # Send DTR/RTS reset pulse
-    ser.dtr = True
-    time.sleep(0.05)
-    ser.dtr = False
-    time.sleep(0.05)
-    ser.rts = True
-    time.sleep(0.05)
-    ser.rts = False
-
-    # Read boot output (up to 5s)
-    lines, _ = _read_serial_lines(ser, None, timeout=5.0)
-    ser.close()
-
-    # Restart the proxy — DTR/RTS resets don't cause USB re-enumeration
-    # (the chip reboots but ttyACM stays), so hotplug won't restart it.
-    time.sleep(NATIVE_USB_BOOT_DELAY_S)
-    with slot["_lock"]:
-        if not slot["running"]:
-            start_proxy(slot)
-        # start_proxy sets STATE_IDLE on success; set it here if proxy failed
-        if slot["state"] == STATE_RESETTING:
-            slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
+        # Open direct serial with DTR/RTS safe
+        try:
+            ser = pyserial.Serial(devnode, 115200, timeout=0.1)
+            ser.dtr = False
+            ser.rts = False
+            time.sleep(0.1)
+            ser.read(8192)  # drain
+        except Exception as e:
+            return {"ok": False, "error": f"Cannot open {devnode}: {e}"}
 
-    return {"ok": True, "output": lines}
+        try:
+            # Send DTR/RTS reset pulse
+            ser.dtr = True
+            time.sleep(0.05)
+            ser.dtr = False
+            time.sleep(0.05)
+            ser.rts = True
+            time.sleep(0.05)
+            ser.rts = False
+
+            # Read boot output (up to 5s)
+            lines, _ = _read_serial_lines(ser, None, timeout=5.0)
+        except Exception as e:
+            return {"ok": False, "error": f"Reset on {devnode} failed: {e}"}
+        finally:
+            ser.close()
+
+        time.sleep(NATIVE_USB_BOOT_DELAY_S)
+        return {"ok": True, "output": lines}
+    finally:
+        _actors.ask(slot["slot_key"], _return_port, slot)
+
+
+def _lend_port(slot: dict, purpose: str, state: str) -> str:
+    """Stop the proxy and lend the slot's tty to a reset or flash run
+    outside the actor; _return_port() takes it back. Hotplug events
+    meanwhile are recorded but leave the proxy alone."""
+    label = slot["label"]
+    if not slot["present"]:
+        raise RuntimeError(f"{label}: device not present")
+    if not slot["devnode"]:
+        raise RuntimeError(f"{label}: no device node")
+    if slot["_lent"]:
+        raise RuntimeError(f"{label}: port in use ({slot['_lent']})")
+    slot["_lent"] = purpose
+    slot["_lent_state"] = slot["state"]
+    stop_proxy(slot)
+    _unlisten(slot)
+    _set_state(slot, state)
+    return slot["devnode"]
+
+
+def _return_port(slot: dict):
+    """Restart the proxy once a reset or flash is done with the tty.
+
+    DTR/RTS and esptool resets reboot the chip without re-enumerating a
+    UART bridge, so hotplug won't restart the proxy; a native USB port
+    does re-enumerate, and its add event defers to us while the port is
+    lent.
+    """
+    purpose, prev = slot["_lent"], slot["_lent_state"]
+    slot["_lent"] = slot["_lent_state"] = None
+    if slot["lazy"]:
+        _reconcile(slot)
+    elif slot["present"] and not slot["running"] and not slot["flapping"]:
+        start_proxy(slot)
+    # BOOT still held by GPIO recovery: the chip is back in the bootloader
+    if purpose == "flash" and prev == STATE_DOWNLOAD_MODE and slot["present"]:
+        _set_state(slot, STATE_DOWNLOAD_MODE)
+    elif slot["state"] in (STATE_RESETTING, STATE_FLASHING):
+        _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
 
 
 def serial_monitor(slot: dict, pattern: str | None = None,
@@ -690,12 +1159,14 @@ def serial_monitor(slot: dict, pattern: str | None = None,
     """
     import serial as pyserial
 
-    label = slot["label"]
-    tcp_port = slot.get("tcp_port")
+    with _slots_cond:
+        view = _slot_views.get(slot["slot_key"], {})
+    label = view.get("label", slot["slot_key"])
+    tcp_port = view.get("tcp_port")
 
     if not tcp_port:
         return {"ok": False, "error": f"{label}: no tcp_port configured"}
-    if not slot.get("running"):
+    if not (view.get("running") or view.get("listening")):   # connecting starts a lazy one
         return {"ok": False, "error": f"{label}: proxy not running"}
 
     rfc2217_url = f"rfc2217://127.0.0.1:{tcp_port}"
@@ -709,15 +1180,20 @@ def serial_monitor(slot: dict, pattern: str | None = None,
     except Exception as e:
         return {"ok": False, "error": f"Cannot connect to {rfc2217_url}: {e}"}
 
-    slot["state"] = STATE_MONITORING
+    # "monitoring" once connected: clients wait for it before producing output
+    if not _actors.ask(slot["slot_key"], _monitor_begin, slot):
+        ser.close()
+        return {"ok": False, "error": f"{label}: proxy not running"}
+    op = _bus.charge(_slot_bus(slot), "monitor", label, usb_bus.baud_kbps(ser.baudrate))
     try:
         lines, matched_line = _read_serial_lines(ser, pattern, timeout)
     finally:
+        _bus.release(op)
         try:
             ser.close()
         except Exception:
             pass
-        slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
+        _actors.tell(slot["slot_key"], _monitor_end, slot)
 
     return {
         "ok": True,
@@ -727,25 +1203,258 @@ def serial_monitor(slot: dict, pattern: str | None = None,
     }
 
 
+def _monitor_begin(slot: dict) -> bool:
+    if not slot["running"]:
+        return False
+    slot["_monitors"] += 1
+    _set_state(slot, STATE_MONITORING)
+    return True
+
+
+def _monitor_end(slot: dict):
+    # Monitors share the proxy; the last one out ends the state
+    slot["_monitors"] -= 1
+    if not slot["_monitors"] and slot["state"] == STATE_MONITORING:
+        _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
+
+
+# ---------------------------------------------------------------------------
+# Local flashing — proxy hand-over for flash_orchestrator jobs
+# ---------------------------------------------------------------------------
+
+def _flash_suspend(label: str) -> str:
+    """Stop the slot's proxy and hand its devnode to a flash worker."""
+    slot = _find_slot_by_label(label)
+    try:
+        return _actors.ask(slot["slot_key"], _lend_port, slot, "flash", STATE_FLASHING)
+    except RuntimeError as e:
+        raise flash_orchestrator.FlashError(str(e)) from None
+
+
+def _flash_resume(label: str):
+    """Restart the proxy after a flash worker is done with the port."""
+    slot = _find_slot_by_label(label)
+    with _slots_cond:
+        devnode = _slot_views[slot["slot_key"]]["devnode"]
+    if devnode and "ttyACM" in devnode:
+        time.sleep(NATIVE_USB_BOOT_DELAY_S)
+    _actors.ask(slot["slot_key"], _return_port, slot)
+
+
+def _flash_ended(job: dict):
+    for s in job["slots"]:
+        slot = _find_slot_by_label(s["label"])
+        if s["rtt_ms"] and slot:
+            # esptool command round trip at the flashing baud, for /api/devices
+            _actors.ask(slot["slot_key"], _set_fields, slot,
+                        {"rtt_ms": dict(s["rtt_ms"], baud=s["baud"], at=time.time())})
+        if s["state"] == "done":
+            skipped = f", {len(s['skipped'])} region(s) unchanged" if s["skipped"] else ""
+            rtt = f", rtt {s['rtt_ms']['p50']} ms" if s["rtt_ms"] else ""
+            log_activity(f"flash({job['project']}) {s['label']}: done in {s['elapsed_s']}s "
+                         f"at {s['baud']} baud{rtt}{skipped}", "ok")
+        else:
+            log_activity(f"flash({job['project']}) {s['label']}: {s['error']}", "error")
+
+
 # ---------------------------------------------------------------------------
 # USB Flap Recovery — unbind USB to stop storm, then recover via GPIO or backoff
 # ---------------------------------------------------------------------------
 
+def process_hotplug(action: str, devnode: str, id_path: str, devpath: str,
+                    now: float | None = None):
+    """Queue one USB serial add/remove event on its slot's actor.
+
+    Called only from the hotplug dispatcher thread (netlink monitor or
+    POST /api/hotplug), so slots are created and events numbered in
+    arrival order without waiting for any slot. Returns a Future for the
+    _apply_hotplug() result. *now* overrides the event time (trace replay).
+    """
+    global seq_counter
+
+    slot_key = id_path if id_path else devpath
+
+    # Look up or create slot
+    if slot_key not in slots:
+        slots[slot_key] = _make_dynamic_slot(slot_key)
+
+    seq_counter += 1
+    return _actors.tell(slot_key, _apply_hotplug, slots[slot_key], action, devnode,
+                        seq_counter, time.time() if now is None else now)
+
+
+def _apply_hotplug(slot: dict, action: str, devnode: str, seq: int, now: float) -> dict:
+    """Apply one hotplug event to *slot* (on its actor).  The proxy itself
+    is started or stopped by a _reconcile() queued behind the event, so a
+    burst of events costs one proxy restart, not one per event."""
+    slot_key = slot["slot_key"]
+
+    # Update event bookkeeping (always, even for unknown slots)
+    slot["seq"] = seq
+    slot["last_action"] = action
+    slot["last_event_ts"] = datetime.now(timezone.utc).isoformat()
+
+    label = slot["label"] or slot_key[-20:]
+    configured = slot["tcp_port"] is not None
+
+    # -- Early exit: if recovery is in progress, ignore all events --
+    # The unbind/rebind cycle generates synthetic udev events; don't let
+    # them interfere with recovery state.
+    if slot["_recovering"]:
+        print(
+            f"[portal] hotplug: {action} {label} ignored (recovery in progress)",
+            flush=True,
+        )
+        return {
+            "ok": True, "slot_key": slot_key, "seq": seq,
+            "accepted": False, "flapping": True, "recovering": True,
+        }
+
+    # -- Flap detection --
+    det = slot["_flap"]
+    transition = det.observe(now)
+
+    if transition == flap_detector.STABLE:
+        slot["flapping"] = False
+        slot["last_error"] = None
+        _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
+        print(f'[portal] {label}: USB flapping cleared (quiet for {det.quiet_s:.0f}s)', flush=True)
+    elif transition == flap_detector.FLAPPING:
+        slot["flapping"] = True
+        _set_state(slot, STATE_FLAPPING)
+        slot["last_error"] = "USB flapping detected — starting recovery"
+        print(f'[portal] {label}: USB flapping detected ({det.threshold} events in '
+              f'{det.burst_span():.1f}s) — starting recovery', flush=True)
+        _start_flap_recovery(slot)
+
+    if action == "add":
+        slot["present"] = True
+        slot["devnode"] = devnode
+        slot["_plugged"] = time.monotonic()
+        if not slot["flapping"] and not slot["_lent"]:
+            _set_state(slot, STATE_IDLE)
+        _assign_port(slot, devnode)
+        label = slot["label"] or label
+        configured = slot["tcp_port"] is not None
+        if not configured:
+            print(
+                f"[portal] hotplug: unknown slot_key={slot_key} "
+                f"(tracked, no proxy)",
+                flush=True,
+            )
+    elif action == "remove":
+        slot["present"] = False
+        if not slot["flapping"]:
+            _set_state(slot, STATE_ABSENT)
+
+    if configured and not slot["flapping"]:
+        _actors.tell(slot_key, _reconcile, slot, tag="reconcile")
+    elif slot["flapping"] and not slot["_recovering"]:
+        _schedule_flap_poll(slot)
+
+    log_activity(
+        f"USB {action}: {label} ({devnode or '?'})",
+        "ok" if action == "add" else "info",
+    )
+    print(
+        f"[portal] hotplug: {action} slot_key={slot_key} "
+        f"devnode={devnode} seq={seq}",
+        flush=True,
+    )
+
+    return {
+        "ok": True,
+        "slot_key": slot_key,
+        "seq": seq,
+        "accepted": configured,
+        "flapping": slot["flapping"],
+        "recovering": slot["_recovering"],
+    }
+
+
+def _reconcile(slot: dict):
+    """Run the slot's proxy while its device is present, stop it when not.
+
+    Restarts a proxy opened before the latest add (its tty is stale).
+    Leaves the port alone while it is lent to a reset or flash, while a
+    flash job is about to take it, and while the slot is flapping.
+    A lazy slot only listens; _activate() starts its proxy on connect.
+    """
+    if slot["tcp_port"] is None or slot["_lent"] or slot["flapping"] or slot["_recovering"]:
+        return
+    if not slot["present"]:
+        if slot["running"]:
+            stop_proxy(slot)
+        _unlisten(slot)
+        return
+    if _flasher.busy(slot["label"]):
+        return  # Flash job restarts it when done
+    if slot["running"] and slot["_proxy_at"] >= slot["_plugged"]:
+        return
+    if slot["lazy"]:
+        if slot["running"]:
+            stop_proxy(slot)
+        _listen(slot)
+        return
+    # Native USB (ttyACM): delay before opening port so the chip boots
+    # past the download-mode-sensitive phase — on a timer, not a worker.
+    wait = slot["_plugged"] + NATIVE_USB_BOOT_DELAY_S - time.monotonic()
+    if slot["devnode"] and "ttyACM" in slot["devnode"] and wait > 0:
+        _actors.after(wait, slot["slot_key"], _reconcile, slot, tag="reconcile")
+        return
+    if slot["running"] and slot["pid"]:
+        stop_proxy(slot)
+    start_proxy(slot)
+
+
+def _schedule_flap_poll(slot: dict):
+    if not slot["_flap_poll"]:
+        slot["_flap_poll"] = True
+        _actors.after(slot["_flap"].quiet_s, slot["slot_key"], _poll_flap, slot)
+
+
+def _poll_flap(slot: dict):
+    """Clear stale flapping: the device stopped cycling and no new hotplug
+    event arrived to run the detector's quiet-period check."""
+    slot["_flap_poll"] = False
+    if not slot["flapping"] or slot["_recovering"]:
+        return
+    if slot["_flap"].poll(time.time()) != flap_detector.STABLE:
+        _schedule_flap_poll(slot)
+        return
+    label = slot["label"] or slot["slot_key"][-20:]
+    slot["flapping"] = False
+    slot["last_error"] = None
+    _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
+    print(f'[portal] {label}: flapping cleared (quiet)', flush=True)
+    log_activity(f"{label}: device stabilised — flapping cleared", "ok")
+    _reconcile(slot)
+
+
+def _request_recovery(slot: dict):
+    """POST /api/serial/recover: fresh recovery cycle with retries reset."""
+    slot["_recover_retries"] = 0
+    slot["flapping"] = True
+    slot["_flap"].trip(time.time())
+    _start_flap_recovery(slot)
+
+
 def _start_flap_recovery(slot: dict):
-    """Entry point when flapping is detected.  Unbinds USB to stop the storm,
-    then dispatches to GPIO or no-GPIO recovery in a background thread."""
+    """Entry point when flapping is detected (on the slot's actor).  Unbinds
+    USB to stop the storm, then starts GPIO or no-GPIO recovery, whose
+    waits are actor timers."""
     label = slot["label"] or slot["slot_key"][-20:]
 
     if slot["_recovering"]:
         return  # Already in a recovery cycle
 
     slot["_recovering"] = True
-    slot["state"] = STATE_RECOVERING
+    _set_state(slot, STATE_RECOVERING)
 
     # Stop proxy if still running
-    with slot["_lock"]:
-        if slot["running"] and slot["pid"]:
-            stop_proxy(slot)
+    if slot["running"] and slot["pid"]:
+        stop_proxy(slot)
+    _unlisten(slot)
 
     # Unbind USB at kernel level — event storm stops immediately
     usb_device = _slot_key_to_usb_device(slot["slot_key"])
@@ -755,24 +1464,17 @@ def _start_flap_recovery(slot: dict):
     else:
         log_activity(f"{label}: cannot determine USB device from slot_key", "error")
         slot["_recovering"] = False
-        slot["state"] = STATE_FLAPPING
+        _set_state(slot, STATE_FLAPPING)
+        _schedule_flap_poll(slot)
         return
 
-    has_gpio = slot.get("gpio_boot") is not None
-    if has_gpio:
-        t = threading.Thread(
-            target=_recover_with_gpio, args=(slot, usb_device),
-            daemon=True, name=f"recover-gpio-{label}",
-        )
+    if slot.get("gpio_boot") is not None:
+        _recover_with_gpio(slot, usb_device)
     else:
-        t = threading.Thread(
-            target=_recover_without_gpio, args=(slot, usb_device),
-            daemon=True, name=f"recover-nogpio-{label}",
-        )
-    t.start()
+        _recover_without_gpio(slot, usb_device)
 
 
-def _recover_with_gpio(slot: dict, usb_device: str):
+def _recover_with_gpio(slot: dict, usb_device: str, step: str = "cooldown"):
     """Recovery for boards WITH GPIO pins configured.
 
     1. Wait cooldown
@@ -780,51 +1482,58 @@ def _recover_with_gpio(slot: dict, usb_device: str):
     3. Pulse EN/RST if configured
     4. Rebind USB — device enumerates in download mode (stable)
     5. State → download_mode; BOOT stays held LOW until /api/serial/release
+
+    Each step is a command on the slot's actor, queued by the one before.
     """
     label = slot["label"] or slot["slot_key"][-20:]
     gpio_boot = slot["gpio_boot"]
     gpio_en = slot.get("gpio_en")
 
-    log_activity(f"{label}: GPIO recovery — waiting {FLAP_COOLDOWN_S}s cooldown", "step")
-    time.sleep(FLAP_COOLDOWN_S)
+    def next_step(delay, name):
+        _actors.after(delay, slot["slot_key"], _recover_with_gpio, slot, usb_device, name)
 
-    # Hold BOOT/GPIO0 LOW → forces download mode
-    try:
-        _gpio_set(gpio_boot, 0)
-        log_activity(f"{label}: GPIO{gpio_boot} (BOOT) held LOW", "step")
-    except Exception as e:
-        log_activity(f"{label}: GPIO set failed: {e}", "error")
-        slot["_recovering"] = False
-        slot["state"] = STATE_FLAPPING
-        return
+    if step == "cooldown":
+        log_activity(f"{label}: GPIO recovery — waiting {FLAP_COOLDOWN_S}s cooldown", "step")
+        next_step(FLAP_COOLDOWN_S, "reset")
 
-    # Pulse EN/RST if we have it — clean reset into download mode
-    if gpio_en is not None:
+    elif step == "reset":
+        # Hold BOOT/GPIO0 LOW → forces download mode, then pulse EN/RST if we
+        # have it for a clean reset into download mode — one timed sequence
+        steps = [{"set": {"boot": 0}}]
+        if gpio_en is not None:
+            steps.append({"pulse": "en", "level": 0, "us": GPIO_EN_PULSE_US, "then": 1})
         try:
-            _gpio_set(gpio_en, 0)
-            time.sleep(0.1)
-            _gpio_set(gpio_en, 1)
-            log_activity(f"{label}: GPIO{gpio_en} (EN) pulsed — reset", "step")
-            time.sleep(0.5)
+            result = _slot_gpio_run(slot, steps)
         except Exception as e:
-            log_activity(f"{label}: EN pulse failed: {e}", "error")
+            log_activity(f"{label}: GPIO set failed: {e}", "error")
+            slot["_recovering"] = False
+            _set_state(slot, STATE_FLAPPING)
+            return
+        log_activity(f"{label}: GPIO{gpio_boot} (BOOT) held LOW", "step")
+        if gpio_en is not None:
+            width = result["steps"][1]["width_us"]
+            log_activity(f"{label}: GPIO{gpio_en} (EN) pulsed {width / 1000:.1f} ms — reset", "step")
+        next_step(0.5 if gpio_en is not None else 0, "rebind")
 
-    # Rebind USB — device should enumerate in download mode now
-    _usb_rebind(usb_device)
-    time.sleep(2)  # Let kernel enumerate
+    elif step == "rebind":
+        # Rebind USB — device should enumerate in download mode now
+        _usb_rebind(usb_device)
+        next_step(2, "done")  # Let kernel enumerate
 
-    slot["_recovering"] = False
-    slot["flapping"] = False
-    slot["_recover_retries"] = 0
-    slot["state"] = STATE_DOWNLOAD_MODE
-    slot["last_error"] = None
-    log_activity(
-        f"{label}: device in download mode — flash firmware, then POST /api/serial/release",
-        "ok",
-    )
+    else:
+        slot["_recovering"] = False
+        slot["flapping"] = False
+        slot["_flap"].reset()
+        slot["_recover_retries"] = 0
+        _set_state(slot, STATE_DOWNLOAD_MODE)
+        slot["last_error"] = None
+        log_activity(
+            f"{label}: device in download mode — flash firmware, then POST /api/serial/release",
+            "ok",
+        )
 
 
-def _recover_without_gpio(slot: dict, usb_device: str):
+def _recover_without_gpio(slot: dict, usb_device: str, step: str = "cooldown"):
     """Recovery for boards WITHOUT GPIO pins.
 
     Unbind, wait fixed cooldown, rebind, check if flapping resumes.
@@ -833,34 +1542,57 @@ def _recover_without_gpio(slot: dict, usb_device: str):
     label = slot["label"] or slot["slot_key"][-20:]
     retry = slot["_recover_retries"]
 
-    if retry >= FLAP_MAX_RETRIES:
-        slot["_recovering"] = False
-        slot["state"] = STATE_FLAPPING
-        slot["last_error"] = (
-            f"Recovery failed after {FLAP_MAX_RETRIES} attempts — "
-            "needs manual intervention (re-flash with USB cable or add GPIO wiring)"
-        )
-        log_activity(f"{label}: {slot['last_error']}", "error")
+    if step == "cooldown":
+        if retry >= FLAP_MAX_RETRIES:
+            slot["_recovering"] = False
+            _set_state(slot, STATE_FLAPPING)
+            slot["last_error"] = (
+                f"Recovery failed after {FLAP_MAX_RETRIES} attempts — "
+                "needs manual intervention (re-flash with USB cable or add GPIO wiring)"
+            )
+            log_activity(f"{label}: {slot['last_error']}", "error")
+            return
+        log_activity(f"{label}: no-GPIO recovery attempt {retry + 1}/{FLAP_MAX_RETRIES} — "
+                     f"waiting {FLAP_COOLDOWN_S}s", "step")
+        _actors.after(FLAP_COOLDOWN_S, slot["slot_key"], _recover_without_gpio, slot,
+                      usb_device, "rebind")
         return
 
-    log_activity(f"{label}: no-GPIO recovery attempt {retry + 1}/{FLAP_MAX_RETRIES} — waiting {FLAP_COOLDOWN_S}s", "step")
-    time.sleep(FLAP_COOLDOWN_S)
-
     slot["_recover_retries"] = retry + 1
     slot["_recovering"] = False  # Allow hotplug to detect if flapping resumes
     slot["flapping"] = False
-    slot["_event_times"] = []
+    slot["_flap"].reset()
     slot["last_error"] = None
-    slot["state"] = STATE_IDLE
+    _set_state(slot, STATE_IDLE)
 
     # Rebind USB — if firmware is OK, device boots normally.
-    # If still corrupt, flapping resumes → _handle_hotplug detects → another cycle.
+    # If still corrupt, flapping resumes → _apply_hotplug detects → another cycle.
     _usb_rebind(usb_device)
     log_activity(f"{label}: USB rebound — monitoring for stability", "step")
 
 
+def _restart_proxy(slot: dict, devnode: str) -> tuple[bool, bool]:
+    """POST /api/start: (re)start the proxy on *devnode*. Returns (ok, running)."""
+    if slot["running"] and slot["pid"]:
+        stop_proxy(slot)
+    slot["devnode"] = devnode
+    slot["present"] = True
+    ok = start_proxy(slot)
+    # start_proxy sets STATE_IDLE on success; ensure idle on failure too
+    if not ok and slot["state"] not in (STATE_IDLE, STATE_FLAPPING):
+        _set_state(slot, STATE_IDLE)
+    return ok, slot["running"]
+
+
+def _stop_slot(slot: dict):
+    """POST /api/stop."""
+    stop_proxy(slot)
+    _unlisten(slot)
+    _set_state(slot, STATE_IDLE if slot["present"] else STATE_ABSENT)
+
+
 def _release_slot_gpio(slot: dict) -> dict:
-    """Release GPIO pins after flashing and reboot the device cleanly.
+    """Release GPIO pins after flashing and reboot the device cleanly (on the slot's actor).
 
     Sets BOOT to high-Z, pulses EN if available.
     """
@@ -884,14 +1616,12 @@ def _release_slot_gpio(slot: dict) -> dict:
     # Pulse EN for clean reboot into normal firmware
     if gpio_en is not None:
         try:
-            _gpio_set(gpio_en, 0)
-            time.sleep(0.1)
-            _gpio_set(gpio_en, 1)
+            _slot_gpio_run(slot, [{"pulse": "en", "level": 0, "us": GPIO_EN_PULSE_US, "then": 1}])
             log_activity(f"{label}: GPIO{gpio_en} (EN) pulsed — rebooting into firmware", "step")
         except Exception as e:
             log_activity(f"{label}: EN pulse failed (non-fatal): {e}", "info")
 
-    slot["state"] = STATE_IDLE
+    _set_state(slot, STATE_IDLE)
     slot["_recover_retries"] = 0
     log_activity(f"{label}: released — device should boot into firmware", "ok")
     return {"ok": True}
@@ -966,6 +1696,14 @@ def _do_enter_portal(portal_ssid: str, wifi_ssid: str, wifi_password: str,
 # ---------------------------------------------------------------------------
 
 class Handler(http.server.BaseHTTPRequestHandler):
+    # Keep-alive: test drivers reuse one connection for thousands of calls.
+    # Every response carries Content-Length; idle connections close after
+    # `timeout` seconds so they don't pin server threads.
+    protocol_version = "HTTP/1.1"
+    timeout = 120
+    # Headers and body go out in separate writes; without TCP_NODELAY every
+    # kept-alive response stalls ~40 ms on Nagle + delayed ACK.
+    disable_nagle_algorithm = True
 
     def log_message(self, fmt, *args):
         print(f"[portal] {self.address_string()} {fmt % args}", flush=True)
@@ -986,17 +1724,37 @@ class Handler(http.server.BaseHTTPRequestHandler):
 
     def _read_json(self):
         length = int(self.headers.get("Content-Length", 0))
+        self._body_read = True
         if length == 0:
             return None
         return json.loads(self.rfile.read(length))
 
+    def _end_request(self):
+        """A body left unread would be parsed as the next request on a
+        kept-alive connection; close the connection instead."""
+        if not getattr(self, "_body_read", False) and int(self.headers.get("Content-Length", 0)):
+            self.close_connection = True
+        self._body_read = False
+
+    def _lease_blocked(self, slot: str | None = None, radio: bool = False) -> bool:
+        """Send 423 and return True if another holder leases the slot/radio."""
+        tokens = [t.strip() for t in self.headers.get("X-Lease", "").split(",") if t.strip()]
+        lease = _leases.conflict(tokens, slot, radio)
+        if lease is None:
+            return False
+        what = f"slot '{slot}'" if slot and lease.slot == slot else "radio"
+        self._send_json({"ok": False, "error": f"{what} is leased by {lease.holder}",
+                         "holder": lease.holder}, 423)
+        return True
+
     # -- routes --
 
     def do_OPTIONS(self):
         self.send_response(200)
         self.send_header("Access-Control-Allow-Origin", "*")
         self.send_header("Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS")
-        self.send_header("Access-Control-Allow-Headers", "Content-Type")
+        self.send_header("Access-Control-Allow-Headers", "Content-Type, X-Lease")
+        self.send_header("Content-Length", "0")
         self.end_headers()
 
     def do_GET(self):
@@ -1004,7 +1762,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         path = parsed.path
 
         if path == "/api/devices":
-            self._handle_get_devices()
+            qs = parse_qs(parsed.query)
+            self._handle_get_devices(qs)
         elif path == "/api/info":
             self._handle_get_info()
         elif path == "/api/wifi/ping":
@@ -1024,14 +1783,34 @@ class Handler(http.server.BaseHTTPRequestHandler):
         elif path == "/api/human/status":
             self._handle_human_status()
         elif path == "/api/test/progress":
-            self._handle_test_progress()
+            qs = parse_qs(parsed.query)
+            self._handle_test_progress(qs)
+        elif path == "/api/sessions":
+            qs = parse_qs(parsed.query)
+            self._handle_get_sessions(qs)
+        elif path == "/api/leases":
+            self._send_json({"ok": True, "leases": _leases.snapshot()})
         elif path == "/api/gpio/status":
-            self._handle_gpio_status()
+            qs = parse_qs(parsed.query)
+            self._handle_gpio_status(qs)
         elif path == "/api/udplog":
             qs = parse_qs(parsed.query)
             self._handle_get_udplog(qs)
+        elif path == "/api/bootrec":
+            qs = parse_qs(parsed.query)
+            self._handle_get_bootrec(qs)
+        elif path == "/api/coredump/list":
+            self._send_json({"ok": True, "coredumps": _coredump_list()})
+        elif path == "/api/coredump/report":
+            qs = parse_qs(parsed.query)
+            self._handle_coredump_report(qs)
         elif path == "/api/firmware/list":
             self._handle_firmware_list()
+        elif path == "/api/flash":
+            qs = parse_qs(parsed.query)
+            self._handle_flash_status(qs)
+        elif path == "/api/bus":
+            self._send_json({"ok": True, "net_bus": _net_bus, **_bus.snapshot()})
         elif path == "/api/ble/status":
             self._handle_ble_status()
         elif path.startswith("/firmware/"):
@@ -1082,10 +1861,24 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._handle_human_cancel()
         elif path == "/api/test/update":
             self._handle_test_update()
+        elif path == "/api/lease/acquire":
+            self._handle_lease_acquire()
+        elif path == "/api/lease/renew":
+            self._handle_lease_renew()
+        elif path == "/api/lease/release":
+            self._handle_lease_release()
         elif path == "/api/gpio/set":
             self._handle_gpio_set()
+        elif path == "/api/gpio/sequence":
+            self._handle_gpio_sequence()
+        elif path == "/api/gpio/capture":
+            self._handle_gpio_capture()
         elif path == "/api/firmware/upload":
             self._handle_firmware_upload()
+        elif path == "/api/flash":
+            self._handle_flash_start()
+        elif path == "/api/coredump/upload":
+            self._handle_coredump_upload()
         elif path == "/api/ble/scan":
             self._handle_ble_scan()
         elif path == "/api/ble/connect":
@@ -1096,6 +1889,7 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._handle_ble_write()
         else:
             self._send_json({"error": "not found"}, 404)
+        self._end_request()
 
     def do_DELETE(self):
         path = urlparse(self.path).path
@@ -1106,29 +1900,49 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._handle_firmware_delete()
         else:
             self._send_json({"error": "not found"}, 404)
+        self._end_request()
 
     # -- handlers --
 
-    def _handle_get_devices(self):
+    def _handle_get_devices(self, qs):
+        """GET /api/devices[?since=V&timeout=S] — with since, waits until a
+        slot state changes after version V (or the timeout)."""
+        try:
+            since = int(qs.get("since", ["-1"])[0])
+            timeout = min(float(qs.get("timeout", ["0"])[0]), DEVICES_POLL_MAX_S)
+        except ValueError:
+            self._send_json({"ok": False, "error": "bad since/timeout"}, 400)
+            return
+        if since >= 0 and timeout > 0:
+            deadline = time.monotonic() + timeout
+            with _slots_cond:
+                while _slots_version <= since:
+                    remaining = deadline - time.monotonic()
+                    if remaining <= 0:
+                        break
+                    _slots_cond.wait(remaining)
         _refresh_host_ip()
-        infos = []
-        for slot in slots.values():
-            _refresh_slot_health(slot)
-            infos.append(_slot_info(slot))
-        self._send_json({"slots": infos, "host_ip": host_ip, "hostname": hostname})
+        with _slots_cond:
+            version = _slots_version
+            infos = list(_slot_views.values())
+        self._send_json({"slots": infos, "host_ip": host_ip, "hostname": hostname,
+                         "version": version})
 
     def _handle_get_info(self):
         _refresh_host_ip()
+        views = list(_slot_views.values())
         self._send_json({
             "host_ip": host_ip,
             "hostname": hostname,
-            "slots_configured": sum(1 for s in slots.values() if s["tcp_port"] is not None),
-            "slots_running": sum(1 for s in slots.values() if s["running"]),
+            "slots_configured": sum(1 for v in views if v["tcp_port"] is not None),
+            "slots_running": sum(1 for v in views if v["running"]),
+            "slots_listening": sum(1 for v in views if v["listening"] and not v["running"]),
+            "slot_actors": _actors.snapshot(),
+            "auto_ports": _ports.snapshot() if _ports else None,
+            "activator": _activator.snapshot(),
         })
 
     def _handle_hotplug(self):
-        global seq_counter
-
         body = self._read_json()
         if body is None:
             self._send_json({"ok": False, "error": "empty body"}, 400)
@@ -1142,132 +1956,22 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not action:
             self._send_json({"ok": False, "error": "missing action"}, 400)
             return
-
-        slot_key = id_path if id_path else devpath
-        if not slot_key:
+        if not (id_path or devpath):
             self._send_json({"ok": False, "error": "missing id_path and devpath"}, 400)
             return
 
-        # Look up or create slot
-        if slot_key not in slots:
-            slots[slot_key] = _make_dynamic_slot(slot_key)
-
-        slot = slots[slot_key]
-        lock = slot["_lock"]
-
-        # Update event bookkeeping (always, even for unknown slots)
-        seq_counter += 1
-        slot["seq"] = seq_counter
-        slot["last_action"] = action
-        slot["last_event_ts"] = datetime.now(timezone.utc).isoformat()
-
-        label = slot["label"] or slot_key[-20:]
-        configured = slot["tcp_port"] is not None
-
-        # -- Early exit: if recovery is in progress, ignore all events --
-        # The unbind/rebind cycle generates synthetic udev events; don't let
-        # them interfere with recovery state.
-        if slot["_recovering"]:
-            print(
-                f"[portal] hotplug: {action} {label} ignored (recovery in progress)",
-                flush=True,
-            )
-            self._send_json({
-                "ok": True, "slot_key": slot_key, "seq": seq_counter,
-                "accepted": False, "flapping": True, "recovering": True,
-            })
-            return
-
-        # -- Flap detection --
-        now = time.time()
-        slot["_event_times"].append(now)
-        # Prune events older than window
-        slot["_event_times"] = [t for t in slot["_event_times"] if now - t < FLAP_WINDOW_S]
-
-        # Recovery: if already flapping but not recovering, check if quiet long enough
-        if slot["flapping"] and not slot["_recovering"]:
-            if len(slot["_event_times"]) < 2:
-                slot["flapping"] = False
-                slot["last_error"] = None
-                slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
-                print(f'[portal] {label}: USB flapping cleared (events aged out)', flush=True)
-            else:
-                gap = slot["_event_times"][-1] - slot["_event_times"][-2]
-                if gap >= FLAP_COOLDOWN_S:
-                    slot["flapping"] = False
-                    slot["last_error"] = None
-                    slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
-                    print(f'[portal] {label}: USB flapping cleared (quiet for {gap:.0f}s)', flush=True)
-
-        # Detect new flapping → active recovery
-        if not slot["flapping"] and len(slot["_event_times"]) >= FLAP_THRESHOLD:
-            slot["flapping"] = True
-            slot["state"] = STATE_FLAPPING
-            slot["last_error"] = "USB flapping detected — starting recovery"
-            print(f'[portal] {label}: USB flapping detected ({len(slot["_event_times"])} events in {FLAP_WINDOW_S}s) — starting recovery', flush=True)
-            _start_flap_recovery(slot)
-
-        if action == "add":
-            slot["present"] = True
-            slot["devnode"] = devnode
-            if not slot["flapping"]:
-                slot["state"] = STATE_IDLE
-
-            if slot["flapping"]:
-                pass  # Recovery handles everything
-            elif configured:
-                # Start proxy in a background thread so we don't block the
-                # HTTP response for the settle + port-listen check.
-                def _bg_start(s=slot, lk=lock, dn=devnode):
-                    # Native USB (ttyACM): delay before opening port so the
-                    # chip boots past the download-mode-sensitive phase.
-                    if dn and "ttyACM" in dn:
-                        time.sleep(NATIVE_USB_BOOT_DELAY_S)
-                    with lk:
-                        if s["flapping"] or s["_recovering"]:
-                            return  # Recovery in progress
-                        # Stop existing proxy first if still running
-                        if s["running"] and s["pid"]:
-                            stop_proxy(s)
-                        start_proxy(s)
-                        if s["flapping"]:
-                            s["last_error"] = "USB flapping detected \u2014 device is connect/disconnect cycling"
-                threading.Thread(target=_bg_start, daemon=True).start()
-            else:
-                print(
-                    f"[portal] hotplug: unknown slot_key={slot_key} "
-                    f"(tracked, no proxy)",
-                    flush=True,
-                )
-
-        elif action == "remove":
-            slot["present"] = False
-            if not slot["flapping"]:
-                slot["state"] = STATE_ABSENT
-            if configured and slot["running"]:
-                def _bg_stop(s=slot, lk=lock):
-                    with lk:
-                        stop_proxy(s)
-                threading.Thread(target=_bg_stop, daemon=True).start()
-
-        log_activity(
-            f"USB {action}: {label} ({devnode or '?'})",
-            "ok" if action == "add" else "info",
-        )
-        print(
-            f"[portal] hotplug: {action} slot_key={slot_key} "
-            f"devnode={devnode} seq={seq_counter}",
-            flush=True,
-        )
-
-        self._send_json({
-            "ok": True,
-            "slot_key": slot_key,
-            "seq": seq_counter,
-            "accepted": configured,
-            "flapping": slot["flapping"],
-            "recovering": slot["_recovering"],
-        })
+        try:
+            future = _hotplug_dispatcher.submit((action, devnode, id_path, devpath), wait=True)
+            result = future.result(HOTPLUG_WAIT_S) if future else None
+        except TimeoutError as e:
+            self._send_json({"ok": False, "error": str(e) or "slot busy"}, 503)
+            return
+        except Exception:
+            result = None
+        if result is None:
+            self._send_json({"ok": False, "error": "hotplug handler failed"}, 500)
+            return
+        self._send_json(result)
 
     def _handle_start(self):
         body = self._read_json()
@@ -1285,17 +1989,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._send_json({"ok": False, "error": "unknown slot_key"}, 404)
             return
 
-        slot = slots[slot_key]
-        with slot["_lock"]:
-            if slot["running"] and slot["pid"]:
-                stop_proxy(slot)
-            slot["devnode"] = devnode
-            slot["present"] = True
-            ok = start_proxy(slot)
-            # start_proxy sets STATE_IDLE on success; ensure idle on failure too
-            if not ok and slot["state"] not in (STATE_IDLE, STATE_FLAPPING):
-                slot["state"] = STATE_IDLE
-        self._send_json({"ok": ok, "slot_key": slot_key, "running": slot["running"]})
+        ok, running = _actors.ask(slot_key, _restart_proxy, slots[slot_key], devnode)
+        self._send_json({"ok": ok, "slot_key": slot_key, "running": running})
 
     def _handle_stop(self):
         body = self._read_json()
@@ -1312,10 +2007,7 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._send_json({"ok": False, "error": "unknown slot_key"}, 404)
             return
 
-        slot = slots[slot_key]
-        with slot["_lock"]:
-            stop_proxy(slot)
-            slot["state"] = STATE_IDLE if slot["present"] else STATE_ABSENT
+        _actors.ask(slot_key, _stop_slot, slots[slot_key])
         self._send_json({"ok": True, "slot_key": slot_key, "running": False})
 
     # -- WiFi handlers --
@@ -1331,6 +2023,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if body is None:
             self._send_json({"ok": False, "error": "empty body"}, 400)
             return
+        if self._lease_blocked(radio=True):
+            return
         mode = body.get("mode")
         if mode not in ("wifi-testing", "serial-interface"):
             self._send_json({"ok": False, "error": "mode must be 'wifi-testing' or 'serial-interface'"}, 400)
@@ -1348,6 +2042,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if body is None:
             self._send_json({"ok": False, "error": "empty body"}, 400)
             return
+        if self._lease_blocked(radio=True):
+            return
         ssid = body.get("ssid")
         if not ssid:
             self._send_json({"ok": False, "error": "missing ssid"}, 400)
@@ -1361,6 +2057,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._send_json({"ok": False, "error": str(e)})
 
     def _handle_wifi_ap_stop(self):
+        if self._lease_blocked(radio=True):
+            return
         try:
             wifi_controller.ap_stop()
             self._send_json({"ok": True})
@@ -1375,6 +2073,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if body is None:
             self._send_json({"ok": False, "error": "empty body"}, 400)
             return
+        if self._lease_blocked(radio=True):
+            return
         ssid = body.get("ssid")
         if not ssid:
             self._send_json({"ok": False, "error": "missing ssid"}, 400)
@@ -1391,6 +2091,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._send_json({"ok": False, "error": str(e)})
 
     def _handle_wifi_sta_leave(self):
+        if self._lease_blocked(radio=True):
+            return
         log_activity("WiFi STA disconnecting", "step")
         try:
             wifi_controller.sta_leave()
@@ -1405,6 +2107,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if body is None:
             self._send_json({"ok": False, "error": "empty body"}, 400)
             return
+        if self._lease_blocked(radio=True):
+            return
         method = body.get("method", "GET")
         url = body.get("url")
         if not url:
@@ -1423,6 +2127,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._send_json({"ok": False, "error": str(e)})
 
     def _handle_wifi_scan(self):
+        if self._lease_blocked(radio=True):
+            return
         log_activity("WiFi scanning...", "step")
         try:
             result = wifi_controller.scan()
@@ -1470,6 +2176,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not slot:
             self._send_json({"ok": False, "error": f"slot '{slot_label}' not found"})
             return
+        if self._lease_blocked(slot=slot_label):
+            return
         log_activity(f"serial.reset({slot_label})", "step")
         result = serial_reset(slot)
         if result["ok"]:
@@ -1488,6 +2196,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not slot:
             self._send_json({"ok": False, "error": f"slot '{slot_label}' not found"})
             return
+        if self._lease_blocked(slot=slot_label):
+            return
         pattern = body.get("pattern")
         timeout = float(body.get("timeout", 10))
         log_activity(f"serial.monitor({slot_label}, pattern={pattern!r}, timeout={timeout})", "step")
@@ -1514,11 +2224,10 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not slot:
             self._send_json({"ok": False, "error": f"slot '{slot_label}' not found"})
             return
-        # Reset retry counter for fresh attempt
-        slot["_recover_retries"] = 0
-        slot["flapping"] = True
+        if self._lease_blocked(slot=slot_label):
+            return
         log_activity(f"serial.recover({slot_label}) — manual recovery triggered", "step")
-        _start_flap_recovery(slot)
+        _actors.ask(slot["slot_key"], _request_recovery, slot)
         self._send_json({"ok": True, "message": f"recovery started for {slot_label}"})
 
     def _handle_serial_release(self):
@@ -1532,8 +2241,10 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not slot:
             self._send_json({"ok": False, "error": f"slot '{slot_label}' not found"})
             return
+        if self._lease_blocked(slot=slot_label):
+            return
         log_activity(f"serial.release({slot_label})", "step")
-        result = _release_slot_gpio(slot)
+        result = _actors.ask(slot["slot_key"], _release_slot_gpio, slot)
         if result["ok"]:
             log_activity(f"serial.release({slot_label}) — done", "ok")
         else:
@@ -1560,6 +2271,8 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not wifi_ssid:
             self._send_json({"ok": False, "error": "ssid is required"})
             return
+        if self._lease_blocked(radio=True):
+            return
 
         if _enter_portal_running:
             self._send_json({"ok": False, "error": "enter-portal already running"})
@@ -1584,132 +2297,152 @@ class Handler(http.server.BaseHTTPRequestHandler):
 
         self._send_json({"ok": True, "message": "enter-portal started in background"})
 
+    # -- lease handlers --
+
+    def _handle_lease_acquire(self):
+        """POST /api/lease/acquire {"slot"?: label|"any", "radio"?, "holder",
+        "ttl"?, "wait"?} — blocks up to "wait" s; 409 if still busy."""
+        body = self._read_json() or {}
+        slot_label = body.get("slot")
+        if slot_label not in (None, "any") and not _find_slot_by_label(slot_label):
+            self._send_json({"ok": False, "error": f"slot '{slot_label}' not found"}, 404)
+            return
+        holder = str(body.get("holder") or self.client_address[0])
+        try:
+            lease = _leases.acquire(holder, slot_label, bool(body.get("radio")),
+                                    ttl=body.get("ttl", lease_manager.DEFAULT_TTL_S),
+                                    wait=body.get("wait", 0))
+        except (ValueError, TypeError) as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
+        if lease is None:
+            self._send_json({"ok": False, "error": "busy", "busy": True,
+                             "leases": _leases.snapshot()}, 409)
+            return
+        what = ", ".join(filter(None, [lease.slot, "radio" if body.get("radio") else None]))
+        log_activity(f"Lease: {what} → {holder}", "info")
+        self._send_json({"ok": True, **lease.info(time.monotonic())})
+
+    def _handle_lease_renew(self):
+        """POST /api/lease/renew {"token", "ttl"?} — extend before it expires."""
+        body = self._read_json() or {}
+        try:
+            lease = _leases.renew(str(body.get("token", "")), body.get("ttl"))
+        except (ValueError, TypeError) as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
+        if lease is None:
+            self._send_json({"ok": False, "error": "unknown or expired lease"}, 404)
+            return
+        self._send_json({"ok": True, **lease.info(time.monotonic())})
+
+    def _handle_lease_release(self):
+        """POST /api/lease/release {"token"}."""
+        body = self._read_json() or {}
+        if not _leases.release(str(body.get("token", ""))):
+            self._send_json({"ok": False, "error": "unknown or expired lease"}, 404)
+            return
+        self._send_json({"ok": True})
+
     # -- human interaction handlers (event-driven, blocking) --
 
     def _handle_human_interaction(self):
         """Blocking endpoint — stays open until human clicks Done/Cancel or timeout."""
-        global _human_event, _human_confirmed, _human_message
-
         body = self._read_json()
         if not body or not body.get("message"):
             self._send_json({"ok": False, "error": "missing message"}, 400)
             return
         timeout = float(body.get("timeout", 120))
+        try:
+            req = _sessions.human_open(body.get("session"), body["message"])
+        except ValueError as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
+        if req is None:
+            self._send_json({"ok": False, "error": "another request pending"}, 409)
+            return
 
-        with _human_lock:
-            if _human_event is not None:
-                self._send_json({"ok": False, "error": "another request pending"}, 409)
-                return
-            _human_event = threading.Event()
-            _human_confirmed = False
-            _human_message = body["message"]
-
-        log_activity(f"Human interaction: {body['message']}", "step")
+        tag = "" if req.session == session_hub.DEFAULT_SESSION else f"[{req.session}] "
+        log_activity(f"{tag}Human interaction: {req.message}", "step")
 
         # Block here until Done/Cancel or timeout
-        responded = _human_event.wait(timeout=timeout)
-
-        with _human_lock:
-            confirmed = _human_confirmed
-            msg = _human_message
-            _human_event = None
-            _human_message = None
+        responded = req.event.wait(timeout=timeout)
+        _sessions.human_close(req)
 
         if responded:
+            confirmed = req.confirmed
             cat = "ok" if confirmed else "info"
-            log_activity(f"Human {'confirmed' if confirmed else 'cancelled'}: {msg}", cat)
+            log_activity(f"{tag}Human {'confirmed' if confirmed else 'cancelled'}: {req.message}", cat)
             self._send_json({"ok": True, "confirmed": confirmed})
         else:
-            log_activity(f"Human interaction timed out: {msg}", "error")
+            log_activity(f"{tag}Human interaction timed out: {req.message}", "error")
             self._send_json({"ok": True, "confirmed": False, "timeout": True})
 
     def _handle_human_status(self):
-        """UI polls this to show/hide the modal."""
-        with _human_lock:
-            if _human_event is not None and not _human_event.is_set():
-                self._send_json({"ok": True, "pending": True, "message": _human_message})
-            else:
-                self._send_json({"ok": True, "pending": False, "message": ""})
+        """All pending operator requests; top-level fields describe the oldest."""
+        pending = _sessions.human_pending()
+        first = pending[0] if pending else None
+        self._send_json({"ok": True, "pending": first is not None,
+                         "message": first["message"] if first else "",
+                         "id": first["id"] if first else None,
+                         "requests": pending})
+
+    def _handle_human_answer(self, confirmed: bool):
+        """UI Done/Cancel — wakes the blocking handler. Body {"id"?}: without
+        an id the oldest pending request is answered."""
+        body = self._read_json() or {}
+        req_id = body.get("id")
+        if req_id is not None and not isinstance(req_id, int):
+            self._send_json({"ok": False, "error": "id must be an integer"}, 400)
+            return
+        if not _sessions.human_respond(req_id, confirmed):
+            self._send_json({"ok": False, "error": "no pending request"})
+            return
+        self._send_json({"ok": True})
 
     def _handle_human_done(self):
-        """UI Done button — wakes the blocking handler with confirmed=True."""
-        global _human_confirmed
-        with _human_lock:
-            if _human_event is None or _human_event.is_set():
-                self._send_json({"ok": False, "error": "no pending request"})
-                return
-            _human_confirmed = True
-            _human_event.set()
-        self._send_json({"ok": True})
+        self._handle_human_answer(True)
 
     def _handle_human_cancel(self):
-        """UI Cancel button — wakes the blocking handler with confirmed=False."""
-        global _human_confirmed
-        with _human_lock:
-            if _human_event is None or _human_event.is_set():
-                self._send_json({"ok": False, "error": "no pending request"})
-                return
-            _human_confirmed = False
-            _human_event.set()
-        self._send_json({"ok": True})
+        self._handle_human_answer(False)
 
     # -- test progress handlers --
 
-    def _handle_test_progress(self):
-        """GET /api/test/progress — UI polls this for test session state."""
-        with _test_lock:
-            if _test_session is None:
-                self._send_json({"ok": True, "active": False})
-            else:
-                self._send_json({"ok": True, "active": True, **_test_session})
+    def _handle_test_progress(self, qs):
+        """GET /api/test/progress[?session=ID] — one session's state."""
+        session = qs.get("session", [session_hub.DEFAULT_SESSION])[0]
+        info = _sessions.progress(session)
+        if info is None or info["ended"]:
+            self._send_json({"ok": True, "active": False})
+        else:
+            self._send_json({"ok": True, "active": True, **info})
+
+    def _handle_get_sessions(self, qs):
+        """GET /api/sessions[?since=V&timeout=S] — all sessions; long-polls
+        until something changes after version V."""
+        try:
+            since = int(qs.get("since", ["-1"])[0])
+            timeout = min(float(qs.get("timeout", ["0"])[0]), SESSIONS_POLL_MAX_S)
+        except ValueError:
+            self._send_json({"ok": False, "error": "bad since/timeout"}, 400)
+            return
+        snap = _sessions.wait(since, timeout) if since >= 0 and timeout > 0 else _sessions.snapshot()
+        self._send_json({"ok": True, **snap})
 
     def _handle_test_update(self):
         """POST /api/test/update — test scripts push progress updates."""
-        global _test_session
-
         body = self._read_json()
         if not body:
             self._send_json({"ok": False, "error": "empty body"}, 400)
             return
-
-        with _test_lock:
-            # End session
-            if body.get("end"):
-                _test_session = None
-                self._send_json({"ok": True})
-                return
-
-            # Start session (spec field present)
-            if "spec" in body:
-                _test_session = {
-                    "spec": body["spec"],
-                    "phase": body.get("phase", ""),
-                    "total": body.get("total", 0),
-                    "completed": [],
-                    "current": None,
-                }
-
-            if _test_session is None:
-                self._send_json({"ok": False, "error": "no active session"}, 400)
-                return
-
-            # Update phase if provided
-            if "phase" in body and "spec" not in body:
-                _test_session["phase"] = body["phase"]
-
-            # Update total if provided
-            if "total" in body and "spec" not in body:
-                _test_session["total"] = body["total"]
-
-            # Update current test
-            if "current" in body:
-                _test_session["current"] = body["current"]
-
-            # Record a result
-            if "result" in body:
-                _test_session["completed"].append(body["result"])
-                _test_session["current"] = None
-
+        try:
+            error = _sessions.update(body.get("session"), body)
+        except (ValueError, TypeError) as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
+        if error:
+            self._send_json({"ok": False, "error": error}, 400)
+            return
         self._send_json({"ok": True})
 
     # -- GPIO handlers --
@@ -1737,19 +2470,79 @@ class Handler(http.server.BaseHTTPRequestHandler):
             return
         self._send_json({"ok": True, "pin": pin, "value": value})
 
-    def _handle_gpio_status(self):
-        pins = {}
-        with _gpio_lock:
-            for pin, req in _gpio_requests.items():
-                try:
-                    val = req.get_value(pin)
-                    # Track direction from our own state
-                    direction = _gpio_directions.get(pin, "unknown")
-                    pins[str(pin)] = {"direction": direction, "value": val.value}
-                except Exception:
-                    pins[str(pin)] = {"direction": "unknown", "value": None}
+    def _handle_gpio_status(self, qs):
+        """GET /api/gpio/status[?sample=27,22] — driven pins, plus sampled inputs."""
+        sample = [p for p in qs.get("sample", [""])[0].split(",") if p]
+        try:
+            pins = _gpio_bank.status()
+            if sample:
+                pins.update(_gpio_bank.sample([int(p) for p in sample]))
+        except ValueError as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
         self._send_json({"ok": True, "pins": pins})
 
+    def _gpio_names(self, body: dict) -> dict | None:
+        """Pin names for a sequence/capture body ("slot" and "pins"); sends
+        the error response and returns None if they are invalid."""
+        names = {}
+        slot_label = body.get("slot")
+        if slot_label:
+            slot = _find_slot_by_label(slot_label)
+            if not slot:
+                self._send_json({"ok": False, "error": f"slot '{slot_label}' not found"}, 404)
+                return None
+            if self._lease_blocked(slot=slot_label):
+                return None
+            names.update(_slot_gpio_names(slot))
+        pins = body.get("pins") or {}
+        if not isinstance(pins, dict) or not all(isinstance(v, int) for v in pins.values()):
+            self._send_json({"ok": False, "error": "'pins' must map names to pin numbers"}, 400)
+            return None
+        names.update(pins)
+        return names
+
+    def _handle_gpio_sequence(self):
+        """POST /api/gpio/sequence {"slot"?, "pins"?, "steps": [...]} — timed GPIO sequence."""
+        body = self._read_json()
+        if not body or "steps" not in body:
+            self._send_json({"ok": False, "error": "missing 'steps'"}, 400)
+            return
+        names = self._gpio_names(body)
+        if names is None:
+            return
+        try:
+            result = _gpio_bank.run(body["steps"], names)
+        except ValueError as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
+        except Exception as e:
+            self._send_json({"ok": False, "error": str(e)})
+            return
+        self._send_json(result)
+
+    def _handle_gpio_capture(self):
+        """POST /api/gpio/capture {"capture": [...], "duration_ms", ...} — edge capture."""
+        body = self._read_json()
+        if not body or "capture" not in body or "duration_ms" not in body:
+            self._send_json({"ok": False, "error": "missing 'capture' or 'duration_ms'"}, 400)
+            return
+        names = self._gpio_names(body)
+        if names is None:
+            return
+        try:
+            result = _gpio_bank.capture(
+                body["capture"], body["duration_ms"], names,
+                max_edges=body.get("max_edges", 10_000), steps=body.get("steps"),
+                include_edges=bool(body.get("edges", True)))
+        except ValueError as e:
+            self._send_json({"ok": False, "error": str(e)}, 400)
+            return
+        except Exception as e:
+            self._send_json({"ok": False, "error": str(e)})
+            return
+        self._send_json(result)
+
     # -- UDP log handlers --
 
     def _handle_get_udplog(self, qs):
@@ -1767,6 +2560,12 @@ class Handler(http.server.BaseHTTPRequestHandler):
                 break
         self._send_json({"ok": True, "lines": lines})
 
+    def _handle_get_bootrec(self, qs):
+        source = qs.get("source", [""])[0]
+        with _bootrec_lock:
+            sources = [source] if source else sorted(_bootrec)
+        self._send_json({"ok": True, "devices": [_bootrec_summary(s) for s in sources]})
+
     # -- firmware handlers --
 
     def _handle_firmware_list(self):
@@ -1805,6 +2604,14 @@ class Handler(http.server.BaseHTTPRequestHandler):
         if not os.path.isfile(fpath):
             self._send_json({"error": "not found"}, 404)
             return
+        # Downloads through the AP stay on wlan0; anything else crosses the NIC
+        bus = _net_bus if self.connection.getsockname()[0] != wifi_controller.AP_IP else None
+        op = None
+        if bus:
+            op = _bus.acquire(bus, "ota", self.client_address[0], OTA_KBPS, OTA_BUS_WAIT_S)
+            if op is None:
+                self._send_json({"error": f"USB bus {bus} busy, retry later"}, 503)
+                return
         try:
             fsize = os.path.getsize(fpath)
             self.send_response(200)
@@ -1818,8 +2625,11 @@ class Handler(http.server.BaseHTTPRequestHandler):
                     if not chunk:
                         break
                     self.wfile.write(chunk)
-        except BrokenPipeError:
+        except (BrokenPipeError, ConnectionResetError):
             pass
+        finally:
+            if op:
+                _bus.release(op)
 
     def _handle_firmware_upload(self):
         content_type = self.headers.get("Content-Type", "")
@@ -1840,6 +2650,7 @@ class Handler(http.server.BaseHTTPRequestHandler):
             self._send_json({"ok": False, "error": "empty body"}, 400)
             return
         body = self.rfile.read(length)
+        self._body_read = True
         boundary_bytes = boundary.encode()
         parts_raw = body.split(b"--" + boundary_bytes)
         project = None
@@ -1902,6 +2713,154 @@ class Handler(http.server.BaseHTTPRequestHandler):
         log_activity(f"firmware.delete({project}/{filename})", "ok")
         self._send_json({"ok": True})
 
+    # -- local flashing handlers --
+
+    def _handle_flash_start(self):
+        """POST /api/flash {"project", "slots": [labels] | "all", "baud"?,
+        "skip_unchanged"?} — flash FIRMWARE_DIR/<project> (flash_args + bins)
+        to the slots in parallel; returns the job, progress via GET /api/flash."""
+        body = self._read_json() or {}
+        project = str(body.get("project", ""))
+        if not project or ".." in project or "/" in project:
+            self._send_json({"ok": False, "error": "missing or invalid 'project'"}, 400)
+            return
+        labels = body.get("slots")
+        if labels == "all":
+            labels = [v["label"] for v in list(_slot_views.values())
+                      if v["label"] and v["present"] and v["state"] in FLASH_READY_STATES]
+        elif isinstance(labels, str):
+            labels = [labels]
+        if not labels or not isinstance(labels, list):
+            self._send_json({"ok": False, "error": "missing 'slots' (labels or \"all\")"}, 400)
+            return
+        try:
+            baud = int(body.get("baud", flash_orchestrator.FLASH_BAUDS[0]))
+        except (TypeError, ValueError):
+            baud = 0
+        if baud < 9600:
+            self._send_json({"ok": False, "error": "bad 'baud'"}, 400)
+            return
+        for label in dict.fromkeys(labels):
+            view = _find_view_by_label(label)
+            if not view or view["tcp_port"] is None:
+                self._send_json({"ok": False, "error": f"slot '{label}' not found"}, 404)
+                return
+            if self._lease_blocked(slot=label):
+                return
+            state = view.get("state", STATE_ABSENT)
+            if not view.get("present") or state not in FLASH_READY_STATES:
+                self._send_json({"ok": False, "error": f"{label} is {state}"}, 409)
+                return
+        try:
+            job = _flasher.start(os.path.join(FIRMWARE_DIR, project), list(dict.fromkeys(labels)),
+                                 baud, bool(body.get("skip_unchanged", True)))
+        except flash_orchestrator.FlashError as e:
+            status = 409 if str(e).startswith("already flashing") else 400
+            self._send_json({"ok": False, "error": str(e)}, status)
+            return
+        log_activity(f"flash({project}) job {job['job']} → {', '.join(labels)} @ {baud} baud", "step")
+        self._send_json({"ok": True, **job})
+
+    def _handle_flash_status(self, qs):
+        """GET /api/flash[?since=V&timeout=S] — recent flash jobs with per-slot
+        progress; with since, waits until something changes after version V."""
+        try:
+            since = int(qs.get("since", ["-1"])[0])
+            timeout = min(float(qs.get("timeout", ["0"])[0]), FLASH_POLL_MAX_S)
+        except ValueError:
+            self._send_json({"ok": False, "error": "bad since/timeout"}, 400)
+            return
+        snap = _flasher.wait(since, timeout) if since >= 0 and timeout > 0 else _flasher.snapshot()
+        self._send_json({"ok": True, **snap})
+
+    # -- core dump handlers --
+
+    def _handle_coredump_upload(self):
+        """One chunk of a raw core dump image: ?device=&project=&elf_sha256=&offset=&total=
+
+        Chunks must arrive in order; a chunk at offset 0 restarts the
+        upload. A wrong offset gets 409 with the offset expected next.
+        A re-sent chunk (its reply was lost) is acknowledged again without
+        writing, and so is the last chunk of a finished upload.
+        """
+        qs = parse_qs(urlparse(self.path).query)
+        device = qs.get("device", [""])[0]
+        project = qs.get("project", [""])[0]
+        elf_sha = qs.get("elf_sha256", [""])[0]
+        try:
+            offset = int(qs.get("offset", [""])[0])
+            total = int(qs.get("total", [""])[0])
+        except ValueError:
+            self._send_json({"ok": False, "error": "offset and total required"}, 400)
+            return
+        length = int(self.headers.get("Content-Length", 0))
+        if not _safe_name(device) or (project and not _safe_name(project)) or \
+                (elf_sha and not all(c in "0123456789abcdefABCDEF" for c in elf_sha)):
+            self._send_json({"ok": False, "error": "invalid device, project or elf_sha256"}, 400)
+            return
+        if length <= 0 or offset < 0 or total > COREDUMP_MAX_SIZE or offset + length > total:
+            self._send_json({"ok": False, "error": "bad offset/length/total"}, 400)
+            return
+        data = self.rfile.read(length)
+        self._body_read = True
+
+        os.makedirs(COREDUMP_DIR, exist_ok=True)
+        part = os.path.join(COREDUMP_DIR, device + ".part")
+        chunk_id = (offset, total, elf_sha, hashlib.sha256(data).digest())
+        with _coredump_lock:
+            if _coredump_done.get(device) == chunk_id:
+                self._send_json({"ok": True, "received": total, "complete": True})
+                return
+            have = os.path.getsize(part) if os.path.exists(part) else 0
+            if 0 < offset and offset + length == have:
+                with open(part, "rb") as f:
+                    f.seek(offset)
+                    same = f.read(length) == data
+                if same:
+                    self._send_json({"ok": True, "received": have, "complete": False})
+                    return
+            if offset != 0 and offset != have:
+                self._send_json({"ok": False, "error": "out of order", "expected_offset": have}, 409)
+                return
+            with open(part, "wb" if offset == 0 else "ab") as f:
+                f.write(data)
+            _coredump_done.pop(device, None)
+            received = offset + length
+            meta = None
+            if received == total:
+                name = f"{device}-{datetime.now().strftime('%Y%m%d-%H%M%S')}"
+                os.replace(part, os.path.join(COREDUMP_DIR, name + ".core"))
+                _coredump_done[device] = chunk_id
+                meta = {"name": name, "device": device, "project": project,
+                        "elf_sha256": elf_sha, "size": total, "source": self.client_address[0],
+                        "received": datetime.now(timezone.utc).isoformat(),
+                        "status": "decoding", "elf": None}
+                _coredump_write_meta(meta)
+
+        if meta:
+            log_activity(f"coredump {meta['name']} received ({total} bytes) from {device}", "step")
+            threading.Thread(target=_coredump_decode, args=(meta,), daemon=True,
+                             name="coredump-decode").start()
+        self._send_json({"ok": True, "received": received, "complete": meta is not None})
+
+    def _handle_coredump_report(self, qs):
+        name = qs.get("name", [""])[0]
+        if not _safe_name(name):
+            self._send_json({"ok": False, "error": "invalid name"}, 400)
+            return
+        meta_path = os.path.join(COREDUMP_DIR, name + ".json")
+        if not os.path.isfile(meta_path):
+            self._send_json({"ok": False, "error": "not found"}, 404)
+            return
+        with open(meta_path) as f:
+            meta = json.load(f)
+        report = None
+        txt = os.path.join(COREDUMP_DIR, name + ".txt")
+        if os.path.isfile(txt):
+            with open(txt) as f:
+                report = f.read()
+        self._send_json({"ok": True, **meta, "report": report})
+
     # -- BLE handlers --
 
     def _handle_ble_scan(self):
@@ -2150,6 +3109,8 @@ _UI_HTML = """\
         /* Test progress panel */
         .test-section { margin: 20px 0 0; }
         .test-progress { background: #16213e; border-radius: 12px; padding: 20px; border: 2px solid #0f3460; }
+        .test-progress + .test-progress { margin-top: 12px; }
+        .test-progress.ended { opacity: 0.6; }
         .test-header { font-size: 1.1em; color: #e0e0e0; margin-bottom: 10px; }
         .test-bar-container { background: #333; border-radius: 4px; height: 8px; margin-bottom: 8px; }
         .test-bar { background: #28a745; height: 100%; border-radius: 4px; transition: width 0.3s; }
@@ -2178,15 +3139,7 @@ _UI_HTML = """\
     <div class="slots" id="slots"></div>
     <div class="test-section" id="test-section">
         <h2>Test Progress</h2>
-        <div class="test-progress">
-            <div class="test-header" id="test-header"></div>
-            <div class="test-bar-container">
-                <div class="test-bar" id="test-bar"></div>
-            </div>
-            <div class="test-counter" id="test-counter"></div>
-            <div class="test-current" id="test-current"></div>
-            <div class="test-results" id="test-results"></div>
-        </div>
+        <div id="test-sessions"></div>
     </div>
     <div class="log-section">
         <h2>Activity Log</h2>
@@ -2386,28 +3339,39 @@ async function recoverSlot(label) {
     refresh();
 }
 
-let humanPending = false;
-
-async function fetchHuman() {
-    try {
-        const resp = await fetch('/api/human/status');
-        const data = await resp.json();
-        const overlay = document.getElementById('human-overlay');
-        if (data.pending) {
-            if (!humanPending) {
-                document.getElementById('human-message').textContent = data.message;
-                document.getElementById('human-status').textContent = '';
-                overlay.classList.add('visible');
-            }
-            humanPending = true;
-        } else {
-            if (humanPending) {
-                overlay.classList.remove('visible');
-                document.getElementById('human-status').textContent = '';
-            }
-            humanPending = false;
+let humanId = null;
+
+function renderHuman(sessions) {
+    // Oldest pending operator request across all sessions
+    let req = null;
+    sessions.forEach(function(sess) {
+        if (sess.human && (!req || sess.human.id < req.id)) req = sess.human;
+    });
+    const overlay = document.getElementById('human-overlay');
+    if (req) {
+        if (req.id !== humanId) {
+            const prefix = req.session === 'default' ? '' : '[' + req.session + '] ';
+            document.getElementById('human-message').textContent = prefix + req.message;
+            document.getElementById('human-status').textContent = '';
+            overlay.classList.add('visible');
         }
-    } catch (e) { /* ignore */ }
+        humanId = req.id;
+    } else {
+        if (humanId !== null) {
+            overlay.classList.remove('visible');
+            document.getElementById('human-status').textContent = '';
+        }
+        humanId = null;
+    }
+}
+
+async function answerHuman(action) {
+    const resp = await fetch('/api/human/' + action, {
+        method: 'POST',
+        headers: {'Content-Type': 'application/json'},
+        body: JSON.stringify(humanId !== null ? {id: humanId} : {})
+    });
+    return resp.json();
 }
 
 document.getElementById('btn-human-done').addEventListener('click', async function() {
@@ -2417,18 +3381,8 @@ document.getElementById('btn-human-done').addEventListener('click', async functi
     btn.textContent = 'Sending...';
     statusEl.textContent = '';
     try {
-        const resp = await fetch('/api/human/done', {
-            method: 'POST',
-            headers: {'Content-Type': 'application/json'},
-            body: '{}'
-        });
-        const data = await resp.json();
-        if (data.ok) {
-            document.getElementById('human-overlay').classList.remove('visible');
-            humanPending = false;
-        } else {
-            statusEl.textContent = data.error || 'Failed';
-        }
+        const data = await answerHuman('done');
+        if (!data.ok) statusEl.textContent = data.error || 'Failed';
     } catch (e) { statusEl.textContent = 'Error: ' + e; }
     btn.disabled = false;
     btn.textContent = 'Done';
@@ -2437,66 +3391,69 @@ document.getElementById('btn-human-done').addEventListener('click', async functi
 document.getElementById('btn-human-cancel').addEventListener('click', async function() {
     const btn = this;
     btn.disabled = true;
-    try {
-        const resp = await fetch('/api/human/cancel', {
-            method: 'POST',
-            headers: {'Content-Type': 'application/json'},
-            body: '{}'
-        });
-        const data = await resp.json();
-        if (data && data.ok) {
-            document.getElementById('human-overlay').classList.remove('visible');
-            humanPending = false;
-        }
-    } catch (e) { /* ignore */ }
+    try { await answerHuman('cancel'); } catch (e) { /* ignore */ }
     btn.disabled = false;
 });
 
-async function fetchTestProgress() {
-    try {
-        const resp = await fetch('/api/test/progress');
-        const data = await resp.json();
+function escapeHtml(t) {
+    return String(t == null ? '' : t).replace(/[&<>"]/g, function(c) {
+        return {'&': '&amp;', '<': '&lt;', '>': '&gt;', '"': '&quot;'}[c];
+    });
+}
 
-        if (!data.active) {
-            document.getElementById('test-header').textContent = 'No test session active';
-            document.getElementById('test-bar').style.width = '0%';
-            document.getElementById('test-counter').textContent = '';
-            document.getElementById('test-current').style.display = 'none';
-            document.getElementById('test-results').innerHTML = '';
-            return;
-        }
+function renderSession(sess) {
+    const pct = sess.total > 0 ? Math.min(100, sess.done / sess.total * 100) : 0;
+    const name = sess.session === 'default' ? '' : '[' + sess.session + '] ';
+    let html = '<div class="test-progress' + (sess.ended ? ' ended' : '') + '">'
+        + '<div class="test-header">' + escapeHtml(name + sess.spec + ' — ' + sess.phase)
+        + (sess.ended ? ' (ended)' : '') + '</div>'
+        + '<div class="test-bar-container"><div class="test-bar" style="width:' + pct + '%"></div></div>'
+        + '<div class="test-counter">' + sess.done + ' / ' + sess.total + ' completed'
+        + Object.keys(sess.counts).map(function(k) { return ' · ' + escapeHtml(k) + ' ' + sess.counts[k]; }).join('')
+        + '</div>';
+    if (sess.current) {
+        html += '<div class="test-current' + (sess.current.manual ? ' manual' : '') + '">'
+            + '<div class="test-id">' + escapeHtml(sess.current.id + ': ' + sess.current.name) + '</div>'
+            + '<div class="test-step">' + escapeHtml(sess.current.step) + '</div></div>';
+    }
+    html += '<div class="test-results">' + sess.completed.slice().reverse().map(function(r) {
+        return '<div class="test-result"><span class="badge ' + escapeHtml(String(r.result).toLowerCase()) + '">'
+            + escapeHtml(r.result) + '</span><span>' + escapeHtml(r.id + ': ' + r.name) + '</span>'
+            + (r.details ? '<span style="color:#666"> — ' + escapeHtml(r.details) + '</span>' : '')
+            + '</div>';
+    }).join('') + '</div></div>';
+    return html;
+}
 
-        document.getElementById('test-header').textContent = data.spec + ' — ' + data.phase;
-        const done = data.completed.length;
-        const pct = data.total > 0 ? (done / data.total * 100) : 0;
-        document.getElementById('test-bar').style.width = pct + '%';
-        document.getElementById('test-counter').textContent = done + ' / ' + data.total + ' completed';
-
-        const cur = document.getElementById('test-current');
-        if (data.current) {
-            cur.style.display = '';
-            cur.className = 'test-current' + (data.current.manual ? ' manual' : '');
-            cur.innerHTML = '<div class="test-id">' + data.current.id + ': ' + data.current.name + '</div>'
-                + '<div class="test-step">' + data.current.step + '</div>';
-        } else {
-            cur.style.display = 'none';
-        }
+function renderSessions(sessions) {
+    const shown = sessions.filter(function(sess) { return sess.spec; });
+    document.getElementById('test-sessions').innerHTML = shown.length
+        ? shown.map(renderSession).join('')
+        : '<div class="test-progress"><div class="test-header">No test session active</div></div>';
+    renderHuman(sessions);
+}
 
-        const res = document.getElementById('test-results');
-        res.innerHTML = data.completed.slice().reverse().map(function(r) {
-            return '<div class="test-result"><span class="badge ' + r.result.toLowerCase() + '">'
-                + r.result + '</span><span>' + r.id + ': ' + r.name + '</span>'
-                + (r.details ? '<span style="color:#666"> — ' + r.details + '</span>' : '')
-                + '</div>';
-        }).join('');
-    } catch (e) { /* ignore */ }
+// Sessions are pushed: the server holds each request until something changes
+async function watchSessions() {
+    let version = -1;
+    for (;;) {
+        try {
+            const resp = await fetch('/api/sessions?since=' + version + '&timeout=25');
+            const data = await resp.json();
+            version = data.version;
+            renderSessions(data.sessions);
+        } catch (e) {
+            await new Promise(function(r) { setTimeout(r, 2000); });
+        }
+    }
 }
 
 async function refresh() {
-    await Promise.all([fetchDevices(), fetchLog(), fetchHuman(), fetchTestProgress()]);
+    await Promise.all([fetchDevices(), fetchLog()]);
 }
 refresh();
 setInterval(refresh, 5000);
+watchSessions();
 </script>
 </body>
 </html>
@@ -2508,20 +3465,33 @@ setInterval(refresh, 5000);
 # ---------------------------------------------------------------------------
 
 def main():
-    global slots, host_ip, hostname
+    global slots, host_ip, hostname, _ports
 
     slots = load_config(CONFIG_FILE)
     host_ip = get_host_ip()
     hostname = get_hostname()
+    auto = port_map.parse_range(AUTO_PORTS)
+    if auto:
+        reserved = {s["tcp_port"] for s in slots.values()} | {PORT, UDP_LOG_PORT}
+        _ports = port_map.PortMap(PORT_MAP_FILE, *auto, reserved=reserved)
+        print(f"[portal] auto ports {auto[0]}-{auto[1]} ({PORT_MAP_FILE}), "
+              f"proxies idle-exit after {PROXY_IDLE_S:.0f}s", flush=True)
 
     # Pre-compute URLs for configured slots
     for slot in slots.values():
         if slot["tcp_port"]:
             slot["url"] = f"rfc2217://{host_ip}:{slot['tcp_port']}"
+        _publish(slot)
+
+    print(f"[portal] USB bus budget {USB_BUS_BUDGET_KBPS:.0f} kB/s per controller, "
+          f"NIC bus: {_net_bus or 'not USB'}", flush=True)
 
     # Scan for devices already plugged in at boot
     scan_existing_devices()
 
+    # Hotplug: one in-order dispatcher, fed by the netlink uevent monitor
+    start_hotplug_monitor()
+
     # Start UDP log receiver
     start_udp_log()
 
@@ -2541,13 +3511,18 @@ def main():
     except KeyboardInterrupt:
         print("[portal] shutting down", flush=True)
         _udp_shutdown.set()
+        if _uevent_monitor:
+            _uevent_monitor.stop()
+        _hotplug_dispatcher.stop()
         wifi_controller.shutdown()
         if ble_controller:
             ble_controller.shutdown()
         # Stop all running proxies
-        for slot in slots.values():
-            if slot["running"] and slot["pid"]:
-                stop_proxy(slot)
+        for key, view in list(_slot_views.items()):
+            if view["running"]:
+                _actors.ask(key, stop_proxy, slots[key], timeout=10)
+        _actors.stop()
+        _activator.stop()
         httpd.server_close()
 
 
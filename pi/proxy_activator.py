@@ -0,0 +1,203 @@
+"""
+Proxy activator — listen on a slot's TCP port without running its proxy,
+and start the proxy when the first client connects.
+
+A slot with "lazy" proxying holds only a listening socket while nobody
+uses it. One selector thread watches all of them; when a client connects
+the socket is disarmed (no longer watched, the connection stays in the
+backlog) and on_connect(key) is called. The portal then starts the proxy
+with the socket inherited as --fd, so the proxy accepts that same
+connection — the client never sees a refused port.
+
+The proxy exits by itself after some idle time. Its stdout pipe is
+watched too: EOF means it has exited, and on_exit(key, pid) lets the
+portal reap it and re-arm the socket.
+
+Callbacks run on the selector thread and must not block; the portal
+only queues actor commands there.
+"""
+
+import os
+import selectors
+import socket
+import threading
+
+LISTEN_BACKLOG = 8
+
+
+class Activator:
+    def __init__(self, on_connect, on_exit, name: str = "activator"):
+        self._on_connect = on_connect
+        self._on_exit = on_exit
+        self._name = name
+        self._lock = threading.Lock()
+        self._socks: dict = {}              # key -> listening socket
+        self._armed: set = set()
+        self._pipes: dict = {}              # key -> (pipe, pid)
+        self._ops: list = []                # selector changes for the thread
+        self._sel: selectors.BaseSelector | None = None
+        self._wake_r = self._wake_w = None
+        self._thread: threading.Thread | None = None
+        self.activations = 0
+
+    # -- internals --
+
+    def _start(self):
+        if self._thread:
+            return
+        self._sel = selectors.DefaultSelector()
+        self._wake_r, self._wake_w = os.pipe()
+        os.set_blocking(self._wake_r, False)
+        self._sel.register(self._wake_r, selectors.EVENT_READ, ("wake", None))
+        self._thread = threading.Thread(target=self._run, daemon=True, name=self._name)
+        self._thread.start()
+
+    def _op(self, kind, fileobj, data=None) -> threading.Event:
+        """Queue a selector change for the thread (call with _lock held)."""
+        self._start()
+        done = threading.Event()
+        self._ops.append((kind, fileobj, data, done))
+        os.write(self._wake_w, b"x")
+        return done
+
+    def _apply(self, kind, fileobj, data=None):
+        try:
+            if kind == "add":
+                self._sel.register(fileobj, selectors.EVENT_READ, data)
+            else:
+                self._sel.unregister(fileobj)
+        except (KeyError, ValueError, OSError):
+            pass                            # already (un)registered, or closed
+        if kind == "close":
+            fileobj.close()
+
+    def _run(self):
+        while True:
+            for key, _ in self._sel.select():
+                kind, slot_key = key.data
+                if kind == "wake":
+                    try:
+                        os.read(self._wake_r, 4096)
+                    except BlockingIOError:
+                        pass
+                    with self._lock:
+                        ops, self._ops = self._ops, []
+                    for op, fileobj, data, done in ops:
+                        if op == "stop":
+                            self._sel.close()
+                            done.set()
+                            return
+                        self._apply(op, fileobj, data)
+                        done.set()
+                elif kind == "listen":
+                    with self._lock:
+                        if slot_key not in self._armed or self._socks.get(slot_key) is not key.fileobj:
+                            continue
+                        self._armed.discard(slot_key)
+                        self.activations += 1
+                    self._apply("del", key.fileobj)
+                    self._call(self._on_connect, slot_key)
+                elif kind == "pipe":
+                    if key.fileobj.closed:
+                        continue                 # forgotten earlier in this batch
+                    try:
+                        data = os.read(key.fileobj.fileno(), 4096)
+                    except OSError:
+                        data = b""
+                    if data:
+                        continue                 # proxy output: not interesting
+                    self._apply("close", key.fileobj)
+                    with self._lock:
+                        pid = None
+                        if self._pipes.get(slot_key, (None,))[0] is key.fileobj:
+                            pid = self._pipes.pop(slot_key)[1]
+                    if pid is not None:
+                        self._call(self._on_exit, slot_key, pid)
+
+    def _call(self, fn, *args):
+        try:
+            fn(*args)
+        except Exception as e:
+            print(f"[{self._name}] callback failed for {args[0]}: {e}", flush=True)
+
+    # -- API --
+
+    def listen(self, key, port: int) -> int:
+        """Listen on *port* for *key* (once) and arm it; returns the socket's
+        fd for the proxy to inherit. OSError if the port can't be bound."""
+        with self._lock:
+            sock = self._socks.get(key)
+            if sock is None:
+                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                try:
+                    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+                    sock.bind(("", port))
+                    sock.listen(LISTEN_BACKLOG)
+                except OSError:
+                    sock.close()
+                    raise
+                sock.setblocking(False)
+                self._socks[key] = sock
+            if key not in self._armed:
+                self._armed.add(key)
+                self._op("add", sock, ("listen", key))
+            return sock.fileno()
+
+    def fileno(self, key) -> int | None:
+        with self._lock:
+            sock = self._socks.get(key)
+            return sock.fileno() if sock else None
+
+    def disarm(self, key):
+        """Stop watching *key*'s socket (its proxy accepts now); keep it open."""
+        with self._lock:
+            if key in self._armed:
+                self._armed.discard(key)
+                self._op("del", self._socks[key])
+
+    def close(self, key):
+        """Stop listening for *key*; connections in the backlog are refused.
+        Returns once the port is free to bind again."""
+        with self._lock:
+            self._armed.discard(key)
+            sock = self._socks.pop(key, None)
+            done = self._op("close", sock) if sock is not None else None
+        if done is not None:
+            done.wait(5)
+
+    def watch_exit(self, key, pipe, pid: int):
+        """Call on_exit(key, pid) when *pipe* (the proxy's stdout) closes."""
+        with self._lock:
+            self._pipes[key] = (pipe, pid)
+            self._op("add", pipe, ("pipe", key))
+
+    def forget(self, key):
+        """Drop the exit watch for *key* (the portal stopped the proxy itself)."""
+        with self._lock:
+            entry = self._pipes.pop(key, None)
+            if entry:
+                self._op("close", entry[0])
+
+    def snapshot(self) -> dict:
+        with self._lock:
+            return {"listening": len(self._socks), "armed": len(self._armed),
+                    "proxies": len(self._pipes), "activations": self.activations}
+
+    def stop(self):
+        with self._lock:
+            keys = list(self._socks)
+        for key in keys:
+            self.close(key)
+        with self._lock:
+            for key in list(self._pipes):
+                self._pipes.pop(key)[0].close()
+            if self._thread:
+                self._op("stop", None)
+                thread = self._thread
+            else:
+                thread = None
+        if thread:
+            thread.join(5)
+            os.close(self._wake_r)
+            os.close(self._wake_w)
+            self._thread = None
@@ -24,6 +24,8 @@ import serial
 from datetime import datetime
 from pathlib import Path
 
+import serial_tuning
+
 # RFC2217 constants
 IAC = 255   # Interpret As Command
 DONT = 254
@@ -168,6 +170,9 @@ class RFC2217Proxy:
             write_timeout=1
         )
         self.logger.log(f"Opened {self.device} at {self.baudrate} baud")
+        tuned = serial_tuning.tune(self.serial, self.device)
+        self.logger.log(f"Bridge {tuned['bridge']}: low_latency={tuned['low_latency']} "
+                        f"latency_timer={tuned['latency_timer_ms']} ms")
 
     def close_serial(self):
         """Close serial port"""
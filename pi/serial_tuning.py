@@ -0,0 +1,101 @@
+"""
+Serial tuning — keep the USB-UART bridge's buffering out of request/response
+round trips.
+
+A USB-UART bridge holds received bytes until its buffer fills or a timer
+expires, and only then hands them to the host. FTDI chips use a 16 ms
+latency_timer by default, and CP210x and CH34x have fixed timers of their
+own. esptool waits for the short response to every command, so on a
+ttyUSB slot that timer bounds the command rate, not the baud.
+
+tune() is called by whatever opens a slot's tty (the RFC2217 proxy, flash
+workers):
+  - ASYNC_LOW_LATENCY (TIOCSSERIAL) makes the tty layer hand received
+    bytes to the reader at once instead of from a work queue; ftdi_sio
+    also drops its latency timer to 1 ms when the flag is set
+  - an FTDI latency_timer in sysfs is written to LATENCY_TIMER_MS as well,
+    so the timer stays low on kernels that don't tie it to the flag
+Drivers without the ioctl (cdc_acm on native USB, CH34x) or without a
+tunable timer (CP210x) keep what they have; tune() says which applied.
+SERIAL_LOW_LATENCY=0 turns tuning off (for before/after benchmarks).
+
+describe() reads a port's bridge from sysfs without opening it, for the
+portal's /api/devices.
+"""
+
+import os
+
+SYSFS = os.environ.get("SERIAL_SYSFS", "/sys")
+ENABLED = os.environ.get("SERIAL_LOW_LATENCY", "1") != "0"
+LATENCY_TIMER_MS = 1
+
+# tty driver (sysfs driver name) -> bridge family
+DRIVERS = {"ftdi_sio": "ftdi", "cp210x": "cp210x", "ch341-uart": "ch34x",
+           "pl2303": "pl2303", "cdc_acm": "native_usb"}
+# USB vendor -> bridge family, for drivers not listed above
+VENDORS = {"0403": "ftdi", "10c4": "cp210x", "1a86": "ch34x", "067b": "pl2303",
+           "303a": "native_usb"}
+
+
+def _read(path: str) -> str | None:
+    try:
+        with open(path) as f:
+            return f.read().strip()
+    except OSError:
+        return None
+
+
+def describe(devnode: str, sysfs: str | None = None) -> dict:
+    """Bridge of a tty from sysfs: {"tty", "bridge", "driver", "usb_id",
+    "product", "usb_serial", "latency_timer_ms"}; unknowns are None."""
+    tty = os.path.basename(devnode)
+    port_dir = os.path.realpath(os.path.join(sysfs or SYSFS, "class", "tty", tty, "device"))
+    info = {"tty": tty, "bridge": None, "driver": None, "usb_id": None, "product": None,
+            "usb_serial": None, "latency_timer_ms": None}
+    if not os.path.isdir(port_dir):
+        return info
+    driver = os.path.join(port_dir, "driver")
+    if os.path.islink(driver):
+        info["driver"] = os.path.basename(os.path.realpath(driver))
+    timer = _read(os.path.join(port_dir, "latency_timer"))
+    if timer and timer.isdigit():
+        info["latency_timer_ms"] = int(timer)
+    usb_dir = port_dir
+    for _ in range(4):           # port → interface → USB device
+        if os.path.exists(os.path.join(usb_dir, "idVendor")):
+            vid = _read(os.path.join(usb_dir, "idVendor"))
+            pid = _read(os.path.join(usb_dir, "idProduct"))
+            info["usb_id"] = f"{vid}:{pid}"
+            info["product"] = _read(os.path.join(usb_dir, "product"))
+            info["usb_serial"] = _read(os.path.join(usb_dir, "serial"))
+            info["bridge"] = VENDORS.get(vid)
+            break
+        usb_dir = os.path.dirname(usb_dir)
+    info["bridge"] = DRIVERS.get(info["driver"], info["bridge"])
+    return info
+
+
+def tune(ser, devnode: str, sysfs: str | None = None) -> dict:
+    """Apply low-latency settings to an open pyserial port on *devnode*.
+    Returns describe() plus "low_latency" (flag accepted by the driver)
+    and "tuned" (False when disabled)."""
+    sysfs = sysfs or SYSFS
+    info = describe(devnode, sysfs)
+    info.update(tuned=ENABLED, low_latency=False)
+    if not ENABLED:
+        return info
+    try:
+        ser.set_low_latency_mode(True)
+        info["low_latency"] = True
+    except (AttributeError, ValueError, OSError):
+        pass                     # not a real UART (cdc_acm, pty) or not Linux
+    timer = info["latency_timer_ms"]
+    if timer is not None and timer > LATENCY_TIMER_MS:
+        path = os.path.join(sysfs, "class", "tty", info["tty"], "device", "latency_timer")
+        try:
+            with open(path, "w") as f:
+                f.write(str(LATENCY_TIMER_MS))
+        except OSError:
+            pass                 # needs root; reported as it stands
+        info["latency_timer_ms"] = describe(devnode, sysfs)["latency_timer_ms"]
+    return info
@@ -0,0 +1,243 @@
+"""
+Session hub — per-session test progress and human-interaction channels.
+
+Each test run reports under its own session ID, so CI jobs testing
+different slots in parallel no longer overwrite each other's progress or
+compete for the operator dialog. Requests without an ID use
+DEFAULT_SESSION, which keeps the single-session API working unchanged.
+
+Memory is bounded however many sessions come and go:
+  - at most MAX_SESSIONS live sessions (the least recently updated one is
+    evicted first; a session with an operator request pending never is, so
+    the count may run over while every slot waits on the operator)
+  - ended sessions linger for ENDED_KEEP_S so the UI can show the verdict
+  - sessions idle for IDLE_EXPIRE_S are dropped
+  - each session keeps its last MAX_RESULTS results plus running totals
+
+Every change bumps a version number; wait(since, timeout) blocks until the
+version moves past *since* (long-poll push for the web UI).
+"""
+
+import collections
+import itertools
+import threading
+import time
+
+DEFAULT_SESSION = "default"
+MAX_SESSIONS = 16
+MAX_RESULTS = 200
+ENDED_KEEP_S = 300
+IDLE_EXPIRE_S = 3600
+MAX_ID_LEN = 64
+
+
+class HumanRequest:
+    __slots__ = ("id", "session", "message", "created", "event", "confirmed")
+
+    def __init__(self, req_id: int, session: str, message: str):
+        self.id = req_id
+        self.session = session
+        self.message = message
+        self.created = time.time()
+        self.event = threading.Event()
+        self.confirmed = False
+
+    def info(self) -> dict:
+        return {"id": self.id, "session": self.session, "message": self.message,
+                "created": self.created}
+
+
+class Session:
+    __slots__ = ("id", "spec", "phase", "total", "results", "counts", "current",
+                 "started", "updated", "ended", "human")
+
+    def __init__(self, session_id: str, now: float):
+        self.id = session_id
+        self.spec = ""
+        self.phase = ""
+        self.total = 0
+        self.results: collections.deque = collections.deque(maxlen=MAX_RESULTS)
+        self.counts: collections.Counter = collections.Counter()
+        self.current = None
+        self.started = now
+        self.updated = now
+        self.ended = None
+        self.human: HumanRequest | None = None
+
+    def info(self) -> dict:
+        return {
+            "session": self.id,
+            "spec": self.spec,
+            "phase": self.phase,
+            "total": self.total,
+            "done": sum(self.counts.values()),
+            "counts": dict(self.counts),
+            "completed": list(self.results),
+            "current": self.current,
+            "started": self.started,
+            "updated": self.updated,
+            "ended": self.ended,
+            "human": self.human.info() if self.human else None,
+        }
+
+
+class SessionHub:
+    def __init__(self, clock=time.time):
+        self._clock = clock
+        self._cond = threading.Condition()
+        self._sessions: collections.OrderedDict[str, Session] = collections.OrderedDict()
+        self._human: dict[int, HumanRequest] = {}      # pending, by request id
+        self._req_ids = itertools.count(1)
+        self.version = 0
+
+    # -- internals (call with _cond held) --
+
+    def _changed(self):
+        self.version += 1
+        self._cond.notify_all()
+
+    def _prune(self, now: float, keep: str | None = None):
+        for sid, s in list(self._sessions.items()):
+            if s.human:
+                continue
+            if (s.ended and now - s.ended > ENDED_KEEP_S) or now - s.updated > IDLE_EXPIRE_S:
+                del self._sessions[sid]
+        while len(self._sessions) > MAX_SESSIONS:
+            victim = next((sid for sid, s in self._sessions.items()
+                           if not s.human and sid != keep), None)
+            if victim is None:
+                break
+            del self._sessions[victim]
+
+    def _get(self, session_id: str, create: bool) -> Session | None:
+        s = self._sessions.get(session_id)
+        if s is None and create:
+            now = self._clock()
+            s = self._sessions[session_id] = Session(session_id, now)
+            self._prune(now, keep=session_id)     # never evict the one just made
+        return s
+
+    def _touch(self, s: Session):
+        s.updated = self._clock()
+        self._sessions.move_to_end(s.id)
+
+    # -- test progress --
+
+    def update(self, session_id: str, body: dict) -> str | None:
+        """Apply a /api/test/update body; returns an error string or None."""
+        session_id = check_id(session_id)
+        with self._cond:
+            if body.get("end"):
+                s = self._get(session_id, create=False)
+                if s is not None and s.ended is None:
+                    s.ended = self._clock()
+                    s.current = None
+                    self._touch(s)
+                    self._changed()
+                return None
+
+            if "spec" in body:
+                old = self._sessions.pop(session_id, None)
+                s = self._get(session_id, create=True)
+                if old is not None and old.human:     # keep a pending operator request
+                    s.human = old.human
+                s.spec = str(body["spec"])
+                s.phase = str(body.get("phase", ""))
+                s.total = int(body.get("total", 0) or 0)
+            else:
+                s = self._get(session_id, create=False)
+                if s is None or s.ended:
+                    return "no active session"
+                if "phase" in body:
+                    s.phase = str(body["phase"])
+                if "total" in body:
+                    s.total = int(body["total"] or 0)
+
+            if "current" in body:
+                s.current = body["current"]
+            if "result" in body:
+                result = body["result"]
+                s.results.append(result)
+                verdict = str(result.get("result", "")).upper() if isinstance(result, dict) else ""
+                s.counts[verdict or "UNKNOWN"] += 1
+                s.current = None
+            self._touch(s)
+            self._changed()
+        return None
+
+    def progress(self, session_id: str) -> dict | None:
+        with self._cond:
+            s = self._sessions.get(session_id)
+            return s.info() if s else None
+
+    def snapshot(self) -> dict:
+        with self._cond:
+            self._prune(self._clock())
+            return {"version": self.version,
+                    "sessions": [s.info() for s in reversed(self._sessions.values())]}
+
+    def wait(self, since: int, timeout: float) -> dict:
+        """Block until the version passes *since* (or timeout); return a snapshot."""
+        deadline = time.monotonic() + max(0.0, timeout)
+        with self._cond:
+            while self.version <= since:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                self._cond.wait(remaining)
+        return self.snapshot()
+
+    # -- human interaction --
+
+    def human_open(self, session_id: str, message: str) -> HumanRequest | None:
+        """Register an operator request; None if the session already has one."""
+        session_id = check_id(session_id)
+        with self._cond:
+            s = self._get(session_id, create=True)
+            if s.human is not None:
+                return None
+            req = HumanRequest(next(self._req_ids), session_id, message)
+            s.human = req
+            self._touch(s)
+            self._human[req.id] = req
+            self._changed()
+            return req
+
+    def human_close(self, req: HumanRequest):
+        """Called by the blocked requester once it has woken up."""
+        with self._cond:
+            self._human.pop(req.id, None)
+            s = self._sessions.get(req.session)
+            if s is not None and s.human is req:
+                s.human = None
+                self._touch(s)
+            self._changed()
+
+    def human_respond(self, req_id: int | None, confirmed: bool) -> bool:
+        """Operator answer. Without an id, answers the oldest pending request."""
+        with self._cond:
+            if req_id is None:
+                pending = [r for r in self._human.values() if not r.event.is_set()]
+                req = min(pending, key=lambda r: r.id) if pending else None
+            else:
+                req = self._human.get(req_id)
+            if req is None or req.event.is_set():
+                return False
+            req.confirmed = confirmed
+            req.event.set()
+            self._changed()
+            return True
+
+    def human_pending(self) -> list:
+        with self._cond:
+            return [r.info() for r in sorted(self._human.values(), key=lambda r: r.id)
+                    if not r.event.is_set()]
+
+
+def check_id(session_id) -> str:
+    if session_id is None or session_id == "":
+        return DEFAULT_SESSION
+    if not isinstance(session_id, str) or len(session_id) > MAX_ID_LEN or \
+            not all(c.isalnum() or c in "-_.:" for c in session_id):
+        raise ValueError("session must be up to 64 characters of [A-Za-z0-9-_.:]")
+    return session_id
@@ -0,0 +1,215 @@
+"""
+Slot actors — every change to a slot runs as a command in that slot's
+mailbox, one at a time, on a fixed pool of worker threads.
+
+Hotplug events, proxy start/stop, serial reset and monitor hand-over,
+flash hand-over, flap recovery and GPIO release all change the same slot
+record. Giving each its own thread (one per hotplug event, one per
+recovery) made the thread count follow the event rate, and lock coverage
+was partial. Here a slot is owned by whichever worker is running its
+current command, so commands never overlap on a slot, run in the order
+they were sent, and need no locks of their own:
+
+  - tell(key, fn, *args) queues fn(*args) and returns a Future
+  - ask(key, fn, *args) waits for the result (inline when already on
+    that slot's actor, so a command may call helpers that ask)
+  - tag= coalesces: while a command with the same tag is still queued for
+    the slot, another one is dropped and the queued one's Future returned
+  - after(delay, key, fn, *args) queues fn later, from one timer thread,
+    instead of sleeping on a worker (recovery cooldowns, boot delays)
+
+A slot with queued commands waits in a ready queue for a free worker and
+goes to the back after each command, so a busy slot can't starve the
+others. The after= hook runs on the worker once each command is done,
+still owning the slot — the portal publishes the slot's snapshot there.
+Workers start on first use.
+"""
+
+import collections
+import heapq
+import itertools
+import threading
+import time
+from concurrent.futures import Future
+
+DEFAULT_WORKERS = 4
+
+
+class _Mailbox:
+    __slots__ = ("key", "queue", "tags", "running", "processed", "max_depth")
+
+    def __init__(self, key):
+        self.key = key
+        self.queue: collections.deque = collections.deque()
+        self.tags: dict[str, Future] = {}
+        self.running = False
+        self.processed = 0
+        self.max_depth = 0
+
+
+class SlotActors:
+    def __init__(self, workers: int = DEFAULT_WORKERS, after=None, name: str = "slot"):
+        self.workers = max(1, int(workers))
+        self._after = after
+        self._name = name
+        self._cond = threading.Condition()
+        self._boxes: dict = {}
+        self._ready: collections.deque = collections.deque()
+        self._threads: list[threading.Thread] = []
+        self._timers: list = []             # heap of (due, n, key, fn, args, tag)
+        self._timer_ids = itertools.count()
+        self._timer_thread: threading.Thread | None = None
+        self._stopping = False
+        self._local = threading.local()
+        self.processed = 0
+        self.coalesced = 0
+        self.errors = 0
+
+    # -- internals (call with _cond held) --
+
+    def _box(self, key) -> _Mailbox:
+        box = self._boxes.get(key)
+        if box is None:
+            box = self._boxes[key] = _Mailbox(key)
+        return box
+
+    def _ensure_started(self):
+        if self._threads or self._stopping:
+            return
+        for i in range(self.workers):
+            t = threading.Thread(target=self._run, daemon=True, name=f"{self._name}-{i}")
+            t.start()
+            self._threads.append(t)
+        self._timer_thread = threading.Thread(target=self._run_timers, daemon=True,
+                                              name=f"{self._name}-timer")
+        self._timer_thread.start()
+
+    def _enqueue(self, key, fn, args, tag) -> Future:
+        box = self._box(key)
+        if tag is not None and tag in box.tags:
+            self.coalesced += 1
+            return box.tags[tag]
+        fut = Future()
+        box.queue.append((fn, args, fut, tag))
+        box.max_depth = max(box.max_depth, len(box.queue))
+        if tag is not None:
+            box.tags[tag] = fut
+        if not box.running and len(box.queue) == 1:
+            self._ready.append(box)
+            self._cond.notify_all()
+        self._ensure_started()
+        return fut
+
+    # -- API --
+
+    def tell(self, key, fn, *args, tag: str | None = None) -> Future:
+        """Queue fn(*args) on *key*'s actor."""
+        with self._cond:
+            if self._stopping:
+                raise RuntimeError("slot actors stopped")
+            return self._enqueue(key, fn, args, tag)
+
+    def ask(self, key, fn, *args, timeout: float | None = None, tag: str | None = None):
+        """Run fn(*args) on *key*'s actor and return its result (or raise
+        its exception). TimeoutError if it hasn't finished in *timeout*."""
+        if self.current() == key:
+            return fn(*args)
+        return self.tell(key, fn, *args, tag=tag).result(timeout)
+
+    def after(self, delay: float, key, fn, *args, tag: str | None = None):
+        """tell() after *delay* seconds."""
+        with self._cond:
+            if self._stopping:
+                return
+            heapq.heappush(self._timers, (time.monotonic() + max(0.0, delay),
+                                          next(self._timer_ids), key, fn, args, tag))
+            self._ensure_started()
+            self._cond.notify_all()
+
+    def current(self):
+        """Key of the slot whose command is running on this thread, else None."""
+        return getattr(self._local, "key", None)
+
+    def stop(self, timeout: float = 5.0):
+        """Finish the running commands, drop queued ones and timers."""
+        with self._cond:
+            self._stopping = True
+            for box in self._boxes.values():
+                for _, _, fut, _ in box.queue:
+                    fut.cancel()
+                box.queue.clear()
+                box.tags.clear()
+            self._ready.clear()
+            self._timers.clear()
+            self._cond.notify_all()
+            threads = self._threads + ([self._timer_thread] if self._timer_thread else [])
+        for t in threads:
+            t.join(timeout)
+        with self._cond:
+            self._threads = []
+            self._timer_thread = None
+            self._stopping = False
+
+    def snapshot(self) -> dict:
+        with self._cond:
+            return {
+                "workers": self.workers,
+                "threads": sum(t.is_alive() for t in self._threads),
+                "slots": len(self._boxes),
+                "running": sum(b.running for b in self._boxes.values()),
+                "queued": sum(len(b.queue) for b in self._boxes.values()),
+                "timers": len(self._timers),
+                "max_depth": max((b.max_depth for b in self._boxes.values()), default=0),
+                "processed": self.processed, "coalesced": self.coalesced,
+                "errors": self.errors,
+            }
+
+    # -- threads --
+
+    def _run(self):
+        while True:
+            with self._cond:
+                while not self._ready and not self._stopping:
+                    self._cond.wait()
+                if self._stopping:
+                    return
+                box = self._ready.popleft()
+                fn, args, fut, tag = box.queue.popleft()
+                if tag is not None:
+                    box.tags.pop(tag, None)
+                box.running = True
+            self._local.key = box.key
+            try:
+                if fut.set_running_or_notify_cancel():
+                    try:
+                        fut.set_result(fn(*args))
+                    except BaseException as e:
+                        self.errors += 1
+                        fut.set_exception(e)
+                if self._after:
+                    try:
+                        self._after(box.key)
+                    except Exception as e:
+                        print(f"[{self._name}] after-hook failed for {box.key}: {e}", flush=True)
+            finally:
+                self._local.key = None
+                with self._cond:
+                    box.running = False
+                    box.processed += 1
+                    self.processed += 1
+                    if box.queue and not self._stopping:
+                        self._ready.append(box)        # back of the line
+                        self._cond.notify_all()
+
+    def _run_timers(self):
+        with self._cond:
+            while not self._stopping:
+                if not self._timers:
+                    self._cond.wait()
+                    continue
+                wait = self._timers[0][0] - time.monotonic()
+                if wait > 0:
+                    self._cond.wait(wait)
+                    continue
+                _, _, key, fn, args, tag = heapq.heappop(self._timers)
+                self._enqueue(key, fn, args, tag)
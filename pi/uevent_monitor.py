@@ -0,0 +1,294 @@
+"""
+uevent monitor — USB serial hotplug events straight from netlink.
+
+Subscribes to NETLINK_KOBJECT_UEVENT and turns tty add/remove events into
+hotplug calls, replacing the udev rule -> systemd-run -> shell -> curl ->
+POST /api/hotplug chain (one fork and one HTTP round trip per event).
+
+By default the socket joins the udev multicast group, so events arrive
+after udevd has processed them and carry ID_PATH (the slot key). With
+UEVENT_GROUP=kernel it listens to raw kernel events instead; those lack
+ID_PATH and slots are keyed by DEVPATH.
+
+Events are handled one at a time, in arrival order, by HotplugDispatcher.
+A monitor can record the raw datagrams to a JSONL trace, and replay()
+feeds such a trace back through the same parser (offline tests and flap
+threshold tuning).
+
+Usage:
+    python3 uevent_monitor.py [--kernel] [--record trace.jsonl]   # print events
+"""
+
+import base64
+import errno
+import json
+import os
+import queue
+import socket
+import struct
+import threading
+import time
+
+NETLINK_KOBJECT_UEVENT = 15
+GROUP_KERNEL = 1
+GROUP_UDEV = 2
+
+UDEV_PREFIX = b"libudev\0"
+UDEV_MAGIC = 0xFEEDCAFE
+_UDEV_HDR = struct.Struct("=8sIIII")     # prefix, magic (BE), header_size, props_off, props_len
+
+DEFAULT_SUBSYSTEMS = ("tty", "usb")
+HOTPLUG_KERNELS = ("ttyACM", "ttyUSB")
+RCVBUF_BYTES = 4 * 1024 * 1024           # absorb storms while the dispatcher is busy
+SO_RCVBUFFORCE = getattr(socket, "SO_RCVBUFFORCE", 33)
+SO_PASSCRED = getattr(socket, "SO_PASSCRED", 16)
+SCM_CREDENTIALS = getattr(socket, "SCM_CREDENTIALS", 2)
+_UCRED = struct.Struct("=iII")           # pid, uid, gid
+
+
+# ---------------------------------------------------------------------------
+# Parsing
+# ---------------------------------------------------------------------------
+
+def _split_props(blob: bytes) -> dict:
+    props = {}
+    for field in blob.split(b"\0"):
+        key, sep, value = field.partition(b"=")
+        if sep:
+            props[key.decode(errors="replace")] = value.decode(errors="replace")
+    return props
+
+
+def parse_uevent(data: bytes) -> dict | None:
+    """Parse one netlink datagram (udev or kernel format) into a property dict."""
+    if data.startswith(UDEV_PREFIX):
+        if len(data) < _UDEV_HDR.size:
+            return None
+        _, magic, _hdr_size, off, length = _UDEV_HDR.unpack_from(data)
+        if socket.ntohl(magic) != UDEV_MAGIC or off + length > len(data):
+            return None
+        return _split_props(data[off:off + length])
+
+    # Kernel format: "action@devpath\0KEY=VALUE\0..."
+    head, sep, rest = data.partition(b"\0")
+    if not sep or b"@" not in head:
+        return None
+    return _split_props(rest)
+
+
+def encode_udev(props: dict) -> bytes:
+    """Build a udev-format datagram (for traces and tests)."""
+    blob = b"".join(f"{k}={v}".encode() + b"\0" for k, v in props.items())
+    hdr_size = _UDEV_HDR.size + 16       # + filter hashes, as libudev sends
+    header = _UDEV_HDR.pack(UDEV_PREFIX, socket.htonl(UDEV_MAGIC), hdr_size, hdr_size, len(blob))
+    return header + b"\0" * 16 + blob
+
+
+def encode_kernel(props: dict) -> bytes:
+    """Build a kernel-format datagram (for traces and tests)."""
+    head = f"{props.get('ACTION', '')}@{props.get('DEVPATH', '')}".encode()
+    return head + b"\0" + b"".join(f"{k}={v}".encode() + b"\0" for k, v in props.items())
+
+
+def sender_trusted(ancdata, addr) -> bool:
+    """libudev's sender check for one datagram: any local process may
+    send to a uevent group, so only accept multicast from root, and on
+    the kernel group only from the kernel itself (port id 0)."""
+    pid, groups = addr
+    if groups == 0 or (groups == GROUP_KERNEL and pid != 0):
+        return False
+    for level, kind, data in ancdata:
+        if level == socket.SOL_SOCKET and kind == SCM_CREDENTIALS and len(data) >= _UCRED.size:
+            return _UCRED.unpack_from(data)[1] == 0
+    return False                         # no credentials: can't tell
+
+
+def hotplug_args(props: dict) -> tuple | None:
+    """Map a uevent to (action, devnode, id_path, devpath) for the hotplug
+    handler, or None if it is not a USB serial add/remove."""
+    if props.get("SUBSYSTEM") != "tty":
+        return None
+    action = props.get("ACTION")
+    if action not in ("add", "remove"):
+        return None
+    devname = props.get("DEVNAME", "")
+    kernel = os.path.basename(devname)
+    if not kernel.startswith(HOTPLUG_KERNELS):
+        return None
+    devnode = devname if devname.startswith("/") else "/dev/" + devname
+    return action, devnode, props.get("ID_PATH", ""), props.get("DEVPATH", "")
+
+
+# ---------------------------------------------------------------------------
+# Dispatcher
+# ---------------------------------------------------------------------------
+
+class HotplugDispatcher:
+    """Runs handler(action, devnode, id_path, devpath) for each event on one
+    thread, strictly in submission order."""
+
+    def __init__(self, handler):
+        self._handler = handler
+        self._queue: queue.Queue = queue.Queue()
+        self._thread: threading.Thread | None = None
+        self.processed = 0
+        self.errors = 0
+
+    def start(self):
+        self._thread = threading.Thread(target=self._run, daemon=True, name="hotplug")
+        self._thread.start()
+
+    def stop(self):
+        if self._thread:
+            self._queue.put(None)
+            self._thread.join(timeout=5)
+            self._thread = None
+
+    def submit(self, args: tuple, wait: bool = False, timeout: float = 10.0):
+        """Queue one event. With wait=True, block for and return its result."""
+        done = threading.Event() if wait else None
+        slot = {"done": done, "result": None}
+        self._queue.put((args, slot))
+        if done is None:
+            return None
+        if not done.wait(timeout):
+            raise TimeoutError("hotplug dispatcher busy")
+        return slot["result"]
+
+    def _run(self):
+        while True:
+            item = self._queue.get()
+            if item is None:
+                return
+            args, slot = item
+            try:
+                slot["result"] = self._handler(*args)
+            except Exception as e:
+                self.errors += 1
+                print(f"[uevent] handler failed for {args}: {e}", flush=True)
+            self.processed += 1
+            if slot["done"]:
+                slot["done"].set()
+
+
+# ---------------------------------------------------------------------------
+# Netlink monitor
+# ---------------------------------------------------------------------------
+
+class UeventMonitor:
+    """Reads uevents from netlink and passes matching ones to callback(props)."""
+
+    def __init__(self, callback, subsystems=DEFAULT_SUBSYSTEMS, group=GROUP_UDEV,
+                 record_path: str | None = None):
+        self._callback = callback
+        self._subsystems = set(subsystems)
+        self._group = group
+        self._record_path = record_path
+        self._sock: socket.socket | None = None
+        self._thread: threading.Thread | None = None
+        self._shutdown = threading.Event()
+        self.received = 0
+        self.overruns = 0
+        self.rejected = 0
+
+    def start(self):
+        sock = socket.socket(socket.AF_NETLINK, socket.SOCK_DGRAM | socket.SOCK_CLOEXEC,
+                             NETLINK_KOBJECT_UEVENT)
+        try:
+            # SO_RCVBUFFORCE (root) ignores rmem_max; fall back to the capped one
+            sock.setsockopt(socket.SOL_SOCKET, SO_RCVBUFFORCE, RCVBUF_BYTES)
+        except OSError:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, RCVBUF_BYTES)
+        sock.setsockopt(socket.SOL_SOCKET, SO_PASSCRED, 1)
+        sock.bind((0, self._group))          # port id 0: assigned by the kernel
+        sock.settimeout(1.0)
+        self._sock = sock
+        self._shutdown.clear()
+        self._thread = threading.Thread(target=self._run, daemon=True, name="uevent")
+        self._thread.start()
+        src = "udev" if self._group == GROUP_UDEV else "kernel"
+        print(f"[uevent] listening to {src} uevents ({', '.join(sorted(self._subsystems))})",
+              flush=True)
+
+    def stop(self):
+        self._shutdown.set()
+        if self._thread:
+            self._thread.join(timeout=3)
+            self._thread = None
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+
+    def _run(self):
+        record = open(self._record_path, "a") if self._record_path else None
+        try:
+            while not self._shutdown.is_set():
+                try:
+                    data, ancdata, _flags, addr = self._sock.recvmsg(
+                        65536, socket.CMSG_SPACE(_UCRED.size))
+                except socket.timeout:
+                    continue
+                except OSError as e:
+                    if e.errno == errno.ENOBUFS:    # kernel dropped events
+                        self.overruns += 1
+                        print("[uevent] receive buffer overrun, events lost", flush=True)
+                        continue
+                    break
+                if not sender_trusted(ancdata, addr):
+                    self.rejected += 1
+                    continue
+                if record:
+                    record.write(json.dumps({"t": time.time(),
+                                             "raw": base64.b64encode(data).decode()}) + "\n")
+                    record.flush()
+                self._deliver(data)
+        finally:
+            if record:
+                record.close()
+
+    def _deliver(self, data: bytes):
+        props = parse_uevent(data)
+        if props is None or props.get("SUBSYSTEM") not in self._subsystems:
+            return
+        self.received += 1
+        self._callback(props)
+
+
+# ---------------------------------------------------------------------------
+# Replay
+# ---------------------------------------------------------------------------
+
+def replay(path: str, subsystems=DEFAULT_SUBSYSTEMS):
+    """Yield (timestamp, props) for each matching uevent in a recorded trace."""
+    wanted = set(subsystems)
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            rec = json.loads(line)
+            props = parse_uevent(base64.b64decode(rec["raw"]))
+            if props is not None and props.get("SUBSYSTEM") in wanted:
+                yield rec["t"], props
+
+
+def _main(argv):
+    group = GROUP_KERNEL if "--kernel" in argv else GROUP_UDEV
+    record = argv[argv.index("--record") + 1] if "--record" in argv else None
+
+    def show(props):
+        print(props.get("ACTION"), props.get("SUBSYSTEM"), props.get("DEVNAME", ""),
+              props.get("ID_PATH", ""), props.get("DEVPATH", ""), flush=True)
+
+    mon = UeventMonitor(show, group=group, record_path=record)
+    mon.start()
+    try:
+        while True:
+            time.sleep(1)
+    except KeyboardInterrupt:
+        mon.stop()
+
+
+if __name__ == "__main__":
+    import sys
+    _main(sys.argv[1:])
@@ -0,0 +1,220 @@
+"""
+USB bus scheduler — keep flash, reset and OTA traffic within what a shared
+USB bus can carry.
+
+On a Raspberry Pi 3 every hub port and the Ethernet NIC hang off a single
+USB 2.0 host controller (slot keys "platform-3f980000.usb-usb-..."). The
+USB-UART bridges are full-speed devices served through the hub's
+transaction translator, and the bus saturates long before 480 Mbit/s:
+with several flashes, fast serial monitors and an OTA download running at
+once, transfers stall and esptool or the DUT's HTTP client times out.
+
+Each operation declares its demand in kB/s on the bus it uses:
+  - flash:   the flashing baud / 10 (8N1), on the slot's bus
+  - reset:   the 115200 baud boot-log read, on the slot's bus
+  - monitor: the monitor baud — counted, but never queued
+  - ota:     a fixed estimate, on the bus of the Ethernet NIC (if it is USB)
+
+acquire() admits an operation while the bus's admitted demand plus its own
+stays within the budget; otherwise it waits, in arrival order per bus, so
+a flash can't be starved by a stream of short resets. An operation alone
+on its bus is always admitted, even above budget. snapshot() reports
+demand, utilisation, active and queued operations per bus.
+"""
+
+import collections
+import contextlib
+import itertools
+import os
+import re
+import threading
+import time
+
+DEFAULT_BUDGET_KBPS = 500    # about five 921600-baud flashes
+MAX_RECENT = 32              # finished operations kept per bus for snapshot()
+
+_USB_ROOT = re.compile(r"usb\d+")
+_PCI_ADDR = re.compile(r"[0-9a-f]{4}:[0-9a-f]{2}:[0-9a-f]{2}\.[0-9a-f]")
+
+
+class BusBusy(Exception):
+    pass
+
+
+def baud_kbps(baud: int) -> float:
+    """Wire demand of a UART stream: 10 bits per byte (8N1)."""
+    return baud / 10 / 1000
+
+
+def bus_of(slot_key: str) -> str:
+    """Host controller a slot's device sits behind, e.g.
+    'platform-3f980000.usb-usb-0:1.1.2:1.0' → 'platform-3f980000.usb'.
+    Sysfs device paths ('/devices/platform/soc/3f980000.usb/usb1/1-1/...',
+    slot keys of devices without ID_PATH) map to the same name."""
+    idx = slot_key.rfind("-usb-")
+    if idx > 0:
+        return slot_key[:idx]
+    parts = slot_key.split("/")
+    for i, part in enumerate(parts[1:], 1):
+        if _USB_ROOT.fullmatch(part):
+            parent = parts[i - 1]
+            return f"{'pci' if _PCI_ADDR.fullmatch(parent) else 'platform'}-{parent}"
+    return slot_key or "unknown"
+
+
+def net_bus(iface: str = "eth0", sysfs: str = "/sys/class/net") -> str | None:
+    """Bus of a network interface if its NIC is a USB device (the Pi 3's
+    LAN9514), else None."""
+    try:
+        path = os.path.realpath(os.path.join(sysfs, iface, "device"))
+    except OSError:
+        return None
+    if not any(_USB_ROOT.fullmatch(p) for p in path.split("/")):
+        return None
+    return bus_of(path[path.find("/devices/"):] if "/devices/" in path else path)
+
+
+class Op:
+    __slots__ = ("id", "bus", "kind", "label", "kbps", "queued", "admitted", "ended")
+
+    def __init__(self, op_id: int, bus: str, kind: str, label: str, kbps: float, now: float):
+        self.id = op_id
+        self.bus = bus
+        self.kind = kind
+        self.label = label
+        self.kbps = kbps
+        self.queued = now
+        self.admitted = None
+        self.ended = None
+
+    def info(self, now: float) -> dict:
+        info = {"id": self.id, "kind": self.kind, "label": self.label,
+                "kbps": round(self.kbps, 1)}
+        if self.admitted is None:
+            info["waiting_s"] = round(now - self.queued, 2)
+        else:
+            info["waited_s"] = round(self.admitted - self.queued, 2)
+            info["running_s"] = round((self.ended or now) - self.admitted, 2)
+        return info
+
+
+class _Bus:
+    def __init__(self, name: str):
+        self.name = name
+        self.active: dict[int, Op] = {}
+        self.queue: collections.deque[Op] = collections.deque()
+        self.recent: collections.deque[Op] = collections.deque(maxlen=MAX_RECENT)
+        self.admitted = 0
+        self.waited = 0              # admitted only after queueing
+        self.timed_out = 0
+        self.wait_s = 0.0
+        self.peak_kbps = 0.0
+
+    @property
+    def used(self) -> float:
+        return sum(op.kbps for op in self.active.values())
+
+
+class BusScheduler:
+    def __init__(self, budget_kbps: float = DEFAULT_BUDGET_KBPS, clock=time.monotonic):
+        self.budget = budget_kbps
+        self._clock = clock
+        self._cond = threading.Condition()
+        self._buses: dict[str, _Bus] = {}
+        self._ids = itertools.count(1)
+
+    # -- internals (call with _cond held) --
+
+    def _bus(self, name: str) -> _Bus:
+        bus = self._buses.get(name)
+        if bus is None:
+            bus = self._buses[name] = _Bus(name)
+        return bus
+
+    def _fits(self, bus: _Bus, op: Op) -> bool:
+        return not bus.active or bus.used + op.kbps <= self.budget
+
+    def _admit(self, bus: _Bus, op: Op):
+        op.admitted = self._clock()
+        bus.active[op.id] = op
+        bus.admitted += 1
+        bus.peak_kbps = max(bus.peak_kbps, bus.used)
+
+    # -- API --
+
+    def acquire(self, bus: str, kind: str, label: str, kbps: float,
+                timeout: float | None = None) -> Op | None:
+        """Wait until *kbps* more fits on *bus* and no earlier waiter is
+        still queued there. Returns the admitted Op, or None on timeout."""
+        deadline = None if timeout is None else self._clock() + max(0.0, timeout)
+        with self._cond:
+            b = self._bus(bus)
+            op = Op(next(self._ids), bus, kind, label, kbps, self._clock())
+            b.queue.append(op)
+            waited = False
+            while not (b.queue[0] is op and self._fits(b, op)):
+                remaining = None if deadline is None else deadline - self._clock()
+                if remaining is not None and remaining <= 0:
+                    b.queue.remove(op)
+                    b.timed_out += 1
+                    self._cond.notify_all()      # the next waiter may be at the head now
+                    return None
+                self._cond.wait(remaining)
+                waited = True
+            b.queue.popleft()
+            self._admit(b, op)
+            if waited:
+                b.waited += 1
+                b.wait_s += op.admitted - op.queued
+            self._cond.notify_all()              # so may the one behind us
+            return op
+
+    def charge(self, bus: str, kind: str, label: str, kbps: float) -> Op:
+        """Count an operation that must not wait (a live serial monitor)."""
+        with self._cond:
+            b = self._bus(bus)
+            op = Op(next(self._ids), bus, kind, label, kbps, self._clock())
+            self._admit(b, op)
+            return op
+
+    def release(self, op: Op):
+        with self._cond:
+            b = self._bus(op.bus)
+            if b.active.pop(op.id, None) is not None:
+                op.ended = self._clock()
+                b.recent.append(op)
+                self._cond.notify_all()
+
+    @contextlib.contextmanager
+    def hold(self, bus: str, kind: str, label: str, kbps: float,
+             timeout: float | None = None):
+        """acquire() for a with-block; raises BusBusy on timeout."""
+        op = self.acquire(bus, kind, label, kbps, timeout)
+        if op is None:
+            raise BusBusy(f"USB bus {bus} busy ({self.used(bus):.0f}/{self.budget:.0f} kB/s)")
+        try:
+            yield op
+        finally:
+            self.release(op)
+
+    def used(self, bus: str) -> float:
+        with self._cond:
+            b = self._buses.get(bus)
+            return b.used if b else 0.0
+
+    def snapshot(self) -> dict:
+        now = self._clock()
+        with self._cond:
+            buses = []
+            for b in self._buses.values():
+                used = b.used
+                buses.append({
+                    "bus": b.name, "used_kbps": round(used, 1),
+                    "utilisation": round(100 * used / self.budget, 1) if self.budget else 0.0,
+                    "peak_kbps": round(b.peak_kbps, 1),
+                    "active": [op.info(now) for op in b.active.values()],
+                    "queued": [op.info(now) for op in b.queue],
+                    "recent": [op.info(now) for op in reversed(b.recent)],
+                    "admitted": b.admitted, "waited": b.waited, "timed_out": b.timed_out,
+                    "wait_s": round(b.wait_s, 2)})
+            return {"budget_kbps": self.budget, "buses": buses}
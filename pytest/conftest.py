@@ -2,15 +2,30 @@
 
 Usage:
     pytest test_instrument.py --wt-url http://<pi-ip>:8080
+    pytest --wt-url http://<pi-ip>:8080 --wt-workers auto   # one worker per slot
 """
 
+import http.server
+import json
 import os
+import sys
+import threading
 import uuid
 
 import pytest
 
 from wifi_tester_driver import WiFiTesterDriver
 
+pytest_plugins = ["wt_parallel"]
+
+PI_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "pi")
+
+LEASE_WAIT_S = 600   # how long a worker waits for a slot or the radio
+LATENCY_TOP = 10     # endpoints listed in the API latency summary
+
+# endpoint -> [calls, total_s, max_s, nodeid of the slowest call]
+_api_latency: dict[str, list] = {}
+
 
 def pytest_addoption(parser):
     parser.addoption(
@@ -24,6 +39,11 @@ def pytest_addoption(parser):
         default=False,
         help="Run tests that require a DUT connected",
     )
+    parser.addoption(
+        "--wt-slot",
+        default=os.environ.get("WT_SLOT", "any"),
+        help="Slot label to lease for DUT tests ('any' = first free slot)",
+    )
 
 
 def pytest_configure(config):
@@ -31,6 +51,37 @@ def pytest_configure(config):
         "markers",
         "requires_dut: test needs a DUT or second WiFi device connected",
     )
+    config.addinivalue_line(
+        "markers",
+        "radio: test drives the Pi radio; holds the radio lease while it runs",
+    )
+
+
+def pytest_runtest_logreport(report):
+    """Collect per-test API timings (also from parallel workers' reports)."""
+    if report.when != "teardown":
+        return
+    for name, value in report.user_properties:
+        if name != "wt_latency":
+            continue
+        for endpoint, (n, total, worst) in value.items():
+            agg = _api_latency.setdefault(endpoint, [0, 0.0, 0.0, ""])
+            agg[0] += n
+            agg[1] += total
+            if worst > agg[2]:
+                agg[2], agg[3] = worst, report.nodeid
+
+
+def pytest_terminal_summary(terminalreporter):
+    if not _api_latency:
+        return
+    tr = terminalreporter
+    tr.section("portal API latency")
+    tr.write_line(f"{'endpoint':<32} {'calls':>6} {'total s':>8} {'mean ms':>8} {'max ms':>8}  slowest in")
+    ranked = sorted(_api_latency.items(), key=lambda kv: kv[1][1], reverse=True)
+    for endpoint, (n, total, worst, nodeid) in ranked[:LATENCY_TOP]:
+        tr.write_line(f"{endpoint:<32} {n:>6} {total:>8.2f} {total / n * 1000:>8.1f} "
+                      f"{worst * 1000:>8.1f}  {nodeid}")
 
 
 def pytest_collection_modifyitems(config, items):
@@ -46,7 +97,8 @@ def pytest_collection_modifyitems(config, items):
 def wifi_tester(request):
     """Session-scoped connection to the WiFi Tester instrument."""
     url = request.config.getoption("--wt-url")
-    driver = WiFiTesterDriver(url)
+    # WT_SESSION keeps parallel runs (one per slot) apart on the Pi UI
+    driver = WiFiTesterDriver(url, session=os.environ.get("WT_SESSION"))
     driver.open()
     driver.ping()
     yield driver
@@ -57,8 +109,55 @@ def wifi_tester(request):
     driver.close()
 
 
+@pytest.fixture(autouse=True)
+def _wt_latency(request):
+    """Attach this test's portal API timings to its report.
+
+    Long-polls and other deliberate server-side waits are left out.
+    """
+    if "wifi_tester" not in request.fixturenames:
+        yield
+        return
+    driver = request.getfixturevalue("wifi_tester")
+    driver.take_calls()
+    yield
+    per: dict[str, list] = {}
+    for endpoint, secs, wait in driver.take_calls():
+        if wait:
+            continue
+        n, total, worst = per.get(endpoint, (0, 0.0, 0.0))
+        per[endpoint] = [n + 1, total + secs, max(worst, secs)]
+    if per:
+        request.node.user_properties.append(("wt_latency", per))
+
+
+@pytest.fixture(scope="session")
+def wt_slot(wifi_tester, request):
+    """Slot leased by this run (or parallel worker) for its whole session.
+
+    Also becomes wifi_tester's default slot for serial calls.
+    """
+    lease = wifi_tester.lease_acquire(slot=request.config.getoption("--wt-slot"),
+                                      timeout=LEASE_WAIT_S)
+    yield lease["slot"]
+    wifi_tester.lease_release(lease["token"])
+
+
+@pytest.fixture
+def wt_radio(wifi_tester):
+    """Radio lease for one test; other workers' radio tests wait for it."""
+    with wifi_tester.radio(timeout=LEASE_WAIT_S) as lease:
+        yield lease
+
+
+@pytest.fixture(autouse=True)
+def _radio_marker(request):
+    if request.node.get_closest_marker("radio"):
+        request.getfixturevalue("wt_radio")
+
+
 @pytest.fixture
-def wifi_network(wifi_tester):
+def wifi_network(wifi_tester, wt_radio):
     """Start a fresh AP for this test, stop on teardown."""
     ssid = f"WT-{uuid.uuid4().hex[:6].upper()}"
     password = "testpass123"
@@ -66,3 +165,92 @@ def wifi_network(wifi_tester):
     wifi_tester.ap_start(ssid, password)
     yield {"ssid": ssid, "password": password, "ap_ip": "192.168.4.1"}
     wifi_tester.ap_stop()
+
+
+class FakeClock:
+    """Manual time for offline tests: move it with clock.t += seconds.
+    With step, every reading also advances it (orders events cheaply)."""
+
+    def __init__(self, t: float = 1000.0, step: float = 0.0):
+        self.t = t
+        self.step = step
+
+    def __call__(self):
+        self.t += self.step
+        return self.t
+
+
+@pytest.fixture
+def clock():
+    return FakeClock()
+
+
+@pytest.fixture
+def ticking_clock():
+    return FakeClock(step=1)
+
+
+@pytest.fixture(scope="module")
+def sim():
+    """Bench simulator (pi/bench_sim.py) running the real portal with two
+    plugged-in slots; one per test module."""
+    pytest.importorskip("serial")
+    if PI_DIR not in sys.path:
+        sys.path.insert(0, PI_DIR)
+    from bench_sim import BenchSim
+    with BenchSim(slots=2, tick_s=0.3) as bench:
+        bench.plug_all()
+        yield bench
+
+
+@pytest.fixture
+def wt(sim):
+    """Driver for the simulator's portal, defaulting to SLOT1."""
+    d = WiFiTesterDriver(sim.url, slot="SLOT1")
+    yield d
+    d.close()
+
+
+@pytest.fixture
+def inproc_portal(tmp_path, monkeypatch):
+    """Factory for offline tests: serve the portal's HTTP handler in-process.
+
+    inproc_portal(slots=(1, 2), present=True) configures SLOT1, SLOT2, ...
+    (tcp_port 4001, ...) with fresh leases and no hardware behind them, and
+    returns (portal module, base URL). Serial monitor and WiFi scan are
+    stubbed; patch them again for other replies.
+    """
+    if PI_DIR not in sys.path:
+        sys.path.insert(0, PI_DIR)
+    import portal
+    from lease_manager import LeaseManager
+    servers = []
+
+    def start(slots=(1,), present=True):
+        cfg = tmp_path / "slots.json"
+        cfg.write_text(json.dumps({"slots": [
+            {"label": f"SLOT{i}", "slot_key": f"platform-usb-0:1.{i}:1.0", "tcp_port": 4000 + i}
+            for i in slots]}))
+        monkeypatch.setattr(portal, "slots", portal.load_config(str(cfg)))
+        monkeypatch.setattr(portal, "_slot_views", {})
+        for slot in portal.slots.values():
+            slot["present"] = present
+            portal._publish(slot)
+        monkeypatch.setattr(portal, "_leases", LeaseManager(
+            lambda: [s["label"] for s in portal.slots.values() if s["present"]]))
+        monkeypatch.setattr(portal, "log_activity", lambda *a, **k: None)
+        monkeypatch.setattr(portal, "_refresh_host_ip", lambda: None)
+        monkeypatch.setattr(portal.Handler, "log_message", lambda *a: None)
+        monkeypatch.setattr(portal.wifi_controller, "scan", lambda: {"networks": []})
+        monkeypatch.setattr(portal, "serial_monitor",
+                            lambda slot, pattern, timeout: {"ok": True, "matched": False,
+                                                            "output": []})
+        httpd = http.server.ThreadingHTTPServer(("127.0.0.1", 0), portal.Handler)
+        threading.Thread(target=httpd.serve_forever, daemon=True).start()
+        servers.append(httpd)
+        return portal, f"http://127.0.0.1:{httpd.server_address[1]}"
+
+    yield start
+    for httpd in servers:
+        httpd.shutdown()
+        httpd.server_close()
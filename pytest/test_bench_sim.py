@@ -0,0 +1,151 @@
+"""Offline tests for the bench simulator (pi/bench_sim.py): the unmodified
+portal driving simulated DUTs, WiFi tools, BLE and UDP logs.
+
+Usage:
+    pytest test_bench_sim.py
+"""
+
+import os
+import sys
+import time
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "pi"))
+
+pytest.importorskip("serial")
+
+import bench_sim  # noqa: E402
+from bench_sim import BenchSim  # noqa: E402
+
+from wifi_tester_driver import CommandError  # noqa: E402
+
+
+def _wait(cond, timeout=5.0):
+    deadline = time.monotonic() + timeout
+    while not cond():
+        assert time.monotonic() < deadline, "condition not met in time"
+        time.sleep(0.05)
+
+
+def test_serial_monitor_through_proxy(wt):
+    got = wt.serial_monitor(pattern="heartbeat", timeout=5)
+    assert got["matched"] and "app_main: heartbeat" in got["line"]
+
+
+def test_serial_reset_reboots_dut(sim, wt):
+    dev = sim.devices["SLOT2"]
+    got = wt.serial_reset(slot="SLOT2")
+    assert any(line.startswith("rst:0x15 (USB_UART_CHIP_RESET)") for line in got["output"])
+    assert any("Workbench Test Firmware" in line for line in got["output"])
+    assert dev.resets[-1] == "usb" and dev.mode == "app"
+    sim.wait_ready("SLOT2")
+
+
+def test_gpio_boot_and_en_select_download_mode(sim, wt):
+    dev = sim.devices["SLOT1"]
+    wt.gpio_sequence([{"set": {"boot": 0}}, {"pulse": "en", "level": 0, "us": 2000}],
+                     slot="SLOT1")
+    _wait(lambda: dev.mode == "download")
+    assert dev.resets[-1] == "en"
+    wt.gpio_sequence([{"set": {"boot": "z"}}, {"pulse": "en", "level": 0, "us": 2000}],
+                     slot="SLOT1")
+    _wait(lambda: dev.mode == "app")
+
+
+def test_unplug_and_replug(sim, wt):
+    sim.unplug("SLOT2")
+    assert wt.wait_for_state("SLOT2", "absent", timeout=5)["present"] is False
+    sim.plug("SLOT2")
+    assert sim.wait_ready("SLOT2") < 5
+
+
+def test_replay_recorded_trace(sim):
+    posted = sim.replay(os.path.join(HERE, "data", "uevents_flap.jsonl"), speed=100)
+    assert posted >= 6
+    keys = [s["slot_key"] for s in sim.api("GET", "/api/devices")["slots"]]
+    assert "platform-xhci-hcd.0-usb-0:1.2:1.0" in keys
+
+
+def test_wifi_ap_station_and_scan(wt):
+    wt.ap_start("WB-Sim", "simpass1")
+    try:
+        sta = wt.wait_for_station(timeout=5)
+        assert sta["mac"] == "24:0a:c4:00:01:01" and sta["ip"] == "192.168.4.2"
+        assert wt.ap_status()["ssid"] == "WB-Sim"
+    finally:
+        wt.ap_stop()
+    nets = wt.scan()["networks"]
+    assert [(n["ssid"], n["auth"], n["rssi"]) for n in nets] == [
+        ("SimNet", "WPA2", -48), ("SimOpen", "OPEN", -71)]
+
+
+def test_wifi_sta_join_checks_passphrase(wt):
+    got = wt.sta_join("SimNet", "simpass123", timeout=5)
+    assert got == {"ip": "192.168.50.23", "gateway": "192.168.50.1"}
+    wt.sta_leave()
+    with pytest.raises(CommandError, match="Failed to connect"):
+        wt.sta_join("SimNet", "wrong-pass", timeout=1)
+
+
+def test_ble_write_reaches_dut(sim, wt):
+    scan = wt._api_post("/api/ble/scan", {"timeout": 0.1})
+    assert {d["address"] for d in scan["devices"]} == {d.ble_address for d in sim.devices.values()}
+    dev = sim.devices["SLOT2"]
+    since = time.time()
+    wt._api_post("/api/ble/connect", {"address": dev.ble_address})
+    try:
+        wt._api_post("/api/ble/write", {"characteristic": bench_sim.NUS_RX, "data": "48656c6c6f"})
+    finally:
+        wt._api_post("/api/ble/disconnect")
+
+    def dut_logged():
+        lines = wt._api_get(f"/api/udplog?since={since}&source={dev.udp.ip}")["lines"]
+        return any("RX 5 bytes" in e["line"] for e in lines)
+    _wait(dut_logged)
+
+
+def test_crash_shows_in_boot_records(sim, wt):
+    dev = sim.devices["SLOT2"]
+    dev.crash()
+
+    def crashed():
+        recs = wt._api_get(f"/api/bootrec?source={dev.udp.ip}")["devices"][0]
+        return recs["crash_loop"] == 1 and recs["boots"][0]["reset"] == "panic"
+    _wait(crashed)
+
+
+def test_malformed_boot_records_are_dropped(sim, wt):
+    src = bench_sim.UdpLogSource("127.0.0.201", sim.udp_port)
+    try:
+        for payload in ('{"boot":"3"}', '{"boot":2.5}', '{"boot":true}', '[1]', '{"boot":-1}',
+                        '{"boot":4,"uptime_s":"x","reset":"panic","extra":1}', '{"boot":5}'):
+            src.send(f"I (1) boot_record: BOOTREC {payload}")
+    finally:
+        src.close()
+
+    def stored():
+        boots = wt._api_get("/api/bootrec?source=127.0.0.201")["devices"][0]["boots"]
+        return boots if len(boots) == 2 else None
+    _wait(stored)
+    new, old = stored()
+    assert (new["boot"], old["boot"]) == (5, 4)
+    assert set(old) == {"boot", "reset", "ts"}
+
+
+def test_bench_quick():
+    with BenchSim(slots=1, baud=0) as sim:
+        sim.plug_all()
+        results = bench_sim.run_bench(sim, quick=True)
+    assert {"devices", "hotplug", "serial_stream", "udplog", "wifi_scan",
+            "ble_write"} <= set(results)
+    assert results["udplog"]["lost"] == 0
+    assert bench_sim.compare(results, results) == []
+
+
+def test_compare_flags_regressions():
+    base = {"devices": {"p50_ms": 2.0, "ops_s": 1000.0}, "scan": {"p50_ms": 300.0}}
+    cur = {"devices": {"p50_ms": 2.5, "ops_s": 600.0}, "scan": {"p50_ms": 500.0}}
+    assert bench_sim.compare(cur, base, max_slowdown=1.5) == [
+        "devices: ops_s 600.0 vs 1000.0", "scan: p50 500.0 ms vs 300.0 ms"]
@@ -0,0 +1,64 @@
+"""Offline tests for the core dump upload (FR-021a) against an in-process
+portal: chunk order, resume from expected_offset and re-sent chunks whose
+reply was lost.
+
+Usage:
+    pytest test_coredump_upload.py
+"""
+
+import json
+import os
+import urllib.error
+import urllib.request
+
+import pytest
+
+IMAGE = bytes(range(256)) * 40          # 10240 bytes: chunks of 4096, 4096, 2048
+CHUNK = 4096
+
+
+@pytest.fixture
+def upload(inproc_portal, tmp_path, monkeypatch):
+    portal, url = inproc_portal()
+    monkeypatch.setattr(portal, "COREDUMP_DIR", str(tmp_path / "coredumps"))
+    monkeypatch.setattr(portal, "_coredump_done", {})
+    monkeypatch.setattr(portal, "_coredump_decode", lambda meta: None)
+
+    def post(offset, data=None):
+        data = IMAGE[offset:offset + CHUNK] if data is None else data
+        req = urllib.request.Request(
+            f"{url}/api/coredump/upload?device=dut1&project=demo&offset={offset}"
+            f"&total={len(IMAGE)}", data=data, method="POST")
+        try:
+            with urllib.request.urlopen(req, timeout=5) as resp:
+                return resp.status, json.load(resp)
+        except urllib.error.HTTPError as e:
+            return e.code, json.load(e)
+
+    post.dir = tmp_path / "coredumps"
+    return post
+
+
+def _cores(path):
+    return [f for f in os.listdir(path) if f.endswith(".core")]
+
+
+def test_out_of_order_chunk_names_the_offset_to_resume_from(upload):
+    assert upload(0)[0] == 200
+    status, reply = upload(2 * CHUNK)
+    assert status == 409 and reply["expected_offset"] == CHUNK
+    assert upload(CHUNK) == (200, {"ok": True, "received": 2 * CHUNK, "complete": False})
+
+
+def test_resent_chunk_is_acknowledged_once(upload):
+    upload(0)
+    upload(CHUNK)
+    assert upload(CHUNK) == (200, {"ok": True, "received": 2 * CHUNK, "complete": False})
+    assert upload(CHUNK, b"x" * CHUNK)[0] == 409        # same place, other bytes
+    assert upload(2 * CHUNK) == (200, {"ok": True, "received": len(IMAGE), "complete": True})
+
+    # the last reply was lost: the retry must not start a second dump
+    assert upload(2 * CHUNK) == (200, {"ok": True, "received": len(IMAGE), "complete": True})
+    assert len(_cores(upload.dir)) == 1
+    with open(upload.dir / _cores(upload.dir)[0], "rb") as f:
+        assert f.read() == IMAGE
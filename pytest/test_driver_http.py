@@ -0,0 +1,86 @@
+"""Offline tests for the driver's HTTP layer against an in-process portal:
+keep-alive connection reuse, long-poll waits and latency records.
+
+Usage:
+    pytest test_driver_http.py
+"""
+
+import os
+import sys
+import threading
+import time
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "pi"))
+
+from wifi_tester_driver import CommandError, WiFiTesterDriver  # noqa: E402
+
+
+@pytest.fixture
+def portal(inproc_portal):
+    return inproc_portal(slots=(1,), present=False)
+
+
+def test_calls_reuse_one_connection(portal):
+    _, url = portal
+    wt = WiFiTesterDriver(url)
+    for _ in range(50):
+        wt.get_leases()
+        wt.get_devices()
+    with pytest.raises(CommandError):                # error replies keep it open too
+        wt.lease_release("nope")
+    wt.get_leases()
+    assert wt._pool.opened == 1
+    wt.close()
+
+
+def test_unread_body_closes_connection_not_stream(portal):
+    """A POST whose handler never reads the body must not corrupt the next request."""
+    _, url = portal
+    wt = WiFiTesterDriver(url)
+    wt._request("POST", "/api/no-such-endpoint", {"pad": "x" * 1000})
+    assert wt.get_leases() == []
+    assert wt._pool.opened == 2
+
+
+def test_reconnects_after_server_drops_idle_connection(portal):
+    _, url = portal
+    wt = WiFiTesterDriver(url)
+    wt.get_leases()
+    for conn in wt._pool._idle:
+        conn.sock.shutdown(2)                        # as if the portal timed it out
+    assert wt.get_leases() == []
+    assert wt._pool.opened == 2
+
+
+def test_wait_for_state_wakes_on_change(portal):
+    mod, url = portal
+    wt = WiFiTesterDriver(url)
+    slot = next(iter(mod.slots.values()))
+    threading.Timer(0.3, mod._actors.tell,
+                    (slot["slot_key"], mod._set_state, slot, mod.STATE_IDLE)).start()
+    t0 = time.monotonic()
+    got = wt.wait_for_state("SLOT1", mod.STATE_IDLE, timeout=10, poll_interval=5)
+    assert got["state"] == mod.STATE_IDLE
+    assert time.monotonic() - t0 < 1.5               # pushed, not a 5 s poll
+    assert wt._pool.opened == 1
+
+
+def test_wait_for_state_timeout(portal):
+    mod, url = portal
+    wt = WiFiTesterDriver(url)
+    with pytest.raises(TimeoutError, match="current: absent"):
+        wt.wait_for_state("SLOT1", mod.STATE_IDLE, timeout=0.3)
+
+
+def test_latency_records(portal):
+    _, url = portal
+    wt = WiFiTesterDriver(url)
+    wt.get_devices()
+    wt.test_sessions(since=10**6, timeout=0.1)
+    calls = wt.take_calls()
+    assert [(c[0], c[2]) for c in calls] == [("GET /api/devices", False),
+                                             ("GET /api/sessions", True)]
+    assert calls[1][1] >= 0.1
+    assert wt.take_calls() == []
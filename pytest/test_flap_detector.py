@@ -0,0 +1,88 @@
+"""Offline tests for the per-slot USB flap detector (no hardware needed).
+
+Usage:
+    pytest test_flap_detector.py
+"""
+
+import os
+import sys
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "pi"))
+
+from flap_detector import FLAPPING, STABLE, FlapDetector, replay_trace  # noqa: E402
+
+TRACE = os.path.join(os.path.dirname(__file__), "data", "uevents_flap.jsonl")
+
+
+def _feed(det, times):
+    return [(t, tr) for t in times if (tr := det.observe(t))]
+
+
+def test_trips_on_threshold_events_in_window():
+    det = FlapDetector(threshold=6, window_s=30, quiet_s=10)
+    assert _feed(det, [0, 1, 2, 3, 4]) == []
+    assert det.observe(5) == FLAPPING
+    assert det.flapping and det.trips == 1
+
+
+def test_slow_events_never_trip():
+    det = FlapDetector(threshold=6, window_s=30, quiet_s=10)
+    assert _feed(det, [i * 7 for i in range(100)]) == []
+    assert det.events == 100
+
+
+def test_stays_flapping_while_events_continue():
+    det = FlapDetector(threshold=4, window_s=10, quiet_s=5)
+    transitions = _feed(det, [i * 2 for i in range(50)])
+    assert transitions == [(6, FLAPPING)]
+
+
+def test_clears_after_quiet_on_next_event():
+    det = FlapDetector(threshold=4, window_s=10, quiet_s=5)
+    _feed(det, [0, 1, 2, 3])
+    assert det.observe(20) == STABLE
+    assert not det.flapping
+
+
+def test_hysteresis_needs_fresh_burst_to_retrip():
+    # Window still holds the old burst, but clearing emptied the ring
+    det = FlapDetector(threshold=4, window_s=60, quiet_s=5)
+    _feed(det, [0, 1, 2, 3])
+    assert _feed(det, [10, 11, 12]) == [(10, STABLE)]
+    assert det.observe(13) == FLAPPING
+
+
+def test_poll_clears_when_quiet():
+    det = FlapDetector(threshold=4, window_s=10, quiet_s=5)
+    _feed(det, [0, 1, 2, 3])
+    assert det.poll(7) is None
+    assert det.poll(8) == STABLE
+    assert det.poll(9) is None
+
+
+def test_trip_and_reset():
+    det = FlapDetector()
+    det.trip(100)
+    assert det.flapping
+    assert det.poll(105) is None
+    det.reset()
+    assert not det.flapping and det.poll(200) is None
+
+
+def test_from_config_defaults_and_overrides():
+    det = FlapDetector.from_config({"threshold": 10, "quiet_s": 3})
+    assert (det.threshold, det.window_s, det.quiet_s) == (10, 30.0, 3.0)
+    assert FlapDetector.from_config(None).threshold == 6
+    with pytest.raises(ValueError):
+        FlapDetector(threshold=1)
+
+
+def test_replay_recorded_trace():
+    # ttyACM0: plug at 0.05 s, then remove/add pairs from 2.0 s, 0.8 s apart
+    key = "platform-xhci-hcd.0-usb-0:1.2:1.0"
+    assert [(k, tr) for _, k, tr in replay_trace(TRACE)] == [(key, FLAPPING)]
+    assert replay_trace(TRACE, threshold=8, window_s=2) == []
+    # A tighter window skips the slow plug and trips inside the storm
+    assert [round(t % 100, 2) for t, _, _ in replay_trace(TRACE, threshold=4, window_s=2)] == [3.15]
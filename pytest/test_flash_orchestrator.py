@@ -0,0 +1,180 @@
+"""Tests for local parallel flashing (pi/flash_orchestrator.py, POST /api/flash).
+
+Image-set parsing runs on its own; the end-to-end tests flash simulated
+DUTs through the bench simulator, whose pty-backed devices emulate the
+ROM loader and flasher stub protocol in download mode.
+
+Usage:
+    pytest test_flash_orchestrator.py
+"""
+
+import os
+import struct
+import sys
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "pi"))
+
+import flash_orchestrator  # noqa: E402
+from flash_orchestrator import FlashError, load_image_set, parse_flash_args  # noqa: E402
+
+IDF_FLASH_ARGS = """\
+--flash_mode dio --flash_freq 80m --flash_size 4MB
+0x0 bootloader/bootloader.bin
+0x10000 wb-test-firmware.bin
+0x8000 partition_table/partition-table.bin
+"""
+
+
+def _app_image(version: str, size: int = 160 * 1024) -> bytes:
+    """An ESP-IDF app image whose esp_app_desc_t carries *version*."""
+    desc = struct.pack("<IIII", 0xABCD5432, 0, 0, 0) + version.encode().ljust(32, b"\0")
+    body = desc + bytes((i * 7 + len(version)) & 0xFF for i in range(4096))
+    body = (body * (size // len(body) + 1))[:size]
+    return bytes([0xE9, 1, 2, 0x2F]) + b"\0" * 20 + struct.pack("<II", 0x3C000020, len(body)) + body
+
+
+def _write_project(root: str, version: str = "0.2.0", name: str = "wb-test") -> str:
+    proj = os.path.join(root, name)
+    os.makedirs(proj, exist_ok=True)
+    files = {
+        "flash_args": IDF_FLASH_ARGS.encode(),
+        "bootloader.bin": bytes(range(256)) * 80 + b"\x01\x02\x03",    # not 4-byte aligned
+        "partition-table.bin": b"\xaa\x50" + b"\x01" * 3070,
+        "wb-test-firmware.bin": _app_image(version),
+    }
+    for fname, data in files.items():
+        with open(os.path.join(proj, fname), "wb") as f:
+            f.write(data)
+    return proj
+
+
+# -- image sets --
+
+def test_parse_flash_args():
+    options, entries = parse_flash_args(IDF_FLASH_ARGS)
+    assert options == {"flash_mode": "dio", "flash_freq": "80m", "flash_size": "4MB"}
+    assert entries == [(0x0, "bootloader/bootloader.bin"), (0x10000, "wb-test-firmware.bin"),
+                       (0x8000, "partition_table/partition-table.bin")]
+    assert parse_flash_args("--flash_size=2MB\n0x1000 a.bin 0x2000 b.bin\n") == \
+        ({"flash_size": "2MB"}, [(0x1000, "a.bin"), (0x2000, "b.bin")])
+    with pytest.raises(FlashError):
+        parse_flash_args("0x0\n")
+    with pytest.raises(FlashError):
+        parse_flash_args("bootloader.bin 0x0\n")
+
+
+def test_load_image_set_by_basename_sorted_and_padded(tmp_path):
+    proj = _write_project(str(tmp_path))
+    size, regions = load_image_set(proj)
+    assert size == 4 * 1024 * 1024
+    assert [(r.offset, r.name) for r in regions] == [
+        (0x0, "bootloader.bin"), (0x8000, "partition-table.bin"), (0x10000, "wb-test-firmware.bin")]
+    boot = regions[0]
+    assert boot.size % 4 == 0 and boot.data.endswith(b"\x03\xff")
+
+
+@pytest.mark.parametrize("flash_args, error", [
+    ("0x0 missing.bin\n", "not uploaded"),
+    ("0x800 bootloader.bin\n", "not sector aligned"),
+    ("0x0 bootloader.bin\n0x1000 partition-table.bin\n", "overlaps"),
+    ("--flash_size 4XB\n0x0 bootloader.bin\n", "bad flash size"),
+    ("--flash_mode dio\n", "lists no images"),
+])
+def test_load_image_set_rejects(tmp_path, flash_args, error):
+    proj = _write_project(str(tmp_path))
+    with open(os.path.join(proj, "flash_args"), "w") as f:
+        f.write(flash_args)
+    with pytest.raises(FlashError, match=error):
+        load_image_set(proj)
+
+
+def test_load_image_set_needs_flash_args(tmp_path):
+    with pytest.raises(FlashError, match="no flash_args"):
+        load_image_set(str(tmp_path))
+
+
+def test_reset_after_native_usb():
+    assert flash_orchestrator.reset_after("/dev/ttyACM0") == "watchdog_reset"
+    assert flash_orchestrator.reset_after("/dev/ttyUSB1") == "hard_reset"
+
+
+# -- end to end on the bench simulator --
+
+def _flash_region(dev, offset: int, data: bytes) -> bytes:
+    return bytes(dev.flash[offset:offset + len(data)])
+
+
+def test_flash_two_slots_in_parallel(sim, wt):
+    proj = _write_project(os.path.join(sim.dir, "firmware"))
+    job = wt.flash("wb-test", slots=["SLOT1", "SLOT2"], timeout=120)
+
+    assert job["state"] == "done" and len(job["regions"]) == 3
+    total = sum(r["size"] for r in job["regions"])
+    for s in job["slots"]:
+        assert s["state"] == "done" and s["chip"] == "ESP32-C3" and s["baud"] == 921600
+        assert s["bytes_written"] == s["bytes_done"] == s["bytes_total"] == total
+        assert s["skipped"] == [] and s["percent"] == 100.0
+    # both slots ran at the same time
+    assert job["ended"] - job["started"] < sum(s["elapsed_s"] for s in job["slots"])
+
+    with open(os.path.join(proj, "wb-test-firmware.bin"), "rb") as f:
+        app = f.read()
+    for label in ("SLOT1", "SLOT2"):
+        dev = sim.devices[label]
+        assert _flash_region(dev, 0x10000, app) == app
+        assert dev.app_version() == "0.2.0" and dev.mode == "app"
+        sim.wait_ready(label)          # proxy back up, slot idle
+
+    got = wt.serial_monitor(slot="SLOT2", pattern="heartbeat", timeout=5)
+    assert got["matched"]
+
+
+def test_reflash_skips_unchanged_regions(sim, wt):
+    _write_project(os.path.join(sim.dir, "firmware"))
+    job = wt.flash("wb-test", slots="all", timeout=120)
+    for s in job["slots"]:
+        assert s["skipped"] == ["0x0", "0x8000", "0x10000"]
+        assert s["bytes_written"] == 0 and s["bytes_done"] == s["bytes_total"]
+    sim.wait_ready("SLOT1")
+
+
+def test_new_app_rewrites_only_the_app(sim, wt):
+    _write_project(os.path.join(sim.dir, "firmware"), version="0.3.0")
+    job = wt.flash("wb-test", timeout=120)
+    (s,) = job["slots"]
+    assert s["label"] == "SLOT1" and s["skipped"] == ["0x0", "0x8000"]
+    assert 0 < s["bytes_written"] < s["bytes_total"]
+    assert sim.devices["SLOT1"].app_version() == "0.3.0"
+    assert sim.devices["SLOT2"].app_version() == "0.2.0"
+    sim.wait_ready("SLOT1")
+    log = [e["msg"] for e in wt.get_log()]
+    assert any("flash(wb-test) SLOT1: done" in m and "2 region(s) unchanged" in m for m in log)
+
+
+def test_flash_request_errors(sim, wt):
+    from wifi_tester_driver import CommandError
+    with pytest.raises(CommandError, match="no flash_args"):
+        wt.flash("no-such-project")
+    with pytest.raises(CommandError, match="not found"):
+        wt.flash("wb-test", slots=["SLOT9"])
+    with pytest.raises(CommandError, match="missing or invalid"):
+        wt.flash("../etc")
+
+
+def test_flash_failure_restores_proxy(sim, wt):
+    from wifi_tester_driver import CommandError
+    dev = sim.devices["SLOT2"]
+    proj = _write_project(os.path.join(sim.dir, "firmware"), name="too-big")
+    with open(os.path.join(proj, "flash_args"), "a") as f:
+        f.write("0x3ff000 wb-test-firmware.bin\n")         # runs past the 4 MB flash
+    with pytest.raises(CommandError) as exc:
+        wt.flash("too-big", slots="SLOT2", skip_unchanged=False, timeout=120)
+    (s,) = exc.value.payload["job"]["slots"]
+    assert s["state"] == "failed" and "0x10" in s["error"]
+    # the chip answered, so each retry stepped the baud down
+    assert s["attempts"] == flash_orchestrator.MAX_ATTEMPTS and s["baud"] == 230400
+    sim.wait_ready("SLOT2")
+    assert dev.mode == "download"      # like esptool, a failed write leaves the chip in the loader
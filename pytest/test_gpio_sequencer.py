@@ -0,0 +1,349 @@
+"""Tests for the GPIO sequencer.
+
+By default they run against the in-process SimBackend. Point
+GPIO_SIM_CHIP at a gpio-sim chip to also exercise libgpiod:
+
+    modprobe gpio-sim   # + configfs bank, see docs (FR-018)
+    GPIO_SIM_CHIP=/dev/gpiochip2 pytest test_gpio_sequencer.py
+"""
+
+import os
+import sys
+import time
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "pi"))
+
+from gpio_sequencer import GpioBank, GpiodBackend, SimBackend, compile_sequence  # noqa: E402
+
+BOOT, EN, READY = 18, 17, 27
+NAMES = {"boot": BOOT, "en": EN, "ready": READY}
+
+
+@pytest.fixture
+def sim():
+    return SimBackend()
+
+
+@pytest.fixture
+def bank(sim):
+    b = GpioBank(sim, allowed={BOOT, EN, READY, 22})
+    yield b
+    b.close()
+
+
+def test_set_drives_pins_in_one_request(bank, sim):
+    bank.set({BOOT: 0, EN: 1})
+    assert bank.status() == {str(EN): {"direction": "output", "value": 1},
+                             str(BOOT): {"direction": "output", "value": 0}}
+    # One batched write, both pins stamped with the same time
+    assert {ts for ts, _, _ in sim.writes} == {sim.writes[0][0]}
+
+
+def test_release_to_input_keeps_request(bank, sim):
+    bank.set({BOOT: 0})
+    bank.set({BOOT: "z"})
+    assert bank.status()[str(BOOT)] == {"direction": "input", "value": 1}
+    assert len(sim._handles) == 1
+
+
+def test_groups_merge_when_pins_are_used_together(bank, sim):
+    bank.set({BOOT: 0})
+    bank.set({EN: 0})
+    assert len(sim._handles) == 2
+    bank.run([{"set": {"boot": 1, "en": 1}}], NAMES)
+    assert len(sim._handles) == 1
+    assert bank.status()[str(BOOT)]["value"] == 1
+
+
+def test_disallowed_pin_rejected(bank):
+    with pytest.raises(ValueError):
+        bank.set({4: 1})
+    with pytest.raises(ValueError):
+        bank.run([{"set": {4: 1}}])
+
+
+def test_pulse_width_and_restore(bank, sim):
+    bank.set({EN: 1})
+    widths, gaps = [], []
+    for _ in range(5):
+        sim.writes.clear()
+        res = bank.run([{"pulse": "en", "level": 0, "us": 500}], NAMES)
+        assert res["ok"]
+        assert [st for _, pin, st in sim.writes if pin == EN] == [0, 1]
+        low, high = [ts for ts, pin, st in sim.writes if pin == EN]
+        widths.append(res["steps"][0]["width_us"])
+        gaps.append(high - low)
+    # Never shorter than asked. A loaded host may deschedule any one run,
+    # so the overshoot bound holds for the best of them
+    assert min(widths) >= 500 and min(gaps) >= 500_000
+    assert min(widths) < 2500 and min(gaps) < 2_500_000
+
+
+def test_long_pulse_leaves_other_pins_free(bank, sim):
+    import threading
+    bank.set({EN: 1, BOOT: 1})                      # one request for both
+    bank.set({22: 1})
+    started = threading.Event()
+    t = threading.Thread(target=lambda: (started.set(), bank.run(
+        [{"pulse": "en", "level": 0, "us": 200_000}], NAMES)))
+    t.start()
+    started.wait()
+    time.sleep(0.05)
+    t0 = time.monotonic()
+    bank.set({22: 0})                               # another request: not held up
+    assert time.monotonic() - t0 < 0.1
+    bank.set({BOOT: 0})                             # the pulsing request: waits for it
+    t.join()
+    en_high = max(ts for ts, pin, st in sim.writes if pin == EN and st == 1)
+    boot_low = next(ts for ts, pin, st in sim.writes if pin == BOOT and st == 0)
+    assert boot_low > en_high
+
+
+def test_reset_into_download_mode_sequence(bank, sim):
+    res = bank.run([{"set": {"boot": 0}},
+                    {"pulse": "en", "level": 0, "us": 100, "then": 1},
+                    {"sleep_us": 1000},
+                    {"set": {"boot": "z"}}], NAMES)
+    assert res["ok"] and [s["op"] for s in res["steps"]] == ["set", "pulse", "sleep", "set"]
+    order = [(pin, st) for _, pin, st in sim.writes]
+    assert order.index((BOOT, 0)) < order.index((EN, 0)) < order.index((EN, 1)) < order.index((BOOT, "z"))
+    assert res["steps"][2]["slept_us"] >= 1000
+
+
+def test_wait_edge_measures_dut_latency(bank, sim):
+    # DUT raises READY 3 ms after EN is released
+    sim.drive(READY, 0)
+    sim.link(EN, READY, delay_us=3000)
+    res = bank.run([{"set": {"en": 0}},
+                    {"sleep_us": 200},
+                    {"set": {"en": 1}},
+                    {"wait_edge": "ready", "edge": "rising", "timeout_ms": 100}], NAMES)
+    assert res["ok"], res
+    edge = res["steps"][3]
+    assert edge["rising"] is True
+    # The sim stamps READY exactly 3 ms after the EN write; latency_us counts
+    # from when the write returned, so it can only come out shorter
+    en_high = next(ts for ts, pin, st in sim.writes if pin == EN and st == 1)
+    assert edge["ts_ns"] - en_high == 3_000_000
+    assert 0 < edge["latency_us"] <= 3000
+
+
+def test_wait_edge_timeout(bank):
+    res = bank.run([{"wait_edge": "ready", "edge": "falling", "timeout_ms": 20}], NAMES)
+    assert not res["ok"] and res["steps"][0]["timeout"]
+    assert "timeout" in res["error"]
+
+
+def test_wait_edge_ignores_stale_edges(bank, sim):
+    bank.set({READY: "z"})
+    sim.drive(READY, 0)
+    bank.status()                                   # let the sim apply the change
+    res = bank.run([{"wait_edge": "ready", "edge": "falling", "timeout_ms": 20}], NAMES)
+    assert not res["ok"]
+
+
+@pytest.mark.parametrize("steps,msg", [
+    ([], "non-empty"),
+    ([{"set": {"nope": 1}}], "unknown pin"),
+    ([{"set": {"en": 2}}], "bad level"),
+    ([{"pulse": "en", "level": "z"}], "bad level"),
+    ([{"wait_edge": "ready", "edge": "up"}], "edge must be"),
+    ([{"sleep_us": 11_000_000}], "longer than"),
+    ([{"jump": 1}], "unknown step"),
+])
+def test_compile_rejects(steps, msg):
+    with pytest.raises(ValueError, match=msg):
+        compile_sequence(steps, NAMES)
+
+
+@pytest.mark.skipif(not os.environ.get("GPIO_SIM_CHIP"), reason="needs GPIO_SIM_CHIP (gpio-sim)")
+def test_gpiod_backend_on_gpio_sim():
+    bank = GpioBank(GpiodBackend(os.environ["GPIO_SIM_CHIP"], consumer="pytest"))
+    try:
+        res = bank.run([{"set": {0: 0}}, {"pulse": 0, "level": 1, "us": 200},
+                        {"sleep_us": 100}], {})
+        assert res["ok"] and res["steps"][1]["width_us"] >= 200
+        assert bank.status()["0"] == {"direction": "output", "value": 0}
+    finally:
+        bank.close()
+
+
+# ── Capture ───────────────────────────────────────────────────────────
+
+def test_capture_pwm_stats(bank, sim):
+    # 2 kHz, 25 % duty: 125 µs high, 375 µs low
+    sim.drive(READY, 0)
+    bank.sample([READY])
+    start = time.monotonic_ns() + 20_000_000
+    sim.pulse_train(READY, high_us=125, low_us=375, count=40, start_ns=start)
+    res = bank.capture(["ready"], duration_ms=60, names=NAMES)
+    pin = res["pins"]["ready"]
+    assert pin["initial"] == 0 and pin["count"] == 80 and pin["lost"] == 0
+    assert pin["level"][:4] == [1, 0, 1, 0]
+    assert pin["freq_hz"] == pytest.approx(2000, rel=1e-3)
+    assert pin["duty"] == pytest.approx(0.25, rel=1e-3)
+    assert pin["high_us"] == {"min": 125.0, "max": 125.0, "mean": 125.0}
+    # first_us counts from the capture's own t0, not from when start was set
+    assert pin["first_us"] == round((start - res["t0_ns"]) / 1000, 1)
+
+
+def test_capture_with_sequence_measures_ready_delay(bank, sim):
+    sim.drive(READY, 0)
+    sim.link(EN, READY, delay_us=1500)
+    res = bank.capture(["ready"], duration_ms=20, names=NAMES,
+                       steps=[{"set": {"en": 0}}, {"sleep_us": 300}, {"set": {"en": 1}}])
+    assert res["sequence"]["ok"]
+    release_us = res["sequence"]["steps"][2]["at_us"]
+    ready = res["pins"]["ready"]
+    assert ready["level"] == [1]
+    # The sim stamps READY 1.5 ms after the EN write
+    assert 1400 < ready["t_us"][0] - release_us < 3000
+
+
+def test_capture_max_edges_and_no_edge_lists(bank, sim):
+    sim.drive(READY, 0)
+    bank.sample([READY])
+    sim.pulse_train(READY, high_us=50, low_us=50, count=100)
+    res = bank.capture([READY], duration_ms=50, max_edges=30, include_edges=False)
+    pin = res["pins"][str(READY)]
+    assert res["truncated"] and pin["count"] == 30
+    assert "t_us" not in pin
+
+
+def test_capture_rejects_bad_requests(bank):
+    with pytest.raises(ValueError, match="duration_ms"):
+        bank.capture([READY], duration_ms=0)
+    with pytest.raises(ValueError, match="cannot be driven"):
+        bank.capture(["en"], 10, NAMES, steps=[{"set": {"en": 0}}])
+    with pytest.raises(ValueError, match="wait_edge"):
+        bank.capture(["ready"], 10, NAMES, steps=[{"wait_edge": "en"}])
+
+
+def test_sample_reads_inputs(bank, sim):
+    sim.drive(READY, 0)
+    assert bank.sample([READY, 22]) == {str(READY): {"direction": "input", "value": 0},
+                                        "22": {"direction": "input", "value": 1}}
+
+
+def test_decode_raw_kernel_events():
+    import struct
+    from gpio_sequencer import EVENT_SIZE, _GpiodHandle
+
+    class Req:
+        fd = None
+
+    raw = b"".join(struct.pack("=QIIII24x", 1000 + i, 1 + (i & 1), 27, i, i + 1) for i in range(5))
+    assert len(raw) == 5 * EVENT_SIZE
+    r, w = os.pipe()
+    os.write(w, raw)
+    h = _GpiodHandle.__new__(_GpiodHandle)
+    h._req = Req()
+    h._req.fd = r
+    try:
+        ts, pins, rising, seq = h.read_edge_batch()
+    finally:
+        os.close(r)
+        os.close(w)
+    assert ts == [1000, 1001, 1002, 1003, 1004]
+    assert pins == [27] * 5
+    assert rising == [True, False, True, False, True]
+    assert seq == [1, 2, 3, 4, 5]
+
+
+class BlockingHandle:
+    """Behaves like a libgpiod request with an empty event queue: a read
+    blocks until something is written to the pipe."""
+
+    def __init__(self):
+        self.r, self.w = os.pipe()
+        self.reads = 0
+
+    def set_values(self, values):
+        pass
+
+    reconfigure = set_values
+
+    def get_value(self, pin):
+        return 1
+
+    def wait_edges(self, timeout_s):
+        import select
+        return bool(select.select([self.r], [], [], timeout_s)[0])
+
+    def read_edge_batch(self):
+        os.read(self.r, 4096)
+        self.reads += 1
+        return [], [], [], []
+
+    def read_edges(self):
+        return self.read_edge_batch()[0]
+
+    def release(self):
+        os.close(self.r)
+        os.close(self.w)
+
+
+class BlockingBackend:
+    def __init__(self):
+        self.handles = []
+
+    def request(self, config):
+        self.handles.append(BlockingHandle())
+        return self.handles[-1]
+
+
+def _must_return(fn, handle):
+    """Run fn() in a thread; fail (and unblock it) if it hangs."""
+    import threading
+    out = {}
+    t = threading.Thread(target=lambda: out.update(result=fn()), daemon=True)
+    t.start()
+    t.join(2)
+    if t.is_alive():
+        os.write(handle.w, b"x")
+        t.join(2)
+        pytest.fail("bank blocked reading an empty edge queue")
+    return out["result"]
+
+
+def test_run_does_not_block_on_empty_edge_queue():
+    backend = BlockingBackend()
+    b = GpioBank(backend)
+    b.set({EN: 1})
+    handle = backend.handles[-1]
+    res = _must_return(lambda: b.run([{"pulse": "en", "level": 0, "us": 100}], NAMES), handle)
+    assert res["ok"] and handle.reads == 0
+    b.close()
+
+
+def test_capture_does_not_block_on_empty_edge_queue():
+    backend = BlockingBackend()
+    b = GpioBank(backend)
+    b.set({READY: "z"})
+    handle = backend.handles[-1]
+    res = _must_return(lambda: b.capture([READY], 20), handle)
+    assert res["pins"][str(READY)]["count"] == 0 and handle.reads == 0
+    b.close()
+
+
+def test_empty_kernel_queue_reads_as_no_events():
+    from gpio_sequencer import _GpiodHandle
+
+    class Req:
+        pass
+
+    class Chip:
+        def request_lines(self, **kw):
+            return req
+
+    req = Req()
+    r, w = os.pipe()
+    req.fd = r
+    try:
+        h = _GpiodHandle(None, Chip(), "test", {})
+        assert h.read_edge_batch() == ([], [], [], [])
+    finally:
+        os.close(r)
+        os.close(w)
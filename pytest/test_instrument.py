@@ -2,6 +2,8 @@
 
 These verify the instrument itself works correctly.
 Tests marked @requires_dut need a WiFi device connected; skip with default run.
+Tests marked @radio hold the Pi radio lease, so they serialize across
+parallel workers (--wt-workers).
 """
 
 import time
@@ -40,6 +42,7 @@ class TestBasicProtocol:
 # =====================================================================
 
 
+@pytest.mark.radio
 class TestSoftAPManagement:
     """WT-2xx: SoftAP start/stop/status tests."""
 
@@ -116,6 +119,7 @@ class TestSoftAPManagement:
 
 
 @pytest.mark.requires_dut
+@pytest.mark.radio
 class TestStationEvents:
     """WT-3xx: Station connect/disconnect events (requires DUT)."""
 
@@ -158,6 +162,7 @@ class TestStationEvents:
 
 
 @pytest.mark.requires_dut
+@pytest.mark.radio
 class TestSTAMode:
     """WT-4xx: STA join/leave tests (requires another AP)."""
 
@@ -232,6 +237,7 @@ class TestSTAMode:
 
 
 @pytest.mark.requires_dut
+@pytest.mark.radio
 class TestHTTPRelay:
     """WT-5xx: HTTP relay tests (requires DUT with HTTP server)."""
 
@@ -297,6 +303,7 @@ class TestHTTPRelay:
 # =====================================================================
 
 
+@pytest.mark.radio
 class TestWiFiScan:
     """WT-6xx: WiFi scan tests."""
 
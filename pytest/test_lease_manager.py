@@ -0,0 +1,136 @@
+"""Offline tests for slot/radio leases (lease manager + portal endpoints).
+
+Usage:
+    pytest test_lease_manager.py
+"""
+
+import os
+import sys
+import threading
+import time
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "pi"))
+
+import lease_manager  # noqa: E402
+from lease_manager import LeaseManager  # noqa: E402
+
+from wifi_tester_driver import CommandError, WiFiTesterDriver  # noqa: E402
+
+
+@pytest.fixture
+def leases(clock):
+    return LeaseManager(lambda: ["SLOT1", "SLOT2", "SLOT3"], clock)
+
+
+def test_any_picks_distinct_free_slots(leases):
+    got = [leases.acquire(f"w{i}", "any").slot for i in range(3)]
+    assert sorted(got) == ["SLOT1", "SLOT2", "SLOT3"]
+    assert leases.acquire("w3", "any") is None
+
+
+def test_specific_slot_is_exclusive(leases):
+    a = leases.acquire("a", "SLOT2")
+    assert leases.acquire("b", "SLOT2") is None
+    assert leases.acquire("b", "any").slot == "SLOT1"
+    leases.release(a.token)
+    assert leases.acquire("b", "SLOT2") is not None
+
+
+def test_radio_separate_from_slot(leases):
+    slot = leases.acquire("a", "SLOT1")
+    radio = leases.acquire("b", radio=True)
+    assert slot and radio
+    assert leases.acquire("a", radio=True) is None
+    assert leases.conflict([slot.token], radio=True) is radio
+    assert leases.conflict([radio.token], radio=True) is None
+    assert leases.conflict([], slot="SLOT3") is None
+
+
+def test_lease_expires_unless_renewed(leases, clock):
+    a = leases.acquire("a", "SLOT1", ttl=10)
+    clock.t += 8
+    assert leases.renew(a.token)
+    clock.t += 8
+    assert leases.conflict([], slot="SLOT1") is a
+    clock.t += 3
+    assert leases.conflict([], slot="SLOT1") is None
+    assert leases.renew(a.token) is None
+    assert leases.snapshot() == []
+
+
+def test_waiter_wakes_on_release(leases):
+    a = leases.acquire("a", radio=True)
+    threading.Timer(0.05, leases.release, (a.token,)).start()
+    t0 = time.monotonic()
+    b = leases.acquire("b", radio=True, wait=5)
+    assert b is not None and time.monotonic() - t0 < 2
+
+
+def test_waiters_served_in_order():
+    leases = LeaseManager(lambda: ["SLOT1"])
+    first = leases.acquire("first", radio=True)
+    order = []
+
+    def waiter(name):
+        lease = leases.acquire(name, radio=True, wait=5)
+        order.append(name)
+        time.sleep(0.02)
+        leases.release(lease.token)
+
+    threads = []
+    for name in ("w1", "w2", "w3"):
+        threads.append(threading.Thread(target=waiter, args=(name,)))
+        threads[-1].start()
+        time.sleep(0.03)                 # queue them in a known order
+    leases.release(first.token)
+    for t in threads:
+        t.join(5)
+    assert order == ["w1", "w2", "w3"]
+
+
+def test_bad_requests(leases):
+    with pytest.raises(ValueError):
+        leases.acquire("a")
+    with pytest.raises(ValueError):
+        LeaseManager(lambda: []).acquire("a", "any")
+
+
+# ── Portal endpoints ─────────────────────────────────────────────────
+
+
+@pytest.fixture
+def portal(inproc_portal):
+    return inproc_portal(slots=(1, 2))[1]
+
+
+def test_portal_enforces_slot_and_radio_leases(portal):
+    a = WiFiTesterDriver(portal, session="a")
+    b = WiFiTesterDriver(portal, session="b")
+    lease = a.lease_acquire(slot="any", timeout=0, keepalive=False)
+    assert a.slot == lease["slot"] == "SLOT1"
+    a.serial_monitor(timeout=0)                      # holder may use it
+    with pytest.raises(CommandError, match="leased by a"):
+        b.serial_monitor(slot="SLOT1", timeout=0)
+    b.serial_monitor(slot="SLOT2", timeout=0)        # unleased slots stay open
+
+    with a.radio(timeout=0):
+        a.scan()
+        with pytest.raises(CommandError, match="radio is leased by a"):
+            b.scan()
+        with pytest.raises(CommandError, match="busy"):
+            b.lease_acquire(radio=True, timeout=0)
+    b.scan()
+    assert [l["holder"] for l in b.get_leases()] == ["a"]
+    a.close()
+    assert b.get_leases() == []
+
+
+def test_portal_lease_errors(portal):
+    d = WiFiTesterDriver(portal)
+    with pytest.raises(CommandError, match="not found"):
+        d.lease_acquire(slot="SLOT9", timeout=0)
+    with pytest.raises(CommandError, match="unknown or expired"):
+        d.lease_release("deadbeef")
+    assert lease_manager.MAX_WAIT_S <= 30
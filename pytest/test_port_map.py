@@ -0,0 +1,202 @@
+"""Tests for automatic ports (pi/port_map.py), lazy proxy activation
+(pi/proxy_activator.py) and both together in the portal.
+
+The port map and the activator run on their own; the end-to-end test
+plugs unconfigured DUTs into the bench simulator and checks that they get
+stable ports, cost no process while idle, start a proxy on the first
+connect and drop it again after PROXY_IDLE_S.
+
+Usage:
+    pytest test_port_map.py
+"""
+
+import json
+import os
+import socket
+import sys
+import threading
+import time
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "pi"))
+
+import port_map  # noqa: E402
+from proxy_activator import Activator  # noqa: E402
+
+
+@pytest.fixture
+def path(tmp_path):
+    return str(tmp_path / "ports.json")
+
+
+def test_parse_range():
+    assert port_map.parse_range("4100-4199") == (4100, 4199)
+    assert port_map.parse_range("4100") == (4100, 4100)
+    assert port_map.parse_range("") is None
+    with pytest.raises(ValueError):
+        port_map.parse_range("4199-4100")
+
+
+def test_ports_are_stable_across_restarts(path, ticking_clock):
+    ports = port_map.PortMap(path, 4100, 4103, reserved={4101}, clock=ticking_clock)
+    a = ports.assign("hub-1", "A1")
+    b = ports.assign("hub-2", None)
+    assert (a["port"], a["label"], b["port"]) == (4100, "AUTO4100", 4102)   # 4101 reserved
+    assert ports.assign("hub-1", "A1")["port"] == 4100
+
+    again = port_map.PortMap(path, 4100, 4103, reserved={4101})
+    assert again.assign("hub-2", None)["port"] == 4102
+    assert again.assign("hub-1", "A1")["port"] == 4100
+    assert json.load(open(path))["range"] == [4100, 4103]
+
+
+def test_serial_number_follows_the_device(path, ticking_clock):
+    ports = port_map.PortMap(path, 4100, 4109, clock=ticking_clock)
+    ports.assign("hub-1", "A1")
+    moved = ports.assign("hub-5", "A1")                  # same board, other connector
+    assert moved["port"] == 4100 and moved["slot_key"] == "hub-5"
+    assert ports.lookup("hub-1") is None
+    assert ports.assign("hub-1", "B2")["port"] == 4101    # new board on the old connector
+
+
+def test_shared_serial_falls_back_to_connector(path, ticking_clock):
+    ports = port_map.PortMap(path, 4100, 4109, clock=ticking_clock)
+    ports.assign("hub-1", "0001")
+    # a second cheap bridge with the same serial while the first is plugged in
+    second = ports.assign("hub-2", "0001", in_use={"hub-1"})
+    assert second["port"] == 4101
+    assert ports.lookup("hub-1")["port"] == 4100
+
+
+def test_full_range_recycles_the_oldest_unplugged(path, ticking_clock):
+    ports = port_map.PortMap(path, 4100, 4101, clock=ticking_clock)
+    ports.assign("hub-1")
+    ports.assign("hub-2")
+    ports.assign("hub-1")                                 # seen again: hub-2 is older
+    entry = ports.assign("hub-3", in_use={"hub-1"})
+    assert entry["port"] == 4101 and ports.lookup("hub-2") is None
+    with pytest.raises(port_map.PortsExhausted):
+        ports.assign("hub-4", in_use={"hub-1", "hub-3"})
+    assert ports.snapshot()["recycled"] == 1
+
+
+def test_corrupt_map_is_ignored(path):
+    with open(path, "w") as f:
+        f.write("{not json")
+    assert port_map.PortMap(path, 4100, 4101).assign("hub-1")["port"] == 4100
+
+
+def _free_port():
+    s = socket.socket()
+    s.bind(("", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def test_activator_fires_once_per_arm_and_watches_exit():
+    connected, exited = [], []
+    fired = threading.Event()
+    act = Activator(lambda key: (connected.append(key), fired.set()),
+                    lambda key, pid: (exited.append((key, pid)), fired.set()))
+    port = _free_port()
+    try:
+        fd = act.listen("a", port)
+        assert act.listen("a", port) == fd                # idempotent
+        client = socket.create_connection(("127.0.0.1", port))
+        assert fired.wait(2) and connected == ["a"]
+        fired.clear()
+        socket.create_connection(("127.0.0.1", port)).close()
+        assert not fired.wait(0.2)                        # disarmed: the proxy accepts now
+        proxy_side = socket.socket(fileno=os.dup(fd))
+        conn, _ = proxy_side.accept()                     # the waiting client is there
+        for s in (conn, client, proxy_side):
+            s.close()
+
+        r, w = os.pipe()
+        act.watch_exit("a", os.fdopen(r, "rb"), 4242)
+        os.close(w)
+        assert fired.wait(2) and exited == [("a", 4242)]
+        assert act.snapshot() == {"listening": 1, "armed": 0, "proxies": 0, "activations": 1}
+
+        act.close("a")                                    # port free again at once
+        s = socket.socket()
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        s.bind(("", port))
+        s.close()
+    finally:
+        act.stop()
+
+
+def test_activator_survives_forget_racing_the_exit():
+    # forget() and the proxy's exit land in one select() batch, the close first
+    entered, gate = threading.Event(), threading.Event()
+    exited = []
+    act = Activator(lambda key: (entered.set(), gate.wait(2)),
+                    lambda key, pid: exited.append(key))
+    port = _free_port()
+    try:
+        act.listen("a", port)
+        r, w = os.pipe()
+        act.watch_exit("a", os.fdopen(r, "rb"), 4242)
+        client = socket.create_connection(("127.0.0.1", port))
+        assert entered.wait(2)                            # selector thread held in on_connect
+        act.forget("a")
+        os.close(w)
+        gate.set()
+        client.close()
+
+        act.close("a")
+        entered.clear()
+        act.listen("a", port)                             # the old socket was really closed
+        socket.create_connection(("127.0.0.1", port)).close()
+        assert entered.wait(2) and exited == []
+    finally:
+        gate.set()
+        act.stop()
+
+
+# -- end to end, on the bench simulator --
+
+def test_auto_slots_start_on_connect_and_idle_out():
+    pytest.importorskip("serial")
+    from bench_sim import BenchSim, bench_slots
+    with BenchSim(slots=1, auto_slots=4, tick_s=0.3, portal_env={"PROXY_IDLE_S": "1"}) as sim:
+        sim.plug_all(auto=False)
+        stats = bench_slots(sim)
+        print(f"\n{stats['slots']} auto slots: idle {stats['idle_rss_kb']} kB and "
+              f"{stats['idle_fds']} fd each in the portal, {stats['idle_procs']} proxies; "
+              f"first connect {stats['p50_ms']} ms, active proxy {stats['active_rss_kb']} kB")
+        assert stats["idle_procs"] == 0
+        assert stats["idle_fds"] < 2                      # its socket (+ the activator's own)
+
+        views = [sim.slot(f"USB{i}") for i in range(2, 6)]
+        assert [v["label"] for v in views] == [f"AUTO{v['tcp_port']}" for v in views]
+        assert len({v["tcp_port"] for v in views}) == 4 and all(v["auto"] for v in views)
+
+        # every proxy idles out (nobody connected) and the slot listens again
+        deadline = time.monotonic() + 15
+        while any(sim.slot(f"USB{i}")["running"] for i in range(2, 6)):
+            assert time.monotonic() < deadline, "lazy proxies did not exit"
+            time.sleep(0.2)
+        assert all(sim.slot(f"USB{i}")["listening"] for i in range(2, 6))
+
+        # the serial monitor activates it again; a replug keeps the port
+        reply = sim.api("POST", "/api/serial/monitor",
+                        {"slot": views[0]["label"], "pattern": "heartbeat", "timeout": 10})
+        assert reply["ok"] and reply["matched"], reply
+        sim.unplug("USB2")
+        deadline = time.monotonic() + 5
+        while sim.slot("USB2")["listening"]:              # port closed while absent
+            assert time.monotonic() < deadline
+            time.sleep(0.05)
+        sim.plug("USB2")
+        sim.wait_ready("USB2")
+        assert sim.slot("USB2")["tcp_port"] == views[0]["tcp_port"]
+        with open(os.path.join(sim.dir, "ports.json")) as f:
+            saved = {e["usb_serial"]: e["port"] for e in json.load(f)["entries"]}
+        assert saved["SIM0002"] == views[0]["tcp_port"]
+        info = sim.api("GET", "/api/info")
+        assert info["auto_ports"]["assigned"] == 4 and info["activator"]["activations"] >= 5
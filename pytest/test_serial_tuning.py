@@ -0,0 +1,127 @@
+"""Tests for serial latency tuning (pi/serial_tuning.py) and its effect on
+local flashing.
+
+Bridge detection and tuning run against fake sysfs trees; the end-to-end
+test flashes the same image on a simulated FTDI slot with tuning off and
+on, and checks the measured command round trip and flash time.
+
+Usage:
+    pytest test_serial_tuning.py
+"""
+
+import os
+import sys
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "pi"))
+
+import serial_tuning  # noqa: E402
+
+
+def _bridge(sysfs, hub_port, tty, driver, vid, pid, product, timer=None, native=False):
+    """sysfs layout of a usb-serial port (or a cdc_acm interface if native)."""
+    usb = sysfs / "devices/platform/soc/3f980000.usb/usb1/1-1" / f"1-1.{hub_port}"
+    intf = usb / f"{usb.name}:1.0"
+    port = intf if native else intf / tty
+    drv = sysfs / "bus" / ("usb" if native else "usb-serial") / "drivers" / driver
+    for d in (port, drv, sysfs / "class/tty" / tty):
+        d.mkdir(parents=True, exist_ok=True)
+    (usb / "idVendor").write_text(vid + "\n")
+    (usb / "idProduct").write_text(pid + "\n")
+    (usb / "product").write_text(product + "\n")
+    os.symlink(drv, port / "driver")
+    os.symlink(port, sysfs / "class/tty" / tty / "device")
+    if timer is not None:
+        (port / "latency_timer").write_text(f"{timer}\n")
+    return port
+
+
+class FakeSerial:
+    def __init__(self, ok=True):
+        self.ok = ok
+        self.low_latency = None
+
+    def set_low_latency_mode(self, on):
+        if not self.ok:
+            raise ValueError("Failed to update ASYNC_LOW_LATENCY flag to True: [Errno 25]")
+        self.low_latency = on
+
+
+@pytest.fixture
+def sysfs(tmp_path):
+    _bridge(tmp_path, 1, "ttyUSB0", "ftdi_sio", "0403", "6001", "FT232R USB UART", timer=16)
+    _bridge(tmp_path, 2, "ttyUSB1", "cp210x", "10c4", "ea60", "CP2102 USB to UART Bridge Controller")
+    _bridge(tmp_path, 3, "ttyUSB2", "ch341-uart", "1a86", "7523", "USB Serial")
+    _bridge(tmp_path, 4, "ttyACM0", "cdc_acm", "303a", "1001", "USB JTAG/serial debug unit",
+            native=True)
+    return str(tmp_path)
+
+
+@pytest.mark.parametrize("tty, bridge, driver, usb_id, timer", [
+    ("ttyUSB0", "ftdi", "ftdi_sio", "0403:6001", 16),
+    ("ttyUSB1", "cp210x", "cp210x", "10c4:ea60", None),
+    ("ttyUSB2", "ch34x", "ch341-uart", "1a86:7523", None),
+    ("ttyACM0", "native_usb", "cdc_acm", "303a:1001", None),
+])
+def test_describe(sysfs, tty, bridge, driver, usb_id, timer):
+    info = serial_tuning.describe(f"/dev/{tty}", sysfs)
+    assert (info["bridge"], info["driver"], info["usb_id"], info["latency_timer_ms"]) == \
+        (bridge, driver, usb_id, timer)
+    assert info["tty"] == tty and info["product"]
+
+
+def test_describe_unknown_port(sysfs):
+    info = serial_tuning.describe("/dev/ttyS9", sysfs)
+    assert info["tty"] == "ttyS9" and info["bridge"] is None and info["driver"] is None
+
+
+def test_tune_ftdi_sets_flag_and_timer(sysfs):
+    ser = FakeSerial()
+    info = serial_tuning.tune(ser, "/dev/ttyUSB0", sysfs)
+    assert ser.low_latency is True
+    assert info["tuned"] and info["low_latency"] and info["latency_timer_ms"] == 1
+    assert serial_tuning.describe("/dev/ttyUSB0", sysfs)["latency_timer_ms"] == 1
+
+
+def test_tune_reports_unsupported_flag(sysfs):
+    info = serial_tuning.tune(FakeSerial(ok=False), "/dev/ttyACM0", sysfs)
+    assert info["tuned"] and not info["low_latency"] and info["latency_timer_ms"] is None
+    assert not serial_tuning.tune(object(), "/dev/ttyUSB1", sysfs)["low_latency"]
+
+
+def test_tune_disabled(sysfs, monkeypatch):
+    monkeypatch.setattr(serial_tuning, "ENABLED", False)
+    ser = FakeSerial()
+    info = serial_tuning.tune(ser, "/dev/ttyUSB0", sysfs)
+    assert not info["tuned"] and ser.low_latency is None and info["latency_timer_ms"] == 16
+
+
+# -- effect on flashing, on the bench simulator --
+
+def _flash_once(untuned: bool) -> tuple[dict, dict]:
+    from bench_sim import BenchSim, bench_flash
+    env = {"SERIAL_LOW_LATENCY": "0"} if untuned else None
+    with BenchSim(slots=1, tick_s=0.3, portal_env=env) as sim:
+        sim.plug_all()
+        sim.wait_ready("SLOT1")
+        stats = bench_flash(sim, size=128 * 1024)
+        return stats, sim.slot("SLOT1")
+
+
+def test_tuning_cuts_flash_round_trips():
+    pytest.importorskip("serial")
+    from bench_sim import FTDI_LATENCY_MS
+    slow, slot_slow = _flash_once(untuned=True)
+    fast, slot_fast = _flash_once(untuned=False)
+    print(f"\nflash 128 KB: untuned {slow['p50_ms']:.0f} ms (rtt {slow['rtt_ms']} ms), "
+          f"tuned {fast['p50_ms']:.0f} ms (rtt {fast['rtt_ms']} ms)")
+
+    assert slot_slow["serial"]["bridge"] == "ftdi"
+    assert slot_slow["serial"]["latency_timer_ms"] == FTDI_LATENCY_MS
+    assert slot_fast["serial"]["latency_timer_ms"] == serial_tuning.LATENCY_TIMER_MS
+    assert slot_fast["rtt_ms"]["baud"] == 921600 and slot_fast["rtt_ms"]["p50"] == fast["rtt_ms"]
+    # the 16 ms timer is in every round trip; tuned, it all but disappears
+    assert slow["rtt_ms"] >= 16 and fast["rtt_ms"] < 8
+    assert fast["p50_ms"] < slow["p50_ms"]
@@ -0,0 +1,142 @@
+"""Offline tests for per-session test progress and operator requests.
+
+Usage:
+    pytest test_session_hub.py
+"""
+
+import os
+import sys
+import threading
+import time
+
+import pytest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "pi"))
+
+import session_hub  # noqa: E402
+from session_hub import DEFAULT_SESSION, SessionHub  # noqa: E402
+
+
+@pytest.fixture
+def hub(clock):
+    return SessionHub(clock)
+
+
+def _result(i, verdict="PASS"):
+    return {"result": {"id": f"T{i}", "name": "t", "result": verdict}}
+
+
+def test_sessions_are_independent(hub):
+    hub.update("slot1", {"spec": "A", "phase": "p", "total": 2})
+    hub.update("slot2", {"spec": "B", "phase": "q", "total": 3})
+    hub.update("slot1", _result(1))
+    hub.update("slot2", _result(1, "FAIL"))
+    a, b = hub.progress("slot1"), hub.progress("slot2")
+    assert (a["spec"], a["done"], a["counts"]) == ("A", 1, {"PASS": 1})
+    assert (b["spec"], b["done"], b["counts"]) == ("B", 1, {"FAIL": 1})
+
+
+def test_default_session_when_no_id(hub):
+    hub.update(None, {"spec": "A", "phase": "p", "total": 1})
+    assert hub.progress(DEFAULT_SESSION)["spec"] == "A"
+
+
+def test_update_without_start_is_an_error(hub):
+    assert hub.update("x", {"phase": "p"}) == "no active session"
+    hub.update("x", {"spec": "A"})
+    hub.update("x", {"end": True})
+    assert hub.update("x", {"phase": "p"}) == "no active session"
+
+
+def test_results_bounded_but_counted(hub):
+    hub.update("s", {"spec": "A", "total": 1000})
+    for i in range(session_hub.MAX_RESULTS + 50):
+        hub.update("s", _result(i))
+    info = hub.progress("s")
+    assert len(info["completed"]) == session_hub.MAX_RESULTS
+    assert info["done"] == session_hub.MAX_RESULTS + 50
+    assert info["completed"][-1]["id"] == f"T{session_hub.MAX_RESULTS + 49}"
+
+
+def test_session_count_bounded(hub):
+    for i in range(session_hub.MAX_SESSIONS * 3):
+        hub.update(f"s{i}", {"spec": "A"})
+    ids = [s["session"] for s in hub.snapshot()["sessions"]]
+    assert len(ids) == session_hub.MAX_SESSIONS
+    assert ids[0] == f"s{session_hub.MAX_SESSIONS * 3 - 1}"     # newest first
+
+
+def test_ended_and_idle_sessions_expire(hub, clock):
+    hub.update("done", {"spec": "A"})
+    hub.update("done", {"end": True})
+    hub.update("idle", {"spec": "B"})
+    assert len(hub.snapshot()["sessions"]) == 2
+    clock.t += session_hub.ENDED_KEEP_S + 1
+    assert [s["session"] for s in hub.snapshot()["sessions"]] == ["idle"]
+    clock.t += session_hub.IDLE_EXPIRE_S
+    assert hub.snapshot()["sessions"] == []
+
+
+def test_bad_session_id_rejected(hub):
+    with pytest.raises(ValueError):
+        hub.update("a b", {"spec": "A"})
+    with pytest.raises(ValueError):
+        hub.human_open("x" * 65, "m")
+
+
+def test_wait_wakes_on_change(hub):
+    v = hub.snapshot()["version"]
+    threading.Timer(0.05, hub.update, ("s", {"spec": "A"})).start()
+    t0 = time.monotonic()
+    snap = hub.wait(v, timeout=5)
+    assert time.monotonic() - t0 < 2
+    assert snap["version"] > v and snap["sessions"][0]["spec"] == "A"
+
+
+def test_wait_times_out(hub):
+    v = hub.snapshot()["version"]
+    t0 = time.monotonic()
+    assert hub.wait(v, timeout=0.05)["version"] == v
+    assert time.monotonic() - t0 >= 0.05
+
+
+def test_human_requests_per_session(hub):
+    r1 = hub.human_open("slot1", "plug in slot 1")
+    r2 = hub.human_open("slot2", "plug in slot 2")
+    assert r1 and r2
+    assert hub.human_open("slot1", "again") is None          # one per session
+    assert [r["session"] for r in hub.human_pending()] == ["slot1", "slot2"]
+
+    assert hub.human_respond(r2.id, False)
+    assert r2.event.is_set() and not r2.confirmed
+    assert hub.human_respond(None, True)                      # oldest: slot1
+    assert r1.confirmed
+    assert not hub.human_respond(None, True)
+    hub.human_close(r1)
+    hub.human_close(r2)
+    assert hub.progress("slot1")["human"] is None
+    assert hub.human_open("slot1", "next") is not None
+
+
+def test_pending_human_session_not_evicted(hub):
+    req = hub.human_open("waiting", "press reset")
+    for i in range(session_hub.MAX_SESSIONS * 2):
+        hub.update(f"s{i}", {"spec": "A"})
+    assert hub.progress("waiting")["human"]["id"] == req.id
+    assert len(hub.snapshot()["sessions"]) == session_hub.MAX_SESSIONS
+
+
+def test_all_sessions_pending_still_admits_new_one(hub):
+    reqs = [hub.human_open(f"s{i}", "press reset") for i in range(session_hub.MAX_SESSIONS)]
+    late = hub.human_open("late", "press reset")
+    assert late is not None
+    assert hub.progress("late")["human"]["id"] == late.id
+    assert hub.update("spec-late", {"spec": "A"}) is None
+    assert hub.progress("spec-late")["spec"] == "A"
+    assert len(hub.human_pending()) == session_hub.MAX_SESSIONS + 1
+
+    for r in reqs + [late]:
+        hub.human_respond(r.id, True)
+        hub.human_close(r)
+    assert hub.human_pending() == []
+    assert len(hub.snapshot()["sessions"]) == session_hub.MAX_SESSIONS
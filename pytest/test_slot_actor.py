@@ -0,0 +1,282 @@
+"""Tests for slot actors (pi/slot_actor.py) and the portal's use of them.
+
+The actor pool runs on its own; the stress test drives the portal's slot
+commands — hotplug events, proxy start/stop, serial monitor and flash
+hand-over — from several threads at once, with the proxy faked, and
+checks that every slot change ran on that slot's actor, that the thread
+count stayed fixed, and that the slots end consistent.
+
+Usage:
+    pytest test_slot_actor.py
+"""
+
+import collections
+import copy
+import json
+import os
+import random
+import sys
+import threading
+import time
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "pi"))
+
+from slot_actor import SlotActors  # noqa: E402
+
+
+@pytest.fixture
+def actors():
+    a = SlotActors(3)
+    yield a
+    a.stop()
+
+
+def _drain(actors, timeout=10.0):
+    deadline = time.monotonic() + timeout
+    while True:
+        snap = actors.snapshot()
+        if not (snap["queued"] or snap["running"] or snap["timers"]):
+            return snap
+        assert time.monotonic() < deadline, f"actors not idle: {snap}"
+        time.sleep(0.01)
+
+
+def test_commands_run_in_order_one_at_a_time_per_slot(actors):
+    seen = collections.defaultdict(list)
+    busy = set()
+
+    def cmd(key, i):
+        assert key not in busy and actors.current() == key
+        busy.add(key)
+        time.sleep(0.001)
+        seen[key].append(i)
+        busy.discard(key)
+        return i
+
+    futures = [actors.tell(k, cmd, k, i) for i in range(50) for k in "abcde"]
+    assert [f.result(5) for f in futures] == [i for i in range(50) for _ in "abcde"]
+    assert all(seen[k] == list(range(50)) for k in "abcde")
+    snap = actors.snapshot()
+    assert snap["threads"] == 3 and snap["processed"] == 250 and snap["errors"] == 0
+
+
+def test_busy_slot_does_not_hold_up_others(actors):
+    gate = threading.Event()
+    actors.tell("a", gate.wait, 5)
+    actors.tell("a", lambda: None)
+    assert actors.ask("b", lambda: "b", timeout=1) == "b"
+    gate.set()
+
+
+def test_ask_inline_and_errors(actors):
+    def outer():
+        return actors.ask("a", lambda: actors.current())    # would deadlock if queued
+
+    assert actors.ask("a", outer, timeout=1) == "a"
+    assert actors.current() is None
+    with pytest.raises(ZeroDivisionError):
+        actors.ask("a", lambda: 1 / 0, timeout=1)
+    assert actors.ask("a", lambda: "still serving", timeout=1) == "still serving"
+    assert actors.snapshot()["errors"] == 1
+
+
+def test_tag_coalesces_queued_command(actors):
+    gate = threading.Event()
+    runs = []
+    actors.tell("a", gate.wait, 5)
+    futures = [actors.tell("a", runs.append, i, tag="reconcile") for i in range(5)]
+    assert all(f is futures[0] for f in futures)
+    gate.set()
+    futures[0].result(5)
+    actors.tell("a", runs.append, 9, tag="reconcile").result(5)   # no longer queued
+    assert runs == [0, 9] and actors.snapshot()["coalesced"] == 4
+
+
+def test_after_queues_later_without_a_worker(actors):
+    t0 = time.monotonic()
+    done = threading.Event()
+    actors.after(0.2, "a", lambda: done.set())
+    actors.after(0.05, "b", lambda: None)
+    assert actors.snapshot()["timers"] == 2
+    assert actors.ask("a", lambda: "free", timeout=0.1) == "free"
+    assert done.wait(2) and time.monotonic() - t0 >= 0.2
+    _drain(actors)
+
+
+def test_after_hook_runs_on_the_slot(actors):
+    hooked = []
+    a = SlotActors(2, after=lambda key: hooked.append((key, a.current())))
+    try:
+        a.ask("x", lambda: None, timeout=1)
+        assert hooked == [("x", "x")]
+    finally:
+        a.stop()
+
+
+def test_actor_stress_thousands_of_commands():
+    """5000 commands from 8 threads over 16 slots on 4 workers."""
+    actors = SlotActors(4)
+    order = collections.defaultdict(list)
+    running = set()
+    lock = threading.Lock()
+    overlaps = []
+
+    def cmd(key, sender, n):
+        with lock:
+            if key in running:
+                overlaps.append(key)
+            running.add(key)
+        order[key].append((sender, n))
+        with lock:
+            running.discard(key)
+
+    def sender(i):
+        rnd = random.Random(i)
+        for n in range(625):
+            key = f"slot{rnd.randrange(16)}"
+            if n % 50 == 0:
+                actors.after(rnd.random() * 0.05, key, cmd, key, i, -n)
+            else:
+                actors.tell(key, cmd, key, i, n)
+
+    threads = [threading.Thread(target=sender, args=(i,)) for i in range(8)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    snap = _drain(actors)
+    actors.stop()
+    assert not overlaps and snap["processed"] == 5000 and snap["threads"] == 4
+    for key, cmds in order.items():                 # each sender's tells stay in order
+        for i in range(8):
+            ns = [n for s, n in cmds if s == i and n > 0]
+            assert ns == sorted(ns), key
+
+
+# -- the portal's slot commands under load --
+
+@pytest.fixture
+def portal(tmp_path, monkeypatch):
+    import portal
+    cfg = tmp_path / "slots.json"
+    cfg.write_text(json.dumps({"slots": [
+        {"label": f"SLOT{i}", "slot_key": f"platform-usb-0:1.{i}:1.0", "tcp_port": 4000 + i,
+         "flap": {"threshold": 10 ** 6}}
+        for i in range(1, 9)]}))
+    slots = portal.load_config(str(cfg))
+    actors = SlotActors(4, after=lambda key: portal._publish(portal.slots.get(key)))
+    monkeypatch.setattr(portal, "slots", slots)
+    monkeypatch.setattr(portal, "_actors", actors)
+    monkeypatch.setattr(portal, "_slot_views", {})
+    monkeypatch.setattr(portal, "log_activity", lambda *a, **k: None)
+
+    proxies = collections.Counter()
+    off_actor = []
+
+    def start_proxy(slot):
+        if actors.current() != slot["slot_key"] or slot["running"]:
+            off_actor.append(("start", slot["label"], actors.current()))
+        proxies[slot["label"]] += 1
+        slot.update(running=True, pid=os.getpid(), last_error=None,
+                    url=f"rfc2217://127.0.0.1:{slot['tcp_port']}", _proxy_at=time.monotonic())
+        portal._set_state(slot, portal.STATE_IDLE)
+        return True
+
+    def stop_proxy(slot):
+        if actors.current() != slot["slot_key"]:
+            off_actor.append(("stop", slot["label"], actors.current()))
+        if slot["running"]:
+            proxies[slot["label"]] -= 1
+        slot.update(running=False, pid=None, url=None, last_error=None)
+        return True
+
+    monkeypatch.setattr(portal, "start_proxy", start_proxy)
+    monkeypatch.setattr(portal, "stop_proxy", stop_proxy)
+    for slot in slots.values():
+        portal._publish(slot)
+    yield portal, proxies, off_actor
+    actors.stop()
+
+
+def test_portal_slot_commands_under_load(portal):
+    portal, proxies, off_actor = portal
+    slots = list(portal.slots.values())
+    baseline = threading.active_count()
+    stop = threading.Event()
+    peak = [baseline]
+    views = []                                       # (view, copy at read)
+    torn = []
+    counts = collections.Counter()
+
+    def sampler():
+        while not stop.is_set():
+            peak[0] = max(peak[0], threading.active_count())
+            for view in list(portal._slot_views.values()):
+                if view["running"] != (view["pid"] is not None):
+                    torn.append(view)
+                if len(views) < 2000:
+                    views.append((view, copy.deepcopy(view)))
+            time.sleep(0.001)
+
+    def dispatcher():                                # process_hotplug's only caller
+        rnd = random.Random(0)
+        for n in range(2400):
+            slot = rnd.choice(slots)
+            action = rnd.choice(("add", "add", "remove"))
+            portal.process_hotplug(action, f"/dev/ttyUSB{slot['tcp_port'] - 4000}",
+                                   slot["slot_key"], "")
+            counts["hotplug"] += 1
+
+    def client(seed):
+        rnd = random.Random(seed)
+        for _ in range(300):
+            slot = rnd.choice(slots)
+            key = slot["slot_key"]
+            op = rnd.randrange(4)
+            if op == 0:
+                if portal._actors.ask(key, portal._monitor_begin, slot, timeout=10):
+                    portal._actors.tell(key, portal._monitor_end, slot)
+            elif op == 1:
+                try:
+                    portal._flash_suspend(slot["label"])
+                except portal.flash_orchestrator.FlashError:
+                    pass                             # absent, or lent to another flash
+                else:
+                    portal._flash_resume(slot["label"])
+            elif op == 2:
+                portal._actors.ask(key, portal._stop_slot, slot, timeout=10)
+            else:
+                portal._actors.ask(key, portal._restart_proxy, slot, slot["devnode"] or
+                                   f"/dev/ttyUSB{slot['tcp_port'] - 4000}", timeout=10)
+            counts["client"] += 1
+
+    threads = [threading.Thread(target=sampler), threading.Thread(target=dispatcher)]
+    threads += [threading.Thread(target=client, args=(i,)) for i in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads[1:]:
+        t.join(60)
+    for slot in slots:                               # finally every device is plugged in
+        portal.process_hotplug("add", f"/dev/ttyUSB{slot['tcp_port'] - 4000}",
+                               slot["slot_key"], "")
+    snap = _drain(portal._actors)
+    stop.set()
+    threads[0].join(5)
+
+    print(f"\n{counts['hotplug']} hotplug events + {counts['client']} client commands: "
+          f"{snap['processed']} run, {snap['coalesced']} coalesced, "
+          f"max mailbox {snap['max_depth']}, peak threads {peak[0] - baseline} above baseline")
+    assert counts["hotplug"] + counts["client"] == 3600
+    assert off_actor == [] and torn == []
+    # workers + timer + this test's 6 threads, however many events arrived
+    assert peak[0] - baseline <= 4 + 1 + 6
+    assert snap["coalesced"] > 0
+    for slot in slots:
+        assert slot["present"] and slot["running"] and slot["state"] == portal.STATE_IDLE
+        assert slot["_lent"] is None and slot["_monitors"] == 0
+        assert proxies[slot["label"]] == 1
+        assert portal._slot_views[slot["slot_key"]] == portal._slot_info(slot)
+    assert all(view == seen for view, seen in views)   # published views never change
@@ -0,0 +1,112 @@
+"""Offline tests for the netlink hotplug monitor (no hardware needed).
+
+Replays pytest/data/uevents_flap.jsonl — one plug followed by a flap storm
+on ttyACM0 plus unrelated noise — through the same parser and dispatcher
+the portal uses.
+
+Usage:
+    pytest test_uevent_replay.py
+"""
+
+import os
+import socket
+import struct
+import sys
+import threading
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "pi"))
+
+import uevent_monitor  # noqa: E402
+
+TRACE = os.path.join(os.path.dirname(__file__), "data", "uevents_flap.jsonl")
+ID_PATH = "platform-xhci-hcd.0-usb-0:1.2:1.0"
+
+
+def _hotplug_events():
+    return [(t, args) for t, props in uevent_monitor.replay(TRACE)
+            if (args := uevent_monitor.hotplug_args(props))]
+
+
+def test_replay_filters_to_serial_events():
+    events = _hotplug_events()
+    actions = [args[0] for _, args in events]
+    assert actions == ["add"] + ["remove", "add"] * 3 + ["remove"]
+    # usb parent events, the virtual console and the truncated datagram drop out
+    assert all(args[1] in ("/dev/ttyACM0", "/dev/ttyUSB0") for _, args in events)
+
+
+def test_replay_preserves_order_and_time():
+    times = [t for t, _ in _hotplug_events()]
+    assert times == sorted(times)
+
+
+def test_udev_event_fields():
+    _, (action, devnode, id_path, devpath) = _hotplug_events()[0]
+    assert action == "add"
+    assert devnode == "/dev/ttyACM0"
+    assert id_path == ID_PATH
+    assert devpath.endswith("/1-1.2:1.0/tty/ttyACM0")
+
+
+def test_kernel_event_has_no_id_path():
+    _, (action, devnode, id_path, devpath) = _hotplug_events()[-1]
+    assert (action, devnode, id_path) == ("remove", "/dev/ttyUSB0", "")
+    assert devpath.endswith("/tty/ttyUSB0")
+
+
+def test_parse_rejects_bad_magic():
+    raw = bytearray(uevent_monitor.encode_udev({"ACTION": "add", "SUBSYSTEM": "tty"}))
+    raw[8] ^= 0xFF
+    assert uevent_monitor.parse_uevent(bytes(raw)) is None
+
+
+def test_dispatcher_runs_in_submission_order():
+    seen = []
+    lock = threading.Lock()
+
+    def handler(action, devnode, id_path, devpath):
+        with lock:
+            seen.append(action)
+        return {"ok": True}
+
+    disp = uevent_monitor.HotplugDispatcher(handler)
+    disp.start()
+    try:
+        events = _hotplug_events()
+        for _, args in events[:-1]:
+            disp.submit(args)
+        assert disp.submit(events[-1][1], wait=True) == {"ok": True}
+    finally:
+        disp.stop()
+    assert seen == [args[0] for _, args in events]
+    assert disp.processed == len(events) and disp.errors == 0
+
+
+def test_dispatcher_survives_handler_error():
+    def handler(*args):
+        if args[0] == "remove":
+            raise RuntimeError("boom")
+        return {"ok": True}
+
+    disp = uevent_monitor.HotplugDispatcher(handler)
+    disp.start()
+    try:
+        assert disp.submit(("remove", "/dev/ttyACM0", "", ""), wait=True) is None
+        assert disp.submit(("add", "/dev/ttyACM0", "", ""), wait=True) == {"ok": True}
+    finally:
+        disp.stop()
+    assert disp.errors == 1
+
+
+def test_sender_check_accepts_only_root_multicast():
+    def creds(uid):
+        return [(socket.SOL_SOCKET, uevent_monitor.SCM_CREDENTIALS,
+                 struct.pack("=iII", 321, uid, 0))]
+
+    udev, kernel = uevent_monitor.GROUP_UDEV, uevent_monitor.GROUP_KERNEL
+    assert uevent_monitor.sender_trusted(creds(0), (321, udev))        # udevd
+    assert uevent_monitor.sender_trusted(creds(0), (0, kernel))
+    assert not uevent_monitor.sender_trusted(creds(1000), (321, udev))
+    assert not uevent_monitor.sender_trusted([], (321, udev))          # no credentials
+    assert not uevent_monitor.sender_trusted(creds(0), (321, kernel))  # not the kernel
+    assert not uevent_monitor.sender_trusted(creds(0), (321, 0))       # unicast
@@ -0,0 +1,199 @@
+"""Tests for USB bus budgeting (pi/usb_bus.py, GET /api/bus).
+
+The scheduler runs on its own; the end-to-end test gives the bench
+simulator a budget that fits one flash at a time and checks that a
+three-slot flash job is serialized on the bus, and that resets, monitors
+and OTA downloads are accounted.
+
+Usage:
+    pytest test_usb_bus.py
+"""
+
+import os
+import sys
+import threading
+import time
+import urllib.request
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "pi"))
+
+import usb_bus  # noqa: E402
+from usb_bus import BusBusy, BusScheduler  # noqa: E402
+
+PI3 = "platform-3f980000.usb"
+
+
+# -- topology --
+
+@pytest.mark.parametrize("slot_key, bus", [
+    ("platform-3f980000.usb-usb-0:1.1.2:1.0", PI3),
+    ("pci-0000:01:00.0-usb-0:1.2:1.0", "pci-0000:01:00.0"),
+    ("/devices/platform/soc/3f980000.usb/usb1/1-1/1-1.3/1-1.3:1.0/ttyUSB0/tty/ttyUSB0", PI3),
+    ("/devices/pci0000:00/0000:01:00.0/usb1/1-1/1-1:1.0/tty/ttyACM0", "pci-0000:01:00.0"),
+    ("serial-xyz", "serial-xyz"),
+])
+def test_bus_of(slot_key, bus):
+    assert usb_bus.bus_of(slot_key) == bus
+
+
+def test_net_bus(tmp_path):
+    dev = tmp_path / "devices/platform/soc/3f980000.usb/usb1/1-1/1-1.1/1-1.1:1.0"
+    soc = tmp_path / "devices/platform/soc/fe300000.mmcnr/mmc1/mmc1:0001"
+    for d in (dev, soc):
+        d.mkdir(parents=True)
+    for iface, target in (("eth0", dev), ("wlan0", soc)):
+        (tmp_path / "net" / iface).mkdir(parents=True)
+        os.symlink(target, tmp_path / "net" / iface / "device")
+    assert usb_bus.net_bus("eth0", str(tmp_path / "net")) == PI3
+    assert usb_bus.net_bus("wlan0", str(tmp_path / "net")) is None
+    assert usb_bus.net_bus("eth9", str(tmp_path / "net")) is None
+
+
+def test_baud_kbps():
+    assert usb_bus.baud_kbps(921600) == pytest.approx(92.16)
+
+
+# -- admission --
+
+def _acquire_async(sched, *args, **kwargs):
+    result = {}
+    t = threading.Thread(target=lambda: result.setdefault("op", sched.acquire(*args, **kwargs)),
+                         daemon=True)
+    t.start()
+    return t, result
+
+
+def _queued(sched, bus=PI3):
+    return [op["label"] for b in sched.snapshot()["buses"] if b["bus"] == bus for op in b["queued"]]
+
+
+def _wait_queued(sched, n, bus=PI3):
+    deadline = time.monotonic() + 5
+    while len(_queued(sched, bus)) < n:
+        assert time.monotonic() < deadline
+        time.sleep(0.01)
+
+
+def test_admits_within_budget_and_queues_the_rest():
+    sched = BusScheduler(200)
+    a = sched.acquire(PI3, "flash", "SLOT1", 92)
+    b = sched.acquire(PI3, "flash", "SLOT2", 92)
+    assert sched.used(PI3) == pytest.approx(184)
+    t, res = _acquire_async(sched, PI3, "flash", "SLOT3", 92)
+    _wait_queued(sched, 1)
+    assert _queued(sched) == ["SLOT3"]
+    other = sched.acquire("pci-0000:01:00.0", "flash", "SLOT4", 92, timeout=0)
+    assert other is not None                 # budgets are per bus
+    sched.release(a)
+    t.join(5)
+    assert res["op"].label == "SLOT3"
+    snap = {b["bus"]: b for b in sched.snapshot()["buses"]}[PI3]
+    assert snap["waited"] == 1 and snap["admitted"] == 3 and snap["peak_kbps"] == 184
+    assert snap["utilisation"] == 92.0
+    assert [op["label"] for op in snap["recent"]] == ["SLOT1"]
+    sched.release(b)
+    sched.release(res["op"])
+    assert sched.used(PI3) == 0
+
+
+def test_waiters_are_served_in_arrival_order():
+    sched = BusScheduler(100)
+    first = sched.acquire(PI3, "flash", "SLOT1", 92)
+    t_big, big = _acquire_async(sched, PI3, "flash", "SLOT2", 92)
+    _wait_queued(sched, 1)
+    t_small, small = _acquire_async(sched, PI3, "reset", "SLOT3", 5)
+    _wait_queued(sched, 2)
+    time.sleep(0.05)
+    assert "op" not in small                 # fits, but may not overtake the flash
+    sched.release(first)
+    t_big.join(5)
+    t_small.join(5)
+    assert big["op"].admitted <= small["op"].admitted
+
+
+def test_lone_op_above_budget_is_admitted():
+    sched = BusScheduler(50)
+    op = sched.acquire(PI3, "ota", "10.0.0.7", 250, timeout=0)
+    assert op is not None
+    assert sched.snapshot()["buses"][0]["utilisation"] == 500.0
+    assert sched.acquire(PI3, "reset", "SLOT1", 11.5, timeout=0) is None
+    sched.release(op)
+
+
+def test_timeout_leaves_queue_and_unblocks_next():
+    sched = BusScheduler(100)
+    first = sched.acquire(PI3, "flash", "SLOT1", 92)
+    with pytest.raises(BusBusy, match="busy"):
+        with sched.hold(PI3, "reset", "SLOT2", 50, timeout=0.05):
+            pass
+    t, res = _acquire_async(sched, PI3, "reset", "SLOT3", 5)
+    t.join(5)                                # nobody queued ahead: fits beside the flash
+    assert res["op"] is not None
+    snap = sched.snapshot()["buses"][0]
+    assert snap["timed_out"] == 1 and snap["queued"] == []
+    sched.release(res["op"])
+    sched.release(first)
+
+
+def test_charge_counts_without_waiting():
+    sched = BusScheduler(100)
+    flash = sched.acquire(PI3, "flash", "SLOT1", 92)
+    mon = sched.charge(PI3, "monitor", "SLOT2", 200)
+    assert sched.used(PI3) == pytest.approx(292)
+    assert sched.acquire(PI3, "reset", "SLOT3", 5, timeout=0) is None
+    sched.release(mon)
+    sched.release(flash)
+    sched.release(flash)                     # double release is harmless
+    assert sched.used(PI3) == 0
+
+
+# -- end to end on the bench simulator --
+
+def _sim_bus(wt, settle_s=2.0):
+    """The simulator's bus once its last operation has been released."""
+    deadline = time.monotonic() + settle_s
+    while True:
+        data = wt.bus_status()
+        (bus,) = [b for b in data["buses"] if b["bus"] == "platform-sim"]
+        if not bus["active"] or time.monotonic() > deadline:
+            return data, bus
+        time.sleep(0.02)
+
+
+def test_flash_serialized_by_bus_budget():
+    pytest.importorskip("serial")
+    from bench_sim import BenchSim
+    from test_flash_orchestrator import _write_project
+    from wifi_tester_driver import WiFiTesterDriver
+
+    env = {"USB_BUS_BUDGET_KBPS": "150", "USB_NET_BUS": "platform-sim", "OTA_KBPS": "100"}
+    with BenchSim(slots=3, tick_s=0.3, portal_env=env) as sim:
+        sim.plug_all()
+        for label in sim.devices:
+            sim.wait_ready(label)
+        _write_project(os.path.join(sim.dir, "firmware"))
+        with WiFiTesterDriver(sim.url, slot="SLOT1") as wt:
+            assert wt.get_slot("SLOT1")["bus"] == "platform-sim"
+            job = wt.flash("wb-test", slots="all", timeout=180)
+
+            # one 921600-baud flash (92 kB/s) at a time on a 150 kB/s bus
+            assert all(s["state"] == "done" for s in job["slots"])
+            data, sim_bus = _sim_bus(wt)
+            flashes = [op for op in sim_bus["recent"] if op["kind"] == "flash"]
+            assert len(flashes) == 3 and sim_bus["waited"] == 2
+            assert sim_bus["peak_kbps"] == pytest.approx(92.2, abs=0.1)
+            assert sum(op["running_s"] for op in flashes) <= job["ended"] - job["started"] + 0.5
+
+            for label in sim.devices:
+                sim.wait_ready(label)
+            assert wt.serial_reset("SLOT2")["output"]
+            assert wt.serial_monitor(slot="SLOT3", pattern="heartbeat", timeout=5)["matched"]
+            with urllib.request.urlopen(f"{sim.url}/firmware/wb-test/wb-test-firmware.bin") as r:
+                assert len(r.read()) > 0
+            data, sim_bus = _sim_bus(wt)
+            kinds = [(op["kind"], op["label"]) for op in sim_bus["recent"][:3]]
+            assert kinds == [("ota", "127.0.0.1"), ("monitor", "SLOT3"), ("reset", "SLOT2")]
+            assert sim_bus["used_kbps"] == 0 and data["budget_kbps"] == 150
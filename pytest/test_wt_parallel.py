@@ -0,0 +1,105 @@
+"""End-to-end test of parallel runs (wt_parallel.py) against an in-process portal.
+
+Runs a small inner suite with --wt-workers 3 on three simulated slots and
+checks that slot tests ran side by side on distinct slots while radio
+tests never overlapped.
+
+Usage:
+    pytest test_wt_parallel.py
+"""
+
+import json
+import os
+import shutil
+import subprocess
+import sys
+import threading
+import time
+
+import pytest
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+INNER = '''
+import json, os, time
+import pytest
+
+def _trace(kind, slot, t0):
+    with open(os.environ["WT_TRACE"], "a") as f:
+        f.write(json.dumps({"kind": kind, "slot": slot, "worker": os.environ.get("WT_WORKER"),
+                            "t0": t0, "t1": time.time()}) + "\\n")
+
+@pytest.mark.parametrize("i", range(6))
+def test_slot(wifi_tester, wt_slot, i):
+    t0 = time.time()
+    wifi_tester.serial_monitor(timeout=0)
+    time.sleep(0.4)
+    wifi_tester.serial_monitor(timeout=0)
+    _trace("slot", wt_slot, t0)
+
+@pytest.mark.radio
+@pytest.mark.parametrize("i", range(3))
+def test_radio(wifi_tester, i):
+    t0 = time.time()
+    wifi_tester.scan()
+    _trace("radio", None, t0)
+
+def test_failure_is_reported():
+    assert False, "expected failure"
+'''
+
+
+@pytest.fixture
+def portal(inproc_portal, monkeypatch):
+    mod, url = inproc_portal(slots=(1, 2, 3))
+    scans = {"now": 0, "max": 0}
+    lock = threading.Lock()
+
+    def scan():
+        with lock:
+            scans["now"] += 1
+            scans["max"] = max(scans["max"], scans["now"])
+        time.sleep(0.2)
+        with lock:
+            scans["now"] -= 1
+        return {"networks": []}
+
+    monkeypatch.setattr(mod.wifi_controller, "scan", scan)
+    return url, scans
+
+
+def test_parallel_run_leases_slots_and_serializes_radio(portal, tmp_path):
+    url, scans = portal
+    suite = tmp_path / "suite"
+    suite.mkdir()
+    shutil.copy(os.path.join(HERE, "conftest.py"), suite)
+    (suite / "test_inner.py").write_text(INNER)
+    trace = tmp_path / "trace.jsonl"
+    env = dict(os.environ, WT_TRACE=str(trace), PYTHONPATH=HERE)
+    proc = subprocess.run(
+        [sys.executable, "-m", "pytest", "-p", "no:cacheprovider", "-q",
+         "--wt-url", url, "--wt-workers", "auto", "test_inner.py"],
+        cwd=suite, env=env, capture_output=True, text=True, timeout=120)
+    out = proc.stdout
+    assert proc.returncode == 1, out + proc.stderr
+    assert "wt-parallel: 3 workers" in out
+    assert "9 passed" in out and "1 failed" in out
+    assert "expected failure" in out
+    # API timings from every worker reach the controller's summary
+    assert "portal API latency" in out
+    assert [l.split()[2] for l in out.splitlines() if l.startswith("GET /api/wifi/scan")] == ["3"]
+
+    runs = [json.loads(line) for line in trace.read_text().splitlines()]
+    slot_runs = [r for r in runs if r["kind"] == "slot"]
+    assert len(slot_runs) == 6
+    # each worker kept one slot, and no two workers shared a slot
+    by_worker = {}
+    for r in slot_runs:
+        by_worker.setdefault(r["worker"], set()).add(r["slot"])
+    assert all(len(s) == 1 for s in by_worker.values())
+    assert len({next(iter(s)) for s in by_worker.values()}) == len(by_worker) > 1
+    # slot tests overlapped in time: faster than running them one by one
+    span = max(r["t1"] for r in slot_runs) - min(r["t0"] for r in slot_runs)
+    assert span < 6 * 0.4 * 0.75
+    # the radio was never used by two workers at once
+    assert scans["max"] == 1
@@ -5,16 +5,23 @@ the test instrument; eth0 provides LAN connectivity.
 """
 
 import base64
+import collections
+import contextlib
+import http.client
 import json
 import logging
+import os
+import socket
+import threading
 import time
-import urllib.error
-import urllib.request
 from dataclasses import dataclass, field
 from typing import Optional
+from urllib.parse import urlsplit
 
 logger = logging.getLogger(__name__)
 
+CALL_LOG_MAX = 10_000       # latency records kept until take_calls()
+
 
 # ── Response object (mimics requests.Response) ───────────────────────
 
@@ -60,22 +67,111 @@ class CommandTimeout(WiFiTesterError):
     """No response received within timeout."""
 
 
+# ── Connection pool ──────────────────────────────────────────────────
+
+
+class _ConnectionPool:
+    """Keep-alive HTTP/1.1 connections to the portal, shared by threads.
+
+    A connection is checked out per request and returned afterwards, so
+    the lease keep-alive thread and the test thread never interleave on
+    one socket. A request that fails on a reused connection (the portal
+    closed it while idle) is retried once on a fresh one.
+    """
+
+    def __init__(self, base_url: str, max_idle: int = 4):
+        url = urlsplit(base_url)
+        self._cls = (http.client.HTTPSConnection if url.scheme == "https"
+                     else http.client.HTTPConnection)
+        self._host = url.hostname or "localhost"
+        self._port = url.port
+        self._prefix = url.path.rstrip("/")
+        self._max_idle = max_idle
+        self._idle: list = []
+        self._lock = threading.Lock()
+        self.opened = 0
+
+    def request(self, method: str, path: str, body: bytes | None,
+                headers: dict, timeout: float) -> tuple[int, bytes]:
+        for attempt in (0, 1):
+            with self._lock:
+                conn = self._idle.pop() if self._idle else None
+            reused = conn is not None
+            if conn is None:
+                conn = self._cls(self._host, self._port, timeout=timeout)
+                self.opened += 1
+            else:
+                conn.timeout = timeout
+                if conn.sock:
+                    conn.sock.settimeout(timeout)
+            try:
+                conn.request(method, self._prefix + path, body=body, headers=headers)
+                resp = conn.getresponse()
+                data = resp.read()
+            except (ConnectionError, http.client.BadStatusLine):
+                conn.close()
+                if reused and attempt == 0:
+                    continue
+                raise
+            except BaseException:
+                conn.close()
+                raise
+            if resp.will_close:
+                conn.close()
+            else:
+                with self._lock:
+                    if len(self._idle) < self._max_idle:
+                        self._idle.append(conn)
+                        conn = None
+                if conn is not None:
+                    conn.close()
+            return resp.status, data
+
+    def close(self) -> None:
+        with self._lock:
+            idle, self._idle = self._idle, []
+        for conn in idle:
+            conn.close()
+
+
 # ── Driver ───────────────────────────────────────────────────────────
 
 
 class WiFiTesterDriver:
     """HTTP driver for the WiFi Tester (Pi backend)."""
 
-    def __init__(self, base_url: str):
+    def __init__(self, base_url: str, session: str | None = None,
+                 slot: str = "SLOT2"):
         self.base_url = base_url.rstrip("/")
+        # Test-progress / operator channel on the Pi. Parallel runs must use
+        # distinct IDs; None uses the portal's shared "default" session.
+        self.session = session
+        # Default slot for serial calls; lease_acquire(slot=...) replaces it
+        self.slot = slot
+        self.holder = session or f"{socket.gethostname()}:{os.getpid()}"
+        self._leases: dict[str, threading.Event] = {}   # token -> keep-alive stop
+        self._pool = _ConnectionPool(self.base_url)
+        # (endpoint, seconds, wait) per API call; see take_calls()
+        self.calls: collections.deque = collections.deque(maxlen=CALL_LOG_MAX)
+
+    def _with_session(self, body: dict) -> dict:
+        if self.session:
+            body["session"] = self.session
+        return body
 
     # ── Lifecycle ────────────────────────────────────────────────────
 
     def open(self) -> None:
-        """No-op for HTTP driver (no persistent connection)."""
+        """No-op: connections are opened on first use and then kept alive."""
 
     def close(self) -> None:
-        """No-op for HTTP driver."""
+        """Release any leases still held and close pooled connections."""
+        for token in list(self._leases):
+            try:
+                self.lease_release(token)
+            except WiFiTesterError:
+                pass
+        self._pool.close()
 
     def __enter__(self):
         self.open()
@@ -86,46 +182,63 @@ class WiFiTesterDriver:
 
     # ── HTTP helpers ─────────────────────────────────────────────────
 
-    def _api_get(self, path: str, timeout: float = 10) -> dict:
-        """GET an API endpoint, return parsed JSON."""
-        url = f"{self.base_url}{path}"
-        req = urllib.request.Request(url)
+    def _headers(self) -> dict:
+        """Lease tokens go with every request; the portal checks them."""
+        return {"X-Lease": ",".join(self._leases)} if self._leases else {}
+
+    def _request(self, method: str, path: str, body: Optional[dict] = None,
+                 timeout: float = 10, wait: bool = False) -> dict:
+        """Send one request over a pooled connection, return parsed JSON.
+
+        JSON error bodies of 4xx/5xx replies are returned like any other;
+        *wait* marks calls that block server-side by design (long-polls),
+        so they don't count as slow in latency reports.
+        """
+        headers = self._headers()
+        payload = None
+        if method == "POST":
+            payload = json.dumps(body or {}).encode("utf-8")
+            headers["Content-Type"] = "application/json"
+        t0 = time.perf_counter()
+        try:
+            status, raw = self._pool.request(method, path, payload, headers, timeout)
+        except (OSError, http.client.HTTPException) as e:
+            raise CommandTimeout(f"{method} {path}: {e}")
+        finally:
+            self.calls.append((f"{method} {path.split('?')[0]}",
+                               time.perf_counter() - t0, wait))
         try:
-            with urllib.request.urlopen(req, timeout=timeout) as resp:
-                data = json.loads(resp.read())
-        except urllib.error.URLError as e:
-            raise CommandTimeout(f"GET {path}: {e}")
-        except Exception as e:
-            raise CommandTimeout(f"GET {path}: {e}")
+            data = json.loads(raw)
+        except ValueError as e:
+            raise CommandTimeout(f"{method} {path}: HTTP {status}: {e}")
+        if status >= 400 and not (isinstance(data, dict) and "error" in data):
+            raise CommandTimeout(f"{method} {path}: HTTP {status}")
+        return data
 
+    def _api_get(self, path: str, timeout: float = 10, wait: bool = False) -> dict:
+        """GET an API endpoint, return parsed JSON."""
+        data = self._request("GET", path, timeout=timeout, wait=wait)
         if not data.get("ok", False):
-            cmd = path.split("/")[-1]
+            cmd = path.split("?")[0].split("/")[-1]
             raise CommandError(cmd, data)
         return data
 
     def _api_post(self, path: str, body: Optional[dict] = None,
-                  timeout: float = 10) -> dict:
+                  timeout: float = 10, wait: bool = False) -> dict:
         """POST JSON to an API endpoint, return parsed JSON."""
-        url = f"{self.base_url}{path}"
-        data_bytes = json.dumps(body or {}).encode("utf-8")
-        req = urllib.request.Request(
-            url, data=data_bytes,
-            headers={"Content-Type": "application/json"},
-            method="POST",
-        )
-        try:
-            with urllib.request.urlopen(req, timeout=timeout) as resp:
-                data = json.loads(resp.read())
-        except urllib.error.URLError as e:
-            raise CommandTimeout(f"POST {path}: {e}")
-        except Exception as e:
-            raise CommandTimeout(f"POST {path}: {e}")
-
+        data = self._request("POST", path, body, timeout=timeout, wait=wait)
         if not data.get("ok", False):
             cmd = path.split("/")[-1]
             raise CommandError(cmd, data)
         return data
 
+    # ── Latency ──────────────────────────────────────────────────────
+
+    def take_calls(self) -> list[tuple[str, float, bool]]:
+        """Return and clear the (endpoint, seconds, wait) records so far."""
+        calls, self.calls = self.calls, collections.deque(maxlen=CALL_LOG_MAX)
+        return list(calls)
+
     # ── Mode management ──────────────────────────────────────────────
 
     def get_mode(self) -> dict:
@@ -227,11 +340,11 @@ class WiFiTesterDriver:
                 raise TimeoutError(
                     f"No {event_type} event within {timeout}s"
                 )
-            poll_timeout = min(remaining, 5)
+            poll_timeout = min(remaining, 25)
             try:
                 result = self._api_get(
-                    f"/api/wifi/events?timeout={poll_timeout}",
-                    timeout=poll_timeout + 5,
+                    f"/api/wifi/events?timeout={poll_timeout:.3f}",
+                    timeout=poll_timeout + 5, wait=True,
                 )
             except CommandTimeout:
                 continue
@@ -265,14 +378,7 @@ class WiFiTesterDriver:
 
     def get_devices(self) -> list[dict]:
         """GET /api/devices — returns list of slot dicts."""
-        url = f"{self.base_url}/api/devices"
-        req = urllib.request.Request(url)
-        try:
-            with urllib.request.urlopen(req, timeout=10) as resp:
-                data = json.loads(resp.read())
-        except Exception as e:
-            raise CommandTimeout(f"GET /api/devices: {e}")
-        return data.get("slots", [])
+        return self._request("GET", "/api/devices").get("slots", [])
 
     def get_slot(self, label: str) -> dict:
         """Find slot by label in /api/devices response."""
@@ -282,39 +388,45 @@ class WiFiTesterDriver:
                 return s
         raise CommandError("get_slot", {"error": f"slot '{label}' not found"})
 
-    def serial_reset(self, slot: str = "SLOT2") -> dict:
+    def serial_reset(self, slot: str | None = None) -> dict:
         """POST /api/serial/reset — returns {ok, output}."""
         result = self._api_post(
-            "/api/serial/reset", {"slot": slot}, timeout=30
+            "/api/serial/reset", {"slot": slot or self.slot}, timeout=30
         )
         return {k: v for k, v in result.items() if k != "ok"}
 
-    def serial_monitor(self, slot: str = "SLOT2",
+    def serial_monitor(self, slot: str | None = None,
                        pattern: Optional[str] = None,
                        timeout: float = 10) -> dict:
         """POST /api/serial/monitor — returns {ok, matched, line, output}."""
-        body: dict = {"slot": slot, "timeout": timeout}
+        body: dict = {"slot": slot or self.slot, "timeout": timeout}
         if pattern is not None:
             body["pattern"] = pattern
         result = self._api_post(
-            "/api/serial/monitor", body, timeout=timeout + 5
+            "/api/serial/monitor", body, timeout=timeout + 5, wait=True
         )
         return {k: v for k, v in result.items() if k != "ok"}
 
-    def enter_portal(self, slot: str = "SLOT2",
+    def enter_portal(self, slot: str | None = None,
                      resets: int = 3) -> dict:
         """POST /api/enter-portal — starts background portal trigger."""
         result = self._api_post(
-            "/api/enter-portal", {"slot": slot, "resets": resets}, timeout=10
+            "/api/enter-portal", {"slot": slot or self.slot, "resets": resets}, timeout=10
         )
         return {k: v for k, v in result.items() if k != "ok"}
 
     def wait_for_state(self, slot_label: str, state: str,
                        timeout: float = 30,
                        poll_interval: float = 1) -> dict:
-        """Poll /api/devices until slot reaches target state or timeout."""
+        """Wait until a slot reaches *state* or *timeout* expires.
+
+        Long-polls /api/devices, which answers as soon as any slot changes
+        state. Portals without change versions are polled every
+        *poll_interval* seconds.
+        """
         deadline = time.monotonic() + timeout
         last_slot = None
+        version = -1
         while True:
             remaining = deadline - time.monotonic()
             if remaining <= 0:
@@ -323,16 +435,23 @@ class WiFiTesterDriver:
                     f"Slot '{slot_label}' did not reach state "
                     f"'{state}' within {timeout}s (current: {current})"
                 )
+            path = "/api/devices"
+            wait = version >= 0
+            if wait:
+                path += f"?since={version}&timeout={min(remaining, 25):.3f}"
             try:
-                slots = self.get_devices()
-                for s in slots:
+                data = self._request("GET", path, timeout=remaining + 5, wait=wait)
+                for s in data.get("slots", []):
                     if s.get("label") == slot_label:
                         last_slot = s
                         if s.get("state") == state:
                             return s
                         break
+                if "version" in data:
+                    version = data["version"]
+                    continue
             except (CommandTimeout, CommandError):
-                pass
+                version = -1
             time.sleep(min(poll_interval, max(remaining, 0)))
 
     def get_log(self, since: Optional[str] = None) -> list[dict]:
@@ -343,6 +462,121 @@ class WiFiTesterDriver:
         result = self._api_get(path, timeout=10)
         return result.get("entries", [])
 
+    # ── Local flashing ──────────────────────────────────────────────
+
+    def flash(self, project: str, slots=None, baud: int | None = None,
+              skip_unchanged: bool = True, wait: bool = True,
+              timeout: float = 300) -> dict:
+        """Flash an uploaded image set (flash_args + bins) from the Pi.
+
+        *slots* is a label, a list of labels or "all" (default: self.slot);
+        they are flashed in parallel over the Pi's local ttys. Regions whose
+        MD5 already matches are skipped unless *skip_unchanged* is False.
+        With *wait*, returns the finished job and raises CommandError if
+        any slot failed; otherwise returns the job as started.
+        """
+        body: dict = {"project": project, "slots": slots or [self.slot],
+                      "skip_unchanged": skip_unchanged}
+        if baud:
+            body["baud"] = baud
+        job = self._api_post("/api/flash", body, timeout=60)
+        job.pop("ok", None)
+        return self.flash_wait(job["job"], timeout) if wait else job
+
+    def flash_wait(self, job_id: int, timeout: float = 300) -> dict:
+        """Long-poll GET /api/flash until job *job_id* has finished."""
+        deadline = time.monotonic() + timeout
+        version = -1
+        while True:
+            remaining = deadline - time.monotonic()
+            data = self._api_get(f"/api/flash?since={version}&timeout={min(max(remaining, 0), 25):.3f}",
+                                 timeout=remaining + 10, wait=version >= 0)
+            version = data["version"]
+            job = next((j for j in data["jobs"] if j["job"] == job_id), None)
+            if job is None:
+                raise CommandError("flash", {"error": f"flash job {job_id} not found"})
+            if job["state"] == "failed":
+                errors = "; ".join(f"{s['label']}: {s['error']}" for s in job["slots"] if s["error"])
+                raise CommandError("flash", {"error": errors, "job": job})
+            if job["state"] == "done":
+                return job
+            if remaining <= 0:
+                raise TimeoutError(f"flash job {job_id} still running after {timeout}s")
+
+    def bus_status(self) -> dict:
+        """GET /api/bus — per-USB-bus demand, utilisation and queued jobs."""
+        data = self._api_get("/api/bus")
+        data.pop("ok", None)
+        return data
+
+    # ── Leases ──────────────────────────────────────────────────────
+
+    def lease_acquire(self, slot: str | None = None, radio: bool = False,
+                      timeout: float = 600, ttl: float = 60,
+                      keepalive: bool = True) -> dict:
+        """Lease a slot (label or "any") and/or the Pi radio for exclusive use.
+
+        Waits up to *timeout* s while another holder has them. The token is
+        sent with every later request; a leased slot becomes this driver's
+        default slot. With *keepalive*, a thread renews the lease every
+        ttl/3 until lease_release(), so it only expires if this process dies.
+        """
+        body = {"holder": self.holder, "radio": radio, "ttl": ttl}
+        if slot:
+            body["slot"] = slot
+        deadline = time.monotonic() + timeout
+        while True:
+            body["wait"] = max(0.0, min(deadline - time.monotonic(), 30))
+            try:
+                result = self._api_post("/api/lease/acquire", body,
+                                        timeout=body["wait"] + 10, wait=body["wait"] > 0)
+                break
+            except CommandError as e:
+                if not e.payload.get("busy") or time.monotonic() >= deadline:
+                    raise
+        token = result["token"]
+        stop = threading.Event()
+        self._leases[token] = stop
+        if result.get("slot"):
+            self.slot = result["slot"]
+        if keepalive:
+            threading.Thread(target=self._lease_keepalive, args=(token, ttl / 3, stop),
+                             daemon=True).start()
+        logger.info("Leased %s", ", ".join(result["resources"]))
+        return {k: v for k, v in result.items() if k != "ok"}
+
+    def _lease_keepalive(self, token: str, interval: float, stop: threading.Event):
+        while not stop.wait(interval):
+            try:
+                self._api_post("/api/lease/renew", {"token": token}, timeout=interval)
+            except CommandError:
+                logger.warning("Lease %s lost", token)
+                return
+            except CommandTimeout:
+                pass    # try again next interval
+
+    def lease_release(self, token: str) -> None:
+        stop = self._leases.pop(token, None)
+        if stop is not None:
+            stop.set()
+        self._api_post("/api/lease/release", {"token": token})
+
+    @contextlib.contextmanager
+    def radio(self, timeout: float = 600):
+        """Hold the radio lease for a block of wlan0 operations."""
+        lease = self.lease_acquire(radio=True, timeout=timeout)
+        try:
+            yield lease
+        finally:
+            try:
+                self.lease_release(lease["token"])
+            except WiFiTesterError as e:
+                logger.warning("Radio lease release failed: %s", e)
+
+    def get_leases(self) -> list[dict]:
+        """GET /api/leases — all active leases."""
+        return self._api_get("/api/leases")["leases"]
+
     # ── Human interaction ───────────────────────────────────────────
 
     def human_interaction(self, message: str, timeout: float = 120) -> bool:
@@ -357,8 +591,8 @@ class WiFiTesterDriver:
         logger.info("Human interaction: %s", message)
         result = self._api_post(
             "/api/human-interaction",
-            {"message": message, "timeout": timeout},
-            timeout=timeout + 10,
+            self._with_session({"message": message, "timeout": timeout}),
+            timeout=timeout + 10, wait=True,
         )
         confirmed = result.get("confirmed", False)
         logger.info("Human interaction %s", "confirmed" if confirmed else "not confirmed")
@@ -369,25 +603,30 @@ class WiFiTesterDriver:
     def test_start(self, spec: str, phase: str, total: int) -> dict:
         """Start a test session on the Pi UI."""
         return self._api_post("/api/test/update",
-                              {"spec": spec, "phase": phase, "total": total})
+                              self._with_session({"spec": spec, "phase": phase, "total": total}))
 
     def test_step(self, test_id: str, name: str, step: str,
                   manual: bool = False) -> dict:
         """Update the current test step shown on the Pi UI."""
         return self._api_post("/api/test/update",
-                              {"current": {"id": test_id, "name": name,
-                                           "step": step, "manual": manual}})
+                              self._with_session({"current": {"id": test_id, "name": name,
+                                                              "step": step, "manual": manual}}))
 
     def test_result(self, test_id: str, name: str, result: str,
                     details: str = "") -> dict:
         """Record a test result (PASS/FAIL/SKIP)."""
         return self._api_post("/api/test/update",
-                              {"result": {"id": test_id, "name": name,
-                                          "result": result, "details": details}})
+                              self._with_session({"result": {"id": test_id, "name": name,
+                                                             "result": result, "details": details}}))
 
     def test_end(self) -> dict:
         """End the test session."""
-        return self._api_post("/api/test/update", {"end": True})
+        return self._api_post("/api/test/update", self._with_session({"end": True}))
+
+    def test_sessions(self, since: int = -1, timeout: float = 0) -> dict:
+        """All test sessions; with *since*, waits up to *timeout* for a change."""
+        return self._api_get(f"/api/sessions?since={since}&timeout={timeout}",
+                             timeout=timeout + 10, wait=timeout > 0)
 
     # ── GPIO control ──────────────────────────────────────────────────
 
@@ -395,6 +634,43 @@ class WiFiTesterDriver:
         """Set a GPIO pin on the Pi (0=low, 1=high, 'z'=release/high-Z)."""
         return self._api_post("/api/gpio/set", {"pin": pin, "value": value})
 
-    def gpio_get(self) -> dict:
-        """Get current GPIO pin states."""
-        return self._api_get("/api/gpio/status")
+    def gpio_get(self, sample: list | None = None) -> dict:
+        """Get current GPIO pin states; *sample* also reads these input pins."""
+        path = "/api/gpio/status"
+        if sample:
+            path += "?sample=" + ",".join(str(p) for p in sample)
+        return self._api_get(path)
+
+    def gpio_sequence(self, steps: list, slot: str | None = None,
+                      pins: dict | None = None) -> dict:
+        """Run a timed GPIO sequence on the Pi; returns measured step timings.
+
+        Pins are named by the slot config ("boot", "en"), by *pins*
+        ({"ready": 27}) or given as BCM numbers.
+        """
+        body = {"steps": steps}
+        if slot:
+            body["slot"] = slot
+        if pins:
+            body["pins"] = pins
+        return self._api_post("/api/gpio/sequence", body)
+
+    def gpio_capture(self, capture: list, duration_ms: float, steps: list | None = None,
+                     slot: str | None = None, pins: dict | None = None,
+                     max_edges: int = 10_000, edges: bool = True) -> dict:
+        """Capture kernel-timestamped edges on input pins for *duration_ms*.
+
+        *steps* (a gpio_sequence) runs after capture starts, so e.g. the
+        delay from EN release to a DUT ready pin can be read from the result.
+        Returns per-pin edge lists (t_us, level) and pulse statistics.
+        """
+        body = {"capture": capture, "duration_ms": duration_ms,
+                "max_edges": max_edges, "edges": edges}
+        if steps:
+            body["steps"] = steps
+        if slot:
+            body["slot"] = slot
+        if pins:
+            body["pins"] = pins
+        return self._api_post("/api/gpio/capture", body,
+                              timeout=duration_ms / 1000 + 10, wait=True)
@@ -0,0 +1,274 @@
+"""Parallel test runs across workbench slots (pytest-xdist style).
+
+    pytest --wt-workers auto          # one worker per slot with a device
+    pytest --wt-workers 3
+
+The controlling pytest collects as usual, then starts N worker pytest
+processes and hands out test IDs one at a time as workers finish, so
+long and short tests balance out. Workers report results back over a pipe
+and the controller feeds them to its own terminal reporter, so output,
+-x/--maxfail and the exit code behave like a normal run.
+
+Each worker is its own pytest session: the session fixtures in conftest.py
+lease a slot for the worker (wt_slot) and the radio around tests that need
+it (@pytest.mark.radio), so slot tests run side by side while radio tests
+queue on the Pi. Workers get WT_WORKER=gwN and a distinct WT_SESSION.
+"""
+
+import collections
+import json
+import os
+import selectors
+import shutil
+import subprocess
+import sys
+import tempfile
+
+import pytest
+
+from wifi_tester_driver import WiFiTesterDriver, WiFiTesterError
+
+
+def pytest_addoption(parser):
+    parser.addoption(
+        "--wt-workers",
+        default=None,
+        help="Run tests in N worker processes ('auto' = one per present slot)",
+    )
+    parser.addoption(
+        "--wt-worker",
+        default=None,
+        help="(internal) run as the worker with this ID",
+    )
+
+
+def pytest_configure(config):
+    worker_id = config.getoption("--wt-worker")
+    if worker_id:
+        config.pluginmanager.register(_Worker(config), "wt_worker")
+    elif config.getoption("--wt-workers"):
+        config.pluginmanager.register(_Controller(config), "wt_controller")
+
+
+def _auto_workers(config) -> int:
+    try:
+        devices = WiFiTesterDriver(config.getoption("--wt-url")).get_devices()
+    except WiFiTesterError:
+        return 1
+    return sum(1 for s in devices if s.get("present") and s.get("label"))
+
+
+def _worker_args(config) -> list[str]:
+    """The controller's own command line, minus --wt-workers."""
+    args, skip = [], False
+    for arg in map(str, config.invocation_params.args):
+        if skip:
+            skip = False
+        elif arg == "--wt-workers":
+            skip = True
+        elif not arg.startswith("--wt-workers="):
+            args.append(arg)
+    return args
+
+
+# ── Controller ───────────────────────────────────────────────────────
+
+
+class _WorkerProc:
+    def __init__(self, wid: str, config, cache_dir: str):
+        self.wid = wid
+        self.inflight: collections.deque = collections.deque()
+        self.ready = False
+        self.shut = False
+        cmd_r, cmd_w = os.pipe()
+        rep_r, rep_w = os.pipe()
+        env = dict(os.environ, WT_WORKER=wid, WT_WORKER_FDS=f"{cmd_r},{rep_w}",
+                   WT_SESSION=f"{os.environ.get('WT_SESSION') or 'pytest'}-{wid}")
+        argv = [sys.executable, "-m", "pytest", *_worker_args(config),
+                f"--wt-worker={wid}", "-o", f"cache_dir={cache_dir}", "-qq"]
+        self.proc = subprocess.Popen(
+            argv, cwd=config.invocation_params.dir, env=env,
+            stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+            pass_fds=(cmd_r, rep_w))
+        os.close(cmd_r)
+        os.close(rep_w)
+        self.cmd = os.fdopen(cmd_w, "w", buffering=1)
+        self.reports = rep_r        # raw fd: a buffered reader would hide lines from select()
+        self._buf = b""
+
+    def read_messages(self) -> list | None:
+        """Messages now readable from the worker; None at EOF."""
+        chunk = os.read(self.reports, 65536)
+        if not chunk:
+            return None
+        *lines, self._buf = (self._buf + chunk).split(b"\n")
+        return [json.loads(line) for line in lines]
+
+    def send(self, **msg):
+        try:
+            self.cmd.write(json.dumps(msg) + "\n")
+        except BrokenPipeError:
+            pass      # worker died; its EOF is handled by the reader
+
+
+class _Controller:
+    def __init__(self, config):
+        self.config = config
+        spec = config.getoption("--wt-workers")
+        self.count = _auto_workers(config) if spec == "auto" else int(spec)
+
+    @pytest.hookimpl(tryfirst=True)
+    def pytest_runtestloop(self, session):
+        if session.testsfailed and not session.config.option.continue_on_collection_errors:
+            return None     # the default loop reports the collection error
+        if session.config.option.collectonly:
+            return None
+        count = min(self.count, len(session.items))
+        if count < 2:
+            return None     # nothing to parallelise: run in-process
+
+        tr = self.config.pluginmanager.get_plugin("terminalreporter")
+        if tr:
+            tr.write_line(f"wt-parallel: {count} workers")
+        self.session = session
+        self.queue = collections.deque(session.items)
+        self.started = set()
+        cache_dir = tempfile.mkdtemp(prefix="wt-parallel-")
+        try:
+            self._run([_WorkerProc(f"gw{i}", self.config, cache_dir) for i in range(count)])
+        finally:
+            shutil.rmtree(cache_dir, ignore_errors=True)
+
+        if session.shouldfail:
+            raise session.Failed(session.shouldfail)
+        if session.shouldstop:
+            raise session.Interrupted(session.shouldstop)
+        return True
+
+    def _feed(self, w: _WorkerProc):
+        if self.session.shouldfail or self.session.shouldstop:
+            self.queue.clear()
+        if self.queue:
+            item = self.queue.popleft()
+            w.inflight.append(item)
+            w.send(run=item.nodeid)
+        elif not w.shut:
+            w.shut = True
+            w.send(shutdown=True)
+
+    def _run(self, workers: list):
+        sel = selectors.DefaultSelector()
+        for w in workers:
+            sel.register(w.reports, selectors.EVENT_READ, w)
+        alive = len(workers)
+        while alive:
+            for key, _ in sel.select():
+                w = key.data
+                messages = w.read_messages()
+                if messages is not None:
+                    for msg in messages:
+                        self._handle(w, msg)
+                    continue
+                sel.unregister(w.reports)
+                os.close(w.reports)
+                w.cmd.close()
+                w.proc.wait()
+                alive -= 1
+                self._worker_lost(w, alive)
+        sel.close()
+
+    def _handle(self, w: _WorkerProc, msg: dict):
+        hook = self.config.hook
+        if "collected" in msg:
+            w.ready = True
+            self._feed(w)
+            self._feed(w)       # a worker runs an item once it knows the next one
+        elif "report" in msg:
+            rep = hook.pytest_report_from_serializable(config=self.config, data=msg["report"])
+            if rep.nodeid not in self.started:
+                self.started.add(rep.nodeid)
+                hook.pytest_runtest_logstart(nodeid=rep.nodeid, location=rep.location)
+            hook.pytest_runtest_logreport(report=rep)
+        elif "done" in msg:
+            item = w.inflight.popleft()
+            if msg.get("missing"):
+                self._fail(item, f"{w.wid} did not collect {item.nodeid}")
+            else:
+                hook.pytest_runtest_logfinish(nodeid=item.nodeid, location=item.location)
+            self._feed(w)
+
+    def _worker_lost(self, w: _WorkerProc, alive: int):
+        """A worker exited. If it still had tests, the first one crashed it;
+        the rest go back to the queue (or fail if no worker is left)."""
+        if not w.inflight:
+            if not w.ready and w.proc.returncode:
+                self._report_error(f"{w.wid} exited with {w.proc.returncode} before running tests")
+            return
+        crashed = w.inflight.popleft()
+        self._fail(crashed, f"worker {w.wid} crashed (exit code {w.proc.returncode})")
+        self.queue.extendleft(reversed(w.inflight))
+        w.inflight.clear()
+        if not alive:
+            while self.queue:
+                self._fail(self.queue.popleft(), "no workers left")
+
+    def _fail(self, item, message: str):
+        rep = pytest.TestReport(item.nodeid, item.location, {}, "failed", message, "call")
+        self.config.hook.pytest_runtest_logstart(nodeid=item.nodeid, location=item.location)
+        self.config.hook.pytest_runtest_logreport(report=rep)
+        self.config.hook.pytest_runtest_logfinish(nodeid=item.nodeid, location=item.location)
+
+    def _report_error(self, message: str):
+        self.session.testsfailed += 1
+        tr = self.config.pluginmanager.get_plugin("terminalreporter")
+        if tr:
+            tr.write_line(f"wt-parallel: {message}", red=True)
+
+
+# ── Worker ───────────────────────────────────────────────────────────
+
+
+class _Worker:
+    def __init__(self, config):
+        self.config = config
+        cmd_fd, rep_fd = map(int, os.environ["WT_WORKER_FDS"].split(","))
+        self.cmd = os.fdopen(cmd_fd, "r")
+        self.out = os.fdopen(rep_fd, "w", buffering=1)
+
+    def _send(self, **msg):
+        self.out.write(json.dumps(msg) + "\n")
+
+    @pytest.hookimpl(tryfirst=True)
+    def pytest_runtestloop(self, session):
+        if session.testsfailed and not session.config.option.continue_on_collection_errors:
+            return None     # exits non-zero without reporting "collected"
+        items = {item.nodeid: item for item in session.items}
+        self._send(collected=len(items))
+        pending = []
+        for line in self.cmd:
+            msg = json.loads(line)
+            if "shutdown" in msg:
+                break
+            item = items.get(msg["run"])
+            if item is None:
+                pending.append(msg["run"])
+            else:
+                pending.append(item)
+            if len(pending) > 1:
+                self._run(pending.pop(0), pending[0])
+        while pending:
+            self._run(pending.pop(0), pending[0] if pending else None)
+        return True
+
+    def _run(self, item, nextitem):
+        if isinstance(item, str):
+            self._send(done=item, missing=True)
+            return
+        if isinstance(nextitem, str):
+            nextitem = None
+        item.config.hook.pytest_runtest_protocol(item=item, nextitem=nextitem)
+        self._send(done=item.nodeid)
+
+    def pytest_runtest_logreport(self, report):
+        self._send(report=self.config.hook.pytest_report_to_serializable(
+            config=self.config, report=report))
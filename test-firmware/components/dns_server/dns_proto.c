@@ -0,0 +1,186 @@
+/*
+ * DNS wire-format handling for the captive-portal responder.
+ * See dns_proto.h for the reply policy.
+ */
+
+#include "dns_proto.h"
+#include <string.h>
+
+#define FLAG_QR         0x8000
+#define FLAG_AA         0x0400
+#define FLAG_TC         0x0200
+#define FLAG_RD         0x0100
+#define OPCODE_MASK     0x7800
+
+#define SOA_RR_LEN      34
+
+/* Negative-answer SOA: owner is patched to point at the first question,
+ * MNAME/RNAME are the root, all timers are the negative TTL. */
+static const uint8_t s_soa_tmpl[SOA_RR_LEN] = {
+    0xC0, 0x0C,                                 /* owner (patched) */
+    0x00, DNS_TYPE_SOA, 0x00, DNS_CLASS_IN,
+    0x00, 0x00, 0x00, DNS_NEG_TTL_SEC,          /* ttl */
+    0x00, 22,                                   /* rdlength */
+    0x00,                                       /* mname: . */
+    0x00,                                       /* rname: . */
+    0x00, 0x00, 0x00, 0x01,                     /* serial */
+    0x00, 0x00, 0x00, DNS_NEG_TTL_SEC,          /* refresh */
+    0x00, 0x00, 0x00, DNS_NEG_TTL_SEC,          /* retry */
+    0x00, 0x00, 0x00, DNS_NEG_TTL_SEC,          /* expire */
+    0x00, 0x00, 0x00, DNS_NEG_TTL_SEC,          /* minimum */
+};
+
+static inline uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void wr16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+void dns_answer_tmpl_init(dns_answer_tmpl_t *tmpl, uint32_t ip_be, uint32_t ttl)
+{
+    uint8_t *p = tmpl->rr;
+    wr16(p + 0, 0xC00C);
+    wr16(p + 2, DNS_TYPE_A);
+    wr16(p + 4, DNS_CLASS_IN);
+    wr16(p + 6, (uint16_t)(ttl >> 16));
+    wr16(p + 8, (uint16_t)ttl);
+    wr16(p + 10, 4);
+    memcpy(p + 12, &ip_be, 4);  /* already in wire order */
+}
+
+/* True if a label of the (already bounds-checked) wire name holds a '.'. */
+static bool label_has_dot(const uint8_t *s)
+{
+    for (uint8_t l = *s++; l; s += l, l = *s++) {
+        if (memchr(s, '.', l)) return true;
+    }
+    return false;
+}
+
+/* Decode an uncompressed QNAME into lower-case dotted form. Returns the
+ * number of wire bytes consumed, or -1 if malformed or too long. A wire
+ * name of at most 255 bytes always fits DNS_NAME_MAX_LEN when dotted. */
+static int read_qname(const uint8_t *p, const uint8_t *end,
+                      char *out, size_t *out_len)
+{
+    const uint8_t *s = p;
+    size_t n = 0;
+
+    for (;;) {
+        if (s >= end) return -1;
+        uint8_t l = *s++;
+        if (l == 0) break;
+        if (l & 0xC0) return -1;            /* no compression in questions */
+        if (l > end - s) return -1;
+        if ((size_t)(s - p) + l + 1 > 255) return -1;   /* RFC 1035 limit */
+        if (n) out[n++] = '.';
+        for (uint8_t i = 0; i < l; i++) {
+            uint8_t c = s[i];
+            out[n++] = (char)((c >= 'A' && c <= 'Z') ? c + 32 : c);
+        }
+        s += l;
+    }
+    /* '.' inside a label would alias another name, NUL would end the
+     * string early for the lookup. Checked once over the wire name, not
+     * per byte, so the copy loop stays vectorizable: length bytes are
+     * never 0, and one that reads as '.' (46) just costs the exact check. */
+    size_t wire = (size_t)(s - p) - 1;
+    if (memchr(p, '\0', wire)) return -1;
+    if (memchr(p, '.', wire) && label_has_dot(p)) return -1;
+    out[n] = '\0';
+    *out_len = n;
+    return (int)(s - p);
+}
+
+static size_t header_only(uint8_t *reply, uint16_t flags, uint8_t rcode)
+{
+    wr16(reply + 2, (uint16_t)(flags | rcode));
+    memset(reply + 4, 0, DNS_HEADER_LEN - 4);
+    return DNS_HEADER_LEN;
+}
+
+size_t dns_build_reply(const uint8_t *req, size_t req_len,
+                       uint8_t *reply, size_t reply_max,
+                       dns_lookup_fn_t lookup, void *ctx)
+{
+    if (req_len < DNS_HEADER_LEN || reply_max < DNS_HEADER_LEN) return 0;
+
+    uint16_t qflags = rd16(req + 2);
+    if (qflags & FLAG_QR) return 0;         /* never answer a response */
+
+    memcpy(reply, req, 2);                  /* id */
+    uint16_t flags = FLAG_QR | FLAG_AA | (qflags & (OPCODE_MASK | FLAG_RD));
+    if (qflags & OPCODE_MASK) return header_only(reply, flags, DNS_RCODE_NOTIMP);
+
+    uint16_t qd_count = rd16(req + 4);
+    if (qd_count == 0 || qd_count > DNS_MAX_QUESTIONS) {
+        return header_only(reply, flags, DNS_RCODE_FORMERR);
+    }
+
+    /* Pass 1: validate and look up every question */
+    struct {
+        uint16_t off;
+        uint16_t type;
+        uint16_t class;
+        const dns_answer_tmpl_t *tmpl;
+    } q[DNS_MAX_QUESTIONS];
+    char name[DNS_NAME_MAX_LEN];
+    size_t name_len;
+    const uint8_t *end = req + req_len;
+    size_t off = DNS_HEADER_LEN;
+    bool matched = false;
+
+    for (uint16_t i = 0; i < qd_count; i++) {
+        int n = read_qname(req + off, end, name, &name_len);
+        if (n < 0 || off + (size_t)n + 4 > req_len) {
+            return header_only(reply, flags, DNS_RCODE_FORMERR);
+        }
+        q[i].off = (uint16_t)off;
+        q[i].type = rd16(req + off + n);
+        q[i].class = rd16(req + off + n + 2);
+        q[i].tmpl = lookup(ctx, name, name_len);
+        if (q[i].tmpl) matched = true;
+        off += (size_t)n + 4;
+    }
+
+    /* Echo header + questions; drop whatever followed (EDNS OPT) */
+    if (off > reply_max) return header_only(reply, flags, DNS_RCODE_FORMERR);
+    memcpy(reply + DNS_HEADER_LEN, req + DNS_HEADER_LEN, off - DNS_HEADER_LEN);
+
+    /* Pass 2: answers */
+    size_t pos = off;
+    uint16_t an_count = 0;
+    for (uint16_t i = 0; i < qd_count; i++) {
+        if (!q[i].tmpl) continue;
+        if (q[i].class != DNS_CLASS_IN && q[i].class != DNS_CLASS_ANY) continue;
+        if (q[i].type != DNS_TYPE_A && q[i].type != DNS_TYPE_ANY) continue;
+        if (pos + DNS_A_RR_LEN > reply_max) {
+            flags |= FLAG_TC;
+            break;
+        }
+        memcpy(reply + pos, q[i].tmpl->rr, DNS_A_RR_LEN);
+        wr16(reply + pos, (uint16_t)(0xC000 | q[i].off));
+        pos += DNS_A_RR_LEN;
+        an_count++;
+    }
+
+    /* NXDOMAIN or NODATA: add the SOA so the client caches the answer */
+    uint16_t ns_count = 0;
+    if (an_count == 0 && !(flags & FLAG_TC) && pos + SOA_RR_LEN <= reply_max) {
+        memcpy(reply + pos, s_soa_tmpl, SOA_RR_LEN);
+        pos += SOA_RR_LEN;
+        ns_count = 1;
+    }
+
+    wr16(reply + 2, (uint16_t)(flags | (matched ? DNS_RCODE_NOERROR : DNS_RCODE_NXDOMAIN)));
+    wr16(reply + 4, qd_count);
+    wr16(reply + 6, an_count);
+    wr16(reply + 8, ns_count);
+    wr16(reply + 10, 0);
+    return pos;
+}
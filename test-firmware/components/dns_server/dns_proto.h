@@ -0,0 +1,75 @@
+/*
+ * DNS wire-format handling for the captive-portal responder.
+ *
+ * Pure C with no ESP-IDF or lwIP dependencies so it can be fuzzed and
+ * benchmarked on the host (see test-firmware/host_test/). Nothing here
+ * allocates; the caller owns both packet buffers.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DNS_HEADER_LEN      12
+#define DNS_UDP_MAX_LEN     512     /* classic UDP payload limit, no EDNS */
+#define DNS_NAME_MAX_LEN    256     /* dotted name incl. terminating NUL */
+#define DNS_MAX_QUESTIONS   4
+#define DNS_A_RR_LEN        16      /* name ptr, type, class, ttl, rdlen, IPv4 */
+#define DNS_NEG_TTL_SEC     60      /* SOA minimum for NXDOMAIN/NODATA caching */
+
+#define DNS_TYPE_A          1
+#define DNS_TYPE_SOA        6
+#define DNS_TYPE_AAAA       28
+#define DNS_TYPE_SVCB       64
+#define DNS_TYPE_HTTPS      65
+#define DNS_TYPE_ANY        255
+#define DNS_CLASS_IN        1
+#define DNS_CLASS_ANY       255
+
+#define DNS_RCODE_NOERROR   0
+#define DNS_RCODE_FORMERR   1
+#define DNS_RCODE_NXDOMAIN  3
+#define DNS_RCODE_NOTIMP    4
+
+/* Pre-encoded A record for one rule. Only the name pointer (first two
+ * bytes) is patched per answer. */
+typedef struct {
+    uint8_t rr[DNS_A_RR_LEN];
+} dns_answer_tmpl_t;
+
+/* *ip_be* is the IPv4 address in network byte order (as in esp_ip4_addr_t). */
+void dns_answer_tmpl_init(dns_answer_tmpl_t *tmpl, uint32_t ip_be, uint32_t ttl);
+
+/* Rule lookup. *name* is lower-case, dot-separated, without the trailing
+ * dot ("" for the root). Return the answer template, or NULL if no rule
+ * covers the name (the query then gets NXDOMAIN). */
+typedef const dns_answer_tmpl_t *(*dns_lookup_fn_t)(void *ctx, const char *name,
+                                                   size_t name_len);
+
+/*
+ * Build the reply for one query packet.
+ *
+ * - A (and ANY) questions for known names get the rule's A record
+ * - other types for known names (AAAA, HTTPS/SVCB, ...) get NODATA so
+ *   clients fall back to IPv4 right away instead of retrying
+ * - if no question matched any rule the reply is NXDOMAIN
+ * - negative replies carry a synthetic SOA so clients cache them
+ * - the question section is echoed, anything after it (EDNS OPT etc.)
+ *   is dropped and an_count/ns_count/ar_count reflect what is written
+ *
+ * Returns the reply length, or 0 if the packet must be ignored (too
+ * short, or itself a response).
+ */
+size_t dns_build_reply(const uint8_t *req, size_t req_len,
+                       uint8_t *reply, size_t reply_max,
+                       dns_lookup_fn_t lookup, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
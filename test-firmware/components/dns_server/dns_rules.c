@@ -0,0 +1,182 @@
+/*
+ * Hash-indexed DNS rule table. See dns_rules.h.
+ */
+
+#include "dns_rules.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET      2166136261u
+#define FNV_PRIME       16777619u
+
+enum { KIND_EXACT = 0, KIND_SUFFIX = 1 };
+
+struct dns_rules {
+    size_t count;
+    uint32_t mask;          /* slot count - 1 (power of two) */
+    dns_rule_t *catch_all;  /* the "*" rule, if any */
+    dns_rule_t *rules;
+    uint32_t *slots;        /* rule index + 1, 0 = empty */
+    char *pool;             /* normalised names, not NUL-terminated */
+};
+
+static inline uint32_t fnv_label(uint32_t h, const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++) h = (h ^ (uint8_t)s[i]) * FNV_PRIME;
+    return (h ^ '.') * FNV_PRIME;
+}
+
+/* Hash of a whole dotted name with its labels taken right to left. */
+static uint32_t hash_reversed(const char *name, size_t len)
+{
+    uint32_t h = FNV_OFFSET;
+    size_t end = len;
+    while (end > 0) {
+        size_t start = end;
+        while (start > 0 && name[start - 1] != '.') start--;
+        h = fnv_label(h, name + start, end - start);
+        end = start ? start - 1 : 0;
+    }
+    return h;
+}
+
+static dns_rule_t *probe(const dns_rules_t *t, uint32_t h, uint8_t kind,
+                         const char *s, size_t n)
+{
+    for (uint32_t i = h & t->mask;; i = (i + 1) & t->mask) {
+        uint32_t slot = t->slots[i];
+        if (!slot) return NULL;
+        dns_rule_t *r = &t->rules[slot - 1];
+        if (r->hash == h && r->kind == kind && r->name_len == n &&
+            memcmp(t->pool + r->name_off, s, n) == 0) {
+            return r;
+        }
+    }
+}
+
+/* Lower-case *src* into *dst*, strip one trailing dot and reject empty
+ * labels. Returns the normalised length, or 0 if invalid. */
+static size_t normalise(const char *src, char *dst)
+{
+    size_t n = strlen(src);
+    if (n && src[n - 1] == '.') n--;
+    if (n == 0 || n > 253) return 0;
+
+    char prev = '.';
+    for (size_t i = 0; i < n; i++) {
+        char c = src[i];
+        if (c == '.' && prev == '.') return 0;
+        dst[i] = (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+        prev = c;
+    }
+    return n;
+}
+
+dns_rules_t *dns_rules_build(const dns_rule_def_t *defs, size_t count)
+{
+    if (count > DNS_RULES_MAX) return NULL;
+
+    size_t pool_len = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (defs[i].name) pool_len += strlen(defs[i].name);
+    }
+    uint32_t cap = 8;
+    while (cap < 2 * count) cap <<= 1;
+
+    /* One block: header | rules | slots | name pool */
+    size_t rules_off = (sizeof(dns_rules_t) + 7) & ~(size_t)7;
+    size_t slots_off = rules_off + count * sizeof(dns_rule_t);
+    size_t pool_off = slots_off + cap * sizeof(uint32_t);
+    uint8_t *mem = calloc(1, pool_off + pool_len + 1);
+    if (!mem) return NULL;
+
+    dns_rules_t *t = (dns_rules_t *)mem;
+    t->mask = cap - 1;
+    t->rules = (dns_rule_t *)(mem + rules_off);
+    t->slots = (uint32_t *)(mem + slots_off);
+    t->pool = (char *)(mem + pool_off);
+
+    size_t pool_used = 0;
+    for (size_t i = 0; i < count; i++) {
+        const dns_rule_def_t *d = &defs[i];
+        if (!d->name) continue;
+
+        uint8_t kind = KIND_EXACT;
+        const char *name = d->name;
+        bool catch_all = strcmp(name, "*") == 0;
+        if (!catch_all && name[0] == '*' && name[1] == '.') {
+            kind = KIND_SUFFIX;
+            name += 2;
+        }
+
+        dns_rule_t *r = &t->rules[t->count];
+        char *dst = t->pool + pool_used;
+        size_t n = 0;
+        uint32_t h = 0;
+        if (catch_all) {
+            if (t->catch_all) continue;
+            t->catch_all = r;
+        } else {
+            n = normalise(name, dst);
+            if (n == 0) continue;
+            h = hash_reversed(dst, n);
+            if (probe(t, h, kind, dst, n)) continue;   /* first definition wins */
+
+            uint32_t s = h & t->mask;
+            while (t->slots[s]) s = (s + 1) & t->mask;
+            t->slots[s] = (uint32_t)t->count + 1;
+        }
+
+        r->user = d->user;
+        r->ttl = d->ttl;
+        r->hash = h;
+        r->name_off = (uint32_t)pool_used;
+        r->name_len = (uint8_t)n;
+        r->kind = kind;
+        if (d->ip_be) {
+            dns_answer_tmpl_init(&r->tmpl, d->ip_be, d->ttl);
+            r->ready = true;
+        }
+        pool_used += n;
+        t->count++;
+    }
+    return t;
+}
+
+void dns_rules_free(dns_rules_t *rules)
+{
+    free(rules);
+}
+
+size_t dns_rules_count(const dns_rules_t *rules)
+{
+    return rules ? rules->count : 0;
+}
+
+dns_rule_t *dns_rules_lookup(const dns_rules_t *rules, const char *name, size_t len)
+{
+    if (!rules) return NULL;
+
+    /* Right-to-left pass: probe each proper suffix as its hash completes;
+     * a later (longer) match replaces an earlier one. No per-label arrays,
+     * so the pass costs no stack however many labels the name has. */
+    dns_rule_t *best = NULL;
+    uint32_t h = FNV_OFFSET;
+    size_t end = len;
+    while (end > 0) {
+        size_t start = end;
+        while (start > 0 && name[start - 1] != '.') start--;
+        h = fnv_label(h, name + start, end - start);
+        if (start == 0) break;
+        dns_rule_t *r = probe(rules, h, KIND_SUFFIX, name + start, len - start);
+        if (r) best = r;
+        end = start - 1;
+    }
+
+    if (len > 0) {
+        dns_rule_t *r = probe(rules, h, KIND_EXACT, name, len);
+        if (r) return r;
+    }
+    if (best) return best;
+    return rules->catch_all;
+}
@@ -0,0 +1,62 @@
+/*
+ * Hash-indexed DNS rule table for the captive-portal responder.
+ *
+ * Rules are exact names ("portal.local"), wildcard suffixes
+ * ("*.example.com", matching any name strictly below example.com) or the
+ * catch-all "*". The most specific rule wins: exact, then the longest
+ * matching suffix, then "*". Names are case-insensitive.
+ *
+ * Keys are FNV-1a hashes over the labels in reverse order (com, example,
+ * www ...), so one right-to-left pass over a query yields the hash of
+ * every suffix; a lookup costs one probe per label, whatever the number
+ * of rules. Tables are immutable once built (apart from lazily resolved
+ * answers, see dns_rule_t.ready), which is what makes swapping a whole
+ * table under a running server cheap.
+ *
+ * Pure C, no ESP-IDF dependencies (host tests in test-firmware/host_test/).
+ */
+
+#pragma once
+
+#include "dns_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DNS_RULES_MAX   4096
+
+typedef struct {
+    const char *name;       /* "host.example", "*.example" or "*" */
+    uint32_t ip_be;         /* IPv4, network order; 0 = resolve on first use */
+    uint32_t ttl;           /* answer TTL in seconds */
+    const void *user;       /* opaque to the table (e.g. netif key) */
+} dns_rule_def_t;
+
+typedef struct {
+    dns_answer_tmpl_t tmpl; /* valid when ready */
+    const void *user;
+    uint32_t ttl;
+    uint32_t hash;
+    uint32_t name_off;      /* into the table's name pool */
+    uint8_t name_len;
+    uint8_t kind;
+    bool ready;
+} dns_rule_t;
+
+typedef struct dns_rules dns_rules_t;
+
+/* Build a table from *count* definitions. Invalid names are skipped,
+ * duplicates keep the first definition. Returns NULL on allocation failure
+ * or if *count* exceeds DNS_RULES_MAX. Free with dns_rules_free(). */
+dns_rules_t *dns_rules_build(const dns_rule_def_t *defs, size_t count);
+void         dns_rules_free(dns_rules_t *rules);
+size_t       dns_rules_count(const dns_rules_t *rules);
+
+/* Most specific rule covering *name* (lower-case, dotted, no trailing dot,
+ * as produced by dns_build_reply), or NULL. */
+dns_rule_t  *dns_rules_lookup(const dns_rules_t *rules, const char *name, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
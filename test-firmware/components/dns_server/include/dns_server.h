@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <stdint.h>
+#include "esp_err.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -22,17 +25,21 @@ extern "C" {
 /**
  * @brief Definition of one DNS entry: NAME - IP (or the netif whose IP to answer)
  *
- * @note Please use string literals (or ensure they are valid during dns_server lifetime) as names, since
- * we don't take copies of the config values `name` and `if_key`
+ * `name` is an exact name ("portal.local"), a wildcard suffix ("*.example.com", matching any name
+ * below example.com) or "*" for everything. The most specific matching entry answers.
+ *
+ * @note Names are copied when the rules are installed; `if_key` is not, so use a string literal
+ * (or ensure it stays valid during dns_server lifetime)
  */
 typedef struct dns_entry_pair {
-    const char* name;       /**<! Exact match of the name field of the DNS query to answer */
+    const char* name;       /**<! Name, "*.suffix" wildcard or "*" */
     const char* if_key;     /**<! Use this network interface IP to answer, only if NULL, use the static IP below */
     esp_ip4_addr_t ip;      /**<! Constant IP address to answer this query, if "if_key==NULL" */
+    uint32_t ttl;           /**<! Answer TTL in seconds, 0 for the default (300) */
 } dns_entry_pair_t;
 
 /**
- * @brief DNS server config struct defining the rules for answering DNS (A type) queries
+ * @brief DNS server config struct defining the initial rules for answering DNS (A type) queries
  *
  * @note If you want to define more rules, you can set `DNS_SERVER_MAX_ITEMS` before including this header
  * Example of using 2 entries with constant IP addresses
@@ -72,6 +79,20 @@ dns_server_handle_t start_dns_server(dns_server_config_t *config);
  */
 void stop_dns_server(dns_server_handle_t handle);
 
+/**
+ * @brief Replace the rule table of a running server
+ *
+ * The new table is built (and hashed) before the server is touched, then swapped in between two
+ * bursts of queries, so no query ever sees a half-updated table. The number of entries is only
+ * limited by memory (at most DNS_RULES_MAX), not by DNS_SERVER_MAX_ITEMS.
+ *
+ * @param handle DNS server's handle
+ * @param entries Array of rules
+ * @param num_of_entries Number of rules in the array
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM (the old table stays active on failure)
+ */
+esp_err_t dns_server_set_rules(dns_server_handle_t handle, const dns_entry_pair_t *entries, int num_of_entries);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,118 @@
+/* Throughput of the captive DNS reply path (components/dns_server/dns_proto.c).
+ * Replays the query mix a phone sends right after joining the AP, or the
+ * packets of a corpus directory (corpus/dns, see gen_dns_corpus.py).
+ *
+ *   ./bench_dns_proto [iterations] [corpus_dir]
+ */
+
+#include "dns_proto.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static dns_answer_tmpl_t s_tmpl;
+
+static const dns_answer_tmpl_t *lookup_wildcard(void *ctx, const char *name, size_t len)
+{
+    (void)ctx; (void)name; (void)len;
+    return &s_tmpl;
+}
+
+static size_t make_query(uint8_t *buf, uint16_t id, const char *name, uint16_t type)
+{
+    uint8_t *p = buf;
+    *p++ = id >> 8; *p++ = id & 0xFF;
+    *p++ = 0x01; *p++ = 0x00;
+    *p++ = 0; *p++ = 1;
+    memset(p, 0, 6); p += 6;
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        size_t l = dot ? (size_t)(dot - name) : strlen(name);
+        *p++ = (uint8_t)l;
+        memcpy(p, name, l); p += l;
+        name += l + (dot ? 1 : 0);
+    }
+    *p++ = 0;
+    *p++ = type >> 8; *p++ = type & 0xFF;
+    *p++ = 0; *p++ = 1;
+    return (size_t)(p - buf);
+}
+
+/* Loads every file of *dir* as one query; returns the count. */
+static int load_corpus(const char *dir, uint8_t (*q)[DNS_UDP_MAX_LEN], size_t *ql, int max)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        exit(EXIT_FAILURE);
+    }
+    int n = 0;
+    struct dirent *e;
+    while (n < max && (e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        FILE *f = fopen(path, "rb");
+        if (!f) continue;
+        ql[n] = fread(q[n], 1, DNS_UDP_MAX_LEN, f);
+        fclose(f);
+        n++;
+    }
+    closedir(d);
+    return n;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct { const char *name; uint16_t type; } burst[] = {
+        { "connectivitycheck.gstatic.com", DNS_TYPE_A },
+        { "connectivitycheck.gstatic.com", DNS_TYPE_AAAA },
+        { "www.google.com", DNS_TYPE_A },
+        { "www.google.com", DNS_TYPE_HTTPS },
+        { "captive.apple.com", DNS_TYPE_A },
+        { "captive.apple.com", DNS_TYPE_HTTPS },
+        { "www.msftconnecttest.com", DNS_TYPE_A },
+        { "ipv6.msftconnecttest.com", DNS_TYPE_AAAA },
+        { "mtalk.google.com", DNS_TYPE_A },
+        { "time.android.com", DNS_TYPE_A },
+    };
+    enum { BURST = sizeof(burst) / sizeof(burst[0]), MAX_QUERIES = 256 };
+
+    long iters = argc > 1 ? atol(argv[1]) : 2000000;
+    static uint8_t q[MAX_QUERIES][DNS_UDP_MAX_LEN];
+    size_t ql[MAX_QUERIES];
+    uint8_t r[DNS_UDP_MAX_LEN];
+    int N = BURST;
+
+    dns_answer_tmpl_init(&s_tmpl, 0x0104A8C0u, 300);
+    if (argc > 2) {
+        N = load_corpus(argv[2], q, ql, MAX_QUERIES);
+        if (N == 0) {
+            fprintf(stderr, "%s: no queries\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    } else {
+        for (int i = 0; i < N; i++) ql[i] = make_query(q[i], (uint16_t)i, burst[i].name, burst[i].type);
+    }
+
+    size_t bytes = 0;
+    double t0 = now_s();
+    for (long i = 0; i < iters; i++) {
+        int k = (int)(i % N);
+        bytes += dns_build_reply(q[k], ql[k], r, sizeof(r), lookup_wildcard, NULL);
+    }
+    double dt = now_s() - t0;
+
+    printf("dns_build_reply (%d distinct): %ld queries in %.3f s -> %.0f queries/s, %.1f ns/query (%zu reply bytes)\n",
+           N, iters, dt, iters / dt, dt * 1e9 / iters, bytes);
+    return 0;
+}
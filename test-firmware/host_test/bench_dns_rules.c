@@ -0,0 +1,91 @@
+/* Rule lookup cost with 1000 rules (components/dns_server/dns_rules.c),
+ * against the linear strcmp scan the server used before.
+ *
+ *   ./bench_dns_rules [iterations]
+ */
+
+#include "dns_rules.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+enum { N_RULES = 1000, N_QUERIES = 64 };
+
+static char s_names[N_RULES][40];
+static dns_rule_def_t s_defs[N_RULES];
+static char s_queries[N_QUERIES][64];
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Old behaviour plus suffix support: first matching rule in list order */
+static const dns_rule_def_t *linear_lookup(const char *name, size_t len)
+{
+    for (int i = 0; i < N_RULES; i++) {
+        const char *rn = s_defs[i].name;
+        if (rn[0] == '*' && rn[1] == '.') {
+            size_t sl = strlen(rn + 2);
+            if (len > sl && name[len - sl - 1] == '.' &&
+                strcasecmp(name + len - sl, rn + 2) == 0) return &s_defs[i];
+        } else if (strcasecmp(rn, name) == 0) {
+            return &s_defs[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    long iters = argc > 1 ? atol(argv[1]) : 2000000;
+
+    for (int i = 0; i < N_RULES; i++) {
+        snprintf(s_names[i], sizeof(s_names[i]),
+                 i % 4 == 0 ? "*.cdn%d.example.net" : "api%d.service.example.com", i);
+        s_defs[i] = (dns_rule_def_t){ .name = s_names[i], .ip_be = 0x0104A8C0u, .ttl = 60 };
+    }
+    /* Hits spread over the table, a quarter of them wildcard, plus misses */
+    for (int i = 0; i < N_QUERIES; i++) {
+        int r = (i * 997) % N_RULES;
+        if (i % 8 == 7) snprintf(s_queries[i], sizeof(s_queries[i]), "unknown%d.example.org", i);
+        else if (r % 4 == 0) snprintf(s_queries[i], sizeof(s_queries[i]), "img.static.cdn%d.example.net", r);
+        else snprintf(s_queries[i], sizeof(s_queries[i]), "api%d.service.example.com", r);
+    }
+    size_t qlen[N_QUERIES];
+    for (int i = 0; i < N_QUERIES; i++) qlen[i] = strlen(s_queries[i]);
+
+    double t0 = now_s();
+    dns_rules_t *t = dns_rules_build(s_defs, N_RULES);
+    double build = now_s() - t0;
+    if (!t) return 1;
+
+    long hits = 0;
+    t0 = now_s();
+    for (long i = 0; i < iters; i++) {
+        int k = (int)(i % N_QUERIES);
+        hits += dns_rules_lookup(t, s_queries[k], qlen[k]) != NULL;
+    }
+    double dt_hash = now_s() - t0;
+
+    long lin_iters = iters / 100 ? iters / 100 : 1;
+    long lin_hits = 0;
+    t0 = now_s();
+    for (long i = 0; i < lin_iters; i++) {
+        int k = (int)(i % N_QUERIES);
+        lin_hits += linear_lookup(s_queries[k], qlen[k]) != NULL;
+    }
+    double dt_lin = now_s() - t0;
+
+    printf("dns_rules: %d rules built in %.1f us\n", N_RULES, build * 1e6);
+    printf("  hashed: %.1f ns/lookup, %.0f lookups/s (hit rate %.2f)\n",
+           dt_hash * 1e9 / iters, iters / dt_hash, (double)hits / iters);
+    printf("  linear: %.1f ns/lookup, %.0f lookups/s (hit rate %.2f)\n",
+           dt_lin * 1e9 / lin_iters, lin_iters / dt_lin, (double)lin_hits / lin_iters);
+    dns_rules_free(t);
+    return 0;
+}
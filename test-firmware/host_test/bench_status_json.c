@@ -0,0 +1,65 @@
+/* Render cost of the GET /status body (main/status_json.c) with a full
+ * boot record ring, i.e. the work done whenever the cached body is stale.
+ *
+ *   ./bench_status_json [iterations]
+ */
+
+#include "status_json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(const char *label, const status_info_t *s, long iters)
+{
+    static char buf[4096];
+    size_t len = 0;
+
+    double t0 = now_s();
+    for (long i = 0; i < iters; i++) {
+        len = status_json_render(s, buf, sizeof(buf));
+    }
+    double dt = now_s() - t0;
+
+    printf("  %-10s %4zu B: %7.1f ns/render, %6.1f MB/s\n",
+           label, len, dt * 1e9 / iters, len * iters / dt / 1e6);
+    return dt;
+}
+
+int main(int argc, char **argv)
+{
+    long iters = argc > 1 ? atol(argv[1]) : 1000000;
+
+    static const char *const names[] = { "wifi_ssid", "wifi_pass", "boot_count", "boot_recs" };
+    static const uint32_t writes[] = { 3, 3, 41, 12 };
+    status_boot_t boots[8];
+    for (int i = 0; i < 8; i++) {
+        boots[i] = (status_boot_t){
+            .boot = 41 - i, .version = "0.1.0", .reset = i % 3 ? "sw" : "panic",
+            .after_crash = i % 3 == 0, .uptime_s = 86400u * i + 17,
+            .heap_min_free = 181234 - i, .heap_peak_used = 93210 + i,
+            .stack_min = 388 + i, .stack_task = "httpd", .reconnects = i * 7u,
+            .udp_drops = i,
+        };
+    }
+    status_info_t s = {
+        .project = "wb-test", .version = "0.1.0", .boot_count = 41,
+        .wifi_connected = true, .ble_connected = true,
+        .reconnect = { .disconnects = 12, .attempts = 57, .fast_attempts = 12,
+                       .rescans = 3, .last_outage_ms = 1432, .longest_outage_ms = 61230 },
+        .nvs_commits = 59, .nvs_skipped = 211, .nvs_key_names = names,
+        .nvs_writes = writes, .nvs_keys = 4, .boots = boots, .boots_n = 1,
+    };
+
+    printf("status_json:\n");
+    run("1 boot", &s, iters);
+    s.boots_n = 8;
+    run("8 boots", &s, iters);
+    return 0;
+}
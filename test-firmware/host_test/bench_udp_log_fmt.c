@@ -0,0 +1,66 @@
+/* Cost of formatting one log line for the UDP queue (main/udp_log_fmt.c),
+ * paid on every ESP_LOGx call while UDP logging is on.
+ *
+ *   ./bench_udp_log_fmt [iterations]
+ */
+
+#include "udp_log_fmt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char s_buf[256];
+
+/* Stands in for the esp_log vprintf hook */
+static size_t log_line(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    size_t len = udp_log_format(s_buf, sizeof(s_buf), fmt, args);
+    va_end(args);
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    long iters = argc > 1 ? atol(argv[1]) : 2000000;
+    size_t bytes = 0;
+
+    printf("udp_log_fmt:\n");
+
+    double t0 = now_s();
+    for (long i = 0; i < iters; i++) {
+        bytes += log_line("I (%lu) %s: heartbeat %ld\n", 1000UL + i, "app_main", i);
+    }
+    double dt = now_s() - t0;
+    printf("  %-10s %7.1f ns/line, %6.1f MB/s\n", "heartbeat", dt * 1e9 / iters, bytes / dt / 1e6);
+
+    bytes = 0;
+    t0 = now_s();
+    for (long i = 0; i < iters; i++) {
+        bytes += log_line("I (%lu) %s: BOOTREC {\"boot\":%lu,\"version\":\"%s\",\"reset\":\"%s\","
+                          "\"uptime_s\":%lu,\"heap_min_free\":%lu}\n",
+                          1000UL + i, "boot_record", 41UL, "0.1.0", "panic", 86417UL, 181234UL);
+    }
+    dt = now_s() - t0;
+    printf("  %-10s %7.1f ns/line, %6.1f MB/s\n", "bootrec", dt * 1e9 / iters, bytes / dt / 1e6);
+
+    bytes = 0;
+    t0 = now_s();
+    for (long i = 0; i < iters; i++) {
+        bytes += log_line("%s", "W (5123) wifi_prov: this line is longer than the 256 byte UDP "
+                          "limit and gets clamped ........................................"
+                          "................................................................"
+                          "................................................................");
+    }
+    dt = now_s() - t0;
+    printf("  %-10s %7.1f ns/line, %6.1f MB/s\n", "clamped", dt * 1e9 / iters, bytes / dt / 1e6);
+    return 0;
+}
@@ -0,0 +1,28 @@
+/* Minimal assertion helpers shared by the host tests. A failed CHECK is
+ * reported and counted, the test carries on; main() ends with
+ * return check_result("name"). */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int s_failed;
+
+#define CHECK(cond) do {                                                  \
+        if (!(cond)) {                                                    \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n",                  \
+                    __FILE__, __LINE__, #cond);                           \
+            s_failed++;                                                   \
+        }                                                                 \
+    } while (0)
+
+static inline int check_result(const char *name)
+{
+    if (s_failed) {
+        fprintf(stderr, "%d check(s) failed\n", s_failed);
+        return EXIT_FAILURE;
+    }
+    printf("%s: all tests passed\n", name);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/* Stand-in for libFuzzer's main() where only gcc is available. Runs
+ * LLVMFuzzerTestOneInput() over every corpus file (files or directories;
+ * stdin if none, for AFL), then -runs=N seeded mutations of random corpus
+ * entries. Accepts the libFuzzer flags it understands (-runs, -seed,
+ * -max_len) and ignores the rest, so the same command line works with a
+ * clang -fsanitize=fuzzer build. The input being run when a check aborts
+ * or ASan reports is written to ./crash-input.
+ */
+
+#include <dirent.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define MAX_INPUTS  4096
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} input_t;
+
+static input_t s_inputs[MAX_INPUTS];
+static int s_count;
+static size_t s_max_len = 4096;
+
+static const uint8_t *s_cur;
+static size_t s_cur_len;
+
+static void save_crash(void)
+{
+    FILE *f = fopen("crash-input", "wb");
+    if (f) {
+        fwrite(s_cur, 1, s_cur_len, f);
+        fclose(f);
+        fprintf(stderr, "fuzz_driver: failing input (%zu bytes) written to crash-input\n", s_cur_len);
+    }
+}
+
+static void on_signal(int sig)
+{
+    save_crash();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void run_one(const uint8_t *data, size_t len)
+{
+    s_cur = data;
+    s_cur_len = len;
+    LLVMFuzzerTestOneInput(data, len);
+}
+
+static void add_input(const uint8_t *data, size_t len)
+{
+    if (s_count == MAX_INPUTS) return;
+    if (len > s_max_len) len = s_max_len;
+    input_t *in = &s_inputs[s_count++];
+    in->data = malloc(len ? len : 1);
+    memcpy(in->data, data, len);
+    in->len = len;
+}
+
+static void load_file(FILE *f)
+{
+    uint8_t buf[65536];
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    add_input(buf, len);
+}
+
+static void load_path(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return;           /* libFuzzer's output dir may not exist yet */
+    if (S_ISDIR(st.st_mode)) {
+        DIR *d = opendir(path);
+        if (!d) return;
+        struct dirent *e;
+        while ((e = readdir(d))) {
+            if (e->d_name[0] == '.') continue;
+            char sub[4096];
+            snprintf(sub, sizeof(sub), "%s/%s", path, e->d_name);
+            load_path(sub);
+        }
+        closedir(d);
+        return;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    load_file(f);
+    fclose(f);
+}
+
+static uint32_t s_rng = 1;
+
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/* A few libFuzzer-style mutations: bit flips, random and "interesting"
+ * bytes and 16-bit fields, truncation, insertion, deletion, splicing. */
+static size_t mutate(uint8_t *buf, size_t len, size_t max)
+{
+    static const uint8_t interesting[] = { 0x00, 0x01, 0x3F, 0x40, 0x7F, 0x80, 0xC0, 0xFF };
+    int muts = 1 + rnd() % 4;
+    for (int m = 0; m < muts; m++) {
+        switch (rnd() % 8) {
+        case 0: if (len) buf[rnd() % len] ^= (uint8_t)(1u << (rnd() % 8)); break;
+        case 1: if (len) buf[rnd() % len] = (uint8_t)rnd(); break;
+        case 2: if (len) buf[rnd() % len] = interesting[rnd() % sizeof(interesting)]; break;
+        case 3:
+            if (len >= 2) {
+                size_t at = rnd() % (len - 1);
+                uint16_t v = (rnd() & 1) ? (uint16_t)rnd() % 8 : (uint16_t)(0xFFFF - rnd() % 8);
+                buf[at] = (uint8_t)(v >> 8);
+                buf[at + 1] = (uint8_t)v;
+            }
+            break;
+        case 4: len = rnd() % (len + 1); break;
+        case 5:
+            if (len < max) {
+                size_t at = rnd() % (len + 1);
+                memmove(buf + at + 1, buf + at, len - at);
+                buf[at] = (uint8_t)rnd();
+                len++;
+            }
+            break;
+        case 6:
+            if (len) {
+                size_t at = rnd() % len;
+                memmove(buf + at, buf + at + 1, len - at - 1);
+                len--;
+            }
+            break;
+        case 7:
+            if (s_count) {
+                const input_t *o = &s_inputs[rnd() % s_count];
+                size_t at = len ? rnd() % len : 0;
+                size_t from = o->len ? rnd() % o->len : 0;
+                size_t n = o->len - from;
+                if (at + n > max) n = max - at;
+                memcpy(buf + at, o->data + from, n);
+                if (at + n > len) len = at + n;
+            }
+            break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    long runs = 0;
+    uint32_t seed = 1;
+    int paths = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) runs = atol(argv[i] + 6);
+        else if (strncmp(argv[i], "-seed=", 6) == 0) seed = (uint32_t)strtoul(argv[i] + 6, NULL, 10);
+        else if (strncmp(argv[i], "-max_len=", 9) == 0) s_max_len = (size_t)atol(argv[i] + 9);
+        /* other libFuzzer flags are ignored */
+    }
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue;
+        load_path(argv[i]);
+        paths++;
+    }
+    if (!paths) load_file(stdin);
+    s_rng = seed ? seed : 1;
+
+    signal(SIGABRT, on_signal);
+    signal(SIGSEGV, on_signal);
+#if defined(__SANITIZE_ADDRESS__)
+    __sanitizer_set_death_callback(save_crash);
+#endif
+
+    for (int i = 0; i < s_count; i++) run_one(s_inputs[i].data, s_inputs[i].len);
+
+    uint8_t *buf = malloc(s_max_len + 1);
+    for (long i = 0; i < runs && s_count; i++) {
+        const input_t *in = &s_inputs[rnd() % s_count];
+        memcpy(buf, in->data, in->len);
+        size_t len = mutate(buf, in->len, s_max_len);
+        run_one(buf, len);
+    }
+    free(buf);
+
+    printf("fuzz_driver: %d corpus input(s), %ld mutation(s), seed %u: no failures\n",
+           s_count, runs, (unsigned)seed);
+    return 0;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Write the seed corpus for fuzz_dns_proto and bench_dns_proto.
+
+One file per query packet: what iOS, Android, Windows and Linux clients
+send while checking for a captive portal right after joining the AP,
+rebuilt with each stack's header flags and EDNS0 options, plus edge
+cases the parser must reject or answer specially. Query IDs are fixed
+so the output is reproducible.
+
+Usage: gen_dns_corpus.py [out_dir]     (default: corpus/dns next to this file)
+"""
+
+import os
+import struct
+import sys
+
+A, AAAA, HTTPS, ANY = 1, 28, 65, 255
+OPT = 41
+
+
+def qname(name):
+    out = b""
+    for label in name.split(".") if name else []:
+        out += bytes([len(label)]) + label.encode()
+    return out + b"\0"
+
+
+def query(qid, questions, flags=0x0100, edns=None, qd=None):
+    """questions: [(name, type)], edns: (udp_size, options bytes) or None."""
+    body = b"".join(qname(n) + struct.pack(">HH", t, 1) for n, t in questions)
+    ar = 0
+    if edns is not None:
+        size, opts = edns
+        body += b"\0" + struct.pack(">HHIH", OPT, size, 0, len(opts)) + opts
+        ar = 1
+    qd = len(questions) if qd is None else qd
+    return struct.pack(">HHHHHH", qid, flags, qd, 0, 0, ar) + body
+
+
+def cookie():
+    # EDNS client cookie option (code 10, 8 bytes)
+    return struct.pack(">HH", 10, 8) + bytes(range(0x10, 0x18))
+
+
+CORPUS = {
+    # iOS / macOS mDNSResponder: A, AAAA and HTTPS in parallel, no EDNS
+    "ios_captive_a": query(0x1a2b, [("captive.apple.com", A)]),
+    "ios_captive_aaaa": query(0x1a2c, [("captive.apple.com", AAAA)]),
+    "ios_captive_https": query(0x1a2d, [("captive.apple.com", HTTPS)]),
+    "ios_www_apple_a": query(0x1a2e, [("www.apple.com", A)]),
+    "ios_private_relay_https": query(0x1a2f, [("mask.icloud.com", HTTPS)]),
+    # Android DnsResolver: EDNS0 OPT, 1232 byte UDP size
+    "android_gstatic_a": query(0x4c01, [("connectivitycheck.gstatic.com", A)], edns=(1232, b"")),
+    "android_gstatic_aaaa": query(0x4c02, [("connectivitycheck.gstatic.com", AAAA)], edns=(1232, b"")),
+    "android_www_google_a": query(0x4c03, [("www.google.com", A)], edns=(1232, b"")),
+    "android_www_google_https": query(0x4c04, [("www.google.com", HTTPS)], edns=(1232, b"")),
+    "android_dns_google_a": query(0x4c05, [("dns.google", A)], edns=(1232, b"")),
+    # Windows NCSI
+    "windows_msftconnecttest_a": query(0x7e10, [("www.msftconnecttest.com", A)]),
+    "windows_ipv6_msftconnecttest_aaaa": query(0x7e11, [("ipv6.msftconnecttest.com", AAAA)]),
+    "windows_msftncsi_a": query(0x7e12, [("dns.msftncsi.com", A)]),
+    # Linux: systemd-resolved (EDNS0 + cookie), NetworkManager check
+    "linux_nmcheck_a": query(0x2f01, [("nmcheck.gnome.org", A)], edns=(1200, cookie())),
+    "linux_portal_local_any": query(0x2f02, [("portal.local", ANY)], edns=(512, b"")),
+    # Edge cases
+    "edge_two_questions": query(0x0001, [("captive.apple.com", A), ("www.google.com", AAAA)]),
+    "edge_four_questions": query(0x0002, [("a.apple.com", A), ("b", A), ("", A), ("c.apple.com", HTTPS)]),
+    "edge_qd_over_limit": query(0x0003, [("a", A)] * 5),
+    "edge_qd_lies": query(0x0004, [("captive.apple.com", A)], qd=3),
+    "edge_qd_zero": query(0x0005, [], qd=0),
+    "edge_mixed_case": query(0x0006, [("CaPtIvE.ApPlE.cOm", A)]),
+    "edge_root_a": query(0x0007, [("", A)]),
+    "edge_max_name": query(0x0008, [(".".join(["x" * 63] * 3 + ["y" * 61]), A)]),
+    "edge_label_64": query(0x0009, [("z" * 64 + ".com", A)]),
+    "edge_response_bit": query(0x000a, [("captive.apple.com", A)], flags=0x8180),
+    "edge_opcode_status": query(0x000b, [("captive.apple.com", A)], flags=0x1100),
+    "edge_header_only": struct.pack(">HHHHHH", 0x000c, 0x0100, 1, 0, 0, 0),
+    "edge_truncated_name": query(0x000d, [("captive.apple.com", A)])[:20],
+    "edge_compressed_qname": struct.pack(">HHHHHH", 0x000e, 0x0100, 1, 0, 0, 0)
+                             + b"\xc0\x0c" + struct.pack(">HH", A, 1),
+    "edge_class_chaos": query(0x000f, [("version.bind", 16)])[:-2] + struct.pack(">H", 3),
+}
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    out = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "corpus", "dns")
+    os.makedirs(out, exist_ok=True)
+    for name, pkt in sorted(CORPUS.items()):
+        with open(os.path.join(out, name + ".bin"), "wb") as f:
+            f.write(pkt)
+    print(f"{len(CORPUS)} queries -> {out}")
+
+
+if __name__ == "__main__":
+    main()
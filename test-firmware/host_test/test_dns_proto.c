@@ -0,0 +1,294 @@
+/* Host tests for the captive DNS wire handling (components/dns_server/dns_proto.c).
+ * Ends with a seeded mutation fuzz loop that checks memory safety and the
+ * structural invariants of every reply. */
+
+#include "dns_proto.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IP_192_168_4_1  0x0104A8C0u     /* network byte order on little-endian */
+
+static dns_answer_tmpl_t s_tmpl;
+static char s_last_name[DNS_NAME_MAX_LEN];
+
+/* Answers "*" except for names under "blocked." */
+static const dns_answer_tmpl_t *lookup_all(void *ctx, const char *name, size_t len)
+{
+    (void)ctx;
+    memcpy(s_last_name, name, len + 1);
+    if (strncmp(name, "blocked", 7) == 0) return NULL;
+    return &s_tmpl;
+}
+
+static const dns_answer_tmpl_t *lookup_none(void *ctx, const char *name, size_t len)
+{
+    (void)ctx; (void)name; (void)len;
+    return NULL;
+}
+
+/* Build a query for *name* (dotted) with the given type; returns length. */
+static size_t make_query(uint8_t *buf, uint16_t id, const char *name, uint16_t type)
+{
+    uint8_t *p = buf;
+    *p++ = id >> 8; *p++ = id & 0xFF;
+    *p++ = 0x01; *p++ = 0x00;               /* RD */
+    *p++ = 0; *p++ = 1;                     /* qd */
+    memset(p, 0, 6); p += 6;
+    while (*name) {
+        const char *dot = strchr(name, '.');
+        size_t l = dot ? (size_t)(dot - name) : strlen(name);
+        *p++ = (uint8_t)l;
+        memcpy(p, name, l); p += l;
+        name += l + (dot ? 1 : 0);
+    }
+    *p++ = 0;
+    *p++ = type >> 8; *p++ = type & 0xFF;
+    *p++ = 0; *p++ = DNS_CLASS_IN;
+    return (size_t)(p - buf);
+}
+
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+static void test_a_answer(void)
+{
+    uint8_t q[512], r[512];
+    size_t ql = make_query(q, 0xBEEF, "Connectivitycheck.GStatic.com", DNS_TYPE_A);
+    size_t rl = dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL);
+
+    CHECK(rl == ql + DNS_A_RR_LEN);
+    CHECK(rd16(r) == 0xBEEF);
+    CHECK((rd16(r + 2) & 0x8000) != 0);         /* QR */
+    CHECK((rd16(r + 2) & 0x0100) != 0);         /* RD echoed */
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_NOERROR);
+    CHECK(rd16(r + 4) == 1 && rd16(r + 6) == 1);
+    CHECK(rd16(r + 8) == 0 && rd16(r + 10) == 0);
+    CHECK(strcmp(s_last_name, "connectivitycheck.gstatic.com") == 0);
+    CHECK(rd16(r + ql) == 0xC00C);
+    CHECK(rd16(r + ql + 2) == DNS_TYPE_A);
+    CHECK(memcmp(r + ql + 12, "\xC0\xA8\x04\x01", 4) == 0);
+}
+
+static void test_aaaa_https_nodata(void)
+{
+    static const uint16_t types[] = { DNS_TYPE_AAAA, DNS_TYPE_HTTPS, DNS_TYPE_SVCB, 16 };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        uint8_t q[512], r[512];
+        size_t ql = make_query(q, 1, "captive.apple.com", types[i]);
+        size_t rl = dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL);
+        CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_NOERROR);
+        CHECK(rd16(r + 6) == 0);                /* no answers */
+        CHECK(rd16(r + 8) == 1);                /* SOA for negative caching */
+        CHECK(rl > ql);
+        CHECK(rd16(r + ql + 2) == DNS_TYPE_SOA);
+    }
+}
+
+static void test_nxdomain(void)
+{
+    uint8_t q[512], r[512];
+    size_t ql = make_query(q, 2, "blocked.example", DNS_TYPE_A);
+    dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_NXDOMAIN);
+    CHECK(rd16(r + 6) == 0);
+
+    ql = make_query(q, 3, "anything.test", DNS_TYPE_AAAA);
+    dns_build_reply(q, ql, r, sizeof(r), lookup_none, NULL);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_NXDOMAIN);
+}
+
+static void test_multi_question_counts(void)
+{
+    /* Two questions, only one answerable: an_count must be 1, not qd_count */
+    uint8_t q[512], r[512];
+    size_t l1 = make_query(q, 4, "a.test", DNS_TYPE_A);
+    uint8_t tmp[512];
+    size_t l2 = make_query(tmp, 4, "a.test", DNS_TYPE_AAAA);
+    memcpy(q + l1, tmp + DNS_HEADER_LEN, l2 - DNS_HEADER_LEN);
+    q[5] = 2;
+    size_t ql = l1 + l2 - DNS_HEADER_LEN;
+
+    size_t rl = dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL);
+    CHECK(rd16(r + 4) == 2);
+    CHECK(rd16(r + 6) == 1);
+    CHECK(rl == ql + DNS_A_RR_LEN);
+}
+
+static void test_edns_dropped(void)
+{
+    /* Query with an EDNS OPT record appended: it must not be echoed and
+     * ar_count must be zero */
+    uint8_t q[512], r[512];
+    size_t ql = make_query(q, 5, "example.com", DNS_TYPE_A);
+    static const uint8_t opt[] = { 0, 0, 41, 0x10, 0, 0, 0, 0, 0, 0, 0 };
+    memcpy(q + ql, opt, sizeof(opt));
+    q[11] = 1;
+    size_t rl = dns_build_reply(q, ql + sizeof(opt), r, sizeof(r), lookup_all, NULL);
+    CHECK(rl == ql + DNS_A_RR_LEN);
+    CHECK(rd16(r + 10) == 0);
+    CHECK(rd16(r + ql) == 0xC00C);
+}
+
+static void test_rejects(void)
+{
+    uint8_t q[512], r[512];
+    size_t ql = make_query(q, 6, "x.test", DNS_TYPE_A);
+
+    CHECK(dns_build_reply(q, 11, r, sizeof(r), lookup_all, NULL) == 0);
+
+    q[2] |= 0x80;                               /* a response */
+    CHECK(dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL) == 0);
+    q[2] &= 0x7F;
+
+    q[2] |= 0x10;                               /* opcode 2 (STATUS) */
+    CHECK(dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL) == DNS_HEADER_LEN);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_NOTIMP);
+    q[2] &= ~0x10;
+
+    /* truncated question */
+    CHECK(dns_build_reply(q, ql - 2, r, sizeof(r), lookup_all, NULL) == DNS_HEADER_LEN);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_FORMERR);
+
+    /* '.' or NUL inside a label would alias "x.test" / end the name early */
+    static const uint8_t bad_bytes[] = { '.', 0 };
+    for (size_t i = 0; i < sizeof(bad_bytes); i++) {
+        ql = make_query(q, 7, "xy.test", DNS_TYPE_A);
+        q[13] = bad_bytes[i];
+        CHECK(dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL) == DNS_HEADER_LEN);
+        CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_FORMERR);
+    }
+
+    /* a 46-byte label's length byte reads as '.': still a valid name ... */
+    char name46[64];
+    memset(name46, 'a', 46);
+    strcpy(name46 + 46, ".test");
+    ql = make_query(q, 7, name46, DNS_TYPE_A);
+    CHECK(dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL) == ql + DNS_A_RR_LEN);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_NOERROR);
+    q[DNS_HEADER_LEN + 1 + 46 + 2] = '.';       /* ... unless a later label holds one */
+    CHECK(dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL) == DNS_HEADER_LEN);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_FORMERR);
+
+    /* compression pointer in question */
+    q[12] = 0xC0;
+    CHECK(dns_build_reply(q, ql, r, sizeof(r), lookup_all, NULL) == DNS_HEADER_LEN);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_FORMERR);
+}
+
+static void test_long_name(void)
+{
+    /* 4 x 63-byte labels = 255 wire bytes, dotted 255 chars: over the limit */
+    uint8_t q[512], r[512];
+    memset(q, 0, sizeof(q));
+    q[5] = 1;
+    size_t p = DNS_HEADER_LEN;
+    for (int i = 0; i < 4; i++) {
+        q[p++] = 63;
+        memset(q + p, 'a', 63);
+        p += 63;
+    }
+    q[p++] = 0;
+    q[p++] = 0; q[p++] = 1; q[p++] = 0; q[p++] = 1;
+    CHECK(dns_build_reply(q, p, r, sizeof(r), lookup_all, NULL) == DNS_HEADER_LEN);
+    CHECK((rd16(r + 2) & 0x000F) == DNS_RCODE_FORMERR);
+}
+
+static void test_small_reply_buffer(void)
+{
+    uint8_t q[512], r[512];
+    size_t ql = make_query(q, 7, "a.test", DNS_TYPE_A);
+    size_t rl = dns_build_reply(q, ql, r, ql + 4, lookup_all, NULL);
+    CHECK(rl == ql);
+    CHECK((rd16(r + 2) & 0x0200) != 0);         /* TC */
+    CHECK(rd16(r + 6) == 0);
+}
+
+/* ── Fuzz ──────────────────────────────────────────────────────── */
+
+static uint32_t s_rng = 0x2545F491;
+
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void check_reply_invariants(const uint8_t *q, size_t ql,
+                                   const uint8_t *r, size_t rl, size_t rmax)
+{
+    if (rl == 0) return;
+    CHECK(rl >= DNS_HEADER_LEN && rl <= rmax);
+    CHECK(memcmp(q, r, 2) == 0);
+    CHECK((r[2] & 0x80) != 0);
+    uint16_t an = rd16(r + 6), ns = rd16(r + 8);
+    CHECK(rd16(r + 10) == 0);
+    CHECK(ns <= 1);
+    if (rd16(r + 4) == 0) {
+        CHECK(rl == DNS_HEADER_LEN);
+    } else {
+        CHECK(an <= rd16(r + 4));
+        /* everything after the echoed questions is whole records */
+        size_t qend = rl - an * DNS_A_RR_LEN - ns * 34;
+        CHECK(qend <= ql);
+        CHECK(memcmp(q + DNS_HEADER_LEN, r + DNS_HEADER_LEN, qend - DNS_HEADER_LEN) == 0);
+    }
+}
+
+static void test_fuzz(void)
+{
+    static const char *const seeds[] = {
+        "www.google.com", "connectivitycheck.gstatic.com", "captive.apple.com",
+        "www.msftconnecttest.com", "blocked.example", "a", "",
+    };
+    uint8_t base[512], q[512], r[512];
+
+    for (int iter = 0; iter < 200000; iter++) {
+        const char *name = seeds[rnd() % (sizeof(seeds) / sizeof(seeds[0]))];
+        size_t ql = make_query(base, (uint16_t)rnd(), name, (uint16_t)(rnd() % 70));
+        memcpy(q, base, ql);
+
+        /* mutate: flip bytes, change length, splice garbage */
+        int muts = 1 + rnd() % 6;
+        for (int m = 0; m < muts && ql > 0; m++) {
+            switch (rnd() % 4) {
+            case 0: q[rnd() % ql] ^= (uint8_t)(1u << (rnd() % 8)); break;
+            case 1: q[rnd() % ql] = (uint8_t)rnd(); break;
+            case 2: ql = rnd() % (ql + 1); break;
+            case 3: {
+                size_t add = rnd() % 64;
+                if (ql + add > sizeof(q)) add = sizeof(q) - ql;
+                for (size_t i = 0; i < add; i++) q[ql + i] = (uint8_t)rnd();
+                ql += add;
+                break;
+            }
+            }
+        }
+        size_t rmax = (rnd() & 7) ? sizeof(r) : DNS_HEADER_LEN + rnd() % 64;
+        size_t rl = dns_build_reply(q, ql, r, rmax, lookup_all, NULL);
+        check_reply_invariants(q, ql, r, rl, rmax);
+        if (s_failed) {
+            fprintf(stderr, "fuzz iteration %d failed (len %zu)\n", iter, ql);
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    dns_answer_tmpl_init(&s_tmpl, IP_192_168_4_1, 300);
+
+    test_a_answer();
+    test_aaaa_https_nodata();
+    test_nxdomain();
+    test_multi_question_counts();
+    test_edns_dropped();
+    test_rejects();
+    test_long_name();
+    test_small_reply_buffer();
+    test_fuzz();
+
+    return check_result("dns_proto");
+}
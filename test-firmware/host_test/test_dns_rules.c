@@ -0,0 +1,148 @@
+/* Host tests for the DNS rule table (components/dns_server/dns_rules.c). */
+
+#include "dns_rules.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t ip_of(const dns_rules_t *t, const char *name)
+{
+    dns_rule_t *r = dns_rules_lookup(t, name, strlen(name));
+    if (!r || !r->ready) return 0;
+    uint32_t ip;
+    memcpy(&ip, r->tmpl.rr + 12, 4);
+    return ip;
+}
+
+static uint32_t ttl_of(const dns_rules_t *t, const char *name)
+{
+    dns_rule_t *r = dns_rules_lookup(t, name, strlen(name));
+    return r ? r->ttl : 0;
+}
+
+static void test_precedence(void)
+{
+    static const dns_rule_def_t defs[] = {
+        { .name = "*",                 .ip_be = 1, .ttl = 300 },
+        { .name = "*.example.com",     .ip_be = 2, .ttl = 60 },
+        { .name = "*.a.example.com",   .ip_be = 3, .ttl = 30 },
+        { .name = "www.example.com",   .ip_be = 4, .ttl = 10 },
+        { .name = "Portal.Local.",     .ip_be = 5, .ttl = 5 },
+    };
+    dns_rules_t *t = dns_rules_build(defs, 5);
+    CHECK(t && dns_rules_count(t) == 5);
+
+    CHECK(ip_of(t, "www.example.com") == 4);        /* exact beats wildcard */
+    CHECK(ip_of(t, "mail.example.com") == 2);
+    CHECK(ip_of(t, "x.y.example.com") == 2);
+    CHECK(ip_of(t, "b.a.example.com") == 3);        /* longest suffix wins */
+    CHECK(ip_of(t, "c.b.a.example.com") == 3);
+    CHECK(ip_of(t, "a.example.com") == 2);          /* *.a.x does not cover a.x */
+    CHECK(ip_of(t, "example.com") == 1);            /* nor does *.example.com */
+    CHECK(ip_of(t, "portal.local") == 5);           /* normalised on build */
+    CHECK(ip_of(t, "other.org") == 1);
+    CHECK(ip_of(t, "") == 1);
+    CHECK(ttl_of(t, "www.example.com") == 10);
+    CHECK(ttl_of(t, "q.a.example.com") == 30);
+    dns_rules_free(t);
+}
+
+static void test_no_catch_all(void)
+{
+    static const dns_rule_def_t defs[] = {
+        { .name = "*.lan", .ip_be = 7, .ttl = 1 },
+        { .name = "router.lan", .ip_be = 8, .ttl = 1 },
+    };
+    dns_rules_t *t = dns_rules_build(defs, 2);
+    CHECK(ip_of(t, "nas.lan") == 7);
+    CHECK(ip_of(t, "router.lan") == 8);
+    CHECK(dns_rules_lookup(t, "lan", 3) == NULL);
+    CHECK(dns_rules_lookup(t, "google.com", 10) == NULL);
+    CHECK(dns_rules_lookup(t, "xlan", 4) == NULL);  /* suffix is label-aligned */
+    dns_rules_free(t);
+}
+
+static void test_invalid_and_duplicates(void)
+{
+    static const dns_rule_def_t defs[] = {
+        { .name = "dup.test", .ip_be = 1 },
+        { .name = "DUP.test", .ip_be = 2 },         /* duplicate: first wins */
+        { .name = "bad..test", .ip_be = 3 },
+        { .name = ".lead", .ip_be = 3 },
+        { .name = "", .ip_be = 3 },
+        { .name = NULL, .ip_be = 3 },
+        { .name = "pending.test", .ip_be = 0, .user = "WIFI_AP_DEF" },
+    };
+    dns_rules_t *t = dns_rules_build(defs, 7);
+    CHECK(dns_rules_count(t) == 2);
+    CHECK(ip_of(t, "dup.test") == 1);
+
+    dns_rule_t *r = dns_rules_lookup(t, "pending.test", 12);
+    CHECK(r && !r->ready && r->user && strcmp(r->user, "WIFI_AP_DEF") == 0);
+    dns_rules_free(t);
+
+    CHECK(dns_rules_build(defs, DNS_RULES_MAX + 1) == NULL);
+    t = dns_rules_build(NULL, 0);
+    CHECK(t && dns_rules_count(t) == 0 && dns_rules_lookup(t, "a", 1) == NULL);
+    dns_rules_free(t);
+}
+
+static void test_many_rules(void)
+{
+    enum { N = 1000 };
+    static char names[N][32];
+    static dns_rule_def_t defs[N];
+    for (int i = 0; i < N; i++) {
+        snprintf(names[i], sizeof(names[i]), i % 2 ? "*.zone%d.test" : "host%d.test", i);
+        defs[i] = (dns_rule_def_t){ .name = names[i], .ip_be = (uint32_t)i + 1, .ttl = 60 };
+    }
+    dns_rules_t *t = dns_rules_build(defs, N);
+    CHECK(dns_rules_count(t) == N);
+
+    char q[64];
+    for (int i = 0; i < N; i++) {
+        if (i % 2) snprintf(q, sizeof(q), "deep.www.zone%d.test", i);
+        else snprintf(q, sizeof(q), "host%d.test", i);
+        CHECK(ip_of(t, q) == (uint32_t)i + 1);
+    }
+    CHECK(dns_rules_lookup(t, "host1.test", 10) == NULL);
+    CHECK(dns_rules_lookup(t, "zone1.test", 10) == NULL);
+    dns_rules_free(t);
+}
+
+/* End to end through dns_build_reply */
+static const dns_answer_tmpl_t *lookup_table(void *ctx, const char *name, size_t len)
+{
+    dns_rule_t *r = dns_rules_lookup(ctx, name, len);
+    return r && r->ready ? &r->tmpl : NULL;
+}
+
+static void test_reply_ttl(void)
+{
+    static const dns_rule_def_t defs[] = {
+        { .name = "short.test", .ip_be = 0x0104A8C0u, .ttl = 5 },
+    };
+    dns_rules_t *t = dns_rules_build(defs, 1);
+
+    static const uint8_t q[] = {
+        0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0,
+        5, 's', 'h', 'o', 'r', 't', 4, 't', 'e', 's', 't', 0, 0, 1, 0, 1,
+    };
+    uint8_t r[DNS_UDP_MAX_LEN];
+    size_t rl = dns_build_reply(q, sizeof(q), r, sizeof(r), lookup_table, t);
+    CHECK(rl == sizeof(q) + DNS_A_RR_LEN);
+    CHECK(r[sizeof(q) + 9] == 5);                   /* TTL low byte */
+    dns_rules_free(t);
+}
+
+int main(void)
+{
+    test_precedence();
+    test_no_catch_all();
+    test_invalid_and_duplicates();
+    test_many_rules();
+    test_reply_ttl();
+
+    return check_result("dns_rules");
+}
@@ -0,0 +1,197 @@
+/* Host tests for the streaming /connect body parser (main/form_parser.c).
+ * Every case is also replayed split at every byte position, and a seeded
+ * fuzz loop feeds random and mutated bodies in random chunk sizes. */
+
+#include "form_parser.h"
+#include "check.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char ssid[33];
+    char pass[65];
+    form_field_t f[2];
+    bool ok;
+} result_t;
+
+static void parse_split(result_t *r, form_format_t fmt, const char *body, size_t len,
+                        size_t split)
+{
+    r->f[0] = (form_field_t){ .key = "ssid", .out = r->ssid, .out_size = sizeof(r->ssid) };
+    r->f[1] = (form_field_t){ .key = "password", .out = r->pass, .out_size = sizeof(r->pass) };
+    form_parser_t p;
+    form_parser_init(&p, fmt, r->f, 2);
+    if (split > len) split = len;
+    bool ok = form_parser_feed(&p, body, split);
+    ok = form_parser_feed(&p, body + split, len - split) && ok;
+    r->ok = form_parser_finish(&p) && ok;
+}
+
+typedef struct {
+    form_format_t fmt;
+    const char *body;
+    bool ok;
+    const char *ssid;       /* NULL = not found */
+    const char *pass;
+    bool ssid_overflow;
+} case_t;
+
+static const case_t CASES[] = {
+    /* urlencoded */
+    { FORM_FMT_AUTO, "ssid=Home&password=secret", true, "Home", "secret", false },
+    { FORM_FMT_AUTO, "password=p%40ss+word&ssid=My+Net", true, "My Net", "p@ss word", false },
+    { FORM_FMT_URLENCODED, "ssid=a%3Db%26c", true, "a=b&c", NULL, false },
+    { FORM_FMT_AUTO, "xssid=no&ssid=yes", true, "yes", NULL, false },
+    { FORM_FMT_AUTO, "ssid=first&ssid=second", true, "first", NULL, false },
+    { FORM_FMT_AUTO, "ssid=100%&password=%zz%4", true, "100%", "%zz%4", false },
+    { FORM_FMT_AUTO, "flag&ssid=x=y", true, "x=y", NULL, false },
+    { FORM_FMT_AUTO, "s%73id=enc", true, "enc", NULL, false },
+    { FORM_FMT_AUTO, "ssid=", true, "", NULL, false },
+    { FORM_FMT_AUTO, "", true, NULL, NULL, false },
+    { FORM_FMT_AUTO, "ssid=0123456789012345678901234567890123", true, NULL, NULL, true },
+    { FORM_FMT_AUTO, "ssid=01234567890123456789012345678901", true,
+      "01234567890123456789012345678901", NULL, false },
+    /* JSON */
+    { FORM_FMT_AUTO, "{\"ssid\":\"Home\",\"password\":\"secret\"}", true, "Home", "secret", false },
+    { FORM_FMT_JSON, " { \"password\" : \"a\\\"b\\\\c\" , \"ssid\" : \"x\" } \n", true, "x", "a\"b\\c", false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"caf\\u00e9 \\ud83d\\ude00\"}", true, "caf\xc3\xa9 \xf0\x9f\x98\x80", NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"lone\\ud800x\"}", true, "lone\xef\xbf\xbdx", NULL, false },
+    { FORM_FMT_AUTO, "{\"x\":{\"ssid\":\"inner\",\"a\":[1,\"]\",{}]},\"ssid\":\"outer\"}", true, "outer", NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":null,\"password\":12.5e3,\"ok\":true}", true, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"a\",\"ssid\":\"b\"}", true, "a", NULL, false },
+    { FORM_FMT_AUTO, "{}", true, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"0123456789012345678901234567890123\"}", true, NULL, NULL, true },
+    { FORM_FMT_AUTO, "{\"averyveryveryveryverylongkeyname_over_32\":\"v\",\"ssid\":\"k\"}", true, "k", NULL, false },
+    /* malformed JSON */
+    { FORM_FMT_AUTO, "{\"ssid\":\"unterminated", false, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\" \"x\"}", false, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"x\"} trailing", false, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"bad\\q\"}", false, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"ctl\x01\"}", false, NULL, NULL, false },
+    { FORM_FMT_JSON, "[\"ssid\"]", false, NULL, NULL, false },
+    { FORM_FMT_AUTO, "{\"ssid\":\"x\",}", false, NULL, NULL, false },
+};
+
+static void test_cases(void)
+{
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++) {
+        const case_t *c = &CASES[i];
+        size_t len = strlen(c->body);
+        for (size_t split = 0; split <= len; split++) {
+            result_t r;
+            parse_split(&r, c->fmt, c->body, len, split);
+            bool good = r.ok == c->ok;
+            if (good && c->ok) {
+                good = r.f[0].found == (c->ssid != NULL) &&
+                       (!c->ssid || strcmp(r.ssid, c->ssid) == 0) &&
+                       r.f[1].found == (c->pass != NULL) &&
+                       (!c->pass || strcmp(r.pass, c->pass) == 0) &&
+                       r.f[0].overflow == c->ssid_overflow;
+            }
+            if (!good) {
+                fprintf(stderr, "case %zu split %zu: '%s' -> ok=%d ssid=%s'%s' pass=%s'%s'\n",
+                        i, split, c->body, r.ok, r.f[0].found ? "" : "(none)", r.ssid,
+                        r.f[1].found ? "" : "(none)", r.pass);
+                s_failed++;
+                break;
+            }
+        }
+    }
+}
+
+static void test_large_body(void)
+{
+    /* Long fields before and after the wanted ones: bodies well over the
+     * old 256-byte receive buffer */
+    char body[4096];
+    size_t n = 0;
+    n += (size_t)snprintf(body + n, sizeof(body) - n, "{\"note\":\"");
+    for (int i = 0; i < 1500; i++) body[n++] = 'x';
+    n += (size_t)snprintf(body + n, sizeof(body) - n,
+                          "\",\"ssid\":\"Lab\",\"password\":\"%s\"}",
+                          "\\u0041\\u0042\\u0043-0123456789012345678901234567890123456789");
+    result_t r;
+    parse_split(&r, FORM_FMT_AUTO, body, n, 700);
+    CHECK(r.ok && r.f[0].found && strcmp(r.ssid, "Lab") == 0);
+    CHECK(r.f[1].found && strncmp(r.pass, "ABC-0123", 8) == 0);
+
+    /* 64 %-encoded bytes = 192 body bytes for the password alone */
+    n = (size_t)snprintf(body, sizeof(body), "ssid=%s&password=", "Lab");
+    for (int i = 0; i < 64; i++) n += (size_t)snprintf(body + n, sizeof(body) - n, "%%%02X", 'a' + i % 26);
+    parse_split(&r, FORM_FMT_AUTO, body, n, 100);
+    CHECK(r.ok && r.f[1].found && strlen(r.pass) == 64);
+}
+
+/* ── Fuzz ──────────────────────────────────────────────────────── */
+
+static uint32_t s_rng = 0x1234567;
+
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void test_fuzz(void)
+{
+    static const char alphabet[] = "{}[]\":,\\u0aF%+&=ssidpassword \n\x01\xff";
+    char body[512];
+
+    for (int iter = 0; iter < 100000; iter++) {
+        size_t len;
+        if (iter & 1) {
+            /* mutate a valid case */
+            const case_t *c = &CASES[rnd() % (sizeof(CASES) / sizeof(CASES[0]))];
+            len = strlen(c->body);
+            memcpy(body, c->body, len);
+            for (int m = 1 + rnd() % 4; m > 0 && len; m--) {
+                body[rnd() % len] = alphabet[rnd() % (sizeof(alphabet) - 1)];
+            }
+        } else {
+            len = rnd() % sizeof(body);
+            for (size_t i = 0; i < len; i++) body[i] = alphabet[rnd() % (sizeof(alphabet) - 1)];
+        }
+
+        /* random chunking must not change the outcome */
+        result_t whole, chunked;
+        parse_split(&whole, FORM_FMT_AUTO, body, len, len);
+
+        chunked.f[0] = (form_field_t){ .key = "ssid", .out = chunked.ssid, .out_size = sizeof(chunked.ssid) };
+        chunked.f[1] = (form_field_t){ .key = "password", .out = chunked.pass, .out_size = sizeof(chunked.pass) };
+        form_parser_t p;
+        form_parser_init(&p, FORM_FMT_AUTO, chunked.f, 2);
+        bool ok = true;
+        for (size_t off = 0; off < len;) {
+            size_t n = 1 + rnd() % 17;
+            if (n > len - off) n = len - off;
+            ok = form_parser_feed(&p, body + off, n) && ok;
+            off += n;
+        }
+        chunked.ok = form_parser_finish(&p) && ok;
+
+        CHECK(whole.ok == chunked.ok);
+        CHECK(whole.f[0].found == chunked.f[0].found);
+        CHECK(whole.f[1].found == chunked.f[1].found);
+        CHECK(!whole.f[0].found || strcmp(whole.ssid, chunked.ssid) == 0);
+        CHECK(!whole.f[1].found || strcmp(whole.pass, chunked.pass) == 0);
+        CHECK(strlen(whole.ssid) < sizeof(whole.ssid));
+        CHECK(strlen(whole.pass) < sizeof(whole.pass));
+        if (s_failed) {
+            fprintf(stderr, "fuzz iteration %d failed\n", iter);
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    test_cases();
+    test_large_body();
+    test_fuzz();
+
+    return check_result("form_parser");
+}
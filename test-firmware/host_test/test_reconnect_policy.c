@@ -0,0 +1,165 @@
+/* Host tests for the STA reconnect schedule (main/reconnect_policy.c). */
+
+#include "reconnect_policy.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const reconnect_cfg_t CFG = {
+    .base_ms = 500,
+    .max_ms = 30000,
+    .rescan_ms = 60000,
+    .max_retries = 10,
+    .fallback_after = 0,
+};
+
+static void test_fast_path_first(void)
+{
+    reconnect_policy_t p;
+    reconnect_policy_init(&p, &CFG, 1);
+    reconnect_policy_connected(&p, true, 1000);
+
+    reconnect_action_t a = reconnect_policy_next(&p, false, 2000);
+    CHECK(a.kind == RECONNECT_FAST);
+    CHECK(a.use_bssid);
+    CHECK(a.delay_ms == 0);
+
+    /* Fast path is a single shot; the next failure scans */
+    a = reconnect_policy_next(&p, false, 2100);
+    CHECK(a.kind == RECONNECT_BACKOFF);
+    CHECK(!a.use_bssid);
+    CHECK(p.stats.fast_attempts == 1);
+    CHECK(p.stats.disconnects == 1);
+}
+
+static void test_ap_lost_skips_fast_path(void)
+{
+    reconnect_policy_t p;
+    reconnect_policy_init(&p, &CFG, 1);
+    reconnect_policy_connected(&p, true, 0);
+
+    reconnect_action_t a = reconnect_policy_next(&p, true, 10);
+    CHECK(a.kind == RECONNECT_BACKOFF);
+    CHECK(!a.use_bssid);
+    CHECK(p.stats.fast_attempts == 0);
+}
+
+static void test_no_bssid_at_boot(void)
+{
+    reconnect_policy_t p;
+    reconnect_policy_init(&p, &CFG, 1);
+
+    reconnect_action_t a = reconnect_policy_next(&p, false, 0);
+    CHECK(a.kind == RECONNECT_BACKOFF);
+    CHECK(a.delay_ms >= 250 && a.delay_ms <= 500);
+}
+
+static void test_backoff_bounds(void)
+{
+    /* Over many seeds every delay must sit in [d/2, d] for the nominal
+     * d = min(max, base * 2^step), then switch to rescans for good. */
+    for (uint32_t seed = 1; seed < 200; seed++) {
+        reconnect_policy_t p;
+        reconnect_policy_init(&p, &CFG, seed);
+
+        uint32_t d = CFG.base_ms;
+        for (int i = 0; i < CFG.max_retries; i++) {
+            reconnect_action_t a = reconnect_policy_next(&p, false, 0);
+            CHECK(a.kind == RECONNECT_BACKOFF);
+            CHECK(a.delay_ms >= d / 2 && a.delay_ms <= d);
+            d = d * 2 > CFG.max_ms ? CFG.max_ms : d * 2;
+        }
+        for (int i = 0; i < 50; i++) {
+            reconnect_action_t a = reconnect_policy_next(&p, false, 0);
+            CHECK(a.kind == RECONNECT_RESCAN);
+            CHECK(a.delay_ms >= CFG.rescan_ms / 2 && a.delay_ms <= CFG.rescan_ms);
+        }
+        CHECK(p.stats.rescans == 50);
+        CHECK(p.stats.attempts == CFG.max_retries + 50u);
+    }
+}
+
+static void test_jitter_spreads(void)
+{
+    /* Two DUTs losing the same AP must not retry in lockstep */
+    reconnect_policy_t a, b;
+    reconnect_policy_init(&a, &CFG, 0x1234);
+    reconnect_policy_init(&b, &CFG, 0x5678);
+    int same = 0;
+    for (int i = 0; i < CFG.max_retries; i++) {
+        if (reconnect_policy_next(&a, false, 0).delay_ms ==
+            reconnect_policy_next(&b, false, 0).delay_ms) same++;
+    }
+    CHECK(same < CFG.max_retries / 2);
+}
+
+static void test_fallback_once_per_outage(void)
+{
+    reconnect_cfg_t cfg = CFG;
+    cfg.fallback_after = 5;
+    reconnect_policy_t p;
+    reconnect_policy_init(&p, &cfg, 7);
+
+    int fallbacks = 0;
+    for (int i = 1; i <= 30; i++) {
+        reconnect_action_t a = reconnect_policy_next(&p, false, 0);
+        if (a.kind == RECONNECT_FALLBACK) {
+            CHECK(i == 5);
+            fallbacks++;
+        }
+    }
+    CHECK(fallbacks == 1);
+
+    /* A new outage may fall back again */
+    reconnect_policy_connected(&p, false, 0);
+    for (int i = 0; i < 5; i++) reconnect_policy_next(&p, false, 0);
+    CHECK(p.stats.fallbacks == 2);
+}
+
+static void test_reset_and_outage_stats(void)
+{
+    reconnect_policy_t p;
+    reconnect_policy_init(&p, &CFG, 3);
+    reconnect_policy_connected(&p, true, 0);
+
+    reconnect_policy_next(&p, false, 10000);
+    reconnect_policy_next(&p, false, 10500);
+    reconnect_policy_next(&p, false, 12000);
+    CHECK(reconnect_policy_in_outage(&p));
+    reconnect_policy_connected(&p, true, 14000);
+    CHECK(!reconnect_policy_in_outage(&p));
+    CHECK(p.stats.last_outage_ms == 4000);
+    CHECK(p.stats.longest_outage_ms == 4000);
+
+    /* Backoff restarts from base after recovery */
+    reconnect_policy_next(&p, false, 20000);               /* fast */
+    reconnect_action_t a = reconnect_policy_next(&p, false, 20001);
+    CHECK(a.delay_ms <= CFG.base_ms);
+    reconnect_policy_connected(&p, true, 21000);
+    CHECK(p.stats.last_outage_ms == 1000);
+    CHECK(p.stats.longest_outage_ms == 4000);
+    CHECK(p.stats.disconnects == 2);
+}
+
+static void test_clock_wrap(void)
+{
+    reconnect_policy_t p;
+    reconnect_policy_init(&p, &CFG, 3);
+    reconnect_policy_next(&p, false, UINT32_MAX - 499);
+    reconnect_policy_connected(&p, false, 500);
+    CHECK(p.stats.last_outage_ms == 1000);
+}
+
+int main(void)
+{
+    test_fast_path_first();
+    test_ap_lost_skips_fast_path();
+    test_no_bssid_at_boot();
+    test_backoff_bounds();
+    test_jitter_spreads();
+    test_fallback_once_per_outage();
+    test_reset_and_outage_stats();
+    test_clock_wrap();
+
+    return check_result("reconnect_policy");
+}
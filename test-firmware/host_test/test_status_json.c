@@ -0,0 +1,110 @@
+/* Host tests for the /status renderer (main/status_json.c): exact output
+ * for a full snapshot, string escaping, and snprintf-style truncation at
+ * every buffer size. */
+
+#include "status_json.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const KEY_NAMES[] = { "wifi_ssid", "wifi_pass", "boot_count", "boot_recs" };
+static const uint32_t WRITES[] = { 1, 1, 7, 0 };
+
+static const status_boot_t BOOTS[] = {
+    { .boot = 7, .version = "0.1.0", .reset = "panic", .after_crash = true,
+      .uptime_s = 12, .heap_min_free = 180224, .heap_peak_used = 95000,
+      .stack_min = 412, .stack_task = "httpd", .reconnects = 0, .udp_drops = 3 },
+    { .boot = 6, .version = "0.1.0", .reset = "poweron", .after_crash = false,
+      .uptime_s = 4294967295u, .heap_min_free = 0, .heap_peak_used = 1,
+      .stack_min = 65535, .stack_task = "", .reconnects = 10, .udp_drops = 0 },
+};
+
+static status_info_t snapshot(void)
+{
+    return (status_info_t){
+        .project = "wb-test", .version = "0.1.0", .boot_count = 7,
+        .wifi_connected = true, .ble_connected = false,
+        .reconnect = { .disconnects = 2, .attempts = 5, .fast_attempts = 2,
+                       .rescans = 1, .fallbacks = 0, .last_delay_ms = 800,
+                       .last_outage_ms = 1500, .longest_outage_ms = 30000 },
+        .nvs_commits = 4, .nvs_skipped = 9, .nvs_errors = 0,
+        .nvs_key_names = KEY_NAMES, .nvs_writes = WRITES, .nvs_keys = 4,
+        .boots = BOOTS, .boots_n = 2,
+    };
+}
+
+static const char EXPECTED[] =
+    "{\"project\":\"wb-test\",\"version\":\"0.1.0\",\"boot_count\":7,"
+    "\"wifi_connected\":true,\"ble_connected\":false,"
+    "\"reconnect\":{\"disconnects\":2,\"attempts\":5,\"fast_attempts\":2,\"rescans\":1,"
+    "\"fallbacks\":0,\"last_outage_ms\":1500,\"longest_outage_ms\":30000},"
+    "\"nvs\":{\"commits\":4,\"skipped\":9,\"errors\":0,"
+    "\"writes\":{\"wifi_ssid\":1,\"wifi_pass\":1,\"boot_count\":7,\"boot_recs\":0}},"
+    "\"boots\":[{\"boot\":7,\"version\":\"0.1.0\",\"reset\":\"panic\",\"after_crash\":true,"
+    "\"uptime_s\":12,\"heap_min_free\":180224,\"heap_peak_used\":95000,\"stack_min\":412,"
+    "\"stack_task\":\"httpd\",\"reconnects\":0,\"udp_drops\":3},"
+    "{\"boot\":6,\"version\":\"0.1.0\",\"reset\":\"poweron\",\"after_crash\":false,"
+    "\"uptime_s\":4294967295,\"heap_min_free\":0,\"heap_peak_used\":1,\"stack_min\":65535,"
+    "\"stack_task\":\"\",\"reconnects\":10,\"udp_drops\":0}]}";
+
+static void test_full_snapshot(void)
+{
+    status_info_t s = snapshot();
+    char buf[2048];
+    size_t len = status_json_render(&s, buf, sizeof(buf));
+    CHECK(len == strlen(EXPECTED));
+    CHECK(strcmp(buf, EXPECTED) == 0);
+    if (strcmp(buf, EXPECTED) != 0) fprintf(stderr, "got: %s\n", buf);
+
+    /* no boots, no NVS keys: empty containers */
+    s.boots_n = 0;
+    s.nvs_keys = 0;
+    len = status_json_render(&s, buf, sizeof(buf));
+    CHECK(strstr(buf, "\"writes\":{}},\"boots\":[]}") != NULL);
+    CHECK(len == strlen(buf));
+}
+
+static void test_escaping(void)
+{
+    status_info_t s = snapshot();
+    s.project = "a\"b\\c\n\t\x01\x1f caf\xc3\xa9";
+    s.version = NULL;
+    s.boots_n = 0;
+    char buf[2048];
+    status_json_render(&s, buf, sizeof(buf));
+    const char *want = "{\"project\":\"a\\\"b\\\\c\\n\\t\\u0001\\u001f caf\xc3\xa9\","
+                       "\"version\":\"\",";
+    CHECK(strncmp(buf, want, strlen(want)) == 0);
+}
+
+static void test_truncation(void)
+{
+    status_info_t s = snapshot();
+    size_t full = strlen(EXPECTED);
+    CHECK(status_json_render(&s, NULL, 0) == full);
+
+    for (size_t size = 1; size <= full + 1; size++) {
+        char *buf = malloc(size + 8);
+        memset(buf, 'X', size + 8);
+        size_t len = status_json_render(&s, buf, size);
+        CHECK(len == full);
+        CHECK(strlen(buf) == size - 1);
+        CHECK(memcmp(buf, EXPECTED, size - 1) == 0);
+        CHECK(buf[size] == 'X');                /* nothing past the buffer */
+        free(buf);
+        if (s_failed) {
+            fprintf(stderr, "size %zu failed\n", size);
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    test_full_snapshot();
+    test_escaping();
+    test_truncation();
+
+    return check_result("status_json");
+}
@@ -0,0 +1,60 @@
+/* Host tests for the UDP log line formatter (main/udp_log_fmt.c),
+ * including reuse of the caller's va_list afterwards, which is what
+ * udp_log_vprintf() does when it also prints the line to serial. */
+
+#include "udp_log_fmt.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Formats into buf, then formats the same va_list again into again, like
+ * the UDP hook followed by the serial vprintf. */
+static size_t format_twice(char *buf, size_t size, char *again, size_t again_size,
+                           const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    size_t len = udp_log_format(buf, size, fmt, args);
+    vsnprintf(again, again_size, fmt, args);
+    va_end(args);
+    return len;
+}
+
+static void test_format(void)
+{
+    char buf[64], again[64];
+    size_t len = format_twice(buf, sizeof(buf), again, sizeof(again),
+                              "I (%lu) %s: heartbeat %d\n", 1234UL, "app_main", 7);
+    CHECK(len == strlen("I (1234) app_main: heartbeat 7\n"));
+    CHECK(strcmp(buf, "I (1234) app_main: heartbeat 7\n") == 0);
+    CHECK(strcmp(again, buf) == 0);             /* args still intact */
+}
+
+static void test_clamp(void)
+{
+    char buf[8], again[64];
+    size_t len = format_twice(buf, sizeof(buf), again, sizeof(again), "%s-%d", "abcdefgh", 42);
+    CHECK(len == sizeof(buf) - 1);
+    CHECK(strcmp(buf, "abcdefg") == 0);
+    CHECK(strcmp(again, "abcdefgh-42") == 0);
+
+    len = format_twice(buf, 1, again, sizeof(again), "%d", 5);
+    CHECK(len == 0 && buf[0] == '\0');
+    CHECK(format_twice(buf, 0, again, sizeof(again), "%d", 5) == 0);
+}
+
+static void test_empty(void)
+{
+    char buf[16], again[16];
+    CHECK(format_twice(buf, sizeof(buf), again, sizeof(again), "%s", "") == 0);
+}
+
+int main(void)
+{
+    test_format();
+    test_clamp();
+    test_empty();
+
+    return check_result("udp_log_fmt");
+}
@@ -4,6 +4,9 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_store.h"
+#include "conn_state.h"
+#include "boot_record.h"
+#include "coredump_upload.h"
 #include "udp_log.h"
 #include "wifi_prov.h"
 #include "ble_nus.h"
@@ -16,10 +19,26 @@ static const char *TAG = "app_main";
 static void heartbeat_task(void *arg)
 {
     uint32_t tick = 0;
+    EventBits_t bits = conn_state_get();
+    TickType_t next = xTaskGetTickCount() + pdMS_TO_TICKS(10000);
     while (1) {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = (int32_t)(next - now) > 0 ? next - now : 0;
+
+        /* Wake early on connectivity transitions so they are logged as they
+         * happen, without disturbing the 10 s heartbeat cadence. */
+        EventBits_t cur = conn_state_wait_change(bits, wait);
+        if (cur != bits) {
+            ESP_LOGI(TAG, "connectivity changed | wifi=%d ap=%d ble=%d (gen %"PRIu32")",
+                     (cur & CONN_STA_UP) != 0, (cur & CONN_AP_MODE) != 0,
+                     (cur & CONN_BLE_UP) != 0, conn_state_generation());
+            bits = cur;
+            continue;
+        }
+
         ESP_LOGI(TAG, "heartbeat %"PRIu32" | wifi=%d ble=%d",
-                 tick++, wifi_prov_is_connected(), ble_nus_is_connected());
-        vTaskDelay(pdMS_TO_TICKS(10000));
+                 tick++, (bits & CONN_STA_UP) != 0, (bits & CONN_BLE_UP) != 0);
+        next += pdMS_TO_TICKS(10000);
     }
 }
 
@@ -27,8 +46,11 @@ void app_main(void)
 {
     ESP_LOGI(TAG, "=== Workbench Test Firmware v%s ===", FW_VERSION);
 
-    /* 1. NVS */
+    /* 1. NVS + connectivity state (must exist before any event handler),
+     *    then this boot's crash/perf record */
     nvs_store_init();
+    conn_state_init();
+    boot_record_init();
 
     /* 2. Network stack — must be up before UDP logging */
     ESP_ERROR_CHECK(esp_netif_init());
@@ -44,17 +66,21 @@ void app_main(void)
      *    conflicts during association. In AP mode, start BLE immediately. */
     if (!wifi_prov_is_ap_mode()) {
         ESP_LOGI(TAG, "Waiting for WiFi STA connection before starting BLE...");
-        for (int i = 0; i < 150 && !wifi_prov_is_connected(); i++)
-            vTaskDelay(pdMS_TO_TICKS(100));   /* up to 15s */
+        conn_state_wait(CONN_STA_UP, pdMS_TO_TICKS(15000));
     }
 
-    /* 6. BLE — NUS advertisement (no command handler) */
+    /* 6. Core dump from a previous crash, if any — uploaded in the
+     *    background once the station is up */
+    coredump_upload_init();
+
+    /* 7. BLE — NUS advertisement (no command handler) */
     ble_nus_init();
 
-    /* 7. HTTP server — /status, /ota, /wifi-reset */
+    /* 8. HTTP server — /status, /ota, /wifi-reset */
+    http_server_set_boot_count(nvs_store_boot_count());
     http_server_start();
 
-    /* 8. Heartbeat — periodic log to confirm firmware is alive */
+    /* 9. Heartbeat — periodic log to confirm firmware is alive */
     xTaskCreate(heartbeat_task, "heartbeat", 4096, NULL, 1, NULL);
 
     ESP_LOGI(TAG, "Init complete, running event-driven");
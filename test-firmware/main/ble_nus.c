@@ -2,6 +2,7 @@
 
 #if CONFIG_BT_ENABLED
 
+#include "conn_state.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nimble/nimble_port.h"
@@ -125,6 +126,7 @@ static int nus_gap_event(struct ble_gap_event *event, void *arg)
     case BLE_GAP_EVENT_LINK_ESTAB:
         if (event->connect.status == 0) {
             s_conn_handle = event->connect.conn_handle;
+            conn_state_set(CONN_BLE_UP);
             ESP_LOGI(TAG, "Connected, handle=%d", s_conn_handle);
         } else {
             ESP_LOGW(TAG, "Connection failed, status=%d", event->connect.status);
@@ -135,6 +137,7 @@ static int nus_gap_event(struct ble_gap_event *event, void *arg)
     case BLE_GAP_EVENT_DISCONNECT:
         ESP_LOGI(TAG, "Disconnected, reason=%d", event->disconnect.reason);
         s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        conn_state_clear(CONN_BLE_UP);
         nus_advertise();
         break;
 
@@ -240,7 +243,7 @@ esp_err_t ble_nus_init(void)
 
 bool ble_nus_is_connected(void)
 {
-    return s_conn_handle != BLE_HS_CONN_HANDLE_NONE;
+    return conn_state_is(CONN_BLE_UP);
 }
 
 #endif /* CONFIG_BT_ENABLED */
@@ -0,0 +1,255 @@
+#include "boot_record.h"
+#include "nvs_store.h"
+#include "conn_state.h"
+#include "wifi_prov.h"
+#include "udp_log.h"
+#include "esp_attr.h"
+#include "esp_app_desc.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "boot_rec";
+
+#define RING_MAGIC          (0x42524543u ^ (uint32_t)sizeof(boot_ring_t))  /* "BREC" */
+#define PUSH_TASK_STACK     3072
+
+typedef struct {
+    uint32_t      magic;
+    uint8_t       head;         /* record of the running boot */
+    uint8_t       count;
+    uint16_t      reserved;
+    boot_record_t rec[BOOT_RECORD_RING];
+    uint32_t      crc;          /* over everything above */
+} boot_ring_t;
+
+_Static_assert(sizeof(boot_ring_t) <= NVS_STORE_BLOB_MAX, "boot ring does not fit its NVS blob");
+
+/* Not cleared by the bootloader on panic / WDT / software reset */
+static RTC_NOINIT_ATTR boot_ring_t s_rtc;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_sample_timer = NULL;
+static uint32_t s_generation;
+static int64_t s_last_persist_us;
+static bool s_push_started;
+
+/* Tasks whose stack margin is tracked; missing ones are skipped */
+static const char *const s_watch_tasks[] = {
+    "heartbeat", "udp_log", "httpd", "dns_server", "nimble_host",
+    "esp_timer", "tiT", "sys_evt", "ota_task",
+};
+
+static uint32_t ring_crc(const boot_ring_t *r)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)r, offsetof(boot_ring_t, crc));
+}
+
+static bool ring_valid(const boot_ring_t *r)
+{
+    return r->magic == RING_MAGIC && r->head < BOOT_RECORD_RING &&
+           r->count <= BOOT_RECORD_RING && r->crc == ring_crc(r);
+}
+
+/* ── Sampling ──────────────────────────────────────────────────── */
+
+static void persist(void)
+{
+    boot_ring_t copy;
+    portENTER_CRITICAL(&s_lock);
+    copy = s_rtc;
+    portEXIT_CRITICAL(&s_lock);
+    nvs_store_set_blob(NVS_KEY_BOOT_RECORDS, &copy, sizeof(copy));
+    s_last_persist_us = esp_timer_get_time();
+}
+
+static void sample_timer_cb(void *arg)
+{
+    /* Gather outside the lock: xTaskGetHandle walks the task lists */
+    uint32_t min_stack = UINT32_MAX;
+    const char *min_task = NULL;
+    for (size_t i = 0; i < sizeof(s_watch_tasks) / sizeof(s_watch_tasks[0]); i++) {
+        TaskHandle_t t = xTaskGetHandle(s_watch_tasks[i]);
+        if (!t) continue;
+        uint32_t hw = uxTaskGetStackHighWaterMark(t);
+        if (hw < min_stack) {
+            min_stack = hw;
+            min_task = s_watch_tasks[i];
+        }
+    }
+
+    reconnect_stats_t rs;
+    wifi_prov_get_reconnect_stats(&rs);
+    int64_t now = esp_timer_get_time();
+    uint32_t min_free = esp_get_minimum_free_heap_size();
+    uint32_t heap_size = heap_caps_get_total_size(MALLOC_CAP_DEFAULT);
+
+    portENTER_CRITICAL(&s_lock);
+    boot_record_t *r = &s_rtc.rec[s_rtc.head];
+    r->uptime_s = (uint32_t)(now / 1000000);
+    r->heap_min_free = min_free;
+    r->heap_peak_used = heap_size > min_free ? heap_size - min_free : 0;
+    r->reconnects = rs.attempts;
+    r->udp_drops = udp_log_dropped();
+    if (min_task && min_stack < r->stack_min) {
+        r->stack_min = (uint16_t)min_stack;
+        strlcpy(r->stack_task, min_task, sizeof(r->stack_task));
+    }
+    s_rtc.crc = ring_crc(&s_rtc);
+    s_generation++;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (now - s_last_persist_us >= (int64_t)BOOT_RECORD_PERSIST_MS * 1000) {
+        persist();
+    }
+}
+
+/* ── UDP push ──────────────────────────────────────────────────── */
+
+static int record_json(const boot_record_t *r, char *buf, size_t len)
+{
+    return snprintf(buf, len,
+                    "{\"boot\":%"PRIu32",\"version\":\"%s\",\"reset\":\"%s\","
+                    "\"uptime_s\":%"PRIu32",\"heap_min_free\":%"PRIu32","
+                    "\"heap_peak_used\":%"PRIu32",\"stack_min\":%u,\"stack_task\":\"%s\","
+                    "\"reconnects\":%"PRIu32",\"udp_drops\":%"PRIu32"}",
+                    r->boot, r->version, boot_record_reset_name(r->reset_reason),
+                    r->uptime_s, r->heap_min_free, r->heap_peak_used,
+                    r->stack_min, r->stack_task, r->reconnects, r->udp_drops);
+}
+
+/* Sends the previous (finished) and the current record once. Lowest
+ * priority: never delays boot or connect. */
+static void push_task(void *arg)
+{
+    boot_record_t recs[2];
+    int n = boot_record_get(recs, 2);
+    char line[224];
+    for (int i = n - 1; i >= 0; i--) {
+        record_json(&recs[i], line, sizeof(line));
+        ESP_LOGI(TAG, "BOOTREC %s", line);
+    }
+    vTaskDelete(NULL);
+}
+
+static void on_conn_change(EventBits_t old_bits, EventBits_t new_bits,
+                           uint32_t generation, void *arg);
+
+/* The push task only exists once the station is up, so a device that
+ * stays in AP/portal mode never pays for its stack. */
+static void start_push(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool first = !s_push_started;
+    s_push_started = true;
+    portEXIT_CRITICAL(&s_lock);
+    if (!first) return;
+
+    conn_state_unsubscribe(on_conn_change, NULL);
+    xTaskCreate(push_task, "boot_rec", PUSH_TASK_STACK, NULL, tskIDLE_PRIORITY + 1, NULL);
+}
+
+static void on_conn_change(EventBits_t old_bits, EventBits_t new_bits,
+                           uint32_t generation, void *arg)
+{
+    if ((new_bits & CONN_STA_UP) && !(old_bits & CONN_STA_UP)) start_push();
+}
+
+/* ── Public API ────────────────────────────────────────────────── */
+
+esp_err_t boot_record_init(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+
+    if (!ring_valid(&s_rtc)) {
+        /* Power-on reset or new layout: fall back to the NVS copy */
+        boot_ring_t nv;
+        if (nvs_store_get_blob(NVS_KEY_BOOT_RECORDS, &nv, sizeof(nv)) == sizeof(nv) &&
+            ring_valid(&nv)) {
+            s_rtc = nv;
+        } else {
+            memset(&s_rtc, 0, sizeof(s_rtc));
+            s_rtc.magic = RING_MAGIC;
+            s_rtc.head = BOOT_RECORD_RING - 1;
+        }
+    }
+
+    s_rtc.head = (s_rtc.head + 1) % BOOT_RECORD_RING;
+    if (s_rtc.count < BOOT_RECORD_RING) s_rtc.count++;
+
+    boot_record_t *r = &s_rtc.rec[s_rtc.head];
+    memset(r, 0, sizeof(*r));
+    r->boot = nvs_store_boot_count();
+    strlcpy(r->version, esp_app_get_description()->version, sizeof(r->version));
+    r->reset_reason = (uint8_t)reason;
+    r->stack_min = UINT16_MAX;
+    s_rtc.crc = ring_crc(&s_rtc);
+    persist();
+
+    if (s_rtc.count > 1) {
+        const boot_record_t *prev = &s_rtc.rec[(s_rtc.head + BOOT_RECORD_RING - 1) % BOOT_RECORD_RING];
+        ESP_LOGI(TAG, "Boot #%"PRIu32" (%s), previous boot #%"PRIu32" ran %"PRIu32" s",
+                 r->boot, boot_record_reset_name(r->reset_reason), prev->boot, prev->uptime_s);
+    }
+    if (boot_record_is_crash(r->reset_reason)) {
+        ESP_LOGW(TAG, "Previous boot ended abnormally: %s", boot_record_reset_name(r->reset_reason));
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .name = "boot_rec",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_sample_timer));
+    esp_timer_start_periodic(s_sample_timer, (uint64_t)BOOT_RECORD_SAMPLE_MS * 1000);
+
+    conn_state_subscribe(on_conn_change, NULL);
+    if (conn_state_is(CONN_STA_UP)) start_push();      /* came up before we subscribed */
+    return ESP_OK;
+}
+
+int boot_record_get(boot_record_t *out, int max)
+{
+    portENTER_CRITICAL(&s_lock);
+    int n = s_rtc.count < max ? s_rtc.count : max;
+    for (int i = 0; i < n; i++) {
+        out[i] = s_rtc.rec[(s_rtc.head + BOOT_RECORD_RING - i) % BOOT_RECORD_RING];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+uint32_t boot_record_generation(void)
+{
+    return s_generation;
+}
+
+const char *boot_record_reset_name(uint8_t reason)
+{
+    switch (reason) {
+    case ESP_RST_POWERON:   return "poweron";
+    case ESP_RST_EXT:       return "ext";
+    case ESP_RST_SW:        return "sw";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "int_wdt";
+    case ESP_RST_TASK_WDT:  return "task_wdt";
+    case ESP_RST_WDT:       return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_SDIO:      return "sdio";
+    default:                return "unknown";
+    }
+}
+
+bool boot_record_is_crash(uint8_t reason)
+{
+    return reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+           reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT ||
+           reason == ESP_RST_BROWNOUT;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Per-boot crash / performance records.
+ *
+ * A ring of the last BOOT_RECORD_RING boots lives in RTC memory, which
+ * survives panics, watchdog and software resets, and is mirrored to NVS
+ * (key "boot_recs") so power cycles keep the history too. The record of
+ * the running boot is refreshed every BOOT_RECORD_SAMPLE_MS and written
+ * to NVS at most every BOOT_RECORD_PERSIST_MS; the reset reason of the
+ * following boot tells how it ended.
+ *
+ * Once the station is up, the previous and current records are pushed
+ * through the UDP log as "BOOTREC {json}" lines for the portal.
+ */
+
+#define BOOT_RECORD_RING        8
+#define BOOT_RECORD_SAMPLE_MS   10000
+#define BOOT_RECORD_PERSIST_MS  600000
+
+typedef struct {
+    uint32_t boot;              /* persisted boot counter */
+    char     version[16];       /* app version string */
+    uint8_t  reset_reason;      /* esp_reset_reason_t that started this boot */
+    uint8_t  reserved;
+    uint16_t stack_min;         /* smallest stack high-water mark seen, bytes */
+    char     stack_task[12];    /* task owning stack_min */
+    uint32_t uptime_s;          /* at the last sample */
+    uint32_t heap_min_free;     /* lowest free heap seen, bytes */
+    uint32_t heap_peak_used;    /* heap size - heap_min_free */
+    uint32_t reconnects;        /* STA reconnect attempts */
+    uint32_t udp_drops;         /* UDP log lines dropped */
+} boot_record_t;
+
+/* Call after nvs_store_init() and conn_state_init(). */
+esp_err_t boot_record_init(void);
+
+/* Copies up to max records, newest (the running boot) first. */
+int boot_record_get(boot_record_t *out, int max);
+
+/* Bumped on every sample; lets /status cache its rendering. */
+uint32_t boot_record_generation(void);
+
+const char *boot_record_reset_name(uint8_t reason);
+
+/* True if the reset reason means the previous boot died abnormally. */
+bool boot_record_is_crash(uint8_t reason);
@@ -0,0 +1,134 @@
+#include "conn_state.h"
+#include "esp_log.h"
+#include "freertos/semphr.h"
+#include <inttypes.h>
+#include <string.h>
+
+static const char *TAG = "conn_state";
+
+typedef struct {
+    conn_state_cb_t cb;
+    void *arg;
+} conn_sub_t;
+
+static StaticEventGroup_t s_group_buf;
+static EventGroupHandle_t s_group;
+static StaticSemaphore_t s_mutex_buf;
+static SemaphoreHandle_t s_mutex;   /* serialises updaters and subscriber list */
+static volatile uint32_t s_generation;
+static conn_sub_t s_subs[CONN_STATE_MAX_SUBSCRIBERS];
+
+esp_err_t conn_state_init(void)
+{
+    if (s_group) return ESP_OK;
+
+    s_mutex = xSemaphoreCreateMutexStatic(&s_mutex_buf);
+    s_group = xEventGroupCreateStatic(&s_group_buf);
+    xEventGroupSetBits(s_group, CONN_DOWN(CONN_FLAGS));
+    ESP_LOGI(TAG, "Connectivity state initialized");
+    return ESP_OK;
+}
+
+/* Apply set/clear masks; notify subscribers if anything actually changed. */
+static void conn_state_update(EventBits_t set, EventBits_t clear)
+{
+    if (!s_group) return;
+
+    conn_sub_t subs[CONN_STATE_MAX_SUBSCRIBERS];
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    EventBits_t old_bits = xEventGroupGetBits(s_group) & CONN_ALL_BITS;
+    EventBits_t flags = (old_bits | set) & ~clear & CONN_FLAGS;
+    EventBits_t new_bits = flags | CONN_DOWN(~flags & CONN_FLAGS);
+
+    if (new_bits == old_bits) {
+        xSemaphoreGive(s_mutex);
+        return;
+    }
+
+    /* Set before clear so waiters on either edge never see both halves of
+     * a pair cleared at once. */
+    xEventGroupSetBits(s_group, new_bits & ~old_bits);
+    xEventGroupClearBits(s_group, old_bits & ~new_bits);
+    uint32_t gen = ++s_generation;
+    memcpy(subs, s_subs, sizeof(subs));
+
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGD(TAG, "state 0x%03" PRIx32 " -> 0x%03" PRIx32 " (gen %" PRIu32 ")",
+             (uint32_t)old_bits, (uint32_t)new_bits, gen);
+
+    for (int i = 0; i < CONN_STATE_MAX_SUBSCRIBERS; i++) {
+        if (subs[i].cb) subs[i].cb(old_bits, new_bits, gen, subs[i].arg);
+    }
+}
+
+void conn_state_set(EventBits_t flags)
+{
+    conn_state_update(flags & CONN_FLAGS, 0);
+}
+
+void conn_state_clear(EventBits_t flags)
+{
+    conn_state_update(0, flags & CONN_FLAGS);
+}
+
+EventBits_t conn_state_get(void)
+{
+    if (!s_group) return CONN_DOWN(CONN_FLAGS);
+    return xEventGroupGetBits(s_group) & CONN_ALL_BITS;
+}
+
+uint32_t conn_state_generation(void)
+{
+    return s_generation;
+}
+
+EventBits_t conn_state_wait(EventBits_t bits, TickType_t timeout)
+{
+    if (!s_group) return CONN_DOWN(CONN_FLAGS);
+    return xEventGroupWaitBits(s_group, bits & CONN_ALL_BITS,
+                               pdFALSE, pdFALSE, timeout) & CONN_ALL_BITS;
+}
+
+EventBits_t conn_state_wait_change(EventBits_t seen, TickType_t timeout)
+{
+    /* Exactly one bit of every up/down pair is set, so any transition sets
+     * a bit that is clear in *seen*. */
+    return conn_state_wait(~seen & CONN_ALL_BITS, timeout);
+}
+
+esp_err_t conn_state_subscribe(conn_state_cb_t cb, void *arg)
+{
+    if (!cb) return ESP_ERR_INVALID_ARG;
+    if (!s_group) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < CONN_STATE_MAX_SUBSCRIBERS; i++) {
+        if (!s_subs[i].cb) {
+            s_subs[i] = (conn_sub_t){ .cb = cb, .arg = arg };
+            err = ESP_OK;
+            break;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return err;
+}
+
+esp_err_t conn_state_unsubscribe(conn_state_cb_t cb, void *arg)
+{
+    if (!s_group) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    for (int i = 0; i < CONN_STATE_MAX_SUBSCRIBERS; i++) {
+        if (s_subs[i].cb == cb && s_subs[i].arg == arg) {
+            s_subs[i] = (conn_sub_t){ 0 };
+            err = ESP_OK;
+            break;
+        }
+    }
+    xSemaphoreGive(s_mutex);
+    return err;
+}
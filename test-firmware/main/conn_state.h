@@ -0,0 +1,56 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Unified connectivity state (WiFi STA, AP provisioning, BLE link).
+ *
+ * Every flag is mirrored by a complementary "down" bit in the same event
+ * group, so consumers can block on either edge of a transition:
+ *
+ *     conn_state_wait(CONN_STA_UP, pdMS_TO_TICKS(15000));
+ *     conn_state_wait(CONN_DOWN(CONN_STA_UP), portMAX_DELAY);
+ *
+ * Each transition bumps a monotonic generation counter and runs the
+ * registered callbacks from the context that changed the state.
+ */
+
+#define CONN_STA_UP      BIT0   /* STA associated and has an IP */
+#define CONN_AP_MODE     BIT1   /* SoftAP provisioning portal active */
+#define CONN_BLE_UP      BIT2   /* BLE central connected */
+
+#define CONN_FLAGS       (CONN_STA_UP | CONN_AP_MODE | CONN_BLE_UP)
+#define CONN_DOWN(flags) ((EventBits_t)(flags) << 8)
+#define CONN_ALL_BITS    (CONN_FLAGS | CONN_DOWN(CONN_FLAGS))
+
+#define CONN_STATE_MAX_SUBSCRIBERS 4
+
+/* Called after every transition; keep it short (runs in the WiFi event
+ * loop, NimBLE host or caller task). */
+typedef void (*conn_state_cb_t)(EventBits_t old_bits, EventBits_t new_bits,
+                                uint32_t generation, void *arg);
+
+esp_err_t   conn_state_init(void);
+void        conn_state_set(EventBits_t flags);
+void        conn_state_clear(EventBits_t flags);
+EventBits_t conn_state_get(void);
+uint32_t    conn_state_generation(void);
+
+/* Block until any of *bits* is set. Returns the bits at wake-up. */
+EventBits_t conn_state_wait(EventBits_t bits, TickType_t timeout);
+
+/* Block until the state differs from *seen* (a previous conn_state_get()).
+ * Returns the current bits, which equal *seen* on timeout. */
+EventBits_t conn_state_wait_change(EventBits_t seen, TickType_t timeout);
+
+esp_err_t conn_state_subscribe(conn_state_cb_t cb, void *arg);
+esp_err_t conn_state_unsubscribe(conn_state_cb_t cb, void *arg);
+
+static inline bool conn_state_is(EventBits_t flag)
+{
+    return (conn_state_get() & flag) != 0;
+}
@@ -0,0 +1,175 @@
+#include "coredump_upload.h"
+#include "conn_state.h"
+#include "esp_app_desc.h"
+#include "esp_core_dump.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "coredump";
+
+#define UPLOAD_TASK_STACK  4096
+
+typedef struct {
+    const esp_partition_t *part;
+    size_t addr;                /* absolute flash address of the image */
+    size_t size;
+    char   query[160];          /* fixed part of the upload query string */
+} upload_ctx_t;
+
+static upload_ctx_t s_ctx;
+
+/* One chunk per request, so an interrupted upload restarts at a known
+ * offset and the portal never needs to hold a whole request open. The
+ * (short JSON) reply is left in *resp*. */
+static esp_err_t post_chunk(esp_http_client_handle_t client, const char *url,
+                            const uint8_t *buf, size_t len, int *status,
+                            char *resp, size_t resp_len)
+{
+    esp_http_client_set_url(client, url);
+    esp_err_t err = esp_http_client_open(client, (int)len);
+    if (err != ESP_OK) return err;
+
+    if (esp_http_client_write(client, (const char *)buf, (int)len) != (int)len) {
+        esp_http_client_close(client);
+        return ESP_FAIL;
+    }
+    esp_http_client_fetch_headers(client);
+    *status = esp_http_client_get_status_code(client);
+    int r = esp_http_client_read_response(client, resp, (int)resp_len - 1);
+    resp[r > 0 ? r : 0] = '\0';
+    esp_http_client_flush_response(client, NULL);
+    esp_http_client_close(client);
+    return ESP_OK;
+}
+
+/* "expected_offset" from a 409 reply, or -1 */
+static long expected_offset(const char *resp)
+{
+    const char *p = strstr(resp, "\"expected_offset\":");
+    if (!p) return -1;
+    char *end;
+    long v = strtol(p + strlen("\"expected_offset\":"), &end, 10);
+    return end == p + strlen("\"expected_offset\":") ? -1 : v;
+}
+
+static esp_err_t upload_image(void)
+{
+    uint8_t *buf = malloc(COREDUMP_CHUNK_SIZE);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    const esp_http_client_config_t cfg = {
+        .url = COREDUMP_UPLOAD_URL,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = 10000,
+        .keep_alive_enable = true,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&cfg);
+    if (!client) {
+        free(buf);
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(client, "Content-Type", "application/octet-stream");
+
+    esp_err_t err = ESP_OK;
+    char url[sizeof(COREDUMP_UPLOAD_URL) + sizeof(s_ctx.query) + 48];
+    char resp[128];
+    int resumes = 0;
+    for (size_t off = 0; off < s_ctx.size && err == ESP_OK;) {
+        size_t n = s_ctx.size - off < COREDUMP_CHUNK_SIZE ? s_ctx.size - off : COREDUMP_CHUNK_SIZE;
+        err = esp_partition_read(s_ctx.part, s_ctx.addr - s_ctx.part->address + off, buf, n);
+        if (err != ESP_OK) break;
+
+        snprintf(url, sizeof(url), "%s?%s&offset=%u&total=%u",
+                 COREDUMP_UPLOAD_URL, s_ctx.query, (unsigned)off, (unsigned)s_ctx.size);
+        int status = 0;
+        long expected = -1;
+        for (int attempt = 0; attempt < COREDUMP_CHUNK_RETRIES; attempt++) {
+            err = post_chunk(client, url, buf, n, &status, resp, sizeof(resp));
+            if (err == ESP_OK && status == 200) break;
+            if (err == ESP_OK && status == 409 && (expected = expected_offset(resp)) >= 0) break;
+            if (err == ESP_OK) err = ESP_FAIL;
+            vTaskDelay(pdMS_TO_TICKS(1000 << attempt));
+        }
+        if (err == ESP_OK && status == 409) {
+            /* The portal holds a different prefix (e.g. it restarted, or
+             * lost the upload): carry on from where it is */
+            if ((size_t)expected >= s_ctx.size || ++resumes > COREDUMP_CHUNK_RETRIES) {
+                ESP_LOGW(TAG, "Portal expects offset %ld, giving up", expected);
+                err = ESP_FAIL;
+                break;
+            }
+            ESP_LOGW(TAG, "Portal expects offset %ld, resuming there", expected);
+            off = (size_t)expected;
+            continue;
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Chunk at %u failed (HTTP %d)", (unsigned)off, status);
+            break;
+        }
+        off += n;
+    }
+
+    esp_http_client_cleanup(client);
+    free(buf);
+    return err;
+}
+
+static void upload_task(void *arg)
+{
+    conn_state_wait(CONN_STA_UP, portMAX_DELAY);
+    vTaskDelay(pdMS_TO_TICKS(COREDUMP_START_DELAY_MS));
+
+    ESP_LOGI(TAG, "Uploading core dump (%u bytes) to %s", (unsigned)s_ctx.size, COREDUMP_UPLOAD_URL);
+    if (upload_image() == ESP_OK) {
+        esp_core_dump_image_erase();
+        ESP_LOGI(TAG, "Core dump uploaded and erased");
+    } else {
+        ESP_LOGW(TAG, "Core dump upload failed, kept for the next boot");
+    }
+    vTaskDelete(NULL);
+}
+
+/* ── Public API ────────────────────────────────────────────────── */
+
+esp_err_t coredump_upload_init(void)
+{
+    if (esp_core_dump_image_check() != ESP_OK) return ESP_OK;   /* nothing stored */
+
+    s_ctx.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                          ESP_PARTITION_SUBTYPE_DATA_COREDUMP, NULL);
+    if (!s_ctx.part || esp_core_dump_image_get(&s_ctx.addr, &s_ctx.size) != ESP_OK) {
+        ESP_LOGW(TAG, "Core dump present but unreadable");
+        return ESP_FAIL;
+    }
+
+    /* The dump carries the SHA-256 of the ELF that crashed, which may not
+     * be the running one after an OTA. */
+    esp_core_dump_summary_t *sum = malloc(sizeof(*sum));
+    if (!sum) return ESP_ERR_NO_MEM;
+    const char *sha = "";
+    if (esp_core_dump_get_summary(sum) == ESP_OK) {
+        ESP_LOGW(TAG, "Core dump from previous boot: task %s, PC 0x%08"PRIx32", ELF %s",
+                 sum->exc_task, sum->exc_pc, sum->app_elf_sha256);
+        sha = (const char *)sum->app_elf_sha256;
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_ctx.query, sizeof(s_ctx.query),
+             "device=%02x%02x%02x%02x%02x%02x&project=%s&elf_sha256=%s",
+             MAC2STR(mac), esp_app_get_description()->project_name, sha);
+    free(sum);
+
+    if (xTaskCreate(upload_task, "coredump_up", UPLOAD_TASK_STACK, NULL,
+                    tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
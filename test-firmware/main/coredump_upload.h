@@ -0,0 +1,20 @@
+#pragma once
+
+#include "esp_err.h"
+
+/*
+ * Core dumps are written to the "coredump" flash partition by the panic
+ * handler (CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH, ELF format). On the next
+ * boot a lowest-priority task waits for the station to come up, streams
+ * the raw image to the portal in COREDUMP_CHUNK_SIZE pieces and erases it
+ * once the last piece is acknowledged. The portal decodes it against the
+ * ELF with the matching SHA-256 in its firmware directory.
+ */
+
+#define COREDUMP_UPLOAD_URL     "http://192.168.0.87:8080/api/coredump/upload"
+#define COREDUMP_CHUNK_SIZE     4096
+#define COREDUMP_START_DELAY_MS 5000    /* after STA up: let the boot settle */
+#define COREDUMP_CHUNK_RETRIES  3
+
+/* Starts the upload task if a valid core dump is stored; no-op otherwise. */
+esp_err_t coredump_upload_init(void);
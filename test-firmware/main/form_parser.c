@@ -0,0 +1,417 @@
+#include "form_parser.h"
+#include <string.h>
+
+enum {
+    ST_DETECT = 0,
+    /* urlencoded */
+    U_KEY,
+    U_VAL,
+    /* JSON */
+    J_START,        /* expect '{' */
+    J_FIRST,        /* expect key or '}' */
+    J_KEY_REQ,      /* after ',': expect key */
+    J_KEY,          /* inside key string */
+    J_COLON,
+    J_VALUE,
+    J_VSTR,         /* inside string value */
+    J_SKIP,         /* inside scalar (depth 0) or nested value */
+    J_NEXT,         /* expect ',' or '}' */
+    J_DONE,
+};
+
+static int hexval(unsigned char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool is_ws(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* ── Key / value sinks ─────────────────────────────────────────── */
+
+static void put_key(form_parser_t *p, char c)
+{
+    if (p->key_len < FORM_KEY_MAX) p->key[p->key_len++] = c;
+    else p->key_overflow = true;
+}
+
+static void reset_key(form_parser_t *p)
+{
+    p->key_len = 0;
+    p->key_overflow = false;
+}
+
+static void begin_value(form_parser_t *p)
+{
+    p->cur = NULL;
+    p->val_len = 0;
+    if (p->key_overflow) return;
+    p->key[p->key_len] = '\0';
+    for (size_t i = 0; i < p->n_fields; i++) {
+        form_field_t *f = &p->fields[i];
+        if (!f->found && !f->overflow && strcmp(f->key, p->key) == 0) {
+            p->cur = f;
+            break;
+        }
+    }
+}
+
+static void put_val(form_parser_t *p, char c)
+{
+    if (!p->cur) return;
+    if (p->val_len + 1 < p->cur->out_size) {
+        p->cur->out[p->val_len++] = c;
+        p->cur->out[p->val_len] = '\0';
+    } else {
+        p->cur->overflow = true;
+    }
+}
+
+static void end_value(form_parser_t *p)
+{
+    if (p->cur) {
+        p->cur->out[p->val_len] = '\0';
+        if (!p->cur->overflow) p->cur->found = true;
+        p->cur = NULL;
+    }
+    reset_key(p);
+}
+
+/* ── application/x-www-form-urlencoded ─────────────────────────── */
+
+static void url_data(form_parser_t *p, char c)
+{
+    if (p->state == U_KEY) put_key(p, c);
+    else put_val(p, c);
+}
+
+/* An invalid %-escape is kept literally */
+static void url_flush_pct(form_parser_t *p)
+{
+    if (p->esc >= 1) url_data(p, '%');
+    if (p->esc == 2) url_data(p, p->pct[1]);
+    p->esc = 0;
+}
+
+static void url_byte(form_parser_t *p, char c)
+{
+    if (p->esc) {
+        int h = hexval((unsigned char)c);
+        if (h >= 0) {
+            if (p->esc == 1) {
+                p->code = (unsigned)h;
+                p->pct[1] = c;
+                p->esc = 2;
+            } else {
+                url_data(p, (char)((p->code << 4) | (unsigned)h));
+                p->esc = 0;
+            }
+            return;
+        }
+        url_flush_pct(p);
+    }
+
+    switch (c) {
+    case '%':
+        p->esc = 1;
+        return;
+    case '+':
+        url_data(p, ' ');
+        return;
+    case '&':
+        if (p->state == U_VAL) end_value(p);
+        else reset_key(p);              /* bare key without '=' */
+        p->state = U_KEY;
+        return;
+    case '=':
+        if (p->state == U_KEY) {
+            begin_value(p);
+            p->state = U_VAL;
+            return;
+        }
+        break;                          /* '=' inside a value is data */
+    default:
+        break;
+    }
+    url_data(p, c);
+}
+
+/* ── JSON ──────────────────────────────────────────────────────── */
+
+static void json_emit(form_parser_t *p, char c)
+{
+    if (p->state == J_KEY) put_key(p, c);
+    else put_val(p, c);
+}
+
+static void json_emit_cp(form_parser_t *p, unsigned cp)
+{
+    if (cp < 0x80) {
+        json_emit(p, (char)cp);
+    } else if (cp < 0x800) {
+        json_emit(p, (char)(0xC0 | (cp >> 6)));
+        json_emit(p, (char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        json_emit(p, (char)(0xE0 | (cp >> 12)));
+        json_emit(p, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        json_emit(p, (char)(0x80 | (cp & 0x3F)));
+    } else {
+        json_emit(p, (char)(0xF0 | (cp >> 18)));
+        json_emit(p, (char)(0x80 | ((cp >> 12) & 0x3F)));
+        json_emit(p, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        json_emit(p, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+/* A high surrogate not followed by a low one becomes U+FFFD */
+static void json_flush_surrogate(form_parser_t *p)
+{
+    if (p->hi_surrogate) {
+        p->hi_surrogate = 0;
+        json_emit_cp(p, 0xFFFD);
+    }
+}
+
+static void json_codepoint(form_parser_t *p, unsigned cp)
+{
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        json_flush_surrogate(p);
+        p->hi_surrogate = cp;
+        return;
+    }
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (p->hi_surrogate) {
+            cp = 0x10000 + ((p->hi_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+            p->hi_surrogate = 0;
+        } else {
+            cp = 0xFFFD;
+        }
+    } else {
+        json_flush_surrogate(p);
+    }
+    json_emit_cp(p, cp);
+}
+
+/* One byte of a string body (after the opening quote).
+ * Returns 1 on the closing quote, 0 to continue, -1 on error. */
+static int json_str_byte(form_parser_t *p, unsigned char c)
+{
+    if (p->esc == 0) {
+        if (c == '"') {
+            json_flush_surrogate(p);
+            return 1;
+        }
+        if (c == '\\') {
+            p->esc = 1;
+            return 0;
+        }
+        if (c < 0x20) return -1;
+        json_flush_surrogate(p);
+        json_emit(p, (char)c);
+        return 0;
+    }
+
+    if (p->esc == 1) {
+        char out;
+        switch (c) {
+        case '"': case '\\': case '/': out = (char)c; break;
+        case 'b': out = '\b'; break;
+        case 'f': out = '\f'; break;
+        case 'n': out = '\n'; break;
+        case 'r': out = '\r'; break;
+        case 't': out = '\t'; break;
+        case 'u':
+            p->esc = 2;
+            p->code = 0;
+            return 0;
+        default:
+            return -1;
+        }
+        p->esc = 0;
+        json_flush_surrogate(p);
+        json_emit(p, out);
+        return 0;
+    }
+
+    /* esc 2..5: the four hex digits of \uXXXX */
+    int h = hexval(c);
+    if (h < 0) return -1;
+    p->code = (p->code << 4) | (unsigned)h;
+    if (++p->esc < 6) return 0;
+    p->esc = 0;
+    json_codepoint(p, p->code);
+    return 0;
+}
+
+static bool is_scalar_char(unsigned char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+static bool json_byte(form_parser_t *p, unsigned char c)
+{
+again:
+    switch (p->state) {
+    case J_START:
+        if (is_ws(c)) return true;
+        if (c != '{') return false;
+        p->state = J_FIRST;
+        return true;
+
+    case J_FIRST:
+    case J_KEY_REQ:
+        if (is_ws(c)) return true;
+        if (c == '}' && p->state == J_FIRST) {
+            p->state = J_DONE;
+            return true;
+        }
+        if (c != '"') return false;
+        reset_key(p);
+        p->esc = 0;
+        p->state = J_KEY;
+        return true;
+
+    case J_KEY: {
+        int r = json_str_byte(p, c);
+        if (r < 0) return false;
+        if (r > 0) p->state = J_COLON;
+        return true;
+    }
+
+    case J_COLON:
+        if (is_ws(c)) return true;
+        if (c != ':') return false;
+        p->state = J_VALUE;
+        return true;
+
+    case J_VALUE:
+        if (is_ws(c)) return true;
+        if (c == '"') {
+            begin_value(p);
+            p->esc = 0;
+            p->state = J_VSTR;
+            return true;
+        }
+        p->depth = (c == '{' || c == '[') ? 1 : 0;
+        if (p->depth == 0 && !is_scalar_char(c)) return false;
+        p->in_str = false;
+        p->esc = 0;
+        p->state = J_SKIP;
+        return true;
+
+    case J_VSTR: {
+        int r = json_str_byte(p, c);
+        if (r < 0) return false;
+        if (r > 0) {
+            end_value(p);
+            p->state = J_NEXT;
+        }
+        return true;
+    }
+
+    case J_SKIP:
+        if (p->depth == 0) {
+            if (is_scalar_char(c)) return true;
+            reset_key(p);
+            p->state = J_NEXT;
+            goto again;
+        }
+        if (p->in_str) {
+            if (p->esc) p->esc = 0;
+            else if (c == '\\') p->esc = 1;
+            else if (c == '"') p->in_str = false;
+            return true;
+        }
+        if (c == '"') {
+            p->in_str = true;
+        } else if (c == '{' || c == '[') {
+            p->depth++;
+        } else if (c == '}' || c == ']') {
+            if (--p->depth == 0) {
+                reset_key(p);
+                p->state = J_NEXT;
+            }
+        }
+        return true;
+
+    case J_NEXT:
+        if (is_ws(c)) return true;
+        if (c == ',') {
+            p->state = J_KEY_REQ;
+            return true;
+        }
+        if (c == '}') {
+            p->state = J_DONE;
+            return true;
+        }
+        return false;
+
+    case J_DONE:
+        return is_ws(c);
+
+    default:
+        return false;
+    }
+}
+
+/* ── Public API ────────────────────────────────────────────────── */
+
+void form_parser_init(form_parser_t *p, form_format_t fmt,
+                      form_field_t *fields, size_t n_fields)
+{
+    memset(p, 0, sizeof(*p));
+    p->fields = fields;
+    p->n_fields = n_fields;
+    p->fmt = fmt;
+    p->state = fmt == FORM_FMT_JSON ? J_START
+             : fmt == FORM_FMT_URLENCODED ? U_KEY : ST_DETECT;
+    p->pct[0] = '%';
+    for (size_t i = 0; i < n_fields; i++) {
+        fields[i].found = false;
+        fields[i].overflow = false;
+        if (fields[i].out_size) fields[i].out[0] = '\0';
+    }
+}
+
+bool form_parser_feed(form_parser_t *p, const char *data, size_t len)
+{
+    for (size_t i = 0; i < len && !p->error; i++) {
+        unsigned char c = (unsigned char)data[i];
+
+        if (p->state == ST_DETECT) {
+            if (is_ws(c)) continue;
+            if (c == '{') {
+                p->fmt = FORM_FMT_JSON;
+                p->state = J_START;
+            } else {
+                p->fmt = FORM_FMT_URLENCODED;
+                p->state = U_KEY;
+            }
+        }
+
+        if (p->fmt == FORM_FMT_JSON) {
+            if (!json_byte(p, c)) p->error = true;
+        } else {
+            url_byte(p, (char)c);
+        }
+    }
+    return !p->error;
+}
+
+bool form_parser_finish(form_parser_t *p)
+{
+    if (p->error) return false;
+    if (p->fmt == FORM_FMT_JSON) {
+        return p->state == J_DONE;
+    }
+    if (p->state == ST_DETECT) return true;     /* empty body */
+    url_flush_pct(p);
+    if (p->state == U_VAL) end_value(p);
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Incremental extractor for request bodies (application/x-www-form-urlencoded
+ * or a flat JSON object). The body is fed in arbitrary chunks as it arrives
+ * from the socket; only the string values of the requested keys are decoded,
+ * straight into caller-owned buffers, without building a DOM or buffering the
+ * body.
+ *
+ * - urlencoded: '+' and %XX are decoded in keys and values
+ * - JSON: top-level object only; string escapes including \uXXXX (and
+ *   surrogate pairs) are decoded to UTF-8; nested values and non-string
+ *   values of wanted keys are skipped (the key stays "not found")
+ * - the first occurrence of a key wins
+ * - values longer than out_size - 1 set *overflow* instead of being
+ *   silently truncated
+ *
+ * Pure C with no ESP-IDF dependencies (host tests in host_test/).
+ */
+
+#define FORM_KEY_MAX 32
+
+typedef enum {
+    FORM_FMT_AUTO = 0,      /* JSON if the first non-blank byte is '{' */
+    FORM_FMT_URLENCODED,
+    FORM_FMT_JSON,
+} form_format_t;
+
+typedef struct {
+    const char *key;
+    char *out;
+    size_t out_size;
+    bool found;
+    bool overflow;
+} form_field_t;
+
+typedef struct {
+    form_field_t *fields;
+    size_t n_fields;
+    form_format_t fmt;
+    int state;
+    bool error;
+
+    char key[FORM_KEY_MAX + 1];
+    size_t key_len;
+    bool key_overflow;
+    form_field_t *cur;      /* field receiving the current value, or NULL */
+    size_t val_len;
+
+    /* escape decoding */
+    int esc;                /* urlencoded: hex digits pending; JSON: escape state */
+    unsigned code;          /* %XX or \uXXXX accumulator */
+    unsigned hi_surrogate;
+    char pct[3];            /* raw "%X" kept to emit literally if invalid */
+    int depth;              /* JSON: nesting while skipping a value */
+    bool in_str;            /* JSON: inside a string while skipping */
+} form_parser_t;
+
+void form_parser_init(form_parser_t *p, form_format_t fmt,
+                      form_field_t *fields, size_t n_fields);
+
+/* Returns false once the input is malformed (JSON only; urlencoded input
+ * is always accepted). */
+bool form_parser_feed(form_parser_t *p, const char *data, size_t len);
+
+/* End of body. Returns false if the body was malformed or incomplete. */
+bool form_parser_finish(form_parser_t *p);
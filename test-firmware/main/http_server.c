@@ -1,39 +1,135 @@
 #include "http_server.h"
 #include "wifi_prov.h"
-#include "ble_nus.h"
+#include "conn_state.h"
 #include "ota_update.h"
+#include "nvs_store.h"
+#include "boot_record.h"
+#include "status_json.h"
 #include "esp_http_server.h"
 #include "esp_ota_ops.h"
 #include "esp_log.h"
-#include "cJSON.h"
+#include <stdlib.h>
 
 static const char *TAG = "http_srv";
 
 static uint32_t s_boot_count = 0;
 
+/* Rendered /status body, rebuilt only when the connectivity generation,
+ * reconnect attempt count, NVS counters, boot record sample or boot count
+ * move. Only touched from the httpd task. */
+static char *s_status_json = NULL;
+static size_t s_status_cap = 0;
+static size_t s_status_len = 0;
+static uint32_t s_status_gen = 0;
+static uint32_t s_status_attempts = 0;
+static uint32_t s_status_nvs = 0;          /* sum of the NVS counters */
+static uint32_t s_status_boot_gen = 0;
+static bool s_status_stale = true;
+
 void http_server_set_boot_count(uint32_t count)
 {
     s_boot_count = count;
+    s_status_stale = true;
 }
 
-/* GET /status — JSON with device state */
-static esp_err_t status_handler(httpd_req_t *req)
+/* Fills the /status snapshot and renders it into s_status_json, growing
+ * the buffer when the body outgrows it. Returns false if out of memory. */
+static bool render_status(EventBits_t bits, const reconnect_stats_t *rs,
+                          const nvs_store_stats_t *ns)
 {
     const esp_app_desc_t *app = esp_app_get_description();
+    static const char *key_names[NVS_KEY_COUNT];
+    if (!key_names[0]) {
+        for (int k = 0; k < NVS_KEY_COUNT; k++) key_names[k] = nvs_store_key_name(k);
+    }
 
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "project", app->project_name);
-    cJSON_AddStringToObject(root, "version", app->version);
-    cJSON_AddNumberToObject(root, "boot_count", s_boot_count);
-    cJSON_AddBoolToObject(root, "wifi_connected", wifi_prov_is_connected());
-    cJSON_AddBoolToObject(root, "ble_connected", ble_nus_is_connected());
+    /* Newest (this boot) first; each reset reason says how the boot
+     * before it ended */
+    boot_record_t recs[BOOT_RECORD_RING];
+    status_boot_t boots[BOOT_RECORD_RING];
+    int n = boot_record_get(recs, BOOT_RECORD_RING);
+    for (int i = 0; i < n; i++) {
+        const boot_record_t *b = &recs[i];
+        boots[i] = (status_boot_t){
+            .boot = b->boot,
+            .version = b->version,
+            .reset = boot_record_reset_name(b->reset_reason),
+            .after_crash = boot_record_is_crash(b->reset_reason),
+            .uptime_s = b->uptime_s,
+            .heap_min_free = b->heap_min_free,
+            .heap_peak_used = b->heap_peak_used,
+            .stack_min = b->stack_min,
+            .stack_task = b->stack_task,
+            .reconnects = b->reconnects,
+            .udp_drops = b->udp_drops,
+        };
+    }
 
-    const char *json = cJSON_PrintUnformatted(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_sendstr(req, json);
+    const status_info_t info = {
+        .project = app->project_name,
+        .version = app->version,
+        .boot_count = s_boot_count,
+        .wifi_connected = (bits & CONN_STA_UP) != 0,
+        .ble_connected = (bits & CONN_BLE_UP) != 0,
+        .reconnect = *rs,
+        .nvs_commits = ns->commits,
+        .nvs_skipped = ns->skipped,
+        .nvs_errors = ns->errors,
+        .nvs_key_names = key_names,
+        .nvs_writes = ns->writes,
+        .nvs_keys = NVS_KEY_COUNT,
+        .boots = boots,
+        .boots_n = n,
+    };
 
-    cJSON_free((void *)json);
-    cJSON_Delete(root);
+    size_t len = status_json_render(&info, s_status_json, s_status_cap);
+    if (len >= s_status_cap) {
+        char *grown = realloc(s_status_json, len + 1);
+        if (!grown) {
+            /* never serve the truncated body */
+            free(s_status_json);
+            s_status_json = NULL;
+            s_status_cap = 0;
+            return false;
+        }
+        s_status_json = grown;
+        s_status_cap = len + 1;
+        status_json_render(&info, s_status_json, s_status_cap);
+    }
+    s_status_len = len;
+    return true;
+}
+
+/* GET /status — JSON with device state */
+static esp_err_t status_handler(httpd_req_t *req)
+{
+    /* Read the generation before the bits: if a transition races with us the
+     * cache is tagged with the older generation and rebuilt next time. */
+    uint32_t gen = conn_state_generation();
+    reconnect_stats_t rs;
+    wifi_prov_get_reconnect_stats(&rs);
+    nvs_store_stats_t ns;
+    nvs_store_get_stats(&ns);
+    uint32_t nvs_sum = ns.commits + ns.skipped + ns.errors;
+    uint32_t boot_gen = boot_record_generation();
+    if (s_status_stale || !s_status_json || gen != s_status_gen ||
+        rs.attempts != s_status_attempts || nvs_sum != s_status_nvs ||
+        boot_gen != s_status_boot_gen) {
+        if (render_status(conn_state_get(), &rs, &ns)) {
+            s_status_gen = gen;
+            s_status_attempts = rs.attempts;
+            s_status_nvs = nvs_sum;
+            s_status_boot_gen = boot_gen;
+            s_status_stale = false;
+        }
+    }
+
+    if (!s_status_json) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, s_status_json, s_status_len);
     return ESP_OK;
 }
 
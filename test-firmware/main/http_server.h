@@ -1,5 +1,7 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stdint.h>
 
 esp_err_t http_server_start(void);
+void      http_server_set_boot_count(uint32_t count);
@@ -2,11 +2,203 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stddef.h>
 #include <string.h>
 
 static const char *TAG = "nvs_store";
 static const char *NVS_NAMESPACE = "wb_test";
 
+#define COMMIT_TASK_STACK   3072
+
+/* ── Schema ────────────────────────────────────────────────────── */
+
+typedef struct {
+    char     wifi_ssid[33];
+    char     wifi_pass[65];
+    uint32_t boot_count;
+    uint8_t  boot_records[NVS_STORE_BLOB_MAX];
+} config_t;
+
+typedef enum { FIELD_STR, FIELD_U32, FIELD_BLOB } field_type_t;
+
+typedef struct {
+    const char  *key;           /* NVS key, max 15 chars */
+    field_type_t type;
+    size_t       offset;
+    size_t       size;
+} field_def_t;
+
+#define FIELD(id, name, type, member) \
+    [id] = { name, type, offsetof(config_t, member), sizeof(((config_t *)0)->member) }
+
+static const field_def_t s_fields[NVS_KEY_COUNT] = {
+    FIELD(NVS_KEY_WIFI_SSID,    "wifi_ssid",  FIELD_STR,  wifi_ssid),
+    FIELD(NVS_KEY_WIFI_PASS,    "wifi_pass",  FIELD_STR,  wifi_pass),
+    FIELD(NVS_KEY_BOOT_COUNT,   "boot_count", FIELD_U32,  boot_count),
+    FIELD(NVS_KEY_BOOT_RECORDS, "boot_recs",  FIELD_BLOB, boot_records),
+};
+
+/* ── State ─────────────────────────────────────────────────────── */
+
+static config_t s_cfg;
+static uint32_t s_present;      /* bit per key: has a value (else erased) */
+static uint32_t s_dirty;        /* bit per key: mirror differs from flash */
+static size_t   s_blob_len[NVS_KEY_COUNT];
+static nvs_store_stats_t s_stats;
+
+static StaticSemaphore_t s_mutex_buf;
+static SemaphoreHandle_t s_mutex;
+static esp_timer_handle_t s_commit_timer = NULL;
+static TaskHandle_t s_commit_task = NULL;
+
+#define BIT_OF(k) (1u << (k))
+
+static void *field_ptr(nvs_key_t k)
+{
+    return (uint8_t *)&s_cfg + s_fields[k].offset;
+}
+
+static bool valid_key(nvs_key_t k, field_type_t type)
+{
+    return (unsigned)k < NVS_KEY_COUNT && s_fields[k].type == type;
+}
+
+/* Caller holds s_mutex. Each change pushes the commit out again, so a
+ * burst of updates ends in one commit. */
+static void mark_dirty(nvs_key_t k)
+{
+    s_dirty |= BIT_OF(k);
+    if (s_commit_timer) {
+        esp_timer_stop(s_commit_timer);
+        esp_timer_start_once(s_commit_timer, (uint64_t)NVS_STORE_COMMIT_DELAY_MS * 1000);
+    }
+}
+
+/* ── Load / commit ─────────────────────────────────────────────── */
+
+static void load_all(void)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &h);
+    if (err != ESP_OK) {
+        /* ESP_ERR_NVS_NOT_FOUND: namespace not created yet (fresh flash) */
+        ESP_LOGI(TAG, "No stored config (%s)", esp_err_to_name(err));
+        return;
+    }
+
+    for (int k = 0; k < NVS_KEY_COUNT; k++) {
+        const field_def_t *f = &s_fields[k];
+        if (f->type == FIELD_STR) {
+            size_t len = f->size;
+            err = nvs_get_str(h, f->key, field_ptr(k), &len);
+        } else if (f->type == FIELD_BLOB) {
+            size_t len = f->size;
+            err = nvs_get_blob(h, f->key, field_ptr(k), &len);
+            s_blob_len[k] = err == ESP_OK ? len : 0;
+        } else {
+            err = nvs_get_u32(h, f->key, field_ptr(k));
+        }
+        if (err == ESP_OK) {
+            s_present |= BIT_OF(k);
+        } else {
+            memset(field_ptr(k), 0, f->size);
+            if (err != ESP_ERR_NVS_NOT_FOUND) {
+                ESP_LOGW(TAG, "Ignoring %s: %s", f->key, esp_err_to_name(err));
+            }
+        }
+    }
+    nvs_close(h);
+}
+
+esp_err_t nvs_store_flush(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_commit_timer) esp_timer_stop(s_commit_timer);
+    if (!s_dirty) {
+        xSemaphoreGive(s_mutex);
+        return ESP_OK;
+    }
+
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        s_stats.errors++;
+        xSemaphoreGive(s_mutex);
+        ESP_LOGE(TAG, "nvs_open failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    uint32_t written = 0;
+    for (int k = 0; k < NVS_KEY_COUNT; k++) {
+        if (!(s_dirty & BIT_OF(k))) continue;
+        const field_def_t *f = &s_fields[k];
+        esp_err_t e;
+        if (!(s_present & BIT_OF(k))) {
+            e = nvs_erase_key(h, f->key);
+            if (e == ESP_ERR_NVS_NOT_FOUND) e = ESP_OK;
+        } else if (f->type == FIELD_STR) {
+            e = nvs_set_str(h, f->key, field_ptr(k));
+        } else if (f->type == FIELD_BLOB) {
+            e = nvs_set_blob(h, f->key, field_ptr(k), s_blob_len[k]);
+        } else {
+            e = nvs_set_u32(h, f->key, *(uint32_t *)field_ptr(k));
+        }
+        if (e == ESP_OK) {
+            written |= BIT_OF(k);
+            s_stats.writes[k]++;
+        } else {
+            s_stats.errors++;
+            err = e;
+            ESP_LOGE(TAG, "Writing %s failed: %s", f->key, esp_err_to_name(e));
+        }
+    }
+
+    if (written) {
+        esp_err_t e = nvs_commit(h);
+        if (e == ESP_OK) {
+            s_stats.commits++;
+            s_dirty &= ~written;
+        } else {
+            s_stats.errors++;
+            err = e;
+            ESP_LOGE(TAG, "nvs_commit failed: %s", esp_err_to_name(e));
+        }
+    }
+    nvs_close(h);
+    uint32_t commits = s_stats.commits;
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGD(TAG, "Committed 0x%02"PRIx32" (commit #%"PRIu32")", written, commits);
+    return err;
+}
+
+/* esp_timer task: only wake the commit task. A flash erase/write here
+ * would hold up every other esp_timer callback (e.g. WiFi reconnect). */
+static void commit_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_commit_task);
+}
+
+static void commit_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        nvs_store_flush();
+    }
+}
+
+static void shutdown_flush(void)
+{
+    nvs_store_flush();
+}
+
+/* ── Init ──────────────────────────────────────────────────────── */
+
 esp_err_t nvs_store_init(void)
 {
     esp_err_t err = nvs_flash_init();
@@ -16,51 +208,181 @@ esp_err_t nvs_store_init(void)
         err = nvs_flash_init();
     }
     ESP_ERROR_CHECK(err);
-    ESP_LOGI(TAG, "NVS initialized");
+
+    s_mutex = xSemaphoreCreateMutexStatic(&s_mutex_buf);
+    load_all();
+
+    if (xTaskCreate(commit_task, "nvs_commit", COMMIT_TASK_STACK, NULL,
+                    tskIDLE_PRIORITY + 1, &s_commit_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = commit_timer_cb,
+        .name = "nvs_commit",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_commit_timer));
+    esp_register_shutdown_handler(shutdown_flush);
+
+    /* The boot counter is the one write every boot pays for; commit it
+     * straight away so a crash loop is still counted. */
+    nvs_store_set_u32(NVS_KEY_BOOT_COUNT, s_cfg.boot_count + 1);
+    nvs_store_flush();
+
+    ESP_LOGI(TAG, "NVS initialized, boot #%"PRIu32, s_cfg.boot_count);
     return ESP_OK;
 }
 
-esp_err_t nvs_store_set_wifi(const char *ssid, const char *password)
+/* ── Typed accessors ───────────────────────────────────────────── */
+
+esp_err_t nvs_store_set_str(nvs_key_t key, const char *value)
 {
-    nvs_handle_t h;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
-    if (err != ESP_OK) return err;
+    if (!valid_key(key, FIELD_STR) || !value) return ESP_ERR_INVALID_ARG;
+    if (strlen(value) >= s_fields[key].size) return ESP_ERR_INVALID_SIZE;
+
+    char *slot = field_ptr(key);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if ((s_present & BIT_OF(key)) && strcmp(slot, value) == 0) {
+        s_stats.skipped++;
+    } else {
+        strcpy(slot, value);
+        s_present |= BIT_OF(key);
+        mark_dirty(key);
+    }
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+bool nvs_store_get_str(nvs_key_t key, char *out, size_t out_len)
+{
+    if (!valid_key(key, FIELD_STR) || !out_len) return false;
+
+    const char *slot = field_ptr(key);
+    bool ok = false;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if ((s_present & BIT_OF(key)) && strlen(slot) < out_len) {
+        strcpy(out, slot);
+        ok = true;
+    }
+    xSemaphoreGive(s_mutex);
+    return ok;
+}
+
+esp_err_t nvs_store_set_u32(nvs_key_t key, uint32_t value)
+{
+    if (!valid_key(key, FIELD_U32)) return ESP_ERR_INVALID_ARG;
+
+    uint32_t *slot = field_ptr(key);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if ((s_present & BIT_OF(key)) && *slot == value) {
+        s_stats.skipped++;
+    } else {
+        *slot = value;
+        s_present |= BIT_OF(key);
+        mark_dirty(key);
+    }
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+uint32_t nvs_store_get_u32(nvs_key_t key, uint32_t def)
+{
+    if (!valid_key(key, FIELD_U32)) return def;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t v = (s_present & BIT_OF(key)) ? *(uint32_t *)field_ptr(key) : def;
+    xSemaphoreGive(s_mutex);
+    return v;
+}
+
+esp_err_t nvs_store_set_blob(nvs_key_t key, const void *data, size_t len)
+{
+    if (!valid_key(key, FIELD_BLOB) || (!data && len)) return ESP_ERR_INVALID_ARG;
+    if (len > s_fields[key].size) return ESP_ERR_INVALID_SIZE;
+
+    void *slot = field_ptr(key);
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if ((s_present & BIT_OF(key)) && s_blob_len[key] == len && memcmp(slot, data, len) == 0) {
+        s_stats.skipped++;
+    } else {
+        memcpy(slot, data, len);
+        s_blob_len[key] = len;
+        s_present |= BIT_OF(key);
+        mark_dirty(key);
+    }
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+size_t nvs_store_get_blob(nvs_key_t key, void *out, size_t out_len)
+{
+    if (!valid_key(key, FIELD_BLOB)) return 0;
+
+    size_t len = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if ((s_present & BIT_OF(key)) && s_blob_len[key] <= out_len) {
+        len = s_blob_len[key];
+        memcpy(out, field_ptr(key), len);
+    }
+    xSemaphoreGive(s_mutex);
+    return len;
+}
+
+esp_err_t nvs_store_erase(nvs_key_t key)
+{
+    if ((unsigned)key >= NVS_KEY_COUNT) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_present & BIT_OF(key)) {
+        memset(field_ptr(key), 0, s_fields[key].size);
+        s_blob_len[key] = 0;
+        s_present &= ~BIT_OF(key);
+        mark_dirty(key);
+    }
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+const char *nvs_store_key_name(nvs_key_t key)
+{
+    return (unsigned)key < NVS_KEY_COUNT ? s_fields[key].key : "?";
+}
+
+void nvs_store_get_stats(nvs_store_stats_t *out)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_mutex);
+}
+
+/* ── Convenience wrappers ──────────────────────────────────────── */
 
-    err = nvs_set_str(h, "wifi_ssid", ssid);
+esp_err_t nvs_store_set_wifi(const char *ssid, const char *password)
+{
+    esp_err_t err = nvs_store_set_str(NVS_KEY_WIFI_SSID, ssid);
     if (err == ESP_OK) {
-        err = nvs_set_str(h, "wifi_pass", password);
+        err = nvs_store_set_str(NVS_KEY_WIFI_PASS, password);
     }
     if (err == ESP_OK) {
-        err = nvs_commit(h);
+        ESP_LOGI(TAG, "WiFi credentials saved (SSID: %s)", ssid);
     }
-    nvs_close(h);
-    ESP_LOGI(TAG, "WiFi credentials saved (SSID: %s)", ssid);
     return err;
 }
 
 bool nvs_store_get_wifi(char *ssid, size_t ssid_len, char *password, size_t pass_len)
 {
-    nvs_handle_t h;
-    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) return false;
-
-    esp_err_t err = nvs_get_str(h, "wifi_ssid", ssid, &ssid_len);
-    if (err == ESP_OK) {
-        err = nvs_get_str(h, "wifi_pass", password, &pass_len);
-    }
-    nvs_close(h);
-    return (err == ESP_OK);
+    return nvs_store_get_str(NVS_KEY_WIFI_SSID, ssid, ssid_len) &&
+           nvs_store_get_str(NVS_KEY_WIFI_PASS, password, pass_len);
 }
 
 esp_err_t nvs_store_erase_wifi(void)
 {
-    nvs_handle_t h;
-    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
-    if (err != ESP_OK) return err;
-
-    nvs_erase_key(h, "wifi_ssid");
-    nvs_erase_key(h, "wifi_pass");
-    err = nvs_commit(h);
-    nvs_close(h);
+    nvs_store_erase(NVS_KEY_WIFI_SSID);
+    nvs_store_erase(NVS_KEY_WIFI_PASS);
     ESP_LOGI(TAG, "WiFi credentials erased");
-    return err;
+    return ESP_OK;
+}
+
+uint32_t nvs_store_boot_count(void)
+{
+    return nvs_store_get_u32(NVS_KEY_BOOT_COUNT, 0);
 }
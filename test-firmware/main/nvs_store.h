@@ -2,8 +2,60 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
 
+/*
+ * Typed configuration store. Every setting lives in a RAM mirror that is
+ * loaded from NVS once in nvs_store_init(); getters never touch flash.
+ * Setters update the mirror, skip unchanged values and mark the key dirty;
+ * dirty keys are written together with a single nvs_commit() once no
+ * further change has arrived for NVS_STORE_COMMIT_DELAY_MS (by a
+ * low-priority commit task, not the esp_timer task), on
+ * nvs_store_flush(), or from a shutdown handler before esp_restart().
+ *
+ * To add a setting: add a key id here and a row to the field table in
+ * nvs_store.c.
+ */
+
+#define NVS_STORE_COMMIT_DELAY_MS  2000
+#define NVS_STORE_BLOB_MAX         512
+
+typedef enum {
+    NVS_KEY_WIFI_SSID,
+    NVS_KEY_WIFI_PASS,
+    NVS_KEY_BOOT_COUNT,
+    NVS_KEY_BOOT_RECORDS,
+    NVS_KEY_COUNT,
+} nvs_key_t;
+
+typedef struct {
+    uint32_t writes[NVS_KEY_COUNT]; /* nvs_set/erase per key since boot */
+    uint32_t commits;               /* nvs_commit() calls since boot */
+    uint32_t skipped;               /* sets equal to the cached value */
+    uint32_t errors;
+} nvs_store_stats_t;
+
+/* Initialises NVS, loads the mirror and increments the persisted boot
+ * counter (committed immediately). */
 esp_err_t nvs_store_init(void);
+
+/* Writes all dirty keys now. Dirty keys that fail stay dirty. */
+esp_err_t nvs_store_flush(void);
+
+esp_err_t nvs_store_set_str(nvs_key_t key, const char *value);
+bool      nvs_store_get_str(nvs_key_t key, char *out, size_t out_len);
+esp_err_t nvs_store_set_u32(nvs_key_t key, uint32_t value);
+uint32_t  nvs_store_get_u32(nvs_key_t key, uint32_t def);
+esp_err_t nvs_store_set_blob(nvs_key_t key, const void *data, size_t len);
+/* Copies the blob into out; returns its length, 0 if absent or too big. */
+size_t    nvs_store_get_blob(nvs_key_t key, void *out, size_t out_len);
+esp_err_t nvs_store_erase(nvs_key_t key);
+
+const char *nvs_store_key_name(nvs_key_t key);
+void        nvs_store_get_stats(nvs_store_stats_t *out);
+
+/* Convenience wrappers */
 esp_err_t nvs_store_set_wifi(const char *ssid, const char *password);
 bool      nvs_store_get_wifi(char *ssid, size_t ssid_len, char *password, size_t pass_len);
 esp_err_t nvs_store_erase_wifi(void);
+uint32_t  nvs_store_boot_count(void);
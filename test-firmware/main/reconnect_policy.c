@@ -0,0 +1,85 @@
+#include "reconnect_policy.h"
+#include <string.h>
+
+static uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* Uniform in [d/2, d]. */
+static uint32_t equal_jitter(reconnect_policy_t *p, uint32_t d)
+{
+    uint32_t half = d / 2;
+    return half + xorshift32(&p->rng) % (d - half + 1);
+}
+
+void reconnect_policy_init(reconnect_policy_t *p, const reconnect_cfg_t *cfg,
+                           uint32_t seed)
+{
+    memset(p, 0, sizeof(*p));
+    p->cfg = *cfg;
+    if (p->cfg.base_ms == 0) p->cfg.base_ms = 1;
+    if (p->cfg.max_ms < p->cfg.base_ms) p->cfg.max_ms = p->cfg.base_ms;
+    p->rng = seed ? seed : 0x9E3779B9u;
+}
+
+void reconnect_policy_connected(reconnect_policy_t *p, bool bssid_known,
+                                uint32_t now_ms)
+{
+    if (p->failures > 0) {
+        uint32_t outage = now_ms - p->outage_start_ms;
+        p->stats.last_outage_ms = outage;
+        if (outage > p->stats.longest_outage_ms) p->stats.longest_outage_ms = outage;
+    }
+    p->failures = 0;
+    p->backoff_step = 0;
+    p->fallback_done = false;
+    p->bssid_valid = bssid_known;
+}
+
+reconnect_action_t reconnect_policy_next(reconnect_policy_t *p, bool ap_lost,
+                                         uint32_t now_ms)
+{
+    reconnect_action_t act = { .kind = RECONNECT_BACKOFF };
+
+    if (p->failures == 0) {
+        p->stats.disconnects++;
+        p->outage_start_ms = now_ms;
+    }
+    p->failures++;
+    p->stats.attempts++;
+    if (ap_lost) p->bssid_valid = false;
+
+    if (p->failures == 1 && p->bssid_valid) {
+        /* Only worth one shot: if the pinned AP refuses us, fall back to
+         * scanning so a better (roamed-to) AP can be picked. */
+        p->bssid_valid = false;
+        act.kind = RECONNECT_FAST;
+        act.use_bssid = true;
+        p->stats.fast_attempts++;
+    } else if (p->cfg.fallback_after && !p->fallback_done &&
+               p->failures >= p->cfg.fallback_after) {
+        p->fallback_done = true;
+        act.kind = RECONNECT_FALLBACK;
+        act.delay_ms = equal_jitter(p, p->cfg.rescan_ms);
+        p->stats.fallbacks++;
+    } else if (p->backoff_step < p->cfg.max_retries) {
+        uint32_t d = p->cfg.base_ms;
+        for (uint32_t i = 0; i < p->backoff_step && d < p->cfg.max_ms; i++) d <<= 1;
+        if (d > p->cfg.max_ms) d = p->cfg.max_ms;
+        p->backoff_step++;
+        act.delay_ms = equal_jitter(p, d);
+    } else {
+        act.kind = RECONNECT_RESCAN;
+        act.delay_ms = equal_jitter(p, p->cfg.rescan_ms);
+        p->stats.rescans++;
+    }
+
+    p->stats.last_delay_ms = act.delay_ms;
+    return act;
+}
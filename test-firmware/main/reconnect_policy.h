@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * STA reconnect schedule — pure logic, no ESP-IDF dependencies, so it can be
+ * built and tested on the host (see host_test/).
+ *
+ * On every disconnect the caller asks for the next action:
+ *
+ *   1. First failure after a good link, cached BSSID still plausible:
+ *      reconnect immediately to that BSSID/channel (no scan).
+ *   2. Then jittered exponential backoff: base, 2*base, 4*base ... max,
+ *      each delay drawn uniformly from [d/2, d] ("equal jitter").
+ *   3. After max_retries backoff attempts, keep trying forever with a full
+ *      all-channel rescan every rescan_ms (jittered) instead of giving up.
+ *   4. Once fallback_after failures have accumulated, request the AP
+ *      provisioning fallback exactly once per outage (0 = never).
+ */
+
+typedef struct {
+    uint32_t base_ms;         /* first backoff delay */
+    uint32_t max_ms;          /* backoff cap */
+    uint32_t rescan_ms;       /* retry interval after the backoff budget */
+    uint16_t max_retries;     /* backoff attempts before periodic rescans */
+    uint16_t fallback_after;  /* failures before AP fallback, 0 = disabled */
+} reconnect_cfg_t;
+
+typedef enum {
+    RECONNECT_FAST = 0,       /* cached BSSID, no delay */
+    RECONNECT_BACKOFF,        /* full scan after backoff delay */
+    RECONNECT_RESCAN,         /* periodic full scan, budget exhausted */
+    RECONNECT_FALLBACK,       /* start AP provisioning, then rescan */
+} reconnect_kind_t;
+
+typedef struct {
+    reconnect_kind_t kind;
+    uint32_t delay_ms;
+    bool use_bssid;           /* pin cached BSSID + channel for this attempt */
+} reconnect_action_t;
+
+typedef struct {
+    uint32_t disconnects;     /* link losses (outages), not failed attempts */
+    uint32_t attempts;        /* reconnect attempts scheduled */
+    uint32_t fast_attempts;
+    uint32_t rescans;
+    uint32_t fallbacks;
+    uint32_t last_delay_ms;
+    uint32_t last_outage_ms;
+    uint32_t longest_outage_ms;
+} reconnect_stats_t;
+
+typedef struct {
+    reconnect_cfg_t cfg;
+    reconnect_stats_t stats;
+    uint32_t failures;        /* consecutive failures in the current outage */
+    uint32_t backoff_step;
+    uint32_t outage_start_ms;
+    uint32_t rng;
+    bool bssid_valid;
+    bool fallback_done;
+} reconnect_policy_t;
+
+void reconnect_policy_init(reconnect_policy_t *p, const reconnect_cfg_t *cfg,
+                           uint32_t seed);
+
+/* Link is up. Resets the schedule; *bssid_known* says whether the caller
+ * cached the AP's BSSID/channel for the fast path. */
+void reconnect_policy_connected(reconnect_policy_t *p, bool bssid_known,
+                                uint32_t now_ms);
+
+/* Link lost or an attempt failed. *ap_lost* means the AP itself vanished
+ * (beacon timeout, AP not found), which disqualifies the cached BSSID. */
+reconnect_action_t reconnect_policy_next(reconnect_policy_t *p, bool ap_lost,
+                                         uint32_t now_ms);
+
+static inline bool reconnect_policy_in_outage(const reconnect_policy_t *p)
+{
+    return p->failures > 0;
+}
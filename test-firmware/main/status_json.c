@@ -0,0 +1,154 @@
+#include "status_json.h"
+#include <string.h>
+
+/* Output cursor: counts every byte, stores those that fit. */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} out_t;
+
+static void put(out_t *o, const char *s, size_t n)
+{
+    if (o->len < o->size) {
+        size_t room = o->size - o->len;
+        memcpy(o->buf + o->len, s, n < room ? n : room);
+    }
+    o->len += n;
+}
+
+#define PUT_LIT(o, lit) put((o), (lit), sizeof(lit) - 1)
+
+static void put_u32(out_t *o, uint32_t v)
+{
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[sizeof(tmp) - 1 - n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    put(o, tmp + sizeof(tmp) - n, n);
+}
+
+/* Quoted string, escaped like cJSON: short escapes for the common control
+ * characters, \u00xx for the rest, bytes >= 0x80 passed through. */
+static void put_str(out_t *o, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    PUT_LIT(o, "\"");
+    const char *run = s = s ? s : "";
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        put(o, run, s - run);
+        run = s + 1;
+        char esc[6] = { '\\', 0 };
+        switch (c) {
+        case '"':  esc[1] = '"';  break;
+        case '\\': esc[1] = '\\'; break;
+        case '\b': esc[1] = 'b';  break;
+        case '\f': esc[1] = 'f';  break;
+        case '\n': esc[1] = 'n';  break;
+        case '\r': esc[1] = 'r';  break;
+        case '\t': esc[1] = 't';  break;
+        default:
+            memcpy(esc + 1, "u00", 3);
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0xf];
+            put(o, esc, 6);
+            continue;
+        }
+        put(o, esc, 2);
+    }
+    put(o, run, s - run);
+    PUT_LIT(o, "\"");
+}
+
+/* ,"key": — keys are literals here, so they need no escaping */
+static void put_key(out_t *o, bool first, const char *key)
+{
+    if (!first) PUT_LIT(o, ",");
+    PUT_LIT(o, "\"");
+    put(o, key, strlen(key));
+    PUT_LIT(o, "\":");
+}
+
+static void kv_u32(out_t *o, bool first, const char *key, uint32_t v)
+{
+    put_key(o, first, key);
+    put_u32(o, v);
+}
+
+static void kv_str(out_t *o, bool first, const char *key, const char *v)
+{
+    put_key(o, first, key);
+    put_str(o, v);
+}
+
+static void kv_bool(out_t *o, bool first, const char *key, bool v)
+{
+    put_key(o, first, key);
+    if (v) PUT_LIT(o, "true");
+    else   PUT_LIT(o, "false");
+}
+
+size_t status_json_render(const status_info_t *s, char *buf, size_t size)
+{
+    out_t o = { .buf = buf, .size = size ? size - 1 : 0, .len = 0 };
+
+    PUT_LIT(&o, "{");
+    kv_str(&o, true, "project", s->project);
+    kv_str(&o, false, "version", s->version);
+    kv_u32(&o, false, "boot_count", s->boot_count);
+    kv_bool(&o, false, "wifi_connected", s->wifi_connected);
+    kv_bool(&o, false, "ble_connected", s->ble_connected);
+
+    const reconnect_stats_t *rs = &s->reconnect;
+    put_key(&o, false, "reconnect");
+    PUT_LIT(&o, "{");
+    kv_u32(&o, true, "disconnects", rs->disconnects);
+    kv_u32(&o, false, "attempts", rs->attempts);
+    kv_u32(&o, false, "fast_attempts", rs->fast_attempts);
+    kv_u32(&o, false, "rescans", rs->rescans);
+    kv_u32(&o, false, "fallbacks", rs->fallbacks);
+    kv_u32(&o, false, "last_outage_ms", rs->last_outage_ms);
+    kv_u32(&o, false, "longest_outage_ms", rs->longest_outage_ms);
+    PUT_LIT(&o, "}");
+
+    put_key(&o, false, "nvs");
+    PUT_LIT(&o, "{");
+    kv_u32(&o, true, "commits", s->nvs_commits);
+    kv_u32(&o, false, "skipped", s->nvs_skipped);
+    kv_u32(&o, false, "errors", s->nvs_errors);
+    put_key(&o, false, "writes");
+    PUT_LIT(&o, "{");
+    for (int k = 0; k < s->nvs_keys; k++) {
+        put_key(&o, k == 0, s->nvs_key_names[k]);
+        put_u32(&o, s->nvs_writes[k]);
+    }
+    PUT_LIT(&o, "}}");
+
+    put_key(&o, false, "boots");
+    PUT_LIT(&o, "[");
+    for (int i = 0; i < s->boots_n; i++) {
+        const status_boot_t *b = &s->boots[i];
+        if (i) PUT_LIT(&o, ",");
+        PUT_LIT(&o, "{");
+        kv_u32(&o, true, "boot", b->boot);
+        kv_str(&o, false, "version", b->version);
+        kv_str(&o, false, "reset", b->reset);
+        kv_bool(&o, false, "after_crash", b->after_crash);
+        kv_u32(&o, false, "uptime_s", b->uptime_s);
+        kv_u32(&o, false, "heap_min_free", b->heap_min_free);
+        kv_u32(&o, false, "heap_peak_used", b->heap_peak_used);
+        kv_u32(&o, false, "stack_min", b->stack_min);
+        kv_str(&o, false, "stack_task", b->stack_task);
+        kv_u32(&o, false, "reconnects", b->reconnects);
+        kv_u32(&o, false, "udp_drops", b->udp_drops);
+        PUT_LIT(&o, "}");
+    }
+    PUT_LIT(&o, "]}");
+
+    if (size) buf[o.len < o.size ? o.len : o.size] = '\0';
+    return o.len;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "reconnect_policy.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Renders the GET /status body straight into a caller buffer, without a
+ * DOM or heap allocations. The output matches what the handler used to
+ * build with cJSON_PrintUnformatted(): same keys, same order, no spaces.
+ *
+ * The caller fills a snapshot with plain values (strings already resolved,
+ * e.g. reset reason names), so this file has no ESP-IDF dependencies and
+ * is built, tested and benchmarked on the host (see host_test/).
+ */
+
+typedef struct {
+    uint32_t boot;
+    const char *version;
+    const char *reset;          /* boot_record_reset_name() */
+    bool after_crash;
+    uint32_t uptime_s;
+    uint32_t heap_min_free;
+    uint32_t heap_peak_used;
+    uint32_t stack_min;
+    const char *stack_task;
+    uint32_t reconnects;
+    uint32_t udp_drops;
+} status_boot_t;
+
+typedef struct {
+    const char *project;
+    const char *version;
+    uint32_t boot_count;
+    bool wifi_connected;
+    bool ble_connected;
+    reconnect_stats_t reconnect;
+    uint32_t nvs_commits;
+    uint32_t nvs_skipped;
+    uint32_t nvs_errors;
+    const char *const *nvs_key_names;
+    const uint32_t *nvs_writes;     /* per key, nvs_keys entries */
+    int nvs_keys;
+    const status_boot_t *boots;     /* newest first */
+    int boots_n;
+} status_info_t;
+
+/* snprintf() semantics: returns the full body length (excluding the NUL)
+ * and writes at most size - 1 bytes plus a NUL. Render into a buffer of
+ * at least the returned length + 1 to get the whole body. */
+size_t status_json_render(const status_info_t *s, char *buf, size_t size);
@@ -1,4 +1,5 @@
 #include "udp_log.h"
+#include "udp_log_fmt.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -6,7 +7,6 @@
 #include "lwip/sockets.h"
 #include <string.h>
 #include <stdarg.h>
-#include <stdio.h>
 
 static const char *TAG = "udp_log";
 
@@ -16,22 +16,23 @@ static const char *TAG = "udp_log";
 static MessageBufferHandle_t s_msg_buf;
 static struct sockaddr_in s_dest_addr;
 static vprintf_like_t s_orig_vprintf;
+static volatile uint32_t s_dropped;
 
 static int udp_log_vprintf(const char *fmt, va_list args)
 {
-    /* Always print to serial */
-    int ret = s_orig_vprintf(fmt, args);
-
+    /* Format first: udp_log_format() works on a copy of args, while the
+     * serial vprintf consumes them. */
     if (s_msg_buf) {
         char buf[MAX_LOG_LINE];
-        int len = vsnprintf(buf, sizeof(buf), fmt, args);
-        if (len > 0) {
-            if (len >= (int)sizeof(buf)) len = sizeof(buf) - 1;
-            /* Non-blocking send — drop if buffer full */
-            xMessageBufferSendFromISR(s_msg_buf, buf, len, NULL);
+        size_t len = udp_log_format(buf, sizeof(buf), fmt, args);
+        /* Non-blocking send — drop if buffer full */
+        if (len && xMessageBufferSendFromISR(s_msg_buf, buf, len, NULL) == 0) {
+            s_dropped++;
         }
     }
-    return ret;
+
+    /* Always print to serial */
+    return s_orig_vprintf(fmt, args);
 }
 
 static void udp_sender_task(void *arg)
@@ -71,3 +72,8 @@ esp_err_t udp_log_init(const char *host, uint16_t port)
     ESP_LOGI(TAG, "UDP logging -> %s:%d", host, port);
     return ESP_OK;
 }
+
+uint32_t udp_log_dropped(void)
+{
+    return s_dropped;
+}
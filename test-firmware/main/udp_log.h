@@ -1,5 +1,9 @@
 #pragma once
 
 #include "esp_err.h"
+#include <stdint.h>
 
 esp_err_t udp_log_init(const char *host, uint16_t port);
+
+/* Lines dropped because the send buffer was full, since boot */
+uint32_t  udp_log_dropped(void);
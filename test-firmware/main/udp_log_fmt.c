@@ -0,0 +1,15 @@
+#include "udp_log_fmt.h"
+#include <stdio.h>
+
+size_t udp_log_format(char *buf, size_t size, const char *fmt, va_list args)
+{
+    if (size == 0) return 0;
+
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(buf, size, fmt, copy);
+    va_end(copy);
+
+    if (len <= 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/*
+ * Formats one log line for the UDP send queue. Like vsnprintf(), but works
+ * on a copy of *args*, so the caller can still hand the same va_list to the
+ * serial vprintf, and returns the number of bytes stored: the line is
+ * clamped to size - 1 and 0 means nothing to send (empty line or encoding
+ * error).
+ *
+ * Pure C with no ESP-IDF dependencies (host tests in host_test/).
+ */
+size_t udp_log_format(char *buf, size_t size, const char *fmt, va_list args);
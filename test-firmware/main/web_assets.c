@@ -0,0 +1,53 @@
+#include "web_assets.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "web_assets";
+
+static bool etag_matches(httpd_req_t *req, const char *etag)
+{
+    char inm[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) != ESP_OK) {
+        return false;
+    }
+    return strcmp(inm, "*") == 0 || strstr(inm, etag) != NULL;
+}
+
+static esp_err_t asset_get_handler(httpd_req_t *req)
+{
+    const web_asset_t *a = req->user_ctx;
+
+    httpd_resp_set_hdr(req, "ETag", a->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=3600");
+
+    if (etag_matches(req, a->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    /* gzip only: every browser (and captive-portal mini browser) accepts it,
+     * and a missing Accept-Encoding means any coding is acceptable */
+    httpd_resp_set_type(req, a->mime);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    return httpd_resp_send(req, (const char *)a->gz, a->gz_len);
+}
+
+esp_err_t web_assets_register(httpd_handle_t server)
+{
+    for (size_t i = 0; i < web_assets_count; i++) {
+        httpd_uri_t uri = {
+            .uri = web_assets[i].path,
+            .method = HTTP_GET,
+            .handler = asset_get_handler,
+            .user_ctx = (void *)&web_assets[i],
+        };
+        esp_err_t err = httpd_register_uri_handler(server, &uri);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register %s: %s", uri.uri, esp_err_to_name(err));
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "Serving %u embedded asset(s)", (unsigned)web_assets_count);
+    return ESP_OK;
+}
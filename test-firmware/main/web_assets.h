@@ -0,0 +1,31 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Embedded web UI assets.
+ *
+ * Everything under main/www/ is gzipped at build time by
+ * tools/embed_assets.py into a generated table; adding a page only means
+ * dropping a file into that folder (www/index.html is served as "/").
+ * Bodies are stored and sent gzip-only with a strong ETag, and matching
+ * If-None-Match requests get 304 Not Modified.
+ */
+
+typedef struct {
+    const char *path;       /* URL path, e.g. "/" or "/style.css" */
+    const char *mime;
+    const char *etag;       /* quoted, content hash */
+    const uint8_t *gz;
+    size_t gz_len;
+} web_asset_t;
+
+extern const web_asset_t web_assets[];
+extern const size_t web_assets_count;
+
+/* Register a GET handler for every asset. Each asset takes one of the
+ * server's max_uri_handlers slots. */
+esp_err_t web_assets_register(httpd_handle_t server);
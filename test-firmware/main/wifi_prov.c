@@ -1,6 +1,12 @@
 #include "wifi_prov.h"
 #include "nvs_store.h"
+#include "conn_state.h"
+#include "web_assets.h"
+#include "form_parser.h"
+#include "reconnect_policy.h"
 #include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_http_server.h"
@@ -8,22 +14,120 @@
 #include "esp_event.h"
 #include "lwip/inet.h"
 #include "dns_server.h"
-#include "cJSON.h"
 #include <string.h>
 #include <stdlib.h>
 
 static const char *TAG = "wifi_prov";
 
 #define AP_SSID        "WB-Test-Setup"
-#define STA_MAX_RETRY  20
+#define PORTAL_URL     "http://192.168.4.1/"
+#define CONNECT_BODY_MAX 1024  /* /connect: SSID + password, generously escaped */
 
-extern const char portal_html_start[] asm("_binary_portal_html_start");
-extern const char portal_html_end[]   asm("_binary_portal_html_end");
+/* STA reconnect schedule (see reconnect_policy.h) */
+#define STA_BACKOFF_BASE_MS   500
+#define STA_BACKOFF_MAX_MS    30000
+#define STA_BACKOFF_RETRIES   10
+#define STA_RESCAN_MS         60000
+#define STA_FALLBACK_AFTER    12    /* failed attempts before AP portal, 0 = never */
 
-static int s_retry_count = 0;
-static bool s_sta_connected = false;
-static bool s_ap_mode = false;
 static httpd_handle_t s_server = NULL;
+static dns_server_handle_t s_dns = NULL;
+static esp_netif_t *s_ap_netif = NULL;
+static bool s_fallback_active = false;
+
+static void start_fallback_ap(void);
+static void stop_fallback_ap(void);
+
+/* ── STA reconnect scheduler ───────────────────────────────────── */
+
+/* Policy and STA config state is only touched from the WiFi event task:
+ * the backoff timer posts WIFI_PROV_EVENT_RECONNECT instead of connecting
+ * itself. The lock only guards the stats snapshot taken by /status. */
+static ESP_EVENT_DEFINE_BASE(WIFI_PROV_EVENT);
+enum { WIFI_PROV_EVENT_RECONNECT };
+
+static reconnect_policy_t s_policy;
+static portMUX_TYPE s_policy_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_reconnect_timer = NULL;
+static wifi_config_t s_sta_cfg;
+static uint8_t s_ap_bssid[6];
+static uint8_t s_ap_channel = 0;
+static bool s_pending_use_bssid = false;
+static bool s_reconnect_pending = false;  /* timer armed */
+/* Bumped on every arm and posted with the event, so a post left queued by
+ * an earlier arm cannot fire the current one before its backoff ends */
+static volatile uint32_t s_reconnect_arm = 0;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+static void sta_connect(bool use_bssid)
+{
+    if (use_bssid && s_ap_channel) {
+        /* Fast path: skip the scan and rejoin the AP we just lost */
+        s_sta_cfg.sta.bssid_set = true;
+        memcpy(s_sta_cfg.sta.bssid, s_ap_bssid, sizeof(s_ap_bssid));
+        s_sta_cfg.sta.channel = s_ap_channel;
+        s_sta_cfg.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        /* Full scan, strongest AP wins — lets the DUT roam to another AP
+         * of the same ESS if the old one went away */
+        s_sta_cfg.sta.bssid_set = false;
+        s_sta_cfg.sta.channel = 0;
+        s_sta_cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        s_sta_cfg.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &s_sta_cfg);
+    esp_wifi_connect();
+}
+
+static void reconnect_timer_cb(void *arg)
+{
+    /* esp_timer task: hand over to the event task, which owns s_sta_cfg */
+    uint32_t arm = s_reconnect_arm;
+    if (esp_event_post(WIFI_PROV_EVENT, WIFI_PROV_EVENT_RECONNECT,
+                       &arm, sizeof(arm), 0) != ESP_OK) {
+        ESP_LOGW(TAG, "event queue full, retrying reconnect");
+        esp_timer_start_once(s_reconnect_timer, 100 * 1000);
+    }
+}
+
+static bool reason_ap_lost(uint8_t reason)
+{
+    return reason == WIFI_REASON_BEACON_TIMEOUT ||
+           reason == WIFI_REASON_NO_AP_FOUND;
+}
+
+static void schedule_reconnect(uint8_t reason)
+{
+    static const char *const kind_str[] = {
+        [RECONNECT_FAST] = "fast rejoin", [RECONNECT_BACKOFF] = "backoff",
+        [RECONNECT_RESCAN] = "rescan", [RECONNECT_FALLBACK] = "AP fallback",
+    };
+
+    portENTER_CRITICAL(&s_policy_lock);
+    reconnect_action_t act = reconnect_policy_next(&s_policy, reason_ap_lost(reason), now_ms());
+    uint32_t failures = s_policy.failures;
+    portEXIT_CRITICAL(&s_policy_lock);
+
+    ESP_LOGW(TAG, "STA disconnect (reason=%d), %s in %"PRIu32" ms (failure %"PRIu32")",
+             reason, kind_str[act.kind], act.delay_ms, failures);
+
+    if (act.kind == RECONNECT_FALLBACK) start_fallback_ap();
+
+    esp_timer_stop(s_reconnect_timer);
+    s_reconnect_pending = false;
+    if (act.delay_ms == 0) {
+        sta_connect(act.use_bssid);
+    } else {
+        s_pending_use_bssid = act.use_bssid;
+        s_reconnect_arm++;
+        s_reconnect_pending = true;
+        esp_timer_start_once(s_reconnect_timer, (uint64_t)act.delay_ms * 1000);
+    }
+}
 
 /* ── Event handlers ────────────────────────────────────────────── */
 
@@ -35,18 +139,16 @@ static void wifi_event_handler(void *arg, esp_event_base_t base,
         case WIFI_EVENT_STA_START:
             esp_wifi_connect();
             break;
+        case WIFI_EVENT_STA_CONNECTED: {
+            wifi_event_sta_connected_t *e = data;
+            memcpy(s_ap_bssid, e->bssid, sizeof(s_ap_bssid));
+            s_ap_channel = e->channel;
+            break;
+        }
         case WIFI_EVENT_STA_DISCONNECTED: {
             wifi_event_sta_disconnected_t *dis = data;
-            s_sta_connected = false;
-            if (s_retry_count < STA_MAX_RETRY) {
-                s_retry_count++;
-                ESP_LOGW(TAG, "STA disconnect (reason=%d), retry %d/%d",
-                         dis->reason, s_retry_count, STA_MAX_RETRY);
-                esp_wifi_connect();
-            } else {
-                ESP_LOGE(TAG, "STA failed after %d retries (last reason=%d)",
-                         STA_MAX_RETRY, dis->reason);
-            }
+            conn_state_clear(CONN_STA_UP);
+            schedule_reconnect(dis->reason);
             break;
         }
         case WIFI_EVENT_AP_STACONNECTED: {
@@ -60,91 +162,113 @@ static void wifi_event_handler(void *arg, esp_event_base_t base,
     } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t *e = data;
         ESP_LOGI(TAG, "STA got IP: " IPSTR, IP2STR(&e->ip_info.ip));
-        s_sta_connected = true;
-        s_retry_count = 0;
+        esp_timer_stop(s_reconnect_timer);
+        s_reconnect_pending = false;
+        portENTER_CRITICAL(&s_policy_lock);
+        reconnect_policy_connected(&s_policy, s_ap_channel != 0, now_ms());
+        portEXIT_CRITICAL(&s_policy_lock);
+        if (s_fallback_active) stop_fallback_ap();
+        conn_state_set(CONN_STA_UP);
+    } else if (base == WIFI_PROV_EVENT && id == WIFI_PROV_EVENT_RECONNECT) {
+        if (s_reconnect_pending && *(const uint32_t *)data == s_reconnect_arm) {
+            s_reconnect_pending = false;
+            sta_connect(s_pending_use_bssid);
+        }
     }
 }
 
 /* ── Captive portal HTTP handlers ──────────────────────────────── */
 
-static esp_err_t portal_get_handler(httpd_req_t *req)
+/* OS connectivity probes. Anything but the expected reply makes the OS
+ * open its captive-portal UI; a bare 302 to the portal does that on all of
+ * them in one small response, without the 404 path or a page body. */
+static const char *const s_probe_uris[] = {
+    "/generate_204", "/gen_204",                            /* Android, ChromeOS */
+    "/hotspot-detect.html", "/library/test/success.html",   /* Apple */
+    "/connecttest.txt", "/ncsi.txt", "/redirect",           /* Windows */
+    "/canonical.html", "/success.txt",                      /* Firefox */
+};
+#define PROBE_URI_COUNT (sizeof(s_probe_uris) / sizeof(s_probe_uris[0]))
+
+static esp_err_t probe_handler(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, portal_html_start, portal_html_end - portal_html_start);
+    httpd_resp_set_status(req, "302 Found");
+    httpd_resp_set_hdr(req, "Location", PORTAL_URL);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    httpd_resp_send(req, NULL, 0);
     return ESP_OK;
 }
 
-/* URL-decode a string in-place. Returns decoded length. */
-static int url_decode(char *s)
+static form_format_t body_format(httpd_req_t *req)
 {
-    char *dst = s;
-    for (const char *src = s; *src; src++) {
-        if (*src == '+') { *dst++ = ' '; }
-        else if (*src == '%' && src[1] && src[2]) {
-            char hex[3] = {src[1], src[2], 0};
-            *dst++ = (char)strtol(hex, NULL, 16);
-            src += 2;
-        } else { *dst++ = *src; }
-    }
-    *dst = '\0';
-    return (int)(dst - s);
-}
-
-/* Extract a value from URL-encoded form data: "key1=val1&key2=val2" */
-static bool form_get(const char *body, const char *key, char *out, size_t out_sz)
-{
-    size_t klen = strlen(key);
-    const char *p = body;
-    while ((p = strstr(p, key)) != NULL) {
-        if (p != body && *(p - 1) != '&') { p += klen; continue; }
-        if (p[klen] != '=') { p += klen; continue; }
-        p += klen + 1;
-        const char *end = strchr(p, '&');
-        size_t vlen = end ? (size_t)(end - p) : strlen(p);
-        if (vlen >= out_sz) vlen = out_sz - 1;
-        memcpy(out, p, vlen);
-        out[vlen] = '\0';
-        url_decode(out);
-        return true;
-    }
-    return false;
+    char ctype[48];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Content-Type", ctype, sizeof(ctype));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC) return FORM_FMT_AUTO;
+    if (strncmp(ctype, "application/json", 16) == 0) return FORM_FMT_JSON;
+    if (strncmp(ctype, "application/x-www-form-urlencoded", 33) == 0) return FORM_FMT_URLENCODED;
+    return FORM_FMT_AUTO;
 }
 
 static esp_err_t connect_post_handler(httpd_req_t *req)
 {
-    char buf[256];
-    int len = httpd_req_recv(req, buf, sizeof(buf) - 1);
-    if (len <= 0) {
+    if (req->content_len == 0) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No body");
         return ESP_FAIL;
     }
-    buf[len] = '\0';
-
-    char ssid_buf[33] = {0};
-    char pass_buf[65] = {0};
-    const char *ssid = NULL;
-    const char *pass = NULL;
-
-    /* Try JSON first, fall back to form-encoded */
-    cJSON *json = cJSON_Parse(buf);
-    if (json) {
-        ssid = cJSON_GetStringValue(cJSON_GetObjectItem(json, "ssid"));
-        pass = cJSON_GetStringValue(cJSON_GetObjectItem(json, "password"));
-    } else {
-        if (form_get(buf, "ssid", ssid_buf, sizeof(ssid_buf)))
-            ssid = ssid_buf;
-        form_get(buf, "password", pass_buf, sizeof(pass_buf));
-        pass = pass_buf;
+    if (req->content_len > CONNECT_BODY_MAX) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Body too large");
+        return ESP_FAIL;
+    }
+
+    char ssid[33];
+    char pass[65];
+    form_field_t fields[] = {
+        { .key = "ssid", .out = ssid, .out_size = sizeof(ssid) },
+        { .key = "password", .out = pass, .out_size = sizeof(pass) },
+    };
+    form_parser_t parser;
+    form_parser_init(&parser, body_format(req), fields, 2);
+
+    /* Stream the body through the parser; nothing is buffered whole */
+    char chunk[128];
+    size_t remaining = req->content_len;
+    int timeouts = 0;
+    while (remaining > 0) {
+        int n = httpd_req_recv(req, chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk));
+        if (n == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts < 3) {
+            continue;
+        }
+        if (n <= 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Incomplete body");
+            return ESP_FAIL;
+        }
+        if (!form_parser_feed(&parser, chunk, n)) {
+            break;
+        }
+        remaining -= n;
     }
 
-    if (!ssid || strlen(ssid) == 0) {
-        if (json) cJSON_Delete(json);
+    if (remaining > 0 || !form_parser_finish(&parser)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Malformed body");
+        return ESP_FAIL;
+    }
+    if (fields[0].overflow || fields[1].overflow) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SSID or password too long");
+        return ESP_FAIL;
+    }
+    if (!fields[0].found || ssid[0] == '\0') {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing SSID");
         return ESP_FAIL;
     }
 
-    nvs_store_set_wifi(ssid, pass ? pass : "");
-    if (json) cJSON_Delete(json);
+    /* Commit now rather than on the debounce timer: the reply tells the
+     * user the credentials are saved */
+    esp_err_t err = nvs_store_set_wifi(ssid, fields[1].found ? pass : "");
+    if (err == ESP_OK) err = nvs_store_flush();
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save credentials");
+        return ESP_FAIL;
+    }
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"status\":\"ok\",\"message\":\"Rebooting...\"}");
@@ -158,7 +282,7 @@ static esp_err_t connect_post_handler(httpd_req_t *req)
 static esp_err_t redirect_handler(httpd_req_t *req, httpd_err_code_t err)
 {
     httpd_resp_set_status(req, "302 Temporary Redirect");
-    httpd_resp_set_hdr(req, "Location", "/");
+    httpd_resp_set_hdr(req, "Location", PORTAL_URL);
     httpd_resp_send(req, "Redirect to captive portal", HTTPD_RESP_USE_STRLEN);
     return ESP_OK;
 }
@@ -167,6 +291,7 @@ static void start_portal_server(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.max_open_sockets = 7;
+    config.max_uri_handlers = 1 + PROBE_URI_COUNT + web_assets_count;
     config.lru_purge_enable = true;
 
     if (httpd_start(&s_server, &config) != ESP_OK) {
@@ -174,20 +299,82 @@ static void start_portal_server(void)
         return;
     }
 
-    static const httpd_uri_t portal_get = {
-        .uri = "/", .method = HTTP_GET, .handler = portal_get_handler
-    };
     static const httpd_uri_t connect_post = {
         .uri = "/connect", .method = HTTP_POST, .handler = connect_post_handler
     };
 
-    httpd_register_uri_handler(s_server, &portal_get);
+    web_assets_register(s_server);
     httpd_register_uri_handler(s_server, &connect_post);
+    for (size_t i = 0; i < PROBE_URI_COUNT; i++) {
+        httpd_uri_t probe = {
+            .uri = s_probe_uris[i], .method = HTTP_GET, .handler = probe_handler
+        };
+        httpd_register_uri_handler(s_server, &probe);
+    }
     httpd_register_err_handler(s_server, HTTPD_404_NOT_FOUND, redirect_handler);
 
     ESP_LOGI(TAG, "Portal HTTP server started");
 }
 
+/* ── AP portal (provisioning, or fallback while STA is down) ────── */
+
+static void set_ap_config(void)
+{
+    wifi_config_t wifi_cfg = {
+        .ap = {
+            .ssid = AP_SSID,
+            .ssid_len = strlen(AP_SSID),
+            .channel = 1,
+            .max_connection = 4,
+            .authmode = WIFI_AUTH_OPEN,
+        },
+    };
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_cfg));
+}
+
+static void start_ap_portal(void)
+{
+    /* Captive portal HTTP + DNS */
+    esp_log_level_set("httpd_uri", ESP_LOG_ERROR);
+    esp_log_level_set("httpd_txrx", ESP_LOG_ERROR);
+    esp_log_level_set("httpd_parse", ESP_LOG_ERROR);
+
+    start_portal_server();
+
+    dns_server_config_t dns_cfg = DNS_SERVER_CONFIG_SINGLE("*", "WIFI_AP_DEF");
+    s_dns = start_dns_server(&dns_cfg);
+}
+
+/* STA has been failing for STA_FALLBACK_AFTER attempts: bring up the
+ * provisioning portal next to it (APSTA) so the DUT can be re-provisioned
+ * without a serial console. STA retries continue in the background; note
+ * that its scans briefly take the AP off-channel. */
+static void start_fallback_ap(void)
+{
+    if (s_fallback_active) return;
+    ESP_LOGW(TAG, "STA still down, opening provisioning portal '%s'", AP_SSID);
+
+    if (!s_ap_netif) s_ap_netif = esp_netif_create_default_wifi_ap();
+    if (esp_wifi_set_mode(WIFI_MODE_APSTA) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to switch to APSTA");
+        return;
+    }
+    set_ap_config();
+    start_ap_portal();
+    s_fallback_active = true;
+    conn_state_set(CONN_AP_MODE);
+}
+
+static void stop_fallback_ap(void)
+{
+    ESP_LOGI(TAG, "STA recovered, closing fallback portal");
+    if (s_dns) { stop_dns_server(s_dns); s_dns = NULL; }
+    if (s_server) { httpd_stop(s_server); s_server = NULL; }
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    s_fallback_active = false;
+    conn_state_clear(CONN_AP_MODE);
+}
+
 /* ── STA mode ──────────────────────────────────────────────────── */
 
 static esp_err_t start_sta(const char *ssid, const char *password)
@@ -197,15 +384,33 @@ static esp_err_t start_sta(const char *ssid, const char *password)
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
+    const reconnect_cfg_t policy_cfg = {
+        .base_ms = STA_BACKOFF_BASE_MS,
+        .max_ms = STA_BACKOFF_MAX_MS,
+        .rescan_ms = STA_RESCAN_MS,
+        .max_retries = STA_BACKOFF_RETRIES,
+        .fallback_after = STA_FALLBACK_AFTER,
+    };
+    reconnect_policy_init(&s_policy, &policy_cfg, esp_random());
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = reconnect_timer_cb,
+        .name = "sta_reconnect",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_reconnect_timer));
+
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_PROV_EVENT, WIFI_PROV_EVENT_RECONNECT, wifi_event_handler, NULL));
 
-    wifi_config_t wifi_cfg = {};
-    strncpy((char *)wifi_cfg.sta.ssid, ssid, sizeof(wifi_cfg.sta.ssid) - 1);
-    strncpy((char *)wifi_cfg.sta.password, password, sizeof(wifi_cfg.sta.password) - 1);
+    memset(&s_sta_cfg, 0, sizeof(s_sta_cfg));
+    strncpy((char *)s_sta_cfg.sta.ssid, ssid, sizeof(s_sta_cfg.sta.ssid) - 1);
+    strncpy((char *)s_sta_cfg.sta.password, password, sizeof(s_sta_cfg.sta.password) - 1);
+    s_sta_cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    s_sta_cfg.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &s_sta_cfg));
     ESP_ERROR_CHECK(esp_wifi_start());
 
     wifi_mode_t mode;
@@ -218,7 +423,7 @@ static esp_err_t start_sta(const char *ssid, const char *password)
 
 static esp_err_t start_ap(void)
 {
-    esp_netif_create_default_wifi_ap();
+    s_ap_netif = esp_netif_create_default_wifi_ap();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
@@ -228,31 +433,13 @@ static esp_err_t start_ap(void)
                                                         &wifi_event_handler,
                                                         NULL, NULL));
 
-    wifi_config_t wifi_cfg = {
-        .ap = {
-            .ssid = AP_SSID,
-            .ssid_len = strlen(AP_SSID),
-            .channel = 1,
-            .max_connection = 4,
-            .authmode = WIFI_AUTH_OPEN,
-        },
-    };
-
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &wifi_cfg));
+    set_ap_config();
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "AP started: SSID='%s' channel=1 auth=OPEN", AP_SSID);
 
-    /* Captive portal HTTP + DNS */
-    esp_log_level_set("httpd_uri", ESP_LOG_ERROR);
-    esp_log_level_set("httpd_txrx", ESP_LOG_ERROR);
-    esp_log_level_set("httpd_parse", ESP_LOG_ERROR);
-
-    start_portal_server();
-
-    dns_server_config_t dns_cfg = DNS_SERVER_CONFIG_SINGLE("*", "WIFI_AP_DEF");
-    start_dns_server(&dns_cfg);
+    start_ap_portal();
 
     ESP_LOGI(TAG, "AP mode: SSID='%s', portal at 192.168.4.1", AP_SSID);
     return ESP_OK;
@@ -271,7 +458,7 @@ esp_err_t wifi_prov_init(void)
     }
 
     ESP_LOGI(TAG, "No WiFi credentials, starting AP provisioning");
-    s_ap_mode = true;
+    conn_state_set(CONN_AP_MODE);
     return start_ap();
 }
 
@@ -279,17 +466,25 @@ void wifi_prov_reset(void)
 {
     ESP_LOGW(TAG, "WiFi reset requested, erasing credentials and rebooting...");
     nvs_store_erase_wifi();
+    nvs_store_flush();
     vTaskDelay(pdMS_TO_TICKS(500));
     esp_restart();
 }
 
 bool wifi_prov_is_connected(void)
 {
-    return s_sta_connected;
+    return conn_state_is(CONN_STA_UP);
 }
 
 bool wifi_prov_is_ap_mode(void)
 {
-    return s_ap_mode;
+    return conn_state_is(CONN_AP_MODE);
+}
+
+void wifi_prov_get_reconnect_stats(reconnect_stats_t *out)
+{
+    portENTER_CRITICAL(&s_policy_lock);
+    *out = s_policy.stats;
+    portEXIT_CRITICAL(&s_policy_lock);
 }
 
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "esp_err.h"
+#include "reconnect_policy.h"
 #include <stdbool.h>
 
 esp_err_t wifi_prov_init(void);
 void      wifi_prov_reset(void);
 bool      wifi_prov_is_connected(void);
 bool      wifi_prov_is_ap_mode(void);
+void      wifi_prov_get_reconnect_stats(reconnect_stats_t *out);
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Compress the files under a web root and emit them as a C asset table.
+
+Every file becomes one entry of `web_assets[]` (see main/web_assets.h):
+URL path, MIME type, strong ETag and the gzip blob. `index.html` in any
+directory is served as that directory ("/", "/foo/"). Output is
+reproducible (gzip mtime 0, sorted walk), so unchanged assets give an
+identical image and identical ETags across builds.
+
+Usage: embed_assets.py <www_dir> <out.c>
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".htm": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".ico": "image/x-icon",
+    ".txt": "text/plain",
+}
+
+
+def collect(root):
+    assets = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in sorted(filenames):
+            if name.startswith("."):
+                continue
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, root).replace(os.sep, "/")
+            url = "/" + rel
+            if name == "index.html":
+                url = url[: -len("index.html")]
+            ext = os.path.splitext(name)[1].lower()
+            with open(full, "rb") as f:
+                data = f.read()
+            assets.append({
+                "url": url,
+                "mime": MIME_TYPES.get(ext, "application/octet-stream"),
+                "etag": '"%s"' % hashlib.sha256(data).hexdigest()[:16],
+                "raw_len": len(data),
+                "gz": gzip.compress(data, compresslevel=9, mtime=0),
+            })
+    assets.sort(key=lambda a: a["url"])
+    return assets
+
+
+def c_string(s):
+    return '"%s"' % s.replace("\\", "\\\\").replace('"', '\\"')
+
+
+def emit(assets, out):
+    lines = [
+        "/* Generated by tools/embed_assets.py -- do not edit. */",
+        "",
+        '#include "web_assets.h"',
+        "",
+    ]
+    for i, a in enumerate(assets):
+        lines.append("/* %s: %d -> %d bytes */" % (a["url"], a["raw_len"], len(a["gz"])))
+        lines.append("static const uint8_t s_asset_%d[] = {" % i)
+        gz = a["gz"]
+        for off in range(0, len(gz), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in gz[off:off + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+    lines.append("const web_asset_t web_assets[] = {")
+    for i, a in enumerate(assets):
+        lines.append("    { %s, %s, %s, s_asset_%d, sizeof(s_asset_%d) }," % (
+            c_string(a["url"]), c_string(a["mime"]), c_string(a["etag"]), i, i))
+    if not assets:
+        lines.append("    { 0 },")
+    lines.append("};")
+    lines.append("")
+    lines.append("const size_t web_assets_count = %d;" % len(assets))
+    lines.append("")
+
+    text = "\n".join(lines)
+    # Keep the content when nothing changed, but bump the mtime so make/ninja
+    # see the output as newer than its inputs and stop re-running us
+    try:
+        with open(out) as f:
+            if f.read() == text:
+                os.utime(out)
+                return
+    except OSError:
+        pass
+    with open(out, "w") as f:
+        f.write(text)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__.strip().splitlines()[-1])
+    assets = collect(sys.argv[1])
+    emit(assets, sys.argv[2])
+    total = sum(a["raw_len"] for a in assets)
+    packed = sum(len(a["gz"]) for a in assets)
+    print("embed_assets: %d file(s), %d -> %d bytes" % (len(assets), total, packed))
+
+
+if __name__ == "__main__":
+    main()